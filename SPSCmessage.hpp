@@ -0,0 +1,174 @@
+#ifndef SPSCMESSAGE_HPP
+#define SPSCMESSAGE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*
+SPSCmessage - a bounded lock-free queue between exactly one writing thread
+              and one reading thread, with the interface of TSmessage
+
+Values are moved in and out of a ring of Capacity slots, so neither side
+copies them or takes a lock while the queue is neither empty nor full. A
+side that must wait, for a value or for room, parks on a condition variable
+and the other side only locks to wake it when someone is parked.
+
+push, try_push and restart belong to the writer; try_pop, wait_and_pop and
+clear to the reader. The writer may also clear the queue while the reader
+is known not to be popping, e.g. while it is stopped, and the reader may
+restart it while the writer is known not to be pushing.
+
+Unlike TSmessage the queue is bounded, so a writer may wait too: shutting
+the queue down ends that wait, and the value pushed is dropped.
+ */
+template <class T, std::size_t Capacity = 1024>
+class SPSCmessage {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SPSCmessage capacity must be a power of two");
+    public:
+        SPSCmessage(): ring(Capacity) {}
+
+        SPSCmessage(const SPSCmessage &) = delete;
+        SPSCmessage & operator=(const SPSCmessage &) = delete;
+
+        // false if the queue is full
+        bool try_push(T && value){
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == Capacity)
+                return false;
+            ring[t & MASK] = std::move(value);
+            tail.store(t + 1, std::memory_order_seq_cst);
+            wake();
+            return true;
+        };
+
+        // wait for room if the queue is full; false, dropping the value, if
+        // the queue is shut down before there is room
+        bool push(T && value){
+            while (!try_push(std::move(value))){
+                if (stopped.load())
+                    return false;
+                park([this]{ return tail.load() - head.load() < Capacity || stopped.load(); });
+            }
+            return true;
+        };
+
+        bool push(const T & value){
+            return push(T(value));
+        };
+
+        bool empty() const{
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        };
+
+        // exact only on the side that is not moving its index
+        std::size_t size() const{
+            std::size_t h = head.load(std::memory_order_acquire);
+            return tail.load(std::memory_order_acquire) - h;
+        };
+
+        bool try_pop(T & value){
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+            value = std::move(ring[h & MASK]);
+            head.store(h + 1, std::memory_order_seq_cst);
+            wake();
+            return true;
+        };
+
+        // block until a value arrives, false if the queue was shut down first
+        bool wait_and_pop(T & value){
+            if (stopped.load())
+                return false;
+            if (try_pop(value))
+                return true;
+            park([this]{ return !empty() || stopped.load(); });
+            return !stopped.load() && try_pop(value);
+        };
+
+        // as wait_and_pop, also false if no value arrives within timeout
+        template <class Rep, class Period>
+        bool wait_and_pop(T & value, const std::chrono::duration<Rep, Period> & timeout){
+            if (stopped.load())
+                return false;
+            if (try_pop(value))
+                return true;
+            park([this]{ return !empty() || stopped.load(); }, timeout);
+            return !stopped.load() && try_pop(value);
+        };
+
+        // wake every waiting reader and writer, and stop waits from blocking;
+        // either side, or a third thread, may shut the queue down
+        void shutdown(){
+            stopped.store(true);
+            std::lock_guard<std::mutex> lock(mew);
+            cond.notify_all();
+        }
+
+        // let waits block again after a shutdown
+        void restart(){
+            stopped.store(false);
+        }
+
+        bool isShutdown() const{
+            return stopped.load();
+        }
+
+        void clear(){
+            T discard;
+            while (try_pop(discard)){
+            }
+        }
+
+    private:
+        static const std::size_t MASK = Capacity - 1;
+
+        std::vector<T> ring;
+
+        // each index is written by one side only, so keep them on separate
+        // cache lines (padded, since C++11 new ignores extended alignment)
+        char before_head[64];
+        std::atomic<std::size_t> head{0};
+        char before_tail[64];
+        std::atomic<std::size_t> tail{0};
+        char after_tail[64];
+
+        std::atomic<bool> stopped{false};
+        std::atomic<int> parked{0};
+        std::mutex mew;
+        std::condition_variable cond;
+
+        // the seq_cst index stores above order against the load of parked, so
+        // a side that parks either sees the change or is woken by it
+        void wake(){
+            if (parked.load(std::memory_order_seq_cst) > 0){
+                std::lock_guard<std::mutex> lock(mew);
+                cond.notify_all();
+            }
+        }
+
+        // wait until ready holds, ready is evaluated under the lock
+        template <class Ready>
+        void park(Ready ready){
+            std::unique_lock<std::mutex> lock(mew);
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            cond.wait(lock, ready);
+            parked.fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+        template <class Ready, class Rep, class Period>
+        void park(Ready ready, const std::chrono::duration<Rep, Period> & timeout){
+            std::unique_lock<std::mutex> lock(mew);
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            cond.wait_for(lock, timeout, ready);
+            parked.fetch_sub(1, std::memory_order_seq_cst);
+        }
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include "SPSCmessage.hpp"
+#include "expression.hpp"
+
+TEST_CASE( "Test SPSCmessage push and try pop", "[SPSCmessage]" ) {
+
+    typedef std::pair<std::string, Expression> Item;
+    SPSCmessage<Item, 4> myqueue;
+
+    REQUIRE(myqueue.empty());
+
+    Item a = {"rawr x3", Expression(Atom("uWu"))}, b;
+    REQUIRE_FALSE(myqueue.try_pop(b));
+    myqueue.push(a);
+    REQUIRE_FALSE(myqueue.empty());
+    REQUIRE(myqueue.try_pop(b));
+    REQUIRE(a == b);
+    REQUIRE(myqueue.empty());
+}
+
+TEST_CASE( "Test SPSCmessage moves values through", "[SPSCmessage]" ) {
+
+    SPSCmessage<std::unique_ptr<int>, 4> myqueue;
+
+    myqueue.push(std::unique_ptr<int>(new int(3)));
+    std::unique_ptr<int> value;
+    REQUIRE(myqueue.try_pop(value));
+    REQUIRE(*value == 3);
+}
+
+TEST_CASE( "Test SPSCmessage is bounded", "[SPSCmessage]" ) {
+
+    SPSCmessage<int, 2> myqueue;
+
+    REQUIRE(myqueue.try_push(1));
+    REQUIRE(myqueue.try_push(2));
+    REQUIRE_FALSE(myqueue.try_push(3));
+    REQUIRE(myqueue.size() == 2);
+
+    // the wrapped indices keep the order
+    int value = 0;
+    for(int i = 3; i < 10; ++i){
+      REQUIRE(myqueue.try_pop(value));
+      REQUIRE(value == i - 2);
+      REQUIRE(myqueue.try_push(int(i)));
+    }
+
+    myqueue.clear();
+    REQUIRE(myqueue.empty());
+}
+
+TEST_CASE( "Test SPSCmessage wait and pop", "[SPSCmessage]" ) {
+
+    SPSCmessage<int, 8> myqueue;
+    int value = 0;
+
+    REQUIRE_FALSE(myqueue.wait_and_pop(value, std::chrono::milliseconds(10)));
+
+    // a full queue blocks the writer until the reader makes room, and every
+    // value arrives once, in order
+    const int N = 10000;
+    std::thread writer([&myqueue]{
+        for(int i = 0; i < N; ++i){
+          myqueue.push(int(i));
+        }
+    });
+    bool ordered = true;
+    for(int i = 0; i < N; ++i){
+      REQUIRE(myqueue.wait_and_pop(value));
+      ordered = ordered && (value == i);
+    }
+    writer.join();
+    REQUIRE(ordered);
+    REQUIRE(myqueue.empty());
+}
+
+TEST_CASE( "Test SPSCmessage shutdown", "[SPSCmessage]" ) {
+
+    SPSCmessage<int, 4> myqueue;
+    int value = 0;
+
+    bool popped = true;
+    std::thread reader([&]{ popped = myqueue.wait_and_pop(value); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    myqueue.shutdown();
+    reader.join();
+    REQUIRE_FALSE(popped);
+    REQUIRE(myqueue.isShutdown());
+
+    myqueue.push(1);
+    REQUIRE_FALSE(myqueue.wait_and_pop(value));
+    myqueue.restart();
+    REQUIRE(myqueue.wait_and_pop(value));
+    REQUIRE(value == 1);
+}
+
+TEST_CASE( "Test SPSCmessage shutdown releases a writer waiting for room", "[SPSCmessage]" ) {
+
+    // a kernel whose results fill the output ring while nobody reads it
+    SPSCmessage<int, 4> input;
+    SPSCmessage<int, 4> output;
+    input.push(1);
+
+    bool delivered = true;
+    std::thread kernel([&]{
+        int line = 0;
+        while(input.wait_and_pop(line)){
+            for(int i = 0; i < 8 && delivered; ++i){
+                delivered = output.push(int(i));
+            }
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(output.size() == 4);
+
+    // stopping the kernel as the notebook does must not wait for a reader
+    input.shutdown();
+    output.shutdown();
+    kernel.join();
+    REQUIRE_FALSE(delivered);
+
+    // the values queued before the shutdown are still read, and pushes
+    // block again once the queue is restarted
+    int value = -1;
+    REQUIRE(output.try_pop(value));
+    REQUIRE(value == 0);
+    output.restart();
+    REQUIRE(output.push(4));
+    REQUIRE(output.size() == 4);
+}
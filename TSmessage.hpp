@@ -1,10 +1,20 @@
 #ifndef TSMESSAGE_HPP
 #define TSMESSAGE_HPP
 
+#include <cstddef>
 #include <queue>
+#include <utility>
 #include <mutex>
+#include <chrono>
 #include <condition_variable>
 
+/*
+TSmessage - a thread-safe queue passing messages between the UI and the
+            interpreter kernel, whose readers block without spinning
+
+Shutting the queue down wakes every waiting reader, and makes waits return
+false instead of blocking, until it is restarted.
+ */
 template <class T>
 class TSmessage {
     public:
@@ -15,29 +25,66 @@ class TSmessage {
             cond.notify_one();
         };
 
+        void push(T && value){
+            std::unique_lock<std::mutex> lock(mew);
+            quew.push(std::move(value));
+            lock.unlock();
+            cond.notify_one();
+        };
+
         bool empty() const{
             std::lock_guard<std::mutex> lock(mew);
             return quew.empty();
         };
 
+        std::size_t size() const{
+            std::lock_guard<std::mutex> lock(mew);
+            return quew.size();
+        };
+
         bool try_pop(T & value){
             std::lock_guard<std::mutex> lock(mew);
             if (quew.empty())
                 return false;
-            value = quew.front();
+            value = std::move(quew.front());
             quew.pop();
             return true;
         };
 
-        void wait_and_pop(T & value){
+        // block until a value arrives, false if the queue was shut down first
+        bool wait_and_pop(T & value){
             std::unique_lock<std::mutex> lock(mew);
-            while (quew.empty()) {
-                cond.wait(lock);
-            }
-            value = quew.front();
-            quew.pop();
+            cond.wait(lock, [this]{ return !quew.empty() || stopped; });
+            return pop_locked(value);
         };
 
+        // as wait_and_pop, also false if no value arrives within timeout
+        template <class Rep, class Period>
+        bool wait_and_pop(T & value, const std::chrono::duration<Rep, Period> & timeout){
+            std::unique_lock<std::mutex> lock(mew);
+            cond.wait_for(lock, timeout, [this]{ return !quew.empty() || stopped; });
+            return pop_locked(value);
+        };
+
+        // wake every waiting reader, and stop waits from blocking
+        void shutdown(){
+            std::unique_lock<std::mutex> lock(mew);
+            stopped = true;
+            lock.unlock();
+            cond.notify_all();
+        }
+
+        // let waits block again after a shutdown
+        void restart(){
+            std::lock_guard<std::mutex> lock(mew);
+            stopped = false;
+        }
+
+        bool isShutdown() const{
+            std::lock_guard<std::mutex> lock(mew);
+            return stopped;
+        }
+
         void clear(){
             std::lock_guard<std::mutex> lock(mew);
             while(!quew.empty()){
@@ -49,7 +96,17 @@ class TSmessage {
         std::queue<T> quew;
         mutable std::mutex mew;
         std::condition_variable cond;
+        bool stopped = false;
+
+        // a shut down queue hands out nothing, so the reader stops at once
+        bool pop_locked(T & value){
+            if (stopped || quew.empty())
+                return false;
+            value = std::move(quew.front());
+            quew.pop();
+            return true;
+        }
 };
 
 
-#endif
\ No newline at end of file
+#endif
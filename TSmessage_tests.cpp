@@ -1,5 +1,7 @@
 #include "catch.hpp"
 
+#include <chrono>
+#include <thread>
 #include <utility>
 #include "TSmessage.hpp"
 #include "expression.hpp"
@@ -21,6 +23,7 @@ TEST_CASE( "Test TSmessage push", "[TSmessage]" ) {
     myqueue.push(a);
 
     REQUIRE_FALSE(myqueue.empty());
+    REQUIRE(myqueue.size() == 1);
 }
 
 TEST_CASE( "Test TSmessage trypop", "[TSmessage]" ) {
@@ -62,3 +65,49 @@ TEST_CASE( "Test TSmessage clear", "[TSmessage]" ) {
     myqueue.clear();
     REQUIRE(myqueue.empty());
 }
+
+TEST_CASE( "Test TSmessage wait and pop with a timeout", "[TSmessage]" ) {
+
+    TSmessage<int> myqueue;
+    int value = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(myqueue.wait_and_pop(value, std::chrono::milliseconds(20)));
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+    myqueue.push(7);
+    REQUIRE(myqueue.wait_and_pop(value, std::chrono::milliseconds(20)));
+    REQUIRE(value == 7);
+
+    // a value pushed by another thread wakes the reader
+    std::thread writer([&myqueue]{
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        myqueue.push(8);
+    });
+    REQUIRE(myqueue.wait_and_pop(value, std::chrono::seconds(10)));
+    REQUIRE(value == 8);
+    writer.join();
+}
+
+TEST_CASE( "Test TSmessage shutdown", "[TSmessage]" ) {
+
+    TSmessage<int> myqueue;
+    int value = 0;
+
+    // shutting down wakes a blocked reader
+    bool popped = true;
+    std::thread reader([&]{ popped = myqueue.wait_and_pop(value); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    myqueue.shutdown();
+    reader.join();
+    REQUIRE_FALSE(popped);
+    REQUIRE(myqueue.isShutdown());
+
+    // and no wait blocks until the queue is restarted
+    myqueue.push(1);
+    REQUIRE_FALSE(myqueue.wait_and_pop(value));
+    myqueue.restart();
+    REQUIRE_FALSE(myqueue.isShutdown());
+    REQUIRE(myqueue.wait_and_pop(value));
+    REQUIRE(value == 1);
+}
@@ -0,0 +1,102 @@
+#include "arena.hpp"
+
+#include <algorithm>
+
+namespace {
+
+thread_local Arena * current_arena = nullptr;
+thread_local bool allocate_from_current = true;
+thread_local std::size_t allocation_count = 0;
+
+// every allocation is preceded by a header saying where it came from,
+// sized to keep the allocation itself maximally aligned
+const std::size_t HEADER = alignof(std::max_align_t) > sizeof(std::size_t) ?
+                           alignof(std::max_align_t) : sizeof(std::size_t);
+const std::size_t FROM_HEAP = 0;
+const std::size_t FROM_ARENA = 1;
+
+const std::size_t FIRST_BLOCK = 64 * 1024;
+const std::size_t MAX_BLOCK = 16 * 1024 * 1024;
+
+std::size_t round_up(std::size_t bytes){
+  return (bytes + HEADER - 1) / HEADER * HEADER;
+}
+
+}
+
+void * Arena::allocate(std::size_t bytes){
+
+  bytes = round_up(bytes);
+  if(static_cast<std::size_t>(limit - next) < bytes){
+    // blocks double in size, so a long evaluation holds few of them
+    std::size_t size = blocks.empty() ? FIRST_BLOCK : std::min(blocks.back().size * 2, MAX_BLOCK);
+    size = std::max(size, bytes);
+    blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+    next = blocks.back().memory.get();
+    limit = next + size;
+  }
+
+  void * result = next;
+  next += bytes;
+  bytes_used += bytes;
+  return result;
+}
+
+bool Arena::contains(const void * p) const noexcept{
+
+  const char * c = static_cast<const char *>(p);
+  // the newest block is the most likely, so search from the back
+  for(auto b = blocks.rbegin(); b != blocks.rend(); ++b){
+    const char * start = b->memory.get();
+    if(c >= start && c < start + b->size){
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t Arena::used() const noexcept{
+  return bytes_used;
+}
+
+Arena * Arena::current() noexcept{
+  return current_arena;
+}
+
+ArenaScope::ArenaScope(Arena * arena, bool allocate) noexcept:
+  previous(current_arena), previous_allocate(allocate_from_current){
+  current_arena = arena;
+  allocate_from_current = allocate;
+}
+
+ArenaScope::~ArenaScope(){
+  current_arena = previous;
+  allocate_from_current = previous_allocate;
+}
+
+void * arena_allocate(std::size_t bytes){
+
+  ++allocation_count;
+  char * block;
+  if(current_arena && allocate_from_current){
+    block = static_cast<char *>(current_arena->allocate(bytes + HEADER));
+    *reinterpret_cast<std::size_t *>(block) = FROM_ARENA;
+  }
+  else{
+    block = static_cast<char *>(::operator new(bytes + HEADER));
+    *reinterpret_cast<std::size_t *>(block) = FROM_HEAP;
+  }
+  return block + HEADER;
+}
+
+std::size_t arena_allocations() noexcept{
+  return allocation_count;
+}
+
+void arena_deallocate(void * p) noexcept{
+
+  char * block = static_cast<char *>(p) - HEADER;
+  if(*reinterpret_cast<std::size_t *>(block) == FROM_HEAP){
+    ::operator delete(block);
+  }
+}
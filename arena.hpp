@@ -0,0 +1,119 @@
+/*! \file arena.hpp
+Defines the arena used for the transient storage of an evaluation.
+
+While an Arena is current on a thread, the shared storage of the
+Expressions created on that thread is carved out of the arena instead of
+being allocated one block at a time, and freeing it costs nothing. All of
+the arena is released at once when it is destroyed, so a value that must
+outlive it, such as one stored in the global environment or returned to the
+caller, is first promoted to ordinary heap storage.
+
+Every block handed out by ArenaAllocator records where it came from, so it
+may be freed by any thread at any time, whether or not an arena is current.
+An Arena is not thread-safe, so other threads working for an evaluation
+make its arena current without allocating from it: their storage comes from
+the heap but is still promoted as if it were in the arena.
+ */
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/*! \class Arena
+\brief A bump allocator releasing all of its memory at once.
+*/
+class Arena {
+public:
+
+  /// Construct an empty arena, the first block is allocated on first use
+  Arena() = default;
+
+  Arena(const Arena &) = delete;
+  Arena & operator=(const Arena &) = delete;
+
+  /// allocate bytes, aligned for any type
+  void * allocate(std::size_t bytes);
+
+  /// predicate, p points into memory of this arena
+  bool contains(const void * p) const noexcept;
+
+  /// return the number of bytes handed out so far
+  std::size_t used() const noexcept;
+
+  /// return the arena current on the calling thread, or nullptr
+  static Arena * current() noexcept;
+
+private:
+
+  friend class ArenaScope;
+
+  struct Block {
+    std::unique_ptr<char[]> memory;
+    std::size_t size;
+  };
+
+  std::vector<Block> blocks;
+  char * next = nullptr;
+  char * limit = nullptr;
+  std::size_t bytes_used = 0;
+};
+
+/*! \class ArenaScope
+\brief Makes an arena current on the calling thread for its lifetime.
+
+Passing nullptr suspends the current arena, so that allocations in the
+scope go to the heap. With allocate false the arena is current but memory
+is drawn from the heap, which any thread may do.
+*/
+class ArenaScope {
+public:
+  explicit ArenaScope(Arena * arena, bool allocate = true) noexcept;
+  ~ArenaScope();
+
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope & operator=(const ArenaScope &) = delete;
+
+private:
+  Arena * previous;
+  bool previous_allocate;
+};
+
+/// allocate bytes from the current arena, or the heap if there is none
+void * arena_allocate(std::size_t bytes);
+
+/// return the number of allocations arena_allocate has made on the calling thread
+std::size_t arena_allocations() noexcept;
+
+/// free memory from arena_allocate, a no-op for arena memory
+void arena_deallocate(void * p) noexcept;
+
+/*! \class ArenaAllocator
+\brief A stateless allocator drawing from the current arena of the thread.
+*/
+template <class T>
+class ArenaAllocator {
+public:
+  typedef T value_type;
+
+  ArenaAllocator() noexcept {}
+  template <class U> ArenaAllocator(const ArenaAllocator<U> &) noexcept {}
+
+  T * allocate(std::size_t n){
+    return static_cast<T *>(arena_allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T * p, std::size_t) noexcept{
+    arena_deallocate(p);
+  }
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &, const ArenaAllocator<U> &) noexcept { return true; }
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &, const ArenaAllocator<U> &) noexcept { return false; }
+
+#endif
@@ -0,0 +1,101 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "arena.hpp"
+#include "expression.hpp"
+#include "interpreter.hpp"
+
+TEST_CASE( "Test arena allocation", "[arena]" ) {
+
+  Arena arena;
+  REQUIRE(arena.used() == 0);
+  REQUIRE(Arena::current() == nullptr);
+
+  {
+    ArenaScope scope(&arena);
+    REQUIRE(Arena::current() == &arena);
+
+    void * p = arena_allocate(24);
+    REQUIRE(arena.contains(p));
+    REQUIRE(reinterpret_cast<std::uintptr_t>(p) % alignof(std::max_align_t) == 0);
+    arena_deallocate(p);
+
+    // larger than any block, still served by the arena
+    void * big = arena_allocate(32 * 1024 * 1024);
+    REQUIRE(arena.contains(big));
+
+    {
+      ArenaScope suspend(nullptr);
+      REQUIRE(Arena::current() == nullptr);
+      void * q = arena_allocate(24);
+      REQUIRE(!arena.contains(q));
+      arena_deallocate(q);
+    }
+
+    {
+      ArenaScope on_behalf(&arena, false);
+      REQUIRE(Arena::current() == &arena);
+      void * q = arena_allocate(24);
+      REQUIRE(!arena.contains(q));
+      arena_deallocate(q);
+    }
+    REQUIRE(Arena::current() == &arena);
+  }
+
+  REQUIRE(Arena::current() == nullptr);
+  REQUIRE(arena.used() > 32 * 1024 * 1024);
+}
+
+TEST_CASE( "Test promoting expressions out of an arena", "[arena]" ) {
+
+  Expression kept;
+  Expression expected(std::vector<Expression>{Expression(Atom(1.)),
+        Expression(std::vector<Expression>{Expression(Atom("\"a\"")), Expression(Atom(2.))})});
+  {
+    Arena arena;
+    ArenaScope scope(&arena);
+
+    Expression inner(std::vector<Expression>{Expression(Atom("\"a\"")), Expression(Atom(2.))});
+    Expression outer(std::vector<Expression>{Expression(Atom(1.)), inner});
+    REQUIRE(outer.inArena(arena));
+
+    kept = outer;
+    promote_to_heap(kept);
+    REQUIRE(!kept.inArena(arena));
+    REQUIRE(!kept.contents()[1].inArena(arena));
+    REQUIRE(kept == outer);
+
+    // expressions already on the heap are left shared
+    Expression shared(expected);
+    promote_to_heap(shared);
+    REQUIRE(!shared.inArena(arena));
+  }
+
+  REQUIRE(kept == expected);
+}
+
+TEST_CASE( "Test definitions outlive the arena of their evaluation", "[arena]" ) {
+
+  for(auto backend : {Interpreter::Backend::TreeWalker, Interpreter::Backend::Bytecode}){
+    Interpreter interp;
+    interp.setBackend(backend);
+
+    std::istringstream first("(begin (define a (list 1 (list \"b\" 2))) "
+                             "(define f (lambda (x) (list x a))) (f 3))");
+    REQUIRE(interp.parseStream(first));
+    Expression result = interp.evaluate();
+
+    std::istringstream second("(list (f 3) (first (f 4)) a)");
+    REQUIRE(interp.parseStream(second));
+    Expression later = interp.evaluate();
+
+    std::istringstream expected_program("(list (list 3 (list 1 (list \"b\" 2))) 4 (list 1 (list \"b\" 2)))");
+    Interpreter reference;
+    REQUIRE(reference.parseStream(expected_program));
+    REQUIRE(later == reference.evaluate());
+    REQUIRE(result == later.contents()[0]);
+  }
+}
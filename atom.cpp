@@ -1,10 +1,14 @@
 #include "atom.hpp"
 
+#include <cstdint>
+#include <functional>
+#include <locale>
+
 Atom::Atom() {
   m_type = Type::NoneKind;
 }
 
-Atom::Atom(double value){
+Atom::Atom(double value): Atom() {
   setNumber(value);
 }
 
@@ -12,10 +16,97 @@ Atom::Atom(std::complex<double> value): Atom() {
   setComplex(value);
 }
 
+namespace {
+
+// the powers of ten that are exactly representable as a double
+const double EXACT_POWERS_OF_TEN[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Convert a decimal literal filling [p, end) when the conversion is one
+   correctly rounded multiply or divide (Clinger's fast path): an integer
+   mantissa of at most 2^53 scaled by an exact power of ten. Returns false
+   for anything else, which the caller parses the slow way. */
+bool parse_fast_decimal(const char * p, const char * end, double & value){
+
+  bool negative = false;
+  if(p != end && (*p == '+' || *p == '-')){
+    negative = (*p == '-');
+    ++p;
+  }
+
+  std::uint64_t mantissa = 0;
+  int significant = 0, exponent = 0;
+  bool any_digit = false;
+
+  auto digit = [&](char c){
+    any_digit = true;
+    if(mantissa != 0 || c != '0'){
+      ++significant;
+    }
+    mantissa = mantissa * 10 + static_cast<std::uint64_t>(c - '0');
+  };
+
+  for(; p != end && std::isdigit(static_cast<unsigned char>(*p)) && significant < 19; ++p){
+    digit(*p);
+  }
+  if(p != end && *p == '.'){
+    for(++p; p != end && std::isdigit(static_cast<unsigned char>(*p)) && significant < 19; ++p){
+      digit(*p);
+      --exponent;
+    }
+  }
+  if(!any_digit){
+    return false;
+  }
+
+  if(p != end && (*p == 'e' || *p == 'E')){
+    ++p;
+    bool negative_exponent = false;
+    if(p != end && (*p == '+' || *p == '-')){
+      negative_exponent = (*p == '-');
+      ++p;
+    }
+    if(p == end){
+      return false;
+    }
+    int written = 0;
+    for(; p != end && std::isdigit(static_cast<unsigned char>(*p)) && written < 1000; ++p){
+      written = written * 10 + (*p - '0');
+    }
+    exponent += negative_exponent ? -written : written;
+  }
+
+  // trailing text, too many digits or a huge exponent take the slow path
+  const std::uint64_t max_exact = std::uint64_t(1) << 53;
+  if(p != end || mantissa > max_exact || exponent < -22 || exponent > 22){
+    return false;
+  }
+
+  double result = static_cast<double>(mantissa);
+  result = exponent < 0 ? result / EXACT_POWERS_OF_TEN[-exponent] :
+                          result * EXACT_POWERS_OF_TEN[exponent];
+  value = negative ? -result : result;
+  return true;
+}
+
+}
+
 Atom::Atom(const Token & token): Atom(){
 
-  std::istringstream iss(token.asString());
+  const char * text = token.data();
   double temp;
+  if(parse_fast_decimal(text, text + token.size(), temp)){
+    setNumber(temp);
+    return;
+  }
+
+  // everything else goes through a stream fixed to the classic locale, so
+  // that the result does not depend on the locale of the process
+  std::string value = token.asString();
+  std::istringstream iss(value);
+  iss.imbue(std::locale::classic());
   if(iss >> temp){
     // is token a number?
     // check for trailing characters if >> succeeds
@@ -23,9 +114,9 @@ Atom::Atom(const Token & token): Atom(){
       setNumber(temp);
     }
   }
-  else if(!std::isdigit(token.asString()[0]) ){ 
+  else if(!std::isdigit(value[0]) ){ 
       // else assume symbol
-      setSymbol(token.asString());
+      setSymbol(value);
   }
 }
 
@@ -34,43 +125,39 @@ Atom::Atom(const std::string & value): Atom() {
 }
 
 Atom::Atom(const Atom & x): Atom(){
+  copy(x);
+}
 
-  if(x.isNumber()){
-    setNumber(x.numberValue);
-  }
-  else if(x.isSymbol() || x.isString()){
-    setSymbol(x.stringValue);
-  }
-  else if(x.isComplex()){
-    setComplex(x.complexValue);
+Atom & Atom::operator=(const Atom & x){
+
+  if(this != &x){
+    copy(x);
   }
+  return *this;
 }
 
-Atom & Atom::operator=(const Atom & x){
+Atom::Atom(Atom && x) noexcept: Atom(){
+  *this = std::move(x);
+}
+
+Atom & Atom::operator=(Atom && x) noexcept{
 
   if(this != &x){
-    if(x.m_type == NoneKind){
-      m_type = NoneKind;
+    if(x.m_type == StringKind){
+      clear();
+      new (&stringValue) std::shared_ptr<const std::string>(std::move(x.stringValue));
+      m_type = StringKind;
     }
-    else if(x.m_type == NumberKind){
-      setNumber(x.numberValue);
-    }
-    else if(x.m_type == SymbolKind){
-      setSymbol(x.stringValue);
-    }
-    else if(x.m_type == ComplexKind){
-      setComplex(x.complexValue);
+    else{
+      // the remaining kinds are trivially copyable
+      copy(x);
     }
   }
   return *this;
 }
 
 Atom::~Atom(){
-
-  //ensure the destructor of the symbol string is called
-  if(m_type == SymbolKind){
-    stringValue.~basic_string();
-  }
+  clear();
 }
 
 bool Atom::isNone() const noexcept{
@@ -82,7 +169,7 @@ bool Atom::isNumber() const noexcept{
 }
 
 bool Atom::isSymbol() const noexcept{
-  return (m_type == SymbolKind && stringValue[0] != '"');
+  return m_type == SymbolKind;
 }
 
 bool Atom::isComplex() const noexcept{
@@ -90,29 +177,77 @@ bool Atom::isComplex() const noexcept{
 }
 
 bool Atom::isString() const noexcept{
-  return m_type == SymbolKind && stringValue[0] == '"';
+  return m_type == StringKind;
+}
+
+void Atom::clear() noexcept{
+
+  //ensure the destructor of the string is called
+  if(m_type == StringKind){
+    stringValue.~shared_ptr();
+  }
+  m_type = NoneKind;
+}
+
+void Atom::copy(const Atom & x){
+
+  switch(x.m_type){
+    case NumberKind:
+      setNumber(x.numberValue);
+      break;
+    case SymbolKind:
+      clear();
+      m_type = SymbolKind;
+      symbolValue = x.symbolValue;
+      break;
+    case StringKind:
+      setString(x.stringValue);
+      break;
+    case ComplexKind:
+      setComplex(x.complexValue);
+      break;
+    default:
+      clear();
+      break;
+  }
 }
 
 void Atom::setNumber(double value){
 
+  clear();
   m_type = NumberKind;
   numberValue = value;
 }
 
 void Atom::setSymbol(const std::string & value){
 
-  // we need to ensure the destructor of the symbol string is called
-  if(m_type == SymbolKind){
-    stringValue.~basic_string();
+  // strings keep their quotes and are not interned
+  if(!value.empty() && value[0] == '"'){
+    setString(std::make_shared<const std::string>(value));
+    return;
   }
 
+  clear();
   m_type = SymbolKind;
+  symbolValue.id = SymbolTable::intern(value, symbolValue.name);
+}
+
+void Atom::setString(const std::shared_ptr<const std::string> & value){
 
+  if(m_type == StringKind){
+    stringValue = value;
+    return;
+  }
+
+  clear();
   // copy construct in place
-  new (&stringValue) std::string(value);
+  new (&stringValue) std::shared_ptr<const std::string>(value);
+  m_type = StringKind;
 }
 
 void Atom::setComplex(const std::complex<double> & value){
+
+  clear();
   m_type = ComplexKind;
   complexValue = value;
 }
@@ -130,7 +265,10 @@ std::string Atom::asSymbol() const noexcept{
   std::string s;
 
   if(m_type == SymbolKind){
-    s = stringValue;
+    s = *symbolValue.name;
+  }
+  else if(m_type == StringKind){
+    s = *stringValue;
     s.erase(remove( s.begin(), s.end(), '\"' ),s.end());
   }
 
@@ -139,12 +277,17 @@ std::string Atom::asSymbol() const noexcept{
 
 std::string Atom::asString() const noexcept{
 
-  std::ostringstream os;
-
+  // only the numbers need formatting
   if(m_type == SymbolKind){
-    os << stringValue;
+    return *symbolValue.name;
   }
-  else if (m_type == NumberKind){
+  if(m_type == StringKind){
+    return *stringValue;
+  }
+
+  std::ostringstream os;
+
+  if (m_type == NumberKind){
     os << numberValue;
   }
   else if (m_type == ComplexKind){
@@ -162,6 +305,31 @@ std::complex<double> Atom::asComplex() const noexcept{
   return (m_type == ComplexKind) ? complexValue : (std::complex<double>)(0);
 }
 
+SymbolId Atom::symbolId() const noexcept{
+  return m_type == SymbolKind ? symbolValue.id : NoSymbol;
+}
+
+SpecialForm Atom::specialForm() const noexcept{
+  SymbolId id = symbolId();
+  return (id < NumSpecialForms) ? static_cast<SpecialForm>(id) : NotSpecialForm;
+}
+
+bool Atom::isStringOf(const std::string & text) const noexcept{
+  return m_type == StringKind && *stringValue == text;
+}
+
+std::size_t Atom::hash() const noexcept{
+
+  switch(m_type){
+    case SymbolKind:
+      return (static_cast<std::size_t>(symbolValue.id) << 3) | SymbolKind;
+    case StringKind:
+      return (std::hash<std::string>()(*stringValue) << 3) | StringKind;
+    default:
+      return m_type;
+  }
+}
+
 bool Atom::operator==(const Atom & right) const noexcept{
 
   if(m_type != right.m_type) return false;
@@ -181,11 +349,9 @@ bool Atom::operator==(const Atom & right) const noexcept{
       }
       break;
     case SymbolKind:
-      {
-        if(right.m_type != SymbolKind) return false;
-        return stringValue == right.stringValue;
-      }
-      break;
+      return symbolValue.id == right.symbolValue.id;
+    case StringKind:
+      return stringValue == right.stringValue || *stringValue == *right.stringValue;
     case ComplexKind:
     {
       if(right.m_type != ComplexKind) return false;
@@ -221,3 +387,19 @@ std::ostream & operator<<(std::ostream & out, const Atom & a){
   }
   return out;
 }
+
+bool parse_number(const char * begin, const char * end, double & value){
+
+  if(parse_fast_decimal(begin, end, value)){
+    return true;
+  }
+
+  std::istringstream iss(std::string(begin, end));
+  iss.imbue(std::locale::classic());
+  double temp;
+  if(begin == end || !(iss >> temp) || iss.rdbuf()->in_avail() != 0){
+    return false;
+  }
+  value = temp;
+  return true;
+}
@@ -6,17 +6,24 @@ Defines the Atom type and associated functions.
 #define ATOM_HPP
 
 #include "token.hpp"
+#include "symbol_table.hpp"
 #include <complex>
 #include <limits>
+#include <memory>
+#include <string>
 #include <sstream>
 #include <cctype>
 #include <cmath>
 #include <algorithm>
 
 /*! \class Atom
-\brief A variant type that may be a Number or Symbol or the default type None.
+\brief A variant type that may be a Number, Complex, Symbol, String or the
+default type None.
 
-This class provides value semantics.
+This class provides value semantics. An Atom is three words wide: a symbol
+is its interned identifier and a pointer to the name kept by the symbol
+table, and a string is a pointer to text shared by the copies of the atom,
+so copying neither allocates.
 */
 class Atom {
 public:
@@ -39,9 +46,15 @@ public:
   /// Copy-construct an Atom
   Atom(const Atom & x);
 
+  /// Move-construct an Atom
+  Atom(Atom && x) noexcept;
+
   /// Assign an Atom
   Atom & operator=(const Atom & x);
 
+  /// Move-assign an Atom
+  Atom & operator=(Atom && x) noexcept;
+
   /// Atom destructor
   ~Atom();
 
@@ -72,34 +85,63 @@ public:
   /// value of Atom as a comlex number, returns 0 if not a complex number
   std::complex<double> asComplex() const noexcept;
 
+  /// interned identifier of a Symbol, returns NoSymbol if not a Symbol
+  SymbolId symbolId() const noexcept;
+
+  /// special form named by a Symbol, returns NotSpecialForm otherwise
+  SpecialForm specialForm() const noexcept;
+
+  /// predicate, the Atom is a String whose text, with its quotes, is text
+  bool isStringOf(const std::string & text) const noexcept;
+
+  /// hash consistent with ==: numbers, compared within a tolerance, hash by type only
+  std::size_t hash() const noexcept;
+
   /// equality comparison based on type and value
   bool operator==(const Atom & right) const noexcept;
 
 private:
 
   // internal enum of known types
-  enum Type {NoneKind, NumberKind, SymbolKind, ComplexKind};
+  enum Type {NoneKind, NumberKind, SymbolKind, StringKind, ComplexKind};
 
   // track the type
   Type m_type;
 
+  // an interned symbol, whose name lives as long as the symbol table
+  struct Symbol {
+    SymbolId id;
+    const std::string * name;
+  };
+
   // values for the known types. Note the use of a union requires care
-  // when setting non POD values (see setSymbol)
+  // when setting non POD values (see setString)
   union {
     double numberValue;
-    std::string stringValue;
     std::complex<double> complexValue;
+    Symbol symbolValue;
+    // the text of a string, with its quotes, never modified once made
+    std::shared_ptr<const std::string> stringValue;
   };
 
+  // helper to destroy the value, leaving an Atom of type None
+  void clear() noexcept;
+
   // helper to set type and value of Number
   void setNumber(double value);
 
-  // helper to set type and value of Symbol
+  // helper to set type and value of Symbol, or of String if value is quoted
   void setSymbol(const std::string & value);
 
+  // helper to set type and value of String
+  void setString(const std::shared_ptr<const std::string> & value);
+
   // helper to set type and value of a Complex Number
   void setComplex(const std::complex<double> & value);
 
+  // helper to copy the value of another Atom
+  void copy(const Atom & x);
+
 };
 
 /// inequality comparison for Atom
@@ -108,4 +150,12 @@ bool operator!=(const Atom &left, const Atom & right) noexcept;
 /// output stream rendering
 std::ostream & operator<<(std::ostream & out, const Atom & a);
 
+/*! Convert text to a number as the tokenizer does, whatever the locale.
+  \param begin the start of the text
+  \param end one past the end of the text
+  \param value set to the number, if the text is one
+  \return true if the whole text is a number
+ */
+bool parse_number(const char * begin, const char * end, double & value);
+
 #endif
@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include "atom.hpp"
+#include <cstdlib>
 
 TEST_CASE( "Test atom constructors", "[atom]" ) {
 
@@ -283,3 +284,65 @@ TEST_CASE( "Test atom comparisons", "[atom]" ) {
 
 
 
+
+TEST_CASE( "Test atom number parsing from tokens", "[atom]" ) {
+
+  // the fast path must agree with a full conversion, bit for bit
+  const char * numbers[] = {
+    "0", "-0", "1", "+5", "-12.5", ".5", "1.", "0.1", "3.14159", "1e3", "1E-3",
+    "123456789012345", "0.000000000000000000001", "9007199254740993",
+    "1234567890123456789012", "1e300", "2.2250738585072014e-308"
+  };
+  for(auto text : numbers){
+    INFO(text);
+    Atom a{Token(text)};
+    REQUIRE(a.isNumber());
+    REQUIRE(a.asNumber() == std::strtod(text, nullptr));
+  }
+
+  REQUIRE(Atom(Token("-")).isSymbol());
+  REQUIRE(Atom(Token(".")).isSymbol());
+  REQUIRE(Atom(Token("e5")).isSymbol());
+  REQUIRE(Atom(Token("1abc")).isNone());
+  REQUIRE(Atom(Token("1e")).isNone());
+  REQUIRE(Atom(Token("\"12\"")).isString());
+
+  // tokens viewing a buffer convert the same way
+  const char buffer[] = "2.5x";
+  REQUIRE(Atom(Token(buffer, 3)) == Atom(2.5));
+}
+
+TEST_CASE( "Test atom strings and symbols are distinct kinds", "[atom]" ) {
+
+  Atom symbol("text");
+  Atom string("\"text\"");
+  REQUIRE(symbol.isSymbol());
+  REQUIRE(!symbol.isString());
+  REQUIRE(string.isString());
+  REQUIRE(!string.isSymbol());
+  REQUIRE(symbol != string);
+  REQUIRE(string.symbolId() == NoSymbol);
+  REQUIRE(string.specialForm() == NotSpecialForm);
+  REQUIRE(string.asString() == "\"text\"");
+  REQUIRE(string.asSymbol() == "text");
+  REQUIRE(symbol.asString() == "text");
+
+  // copies of a string compare equal, as do strings made apart
+  Atom copy(string);
+  REQUIRE(copy.isString());
+  REQUIRE(copy == string);
+  REQUIRE(Atom("\"text\"") == string);
+
+  // an atom changes kind on assignment, in either direction
+  copy = symbol;
+  REQUIRE(copy.isSymbol());
+  REQUIRE(copy == symbol);
+  copy = Atom(1.0);
+  REQUIRE(copy.isNumber());
+  copy = std::move(string);
+  REQUIRE(copy.isString());
+  REQUIRE(copy.asString() == "\"text\"");
+
+  // no kind needs more than three words
+  REQUIRE(sizeof(Atom) <= 3 * sizeof(double));
+}
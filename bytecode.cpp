@@ -0,0 +1,283 @@
+#include "bytecode.hpp"
+
+#include <unordered_map>
+
+namespace {
+
+/*! Lowers Expressions into one Chunk. The messages, and the order in which
+  checks are made, mirror the handle_* members of Expression so that a
+  compiled program fails the same way the tree-walker would.
+ */
+class Compiler {
+public:
+
+  Compiler(const Environment & env, Chunk & chunk, bool in_lambda):
+    env(env), chunk(chunk), in_lambda(in_lambda)
+  {}
+
+  // compile e so that it leaves one value on the stack, return false if the
+  // tree-walker is needed inside a lambda
+  bool compile(const Expression & e);
+
+private:
+
+  const Environment & env;
+  Chunk & chunk;
+  bool in_lambda;
+  std::unordered_map<SymbolId, std::uint32_t> name_index;
+
+  void emit(OpCode op, std::uint32_t a = 0, std::uint32_t b = 0){
+    chunk.code.push_back(Instruction{op, a, b});
+  }
+
+  std::uint32_t constant(const Expression & e){
+    chunk.constants.push_back(e);
+    return static_cast<std::uint32_t>(chunk.constants.size() - 1);
+  }
+
+  std::uint32_t message(const std::string & text){
+    chunk.messages.push_back(text);
+    return static_cast<std::uint32_t>(chunk.messages.size() - 1);
+  }
+
+  std::uint32_t name(const Atom & sym){
+    bool interned = sym.symbolId() != NoSymbol;
+    auto found = name_index.find(sym.symbolId());
+    if(interned && found != name_index.end()){
+      return found->second;
+    }
+    chunk.names.push_back(sym);
+    const Environment::EnvResult * binding = env.lookup(sym);
+    bool proc = binding != nullptr && binding->type == Environment::ProcedureType;
+    chunk.procs.push_back(proc ? binding->proc : nullptr);
+    chunk.hints.emplace_back();
+    std::uint32_t index = static_cast<std::uint32_t>(chunk.names.size() - 1);
+    if(interned) name_index.emplace(sym.symbolId(), index);
+    return index;
+  }
+
+  // the stack slot of a parameter, the last one when a name is repeated
+  std::uint32_t slot(const Atom & sym) const{
+    for(std::size_t i = chunk.params.size(); sym.isSymbol() && i > 0; --i){
+      if(chunk.params[i - 1].symbolId() == sym.symbolId()){
+        return static_cast<std::uint32_t>(i - 1);
+      }
+    }
+    return NoSlot;
+  }
+
+  // the instruction calling the built-in procedure sym
+  static OpCode arithmetic(const Atom & sym){
+    std::string s = sym.asSymbol();
+    if(s == "+") return OpCode::Add;
+    if(s == "-") return OpCode::Sub;
+    if(s == "*") return OpCode::Mul;
+    if(s == "/") return OpCode::Div;
+    return OpCode::Call;
+  }
+
+  bool fallback(const Expression & e){
+    if(in_lambda){
+      return false;
+    }
+    emit(OpCode::Fallback, constant(e));
+    return true;
+  }
+
+  void fail(const std::string & text){
+    emit(OpCode::Throw, message(text));
+  }
+
+  bool compile_lookup(const Expression & e);
+  bool compile_define(const Expression & e);
+  bool compile_lambda_value(const Expression & e);
+  bool compile_apply(const Expression & e, bool map);
+  bool compile_call(const Expression & e);
+};
+
+bool Compiler::compile(const Expression & e){
+
+  SpecialForm form = e.head().specialForm();
+  const std::vector<Expression> & tail = e.contents();
+
+  if(form == ListForm){
+    for(auto & item : tail){
+      if(!compile(item)) return false;
+    }
+    emit(OpCode::MakeList, 0, static_cast<std::uint32_t>(tail.size()));
+    return true;
+  }
+  if(tail.empty()){
+    return compile_lookup(e);
+  }
+
+  switch(form){
+    case BeginForm:
+      for(std::size_t i = 0; i < tail.size(); ++i){
+        if(i > 0) emit(OpCode::Pop);
+        if(!compile(tail[i])) return false;
+      }
+      return true;
+    case DefineForm:
+      return compile_define(e);
+    case LambdaForm:
+      return compile_lambda_value(e);
+    case ApplyForm:
+      return compile_apply(e, false);
+    case MapForm:
+      return compile_apply(e, true);
+    case SetPropertyForm:
+    case GetPropertyForm:
+    case DiscretePlotForm:
+    case ContinuousPlotForm:
+    case PMapForm:
+      return fallback(e);
+    case ConstantForm:
+      emit(OpCode::Const, constant(tail[0]));
+      return true;
+    default:
+      return compile_call(e);
+  }
+}
+
+bool Compiler::compile_lookup(const Expression & e){
+
+  const Atom & head = e.head();
+  if(head.isSymbol()){
+    std::uint32_t index = slot(head);
+    if(index != NoSlot){
+      emit(OpCode::LoadLocal, index);
+    }
+    else{
+      emit(OpCode::LoadName, name(head));
+    }
+  }
+  else if(head.isNumber() || head.isComplex() || head.isString()){
+    emit(OpCode::Const, constant(Expression(head)));
+  }
+  else{
+    fail("Error during handle lookup: Invalid type in terminal expression");
+  }
+  return true;
+}
+
+bool Compiler::compile_define(const Expression & e){
+
+  const std::vector<Expression> & tail = e.contents();
+  if(tail.size() != 2){
+    fail("Error during handle define: invalid number of arguments to define");
+    return true;
+  }
+
+  const Atom & sym = tail[0].head();
+  if(!sym.isSymbol()){
+    fail("Error during handle define: first argument to define not symbol");
+    return true;
+  }
+
+  SpecialForm form = sym.specialForm();
+  if((form == DefineForm) || (form == BeginForm) || (form == LambdaForm) || (form == ListForm)) {
+    fail("Error during handle define: attempt to redefine a special-form");
+    return true;
+  }
+
+  std::uint32_t index = name(sym);
+  emit(OpCode::CheckDefine, index);
+
+  std::string s = sym.asSymbol();
+  if((s=="pi"||(s=="e")||s=="I")) {
+    fail("Error during handle define: attempt to redefine a built-in symbol");
+    return true;
+  }
+
+  if(!compile(tail[1])) return false;
+  if(in_lambda){
+    emit(OpCode::DefineLocal, index, slot(sym));
+  }
+  else{
+    emit(OpCode::DefineGlobal, index);
+  }
+  return true;
+}
+
+bool Compiler::compile_lambda_value(const Expression & e){
+
+  const std::vector<Expression> & tail = e.contents();
+  if(tail.size() < 2){
+    return fallback(e);
+  }
+
+  // the lambda does not depend on the environment, so build it once here
+  std::vector<Expression> argument_template;
+  argument_template.emplace_back(Expression(tail[0].head()));
+  for(auto p = tail[0].tailConstBegin(); p != tail[0].tailConstEnd(); ++p){
+    argument_template.emplace_back(Expression(*p));
+  }
+  emit(OpCode::Const, constant(Expression(argument_template, tail[1])));
+  return true;
+}
+
+bool Compiler::compile_apply(const Expression & e, bool map){
+
+  const std::vector<Expression> & tail = e.contents();
+  if(tail.size() != 2){
+    fail(map ? "Error during map: invalid number of arguments" :
+               "Error during apply: invalid number of arguments");
+    return true;
+  }
+
+  std::uint32_t index = name(tail[0].head());
+  std::uint32_t text = message(map ? "Error: first argument to map not a procedure" :
+                                     "Error: first argument to apply not a procedure");
+  emit(tail[0].tailLength() > 0 ? OpCode::CheckLambda : OpCode::CheckCallable, index, text);
+
+  if(!compile(tail[1])) return false;
+  emit(map ? OpCode::Map : OpCode::Apply, index);
+  return true;
+}
+
+bool Compiler::compile_call(const Expression & e){
+
+  const std::vector<Expression> & tail = e.contents();
+  for(auto & item : tail){
+    if(!compile(item)) return false;
+  }
+
+  if(!e.head().isSymbol()){
+    fail("Error during evaluation: not a symbol");
+  }
+  else{
+    std::uint32_t index = name(e.head());
+    emit(chunk.procs[index] ? arithmetic(e.head()) : OpCode::Call, index,
+         static_cast<std::uint32_t>(tail.size()));
+  }
+  return true;
+}
+
+}
+
+std::shared_ptr<const Chunk> compile_program(const Expression & program, const Environment & env){
+
+  auto chunk = std::make_shared<Chunk>();
+  Compiler compiler(env, *chunk, false);
+  compiler.compile(program);
+  return chunk;
+}
+
+std::shared_ptr<const Chunk> compile_lambda(const Expression & lambda, const Environment & env){
+
+  auto chunk = std::make_shared<Chunk>();
+  const Expression & arg_template = lambda.contents().front();
+  for(auto p = arg_template.tailConstBegin(); p != arg_template.tailConstEnd(); ++p){
+    // binding a non-symbol is an error only the tree-walker reports
+    if(!p->head().isSymbol()) return nullptr;
+    chunk->params.push_back(p->head());
+    chunk->shadows_procs = chunk->shadows_procs || env.is_proc(p->head());
+  }
+
+  Compiler compiler(env, *chunk, true);
+  if(!compiler.compile(lambda.contents().back())){
+    return nullptr;
+  }
+  return chunk;
+}
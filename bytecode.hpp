@@ -0,0 +1,115 @@
+/*! \file bytecode.hpp
+Defines the bytecode the interpreter AST is compiled to, and the compiler.
+
+A Chunk is the compiled form of either a whole program or the body of a
+lambda. Its instructions run on the operand stack of the VirtualMachine.
+Symbols that name parameters of the lambda being compiled are resolved to
+stack slots, built-in procedures are resolved to function pointers, and all
+other symbols are looked up at run time. Calls of the built-in arithmetic
+procedures get instructions of their own, which the VM computes without
+calling the procedure when the operands are real numbers.
+
+Forms without an instruction of their own (the plot and property forms, and
+pmap) are kept as an Expression and evaluated by the tree-walker. Since the
+tree-walker cannot see the stack slots of a frame, a lambda body that needs
+it is not compiled at all and is always evaluated by the tree-walker.
+ */
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "atom.hpp"
+#include "environment.hpp"
+#include "expression.hpp"
+
+/*! \enum OpCode
+\brief The instructions of the virtual machine.
+
+Each instruction has up to two operands, a and b, whose meaning is given
+below. "push" and "pop" refer to the operand stack.
+*/
+enum class OpCode : std::uint8_t {
+  Const,         //< push constants[a]
+  LoadLocal,     //< push stack slot a of the frame
+  LoadName,      //< push the value bound to names[a]
+  Pop,           //< pop and discard
+  Throw,         //< throw a SemanticError with messages[a]
+  CheckDefine,   //< throw if names[a] names a procedure
+  DefineGlobal,  //< bind names[a] to the top of the stack in the environment
+  DefineLocal,   //< bind names[a] to the top of the stack in the frame, or slot b if valid
+  MakeList,      //< pop b items and push them as a list
+  Call,          //< pop b arguments and push the result of calling names[a]
+  Add,           //< as Call of the built-in +, computed in place for real numbers
+  Sub,           //< as Call of the built-in -, computed in place for real numbers
+  Mul,           //< as Call of the built-in *, computed in place for real numbers
+  Div,           //< as Call of the built-in /, computed in place for real numbers
+  CheckCallable, //< throw messages[b] unless names[a] names a lambda or procedure
+  CheckLambda,   //< throw messages[b] unless names[a] names a lambda
+  Apply,         //< pop a list and push the result of calling names[a] on its items
+  Map,           //< pop a list and push the list of names[a] called on each item
+  Fallback       //< push the result of the tree-walker evaluating constants[a]
+};
+
+/// the operand of DefineLocal for a name that is not a parameter
+const std::uint32_t NoSlot = UINT32_MAX;
+
+/*! \struct Instruction
+\brief An opcode and its operands.
+*/
+struct Instruction {
+  OpCode op;
+  std::uint32_t a;
+  std::uint32_t b;
+};
+
+/*! \struct Chunk
+\brief A compiled program or lambda body.
+*/
+struct Chunk {
+
+  /// the instructions, run in order
+  std::vector<Instruction> code;
+
+  /// the constant Expressions
+  std::vector<Expression> constants;
+
+  /// the symbols referenced by name
+  std::vector<Atom> names;
+
+  /// for each of names, its built-in procedure if it names one, else nullptr
+  std::vector<Procedure> procs;
+
+  /// the error messages thrown by Throw, CheckCallable and CheckLambda
+  std::vector<std::string> messages;
+
+  /// the parameters of the lambda, which occupy the first stack slots
+  std::vector<Atom> params;
+
+  /// a parameter names a built-in procedure, so calls in and below the frame
+  /// must look for the procedures in the frames first
+  bool shadows_procs = false;
+
+  /// for each of names, the slot it was last found in outside of the frames
+  mutable std::vector<SlotHint> hints;
+};
+
+/*! Compile a program to run at the top level of env.
+  \param program the AST to compile
+  \param env the environment the program will run in, used to resolve
+  built-in procedures
+  \return the compiled program
+ */
+std::shared_ptr<const Chunk> compile_program(const Expression & program, const Environment & env);
+
+/*! Compile the body of a lambda.
+  \param lambda the lambda Expression
+  \param env the environment used to resolve built-in procedures
+  \return the compiled body, or nullptr if the body must be tree-walked
+ */
+std::shared_ptr<const Chunk> compile_lambda(const Expression & lambda, const Environment & env);
+
+#endif
@@ -0,0 +1,144 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "startup_config.hpp"
+
+// evaluate program with the startup file loaded, returning the result or the error
+static std::string evaluate_with(Interpreter::Backend backend, const std::string & program,
+                                 Expression & result){
+
+  Interpreter interp;
+  interp.setBackend(backend);
+
+  std::ifstream startup(STARTUP_FILE);
+  REQUIRE(interp.parseStream(startup));
+  REQUIRE_NOTHROW(interp.evaluate());
+
+  std::istringstream iss(program);
+  interp.parseStream(iss);
+  try{
+    result = interp.evaluate();
+  }
+  catch(const SemanticError & ex){
+    return ex.what();
+  }
+  return "";
+}
+
+// require both backends to agree on program
+static void require_same(const std::string & program){
+
+  INFO(program);
+  Expression walked, compiled;
+  std::string walked_error = evaluate_with(Interpreter::Backend::TreeWalker, program, walked);
+  std::string compiled_error = evaluate_with(Interpreter::Backend::Bytecode, program, compiled);
+
+  REQUIRE(walked_error == compiled_error);
+  REQUIRE(walked == compiled);
+}
+
+TEST_CASE( "Test the bytecode backend matches the tree-walker", "[bytecode]" ) {
+
+  const char * programs[] = {
+    "(begin (define r 10) (* pi (* r r)))",
+    "(+ 1 2 3 4 5 6)",
+    "(begin (define answer (+ 9 11)) (answer))",
+    "(begin (define a 1) (define b 1) (+ a b))",
+    "(list)",
+    "(list 1 (list 2 I) \"three\")",
+    "(begin (define f (lambda (x) (* 2 x))) (f 5))",
+    "(begin (define x 100) (lambda (x y) (+ x y 1)))",
+    "(begin (define f (lambda (x) (* 2 x))) (apply f (list 5)))",
+    "(begin (define linear (lambda (a b x) (+ (* a x) b))) (apply linear (list 3 4 5)))",
+    "(apply + (list 1 2 3))",
+    "(begin (define f (lambda (x) (* 2 x))) (map f (range 0 10)))",
+    "(map sqrt (list 4 -4))",
+    "(begin (define x 1) (define f (lambda (x) (* 2 x))) (+ (f 5) x))",
+    "(begin (define g (lambda (y) (+ y n))) (define h (lambda (n) (g 1))) (h 41))",
+    "(begin (define f (lambda (x) (begin (define y (* x x)) (define x 3) (+ x y)))) (f 5))",
+    "(begin (define f (lambda (x) (begin (define y x) y))) (f 1) y)",
+    "(begin (define g (lambda (x) (make-point x x))) (map g (range 0 2)))",
+    "(begin (define f (lambda (x) (+ (* 2 x) 1))) (continuous-plot f (list -2 2)))",
+    "(begin (define f (lambda (x) (* 2 x))) (pmap f (range 0 99)))",
+    "(begin (define f (lambda (x) (list x (lambda (y) (+ x y))))) (f 1))",
+    "(begin (define apply-twice (lambda (f x) (f (f x)))) (define inc (lambda (x) (+ x 1))) (apply-twice inc 1))",
+    "(get-property \"object-name\" (make-point 1 2))"
+  };
+  for(auto program : programs){
+    require_same(program);
+  }
+}
+
+TEST_CASE( "Test the bytecode backend reports the same errors", "[bytecode]" ) {
+
+  const char * programs[] = {
+    "(begin)",
+    "hello",
+    "(begin (define f (lambda (x y) (# x y))) (f 5))",
+    "(begin (define f (lambda (x) x)) (f 1 2))",
+    "(define begin 1)",
+    "(define + 1)",
+    "(define pi 3)",
+    "(define 1 2)",
+    "(define a)",
+    "(begin (define a 1) (a 2))",
+    "(begin (define a 1) (define b (+ a c)))",
+    "(apply + 1)",
+    "(apply 1 (list))",
+    "(apply (+ 1) (list 1))",
+    "(map + (list 1) (list 2))",
+    "(map first (list 1 2))",
+    "(map (lambda (x) x) (list 1))",
+    "(1 2)",
+    "(begin (define f (lambda (x) (define + x))) (f 1))",
+    "(begin (define f (lambda (x) (unknown x))) (f 1))"
+  };
+  for(auto program : programs){
+    require_same(program);
+  }
+}
+
+TEST_CASE( "Test the bytecode backend computes arithmetic as the procedures do", "[bytecode]" ) {
+
+  const char * programs[] = {
+    "(begin (define f (lambda (x y) (list (+ x y) (- x y) (* x y) (/ x y)))) (f 0.1 3))",
+    "(begin (define f (lambda (x) (list (+) (*) (- x) (/ x) (+ x) (* x)))) (f 7))",
+    "(begin (define f (lambda (x) (- x x x))) (f 1))",
+    "(begin (define f (lambda (x) (/ x x x))) (f 1))",
+    "(begin (define f (lambda (x) (-))) (f 1))",
+    "(begin (define f (lambda (x) (+ x I))) (f 1))",
+    "(begin (define f (lambda (x) (* x (list 1 2)))) (f 2))",
+    "(begin (define f (lambda (x) (+ x (set-property \"note\" 1 2)))) (f 1))",
+    "(begin (define f (lambda (+ x) (+ x))) (define g (lambda (y) (list y))) (f g 2))",
+    "(begin (define f (lambda (x) (* x x))) (define m (lambda (f) (map f (list 1 2 3)))) (m f))",
+    "(begin (define f (lambda (x) (* x I))) (map f (list 0 1 2)))",
+    "(begin (define f (lambda (x) (list x))) (map f (range 0 2)))",
+    "(begin (define f (lambda (x) (* x x))) (map f (list)))"
+  };
+  for(auto program : programs){
+    require_same(program);
+  }
+}
+
+TEST_CASE( "Test the bytecode backend keeps definitions between programs", "[bytecode]" ) {
+
+  Interpreter interp;
+  interp.setBackend(Interpreter::Backend::Bytecode);
+  REQUIRE(interp.getBackend() == Interpreter::Backend::Bytecode);
+
+  std::istringstream first("(define f (lambda (x) (* x x)))");
+  REQUIRE(interp.parseStream(first));
+  REQUIRE_NOTHROW(interp.evaluate());
+
+  std::istringstream second("(f 3)");
+  REQUIRE(interp.parseStream(second));
+  REQUIRE(interp.evaluate() == Expression(9.));
+
+  // the same program may be evaluated again
+  REQUIRE(interp.evaluate() == Expression(9.));
+}
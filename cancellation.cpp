@@ -0,0 +1,41 @@
+#include "cancellation.hpp"
+
+#include "semantic_error.hpp"
+
+namespace {
+
+thread_local const CancellationToken * current_token = nullptr;
+
+}
+
+void CancellationToken::cancel() noexcept{
+  requested.store(true, std::memory_order_relaxed);
+}
+
+void CancellationToken::reset() noexcept{
+  requested.store(false, std::memory_order_relaxed);
+}
+
+bool CancellationToken::cancelled() const noexcept{
+  return requested.load(std::memory_order_relaxed);
+}
+
+const CancellationToken * CancellationToken::current() noexcept{
+  return current_token;
+}
+
+CancellationScope::CancellationScope(const CancellationToken * token) noexcept:
+  previous(current_token){
+  current_token = token;
+}
+
+CancellationScope::~CancellationScope(){
+  current_token = previous;
+}
+
+void check_interrupt(){
+
+  if(current_token && current_token->cancelled()){
+    throw SemanticError("Error: interpreter kernal interupted");
+  }
+}
@@ -0,0 +1,64 @@
+/*! \file cancellation.hpp
+Defines the tokens by which a running evaluation is interrupted.
+
+An evaluation polls for interruption as it goes, so a token is cancelled
+from any thread without stopping the thread evaluating, and cancelling one
+interrupts only the evaluations watching it. An evaluation watches the token
+current on its thread, and runs to completion if there is none.
+
+Cancelling a token is a lock-free atomic store, so it may also be done from
+a signal handler.
+ */
+#ifndef CANCELLATION_HPP
+#define CANCELLATION_HPP
+
+#include <atomic>
+
+/*! \class CancellationToken
+\brief A request to interrupt the evaluations that watch it.
+*/
+class CancellationToken {
+public:
+
+  CancellationToken() = default;
+
+  CancellationToken(const CancellationToken &) = delete;
+  CancellationToken & operator=(const CancellationToken &) = delete;
+
+  /// request that the watching evaluations stop, safe from any thread
+  void cancel() noexcept;
+
+  /// withdraw the request, before the next evaluation is started
+  void reset() noexcept;
+
+  /// predicate, the request has been made
+  bool cancelled() const noexcept;
+
+  /// return the token current on the calling thread, or nullptr
+  static const CancellationToken * current() noexcept;
+
+private:
+  std::atomic<bool> requested{false};
+};
+
+/*! \class CancellationScope
+\brief Makes a token current on the calling thread for its lifetime.
+
+Passing nullptr makes evaluations on the thread uninterruptible.
+*/
+class CancellationScope {
+public:
+  explicit CancellationScope(const CancellationToken * token) noexcept;
+  ~CancellationScope();
+
+  CancellationScope(const CancellationScope &) = delete;
+  CancellationScope & operator=(const CancellationScope &) = delete;
+
+private:
+  const CancellationToken * previous;
+};
+
+/// throw SemanticError if the evaluation on the calling thread is interrupted
+void check_interrupt();
+
+#endif
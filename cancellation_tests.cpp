@@ -0,0 +1,87 @@
+#include "catch.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "cancellation.hpp"
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+
+static bool evaluate_interrupted(Interpreter & interp, const std::string & program){
+
+  std::istringstream iss(program);
+  REQUIRE(interp.parseStream(iss));
+  try{
+    interp.evaluate();
+  }
+  catch(const SemanticError & ex){
+    return std::string(ex.what()) == "Error: interpreter kernal interupted";
+  }
+  return false;
+}
+
+TEST_CASE( "Test cancellation token", "[cancellation]" ) {
+
+  CancellationToken token;
+  REQUIRE_FALSE(token.cancelled());
+  token.cancel();
+  REQUIRE(token.cancelled());
+  token.reset();
+  REQUIRE_FALSE(token.cancelled());
+}
+
+TEST_CASE( "Test cancellation scope", "[cancellation]" ) {
+
+  REQUIRE(CancellationToken::current() == nullptr);
+  CancellationToken outer, inner;
+  {
+    CancellationScope a(&outer);
+    REQUIRE(CancellationToken::current() == &outer);
+    {
+      CancellationScope b(&inner);
+      REQUIRE(CancellationToken::current() == &inner);
+    }
+    REQUIRE(CancellationToken::current() == &outer);
+  }
+  REQUIRE(CancellationToken::current() == nullptr);
+}
+
+TEST_CASE( "Test check interrupt", "[cancellation]" ) {
+
+  REQUIRE_NOTHROW(check_interrupt());
+
+  CancellationToken token, other;
+  token.cancel();
+  {
+    // only the current token is watched
+    CancellationScope watch(&other);
+    REQUIRE_NOTHROW(check_interrupt());
+  }
+  {
+    CancellationScope watch(&token);
+    REQUIRE_THROWS_AS(check_interrupt(), SemanticError);
+    CancellationScope suspend(nullptr);
+    REQUIRE_NOTHROW(check_interrupt());
+  }
+  REQUIRE_NOTHROW(check_interrupt());
+}
+
+TEST_CASE( "Test a cancelled token interrupts evaluation", "[cancellation]" ) {
+
+  Interpreter interp;
+  CancellationToken token;
+  CancellationScope watch(&token);
+
+  std::string program = "(begin (define f (lambda (x) (* 2 x))) (pmap f (range 0 999)))";
+  REQUIRE_FALSE(evaluate_interrupted(interp, program));
+
+  token.cancel();
+  REQUIRE(evaluate_interrupted(interp, program));
+  REQUIRE(evaluate_interrupted(interp, "(+ 1 2)"));
+
+  interp.setBackend(Interpreter::Backend::Bytecode);
+  REQUIRE(evaluate_interrupted(interp, "(+ 1 2)"));
+
+  token.reset();
+  REQUIRE_FALSE(evaluate_interrupted(interp, "(+ 1 2)"));
+}
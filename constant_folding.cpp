@@ -0,0 +1,202 @@
+#include "constant_folding.hpp"
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "semantic_error.hpp"
+#include "symbol_table.hpp"
+
+namespace {
+
+typedef std::unordered_set<SymbolId> Names;
+
+// add the parameters of the lambdas of the program e to bound
+void parameters_of_program(const Expression & e, Names & bound){
+
+  if(e.head().specialForm() == LambdaForm && e.tailLength() == 2){
+    const Expression & params = e.contents()[0];
+    if(params.head().isSymbol()){
+      bound.insert(params.head().symbolId());
+    }
+    for(const Expression & p : params.contents()){
+      if(p.head().isSymbol()){
+        bound.insert(p.head().symbolId());
+      }
+    }
+  }
+  for(const Expression & child : e.contents()){
+    parameters_of_program(child, bound);
+  }
+}
+
+// add the parameters of the lambdas held by the value v to bound
+void parameters_of_value(const Expression & v, Names & bound){
+
+  if(v.isLambda()){
+    for(const Expression & p : v.contents()[0].contents()){
+      if(p.head().isSymbol()){
+        bound.insert(p.head().symbolId());
+      }
+    }
+    parameters_of_program(v.contents()[1], bound);
+  }
+  else if(v.isList() && !v.isNumericList()){
+    for(const Expression & item : v.contents()){
+      parameters_of_value(item, bound);
+    }
+  }
+}
+
+// the built-in symbols define refuses to bind
+bool is_builtin_constant(const Atom & a){
+
+  static const SymbolId names[] = {
+    SymbolTable::intern("pi"), SymbolTable::intern("e"), SymbolTable::intern("I")
+  };
+  for(SymbolId id : names){
+    if(a.symbolId() == id){
+      return true;
+    }
+  }
+  return false;
+}
+
+// a subexpression after folding, with its value if it is constant
+struct Folded {
+  Expression node;
+  bool constant;
+  Expression value;
+};
+
+class Folder {
+public:
+  Folder(const Environment & env, Names && bound): env(env), bound(std::move(bound)){}
+
+  Folded fold(const Expression & e);
+
+private:
+  const Environment & env;
+  Names bound;
+
+  // the binding of the built-in name a, or nullptr if a parameter may shadow it
+  const Environment::EnvResult * builtin(const Atom & a) const{
+    if(!a.isSymbol() || bound.count(a.symbolId()) != 0){
+      return nullptr;
+    }
+    return env.lookup(a);
+  }
+
+  // the subexpression standing for value, which evaluates to it
+  static Folded constant(Expression value){
+
+    // the value outlives any evaluation
+    promote_to_heap(value);
+    const Atom & head = value.head();
+    if(value.isNone() && value.tailLength() == 0 &&
+       (head.isNumber() || head.isComplex() || head.isString())){
+      return Folded{value, true, value};
+    }
+    static const Atom form("(constant)");
+    return Folded{Expression(form, std::vector<Expression>{value}), true, value};
+  }
+
+  // e with the items of its tail from first on folded, sharing it if none changed
+  Expression fold_tail(const Expression & e, std::size_t first, std::vector<Folded> * items = nullptr);
+};
+
+Expression Folder::fold_tail(const Expression & e, std::size_t first, std::vector<Folded> * items){
+
+  const std::vector<Expression> & tail = e.contents();
+  std::vector<Expression> folded(tail);
+  bool changed = false;
+  for(std::size_t i = first; i < tail.size(); ++i){
+    Folded item = fold(tail[i]);
+    if(!item.node.identical(tail[i])){
+      folded[i] = item.node;
+      changed = true;
+    }
+    if(items != nullptr){
+      items->push_back(std::move(item));
+    }
+  }
+  return changed ? Expression(e.head(), std::move(folded)) : e;
+}
+
+Folded Folder::fold(const Expression & e){
+
+  const Atom & head = e.head();
+  SpecialForm form = head.specialForm();
+
+  if(form != ListForm && e.tailLength() == 0){
+    if(head.isNumber() || head.isComplex() || head.isString()){
+      return Folded{e, true, e};
+    }
+    if(is_builtin_constant(head)){
+      const Environment::EnvResult * binding = builtin(head);
+      if(binding != nullptr && binding->type == Environment::ExpressionType){
+        return constant(binding->exp);
+      }
+    }
+    return Folded{e, false, Expression()};
+  }
+
+  std::vector<Folded> items;
+  switch(form){
+    case ConstantForm:
+      return Folded{e, true, e.contents()[0]};
+    case DefineForm:
+    case LambdaForm:
+      // the symbol defined, or the parameters, are not evaluated
+      return Folded{fold_tail(e, 1), false, Expression()};
+    case ApplyForm:
+    case MapForm:
+    case PMapForm:
+      // the procedure is named, not evaluated
+      return Folded{fold_tail(e, 1), false, Expression()};
+    case ListForm:
+    case NotSpecialForm:
+      break;
+    default:
+      return Folded{fold_tail(e, 0), false, Expression()};
+  }
+
+  Expression node = fold_tail(e, 0, &items);
+  std::vector<Expression> values;
+  for(const Folded & item : items){
+    if(!item.constant){
+      return Folded{node, false, Expression()};
+    }
+    values.push_back(item.value);
+  }
+
+  if(form == ListForm){
+    return constant(Expression(std::move(values)));
+  }
+
+  const Environment::EnvResult * binding = builtin(head);
+  if(binding == nullptr || binding->type != Environment::ProcedureType || !is_pure_procedure(binding->proc)){
+    return Folded{node, false, Expression()};
+  }
+  try{
+    return constant(binding->proc(values));
+  }
+  catch(const SemanticError &){
+    // the error is raised where the call is evaluated
+    return Folded{node, false, Expression()};
+  }
+}
+
+}
+
+Expression fold_constants(const Expression & program, const Environment & env){
+
+  Names bound;
+  parameters_of_program(program, bound);
+  for(const auto & definition : env.definitions()){
+    parameters_of_value(definition.second, bound);
+  }
+
+  Folder folder(env, std::move(bound));
+  return folder.fold(program).node;
+}
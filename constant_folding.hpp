@@ -0,0 +1,39 @@
+/*! \file constant_folding.hpp
+Defines the optimization pass folding the constant subexpressions of a
+program before it is evaluated.
+
+A call of a pure built-in procedure (see is_pure_procedure) whose arguments
+are all constant is evaluated once, by the pass, and replaced by its value,
+as is a list of constants. Numbers, complex numbers, strings and the
+built-in constants pi, e and I are constant. A value that is not a single
+number or string is kept as a ConstantForm node, which evaluates to it
+without evaluating it again.
+
+The folding applies inside of lambda bodies too, so a constant subtree of a
+body, such as (* 2 pi) or (range 0 100 0.1), is computed once however often
+the lambda is called: it is hoisted out of the body. A subexpression reading
+any other symbol is not folded, and neither is hoisted, since under dynamic
+scoping and define the binding it reads may change between calls.
+
+A lambda parameter may shadow a built-in name for the calls made while it is
+bound, which extend to every lambda they call. So a name bound by a
+parameter of any lambda of the program, or of the environment, is never
+folded. A lambda of a later program could still shadow a name folded in a
+lambda defined here, which is why the pass is optional.
+
+A call that fails, such as (sqrt "a"), is left to fail when it is evaluated.
+ */
+#ifndef CONSTANT_FOLDING_HPP
+#define CONSTANT_FOLDING_HPP
+
+#include "environment.hpp"
+#include "expression.hpp"
+
+/*! Fold the constant subexpressions of a program
+  \param program the AST of the program
+  \param env the global environment the program is to be evaluated in
+  \return the AST with every constant subexpression replaced by its value
+ */
+Expression fold_constants(const Expression & program, const Environment & env);
+
+#endif
@@ -0,0 +1,131 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "constant_folding.hpp"
+#include "interpreter.hpp"
+#include "parse.hpp"
+#include "semantic_error.hpp"
+
+static Expression parse_program(const std::string & program){
+
+  std::istringstream iss(program);
+  Expression ast = parse(tokenize(iss));
+  REQUIRE(ast != Expression());
+  return ast;
+}
+
+static Expression fold(const std::string & program){
+
+  Environment env;
+  return fold_constants(parse_program(program), env);
+}
+
+static Expression evaluate_in(Interpreter & interp, const std::string & program){
+
+  std::istringstream iss(program);
+  INFO(program);
+  REQUIRE(interp.parseStream(iss));
+  return interp.evaluate();
+}
+
+static Expression run(const std::string & program, bool folding){
+
+  Interpreter interp;
+  interp.setFoldConstants(folding);
+  return evaluate_in(interp, program);
+}
+
+TEST_CASE( "Test folding calls of pure procedures on constants", "[constant_folding]" ) {
+
+  const double pi = std::atan2(0, -1);
+
+  REQUIRE(fold("(* 2 pi)") == Expression(Atom(2 * pi)));
+  REQUIRE(fold("(+ 1 (sqrt 4) (- 3))") == Expression(Atom(0.)));
+  REQUIRE(fold("(* 2 I)") == Expression(Atom(std::complex<double>(0, 2))));
+  REQUIRE(fold("(ln e)") == Expression(Atom(1.)));
+
+  // a list is kept as a value, not evaluated again
+  Expression range = fold("(range 0 1 0.5)");
+  REQUIRE(range.head().specialForm() == ConstantForm);
+  REQUIRE(range.contents()[0] == run("(range 0 1 0.5)", false));
+  Environment env;
+  REQUIRE(range.eval(env) == run("(range 0 1 0.5)", false));
+  REQUIRE(fold("(list 1 (+ 1 1))").contents()[0] == run("(list 1 2)", false));
+
+  // what a symbol or an impure procedure reads is not constant
+  REQUIRE(fold("(+ x 1)") == parse_program("(+ x 1)"));
+  REQUIRE(fold("(read-csv \"data.csv\")") == parse_program("(read-csv \"data.csv\")"));
+  Expression plot = fold("(stream-plot (list))");
+  REQUIRE(plot.head() == Atom("stream-plot"));
+  REQUIRE(plot.contents()[0].head().specialForm() == ConstantForm);
+
+  // only the constant parts of a call are folded
+  REQUIRE(fold("(+ x (* 2 3))") == parse_program("(+ x 6)"));
+
+  // an error surfaces where the call is evaluated
+  REQUIRE(fold("(sqrt \"a\")") == parse_program("(sqrt \"a\")"));
+  REQUIRE(fold("(first (list))").head() == Atom("first"));
+}
+
+TEST_CASE( "Test folding hoists constants out of lambda bodies", "[constant_folding]" ) {
+
+  const double pi = std::atan2(0, -1);
+  Expression ast = fold("(define f (lambda (x) (* x (* 2 pi))))");
+  Expression body = ast.contents()[1].contents()[1];
+  REQUIRE(body.head() == Atom("*"));
+  REQUIRE(body.contents()[1] == Expression(Atom(2 * pi)));
+
+  // the parameters and the symbol defined are left alone
+  REQUIRE(ast.contents()[0] == Expression(Atom("f")));
+  REQUIRE(ast.contents()[1].contents()[0] == Expression(Atom("x")));
+}
+
+TEST_CASE( "Test names bound by a parameter are not folded", "[constant_folding]" ) {
+
+  // under dynamic scoping the body of f sees the e bound by g
+  std::string program = "(begin (define f (lambda (x) (* x e))) (define g (lambda (e) (f 2))) (g 5))";
+  REQUIRE(run(program, true) == Expression(Atom(10.)));
+  REQUIRE(run(program, true) == run(program, false));
+
+  REQUIRE(fold("(lambda (sqrt) (sqrt 4))") == parse_program("(lambda (sqrt) (sqrt 4))"));
+
+  // nor are those bound by the lambdas of the environment
+  Interpreter interp;
+  interp.setFoldConstants(true);
+  evaluate_in(interp, "(define g (lambda (pi) (h 1)))");
+  evaluate_in(interp, "(define h (lambda (x) (+ pi 0)))");
+  REQUIRE(evaluate_in(interp, "(g 3)") == Expression(Atom(3.)));
+}
+
+TEST_CASE( "Test folded programs evaluate as before", "[constant_folding]" ) {
+
+  std::vector<std::string> programs = {
+    "(begin (define f (lambda (x) (+ x (* 2 pi)))) (map f (range 0 10 1)))",
+    "(begin (define y (list 1 (+ 1 1) (list))) (append y (^ 2 10)))",
+    "(join (range 0 2 1) (list (sqrt -4) (conj I)))",
+    "(get-property \"k\" (set-property \"k\" (* 3 3) (list (sin 0))))",
+    "(apply + (list 1 (* 2 3)))",
+    "(length (rest (range 0 100 0.5)))",
+  };
+  for(auto & program : programs){
+    INFO(program);
+    REQUIRE(run(program, true) == run(program, false));
+  }
+
+  for(auto backend : {Interpreter::Backend::TreeWalker, Interpreter::Backend::Bytecode}){
+    Interpreter interp;
+    interp.setBackend(backend);
+    interp.setFoldConstants(true);
+    interp.setMemoize(true);
+    REQUIRE(interp.getFoldConstants());
+    evaluate_in(interp, "(define f (lambda (x) (first (join (list x) (range 0 3 1)))))");
+    REQUIRE(evaluate_in(interp, "(map f (list 7 8))") == run("(list 7 8)", false));
+    REQUIRE(evaluate_in(interp, "(f (length (range 0 3 1)))") == Expression(Atom(4.)));
+  }
+
+  REQUIRE_THROWS_AS(run("(begin (define f (lambda (x) (sqrt \"a\"))) 1 (f 1))", true), SemanticError);
+  REQUIRE(run("(begin (define f (lambda (x) (sqrt \"a\"))) 1)", true) == Expression(Atom(1.)));
+}
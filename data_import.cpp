@@ -0,0 +1,336 @@
+#include "data_import.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "atom.hpp"
+#include "cancellation.hpp"
+#include "memo_cache.hpp"
+#include "numeric_list.hpp"
+#include "semantic_error.hpp"
+
+#if !defined(_WIN64) && !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP
+#endif
+
+namespace {
+
+/* The bytes of a file, mapped into memory where the platform allows it and
+   read into a buffer otherwise. */
+class FileBytes {
+public:
+  FileBytes(const std::string & filename, const std::string & name): mapped(nullptr), size(0){
+
+    const std::string unopened = "Error: in call to " + name + ", could not open file " + filename;
+
+#ifdef HAVE_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd >= 0){
+      struct stat info;
+      if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)){
+        // a directory or device opens, but has no bytes to import
+        close(fd);
+        throw SemanticError(unopened);
+      }
+      size = static_cast<std::size_t>(info.st_size);
+      void * data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+      if(data != MAP_FAILED){
+        mapped = static_cast<const char *>(data);
+      }
+      close(fd);
+      if(mapped != nullptr || size == 0){
+        return;
+      }
+    }
+#endif
+
+    std::ifstream in(filename, std::ios::binary);
+    if(!in){
+      throw SemanticError(unopened);
+    }
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    size = buffer.size();
+  }
+
+  ~FileBytes(){
+#ifdef HAVE_MMAP
+    if(mapped != nullptr){
+      munmap(const_cast<char *>(mapped), size);
+    }
+#endif
+  }
+
+  FileBytes(const FileBytes &) = delete;
+  FileBytes & operator=(const FileBytes &) = delete;
+
+  const char * begin() const noexcept { return mapped ? mapped : buffer.data(); }
+  const char * end() const noexcept { return begin() + size; }
+
+private:
+  const char * mapped;
+  std::size_t size;
+  std::string buffer;
+};
+
+// the file named by the first argument, a string
+std::string filename_arg(const std::vector<Expression> & args, const std::string & name){
+
+  if(args.empty() || !args[0].head().isString() || args[0].tailLength() != 0){
+    throw SemanticError("Error: in call to " + name + ", first argument not a file name string");
+  }
+  return args[0].head().asSymbol();
+}
+
+// the columns as a list of numeric lists, drawn by discrete-plot as points
+Expression columns_list(std::vector<std::vector<double>> && columns){
+
+  std::vector<Expression> items;
+  for(auto & column : columns){
+    items.push_back(make_numeric_list(std::move(column)));
+  }
+  Expression result(std::move(items));
+  result.setProperty("\"layout\"", Expression(Atom("\"columns\"")));
+  return result;
+}
+
+// the rows are read in batches, checking for an interrupt between them
+const std::size_t ROWS_PER_CHECK = 1 << 16;
+
+struct Field {
+  const char * begin;
+  const char * end;
+};
+
+// split the line [begin, end) at its commas, trimming blanks from each field
+void split_fields(const char * begin, const char * end, std::vector<Field> & fields){
+
+  fields.clear();
+  while(true){
+    const char * comma = static_cast<const char *>(std::memchr(begin, ',', end - begin));
+    const char * stop = comma ? comma : end;
+    const char * first = begin;
+    const char * last = stop;
+    while(first != last && (*first == ' ' || *first == '\t')) ++first;
+    while(last != first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) --last;
+    fields.push_back(Field{first, last});
+    if(!comma){
+      return;
+    }
+    begin = comma + 1;
+  }
+}
+
+// the next line of [begin, end), advancing begin and the line number past it
+bool next_line(const char * & begin, const char * end, const char * & line, const char * & stop,
+               std::size_t & number){
+
+  while(begin != end){
+    const char * newline = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+    ++number;
+    line = begin;
+    stop = newline ? newline : end;
+    begin = newline ? newline + 1 : end;
+
+    // blank lines hold no row
+    for(const char * p = line; p != stop; ++p){
+      if(*p != ' ' && *p != '\t' && *p != '\r'){
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+std::string field_text(const Field & field){
+
+  // a name may be quoted
+  const char * begin = field.begin;
+  const char * end = field.end;
+  if(end - begin >= 2 && *begin == '"' && end[-1] == '"'){
+    ++begin;
+    --end;
+  }
+  return std::string(begin, end);
+}
+
+}
+
+Expression read_csv(const std::vector<Expression> & args){
+
+  const std::string name = "read-csv";
+  std::string filename = filename_arg(args, name);
+  note_outside_read();
+
+  FileBytes file(filename, name);
+  const char * text = file.begin();
+  const char * end = file.end();
+
+  std::vector<Field> fields;
+  const char * line;
+  const char * stop;
+  std::size_t line_number = 0;
+
+  // the first line is a header if any of its fields is not a number
+  std::vector<std::string> header;
+  std::size_t first_columns = 0;
+  const char * start = text;
+  if(next_line(text, end, line, stop, line_number)){
+    split_fields(line, stop, fields);
+    first_columns = fields.size();
+    double value;
+    for(const Field & field : fields){
+      if(!parse_number(field.begin, field.end, value)){
+        for(const Field & f : fields){
+          header.push_back(field_text(f));
+        }
+        break;
+      }
+    }
+  }
+  if(header.empty()){
+    text = start;
+    line_number = 0;
+  }
+
+  // the columns asked for, every one by default
+  std::vector<std::size_t> selected;
+  for(std::size_t i = 1; i < args.size(); ++i){
+    const Atom & column = args[i].head();
+    if(args[i].tailLength() == 0 && column.isNumber() && column.asNumber() >= 0 &&
+       column.asNumber() == static_cast<double>(static_cast<std::size_t>(column.asNumber()))){
+      selected.push_back(static_cast<std::size_t>(column.asNumber()));
+    }
+    else if(args[i].tailLength() == 0 && column.isString()){
+      std::string wanted = column.asSymbol();
+      std::size_t position = 0;
+      while(position < header.size() && header[position] != wanted) ++position;
+      if(position == header.size()){
+        throw SemanticError("Error: in call to read-csv, no column named " + wanted);
+      }
+      selected.push_back(position);
+    }
+    else{
+      throw SemanticError("Error: in call to read-csv, column not a position or a name");
+    }
+  }
+  if(args.size() == 1){
+    for(std::size_t i = 0; i < first_columns; ++i){
+      selected.push_back(i);
+    }
+  }
+
+  // where each field of a row goes, if it was asked for
+  const std::size_t unused = static_cast<std::size_t>(-1);
+  std::vector<std::size_t> slot;
+  for(std::size_t i = 0; i < selected.size(); ++i){
+    if(selected[i] >= slot.size()){
+      slot.resize(selected[i] + 1, unused);
+    }
+    slot[selected[i]] = i;
+  }
+
+  std::vector<std::vector<double>> columns(selected.size());
+  std::vector<double> row(selected.size());
+  std::size_t rows = 0;
+  while(next_line(text, end, line, stop, line_number)){
+    if(++rows % ROWS_PER_CHECK == 0){
+      check_interrupt();
+    }
+    split_fields(line, stop, fields);
+    if(fields.size() < slot.size()){
+      throw SemanticError("Error: in call to read-csv, too few columns on line " +
+                          std::to_string(line_number) + " of " + filename);
+    }
+    for(std::size_t k = 0; k < slot.size(); ++k){
+      if(slot[k] == unused){
+        continue;
+      }
+      if(!parse_number(fields[k].begin, fields[k].end, row[slot[k]])){
+        throw SemanticError("Error: in call to read-csv, column " + std::to_string(k) +
+                            " of line " + std::to_string(line_number) + " of " + filename +
+                            " not a number");
+      }
+    }
+    // a column may be asked for more than once
+    for(std::size_t i = 0; i < selected.size(); ++i){
+      columns[i].push_back(row[slot[selected[i]]]);
+    }
+  }
+
+  if(args.size() == 2){
+    return make_numeric_list(std::move(columns[0]));
+  }
+  return columns_list(std::move(columns));
+}
+
+namespace {
+
+template <class T>
+void convert(const char * bytes, std::size_t count, std::vector<double> & values){
+
+  values.resize(count);
+  for(std::size_t i = 0; i < count; ++i){
+    // copied a number at a time, as the bytes need not be aligned for T
+    T number;
+    std::memcpy(&number, bytes + i * sizeof(T), sizeof(T));
+    values[i] = static_cast<double>(number);
+  }
+}
+
+}
+
+Expression read_binary(const std::vector<Expression> & args){
+
+  const std::string name = "read-binary";
+  std::string filename = filename_arg(args, name);
+  if(args.size() < 2 || args.size() > 3 || !args[1].head().isString() || args[1].tailLength() != 0){
+    throw SemanticError("Error: in call to read-binary, expected a file name, a type and a number of columns");
+  }
+
+  std::string type = args[1].head().asSymbol();
+  std::size_t width;
+  if(type == "f64" || type == "i64") width = 8;
+  else if(type == "f32" || type == "i32") width = 4;
+  else throw SemanticError("Error: in call to read-binary, type not one of \"f64\", \"f32\", \"i64\" or \"i32\"");
+
+  std::size_t count = 1;
+  if(args.size() == 3){
+    const Atom & n = args[2].head();
+    if(args[2].tailLength() != 0 || !n.isNumber() || n.asNumber() < 1 ||
+       n.asNumber() != static_cast<double>(static_cast<std::size_t>(n.asNumber()))){
+      throw SemanticError("Error: in call to read-binary, number of columns not a positive integer");
+    }
+    count = static_cast<std::size_t>(n.asNumber());
+  }
+  note_outside_read();
+
+  FileBytes file(filename, name);
+  std::size_t size = file.end() - file.begin();
+  if(size % (width * count) != 0){
+    throw SemanticError("Error: in call to read-binary, size of " + filename + " not a whole number of rows");
+  }
+
+  std::vector<double> values;
+  std::size_t numbers = size / width;
+  if(type == "f64") convert<double>(file.begin(), numbers, values);
+  else if(type == "f32") convert<float>(file.begin(), numbers, values);
+  else if(type == "i64") convert<std::int64_t>(file.begin(), numbers, values);
+  else convert<std::int32_t>(file.begin(), numbers, values);
+
+  if(args.size() == 2){
+    return make_numeric_list(std::move(values));
+  }
+
+  std::vector<std::vector<double>> columns(count, std::vector<double>(numbers / count));
+  for(std::size_t i = 0; i < numbers; ++i){
+    columns[i % count][i / count] = values[i];
+  }
+  return columns_list(std::move(columns));
+}
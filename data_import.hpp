@@ -0,0 +1,38 @@
+/*! \file data_import.hpp
+Defines the built-in procedures reading numeric data from files.
+
+The data is converted straight from the bytes of the file into packed
+numeric lists (see numeric_list.hpp), without going through the tokenizer
+or building an Expression per number. Data of several columns comes back
+as a list of one packed list per column, marked with the property "layout"
+set to "columns", which discrete-plot draws as the x and y of its points.
+
+The value of either procedure depends on the file rather than only on its
+arguments, so they note a read outside of the program (see memo_cache.hpp)
+and their results are never cached.
+ */
+#ifndef DATA_IMPORT_HPP
+#define DATA_IMPORT_HPP
+
+#include <vector>
+
+#include "expression.hpp"
+
+/*! Read the numeric columns of a file of comma separated values.
+
+  (read-csv "file") returns every column, (read-csv "file" c) the column c
+  alone, and (read-csv "file" c1 c2 ...) the columns c1, c2, ... A column is
+  given by its position from 0 or, when the first line of the file is a
+  header of names, by its name. Blank lines are skipped.
+ */
+Expression read_csv(const std::vector<Expression> & args);
+
+/*! Read a file of raw numbers in the byte order of the machine.
+
+  (read-binary "file" "type") returns the numbers of the file, of type
+  "f64", "f32", "i64" or "i32", as one list. (read-binary "file" "type" n)
+  returns n columns, the numbers of the file being interleaved by row.
+ */
+Expression read_binary(const std::vector<Expression> & args);
+
+#endif
@@ -0,0 +1,153 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "memo_cache.hpp"
+#include "semantic_error.hpp"
+
+static Expression evaluate_in(Interpreter & interp, const std::string & program){
+
+  std::istringstream iss(program);
+  INFO(program);
+  REQUIRE(interp.parseStream(iss));
+  return interp.evaluate();
+}
+
+static Expression run(const std::string & program){
+
+  Interpreter interp;
+  return evaluate_in(interp, program);
+}
+
+static void write_file(const std::string & filename, const std::string & bytes){
+
+  std::ofstream out(filename, std::ios::binary);
+  out << bytes;
+}
+
+TEST_CASE( "Test reading the columns of a csv file", "[data_import]" ) {
+
+  const std::string file = "data_import_test.csv";
+  write_file(file, "x, \"y\",z\r\n1,2,3\r\n\r\n4.5, -5 ,6e1\r\n");
+
+  REQUIRE(run("(read-csv \"" + file + "\" 0)") == run("(list 1 4.5)"));
+  REQUIRE(run("(read-csv \"" + file + "\" \"y\")") == run("(list 2 -5)"));
+  REQUIRE(run("(read-csv \"" + file + "\" 2 \"x\")") ==
+          run("(set-property \"layout\" \"columns\" (list (list 3 60) (list 1 4.5)))"));
+
+  // every column by default, marked as columns
+  Expression all = run("(read-csv \"" + file + "\")");
+  REQUIRE(all == run("(set-property \"layout\" \"columns\" (list (list 1 4.5) (list 2 -5) (list 3 60)))"));
+  REQUIRE(all.checkProperty("layout", "columns"));
+  REQUIRE(all.contents()[0].isNumericList());
+
+  // a file without a header starts with the data
+  write_file(file, "1,2\n3,4");
+  REQUIRE(run("(read-csv \"" + file + "\")") == run("(set-property \"layout\" \"columns\" (list (list 1 3) (list 2 4)))"));
+  REQUIRE(run("(read-csv \"" + file + "\" 1)") == run("(list 2 4)"));
+
+  write_file(file, "");
+  REQUIRE(run("(read-csv \"" + file + "\")") == run("(set-property \"layout\" \"columns\" (list))"));
+
+  std::remove(file.c_str());
+}
+
+TEST_CASE( "Test errors reading a csv file", "[data_import]" ) {
+
+  const std::string file = "data_import_test.csv";
+  write_file(file, "a,b\n1,2\n3\n");
+
+  REQUIRE_THROWS_AS(run("(read-csv \"no_such_file.csv\")"), SemanticError);
+  // a directory opens on some platforms, but is not a file to read
+  REQUIRE_THROWS_WITH(run("(read-csv \".\")"), Catch::Contains("could not open file"));
+  REQUIRE_THROWS_WITH(run("(read-binary \".\" \"f64\")"), Catch::Contains("could not open file"));
+  REQUIRE_THROWS_AS(run("(read-csv 1)"), SemanticError);
+  REQUIRE_THROWS_AS(run("(read-csv \"" + file + "\" \"c\")"), SemanticError);
+  REQUIRE_THROWS_AS(run("(read-csv \"" + file + "\" -1)"), SemanticError);
+  REQUIRE_THROWS_AS(run("(read-csv \"" + file + "\" 1)"), SemanticError);
+  // the short row does not hold the column asked for, but does hold the first
+  REQUIRE(run("(read-csv \"" + file + "\" 0)") == run("(list 1 3)"));
+
+  write_file(file, "1,2\n3,four\n");
+  REQUIRE_THROWS_WITH(run("(read-csv \"" + file + "\")"),
+                      Catch::Contains("line 2") && Catch::Contains("not a number"));
+
+  std::remove(file.c_str());
+}
+
+TEST_CASE( "Test reading a file of binary numbers", "[data_import]" ) {
+
+  const std::string file = "data_import_test.bin";
+  double doubles[] = {1.5, -2, 3, 4};
+  write_file(file, std::string(reinterpret_cast<const char *>(doubles), sizeof(doubles)));
+
+  Expression values = run("(read-binary \"" + file + "\" \"f64\")");
+  REQUIRE(values == run("(list 1.5 -2 3 4)"));
+  REQUIRE(values.isNumericList());
+
+  Expression columns = run("(read-binary \"" + file + "\" \"f64\" 2)");
+  REQUIRE(columns == run("(set-property \"layout\" \"columns\" (list (list 1.5 3) (list -2 4)))"));
+  REQUIRE(columns.checkProperty("layout", "columns"));
+
+  // three doubles do not make rows of two
+  write_file(file, std::string(reinterpret_cast<const char *>(doubles), 3 * sizeof(double)));
+  REQUIRE_THROWS_AS(run("(read-binary \"" + file + "\" \"f64\" 2)"), SemanticError);
+
+  std::int32_t ints[] = {7, -8, 9};
+  write_file(file, std::string(reinterpret_cast<const char *>(ints), sizeof(ints)));
+  REQUIRE(run("(read-binary \"" + file + "\" \"i32\")") == run("(list 7 -8 9)"));
+  REQUIRE(run("(read-binary \"" + file + "\" \"i32\" 3)") ==
+          run("(set-property \"layout\" \"columns\" (list (list 7) (list -8) (list 9)))"));
+
+  REQUIRE_THROWS_AS(run("(read-binary \"" + file + "\" \"u8\")"), SemanticError);
+  REQUIRE_THROWS_AS(run("(read-binary \"" + file + "\" \"i32\" 0)"), SemanticError);
+  REQUIRE_THROWS_AS(run("(read-binary \"" + file + "\")"), SemanticError);
+
+  std::remove(file.c_str());
+}
+
+TEST_CASE( "Test discrete-plot draws data read as columns", "[data_import]" ) {
+
+  const std::string file = "data_import_test.csv";
+  write_file(file, "x,y\n0,1\n1,3\n2,-2\n");
+
+  Expression columns = run("(discrete-plot (read-csv \"" + file + "\") (list))");
+  Expression points = run("(discrete-plot (list (list 0 1) (list 1 3) (list 2 -2)) (list))");
+  REQUIRE(columns == points);
+
+  // as may columns made otherwise
+  REQUIRE(run("(discrete-plot (set-property \"layout\" \"columns\" (list (range 0 2 1) (list 1 3 -2))) (list))")
+          == points);
+  REQUIRE_THROWS_AS(run("(discrete-plot (read-csv \"" + file + "\" 0 1 1) (list))"), SemanticError);
+
+  std::remove(file.c_str());
+}
+
+TEST_CASE( "Test the values read from files are not cached", "[data_import]" ) {
+
+  const std::string file = "data_import_test.csv";
+  Interpreter interp;
+  interp.setMemoize(true, std::chrono::microseconds(0));
+
+  write_file(file, "1\n2\n");
+  std::string cell = "(length (read-csv \"" + file + "\" 0))";
+  REQUIRE(evaluate_in(interp, cell) == Expression(2.));
+
+  write_file(file, "1\n2\n3\n");
+  REQUIRE(evaluate_in(interp, cell) == Expression(3.));
+
+  // nor is what is computed from them by a lambda
+  evaluate_in(interp, "(define load (lambda (f) (read-csv f 0)))");
+  cell = "(length (load \"" + file + "\"))";
+  REQUIRE(evaluate_in(interp, cell) == Expression(3.));
+  write_file(file, "1\n");
+  REQUIRE(evaluate_in(interp, cell) == Expression(1.));
+
+  std::remove(file.c_str());
+}
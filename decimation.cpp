@@ -0,0 +1,139 @@
+#include "decimation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+thread_local std::size_t current_columns = 0;
+
+std::vector<std::size_t> all_of(std::size_t n){
+  std::vector<std::size_t> indices(n);
+  std::iota(indices.begin(), indices.end(), std::size_t(0));
+  return indices;
+}
+
+}
+
+std::vector<std::size_t> decimate_minmax(const std::vector<double> & x, const std::vector<double> & y,
+                                         std::size_t columns){
+
+  std::size_t n = x.size();
+  columns = std::max<std::size_t>(1, columns);
+  if(n <= 2 * columns){
+    return all_of(n);
+  }
+
+  auto range = std::minmax_element(x.begin(), x.end());
+  double x0 = *range.first, width = *range.second - *range.first;
+
+  // the lowest and highest point seen in each column, n meaning none
+  std::vector<std::size_t> low(columns, n), high(columns, n);
+  for(std::size_t i = 0; i < n; ++i){
+    std::size_t c = (width > 0) ? static_cast<std::size_t>((x[i] - x0) / width * columns) : 0;
+    c = std::min(c, columns - 1);
+    if(low[c] == n || y[i] < y[low[c]]) low[c] = i;
+    if(high[c] == n || y[i] > y[high[c]]) high[c] = i;
+  }
+
+  std::vector<std::size_t> kept;
+  kept.reserve(2 * columns);
+  for(std::size_t c = 0; c < columns; ++c){
+    if(low[c] == n) continue;
+    kept.push_back(low[c]);
+    if(high[c] != low[c]) kept.push_back(high[c]);
+  }
+  std::sort(kept.begin(), kept.end());
+  return kept;
+}
+
+std::vector<std::size_t> decimate_lttb(const std::vector<double> & x, const std::vector<double> & y,
+                                       std::size_t threshold){
+
+  std::size_t n = x.size();
+  threshold = std::max<std::size_t>(3, threshold);
+  if(n <= threshold){
+    return all_of(n);
+  }
+
+  // the buckets are taken along x, so visit the points in order of x
+  std::vector<std::size_t> order = all_of(n);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](std::size_t a, std::size_t b){ return x[a] < x[b]; });
+
+  // the first and last points are always kept, the rest is split into
+  // threshold - 2 buckets of equal count
+  double bucket = static_cast<double>(n - 2) / static_cast<double>(threshold - 2);
+  std::vector<std::size_t> kept;
+  kept.reserve(threshold);
+  kept.push_back(order[0]);
+
+  std::size_t previous = order[0];
+  for(std::size_t b = 0; b < threshold - 2; ++b){
+    std::size_t begin = static_cast<std::size_t>(std::floor(b * bucket)) + 1;
+    std::size_t end = static_cast<std::size_t>(std::floor((b + 1) * bucket)) + 1;
+
+    // the average of the next bucket stands in for the point kept from it
+    std::size_t next_begin = end;
+    std::size_t next_end = std::min(static_cast<std::size_t>(std::floor((b + 2) * bucket)) + 1, n);
+    double ax = 0, ay = 0;
+    if(b + 1 == threshold - 2 || next_begin >= next_end){
+      ax = x[order[n - 1]];
+      ay = y[order[n - 1]];
+    }
+    else{
+      for(std::size_t j = next_begin; j < next_end; ++j){
+        ax += x[order[j]];
+        ay += y[order[j]];
+      }
+      ax /= static_cast<double>(next_end - next_begin);
+      ay /= static_cast<double>(next_end - next_begin);
+    }
+
+    double best_area = -1;
+    std::size_t best = order[begin];
+    for(std::size_t j = begin; j < end; ++j){
+      std::size_t i = order[j];
+      double area = std::abs((x[previous] - ax) * (y[i] - y[previous]) -
+                             (x[previous] - x[i]) * (ay - y[previous]));
+      if(area > best_area){
+        best_area = area;
+        best = i;
+      }
+    }
+    kept.push_back(best);
+    previous = best;
+  }
+
+  kept.push_back(order[n - 1]);
+  std::sort(kept.begin(), kept.end());
+  return kept;
+}
+
+std::vector<std::size_t> decimate(Decimation method, const std::vector<double> & x,
+                                  const std::vector<double> & y, std::size_t columns){
+
+  switch(method){
+    case Decimation::MinMax:
+      return decimate_minmax(x, y, columns);
+    case Decimation::LTTB:
+      // about as many points as minmax keeps for the same width
+      return decimate_lttb(x, y, 2 * columns);
+    case Decimation::None:
+      break;
+  }
+  return all_of(x.size());
+}
+
+PlotWidthScope::PlotWidthScope(std::size_t columns) noexcept: previous(current_columns){
+  current_columns = columns;
+}
+
+PlotWidthScope::~PlotWidthScope(){
+  current_columns = previous;
+}
+
+std::size_t PlotWidthScope::current() noexcept{
+  return current_columns;
+}
@@ -0,0 +1,66 @@
+/*! \file decimation.hpp
+Defines the decimation of plot data to the resolution it is drawn at.
+
+A plot drawn a given number of pixel columns wide cannot show more than a
+few points per column, so large data sets are reduced before any graphics
+are built for them. Each method returns the indices of the points kept, in
+increasing order, so the caller keeps any other data of the points.
+ */
+#ifndef DECIMATION_HPP
+#define DECIMATION_HPP
+
+#include <cstddef>
+#include <vector>
+
+/// The method used to decimate plot data
+enum class Decimation {None, MinMax, LTTB};
+
+/*! Keep the lowest and highest point of every column, splitting the range
+  of x into columns of equal width. Data of at most two points per column
+  is kept whole.
+  \param x the abscissas of the points, in any order
+  \param y the ordinates of the points
+  \param columns the number of columns, at least 1
+  \return the indices of the points kept
+ */
+std::vector<std::size_t> decimate_minmax(const std::vector<double> & x, const std::vector<double> & y,
+                                         std::size_t columns);
+
+/*! Keep threshold points by Largest-Triangle-Three-Buckets, which picks the
+  point of each bucket making the largest triangle with its neighbours.
+  Data of at most threshold points is kept whole.
+  \param x the abscissas of the points, in any order
+  \param y the ordinates of the points
+  \param threshold the number of points to keep, at least 3
+  \return the indices of the points kept
+ */
+std::vector<std::size_t> decimate_lttb(const std::vector<double> & x, const std::vector<double> & y,
+                                       std::size_t threshold);
+
+/// Decimate with method for a plot the given number of columns wide
+std::vector<std::size_t> decimate(Decimation method, const std::vector<double> & x,
+                                  const std::vector<double> & y, std::size_t columns);
+
+/*! \class PlotWidthScope
+\brief Sets the width, in pixel columns, the plots evaluated on the calling
+thread are drawn at, for its lifetime.
+
+The notebook sets it to the width of its view. Where no scope is open, as on
+the command line, the width is unknown.
+*/
+class PlotWidthScope {
+public:
+  explicit PlotWidthScope(std::size_t columns) noexcept;
+  ~PlotWidthScope();
+
+  PlotWidthScope(const PlotWidthScope &) = delete;
+  PlotWidthScope & operator=(const PlotWidthScope &) = delete;
+
+  /// return the width plots are drawn at on the calling thread, 0 if unknown
+  static std::size_t current() noexcept;
+
+private:
+  std::size_t previous;
+};
+
+#endif
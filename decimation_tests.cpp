@@ -0,0 +1,68 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "decimation.hpp"
+
+// a noisy signal with one spike at index spike
+static void make_signal(std::size_t n, std::size_t spike, std::vector<double> & x, std::vector<double> & y){
+  x.resize(n);
+  y.resize(n);
+  for(std::size_t i = 0; i < n; ++i){
+    x[i] = static_cast<double>(i);
+    y[i] = std::sin(0.01 * i);
+  }
+  y[spike] = 100;
+}
+
+TEST_CASE( "Test small data is not decimated", "[decimation]" ) {
+
+  std::vector<double> x = {3, 1, 2}, y = {0, 1, 2};
+  std::vector<std::size_t> all = {0, 1, 2};
+  REQUIRE(decimate_minmax(x, y, 2) == all);
+  REQUIRE(decimate_lttb(x, y, 3) == all);
+  REQUIRE(decimate(Decimation::None, x, y, 1) == all);
+}
+
+TEST_CASE( "Test min/max decimation keeps the extremes of each column", "[decimation]" ) {
+
+  std::vector<double> x, y;
+  make_signal(100000, 4321, x, y);
+
+  std::vector<std::size_t> kept = decimate_minmax(x, y, 500);
+  REQUIRE(kept.size() <= 1000);
+  REQUIRE(kept.size() > 500);
+  REQUIRE(std::is_sorted(kept.begin(), kept.end()));
+  REQUIRE(std::find(kept.begin(), kept.end(), 4321) != kept.end());
+
+  // the global extremes survive
+  std::size_t lowest = std::min_element(y.begin(), y.end()) - y.begin();
+  REQUIRE(std::find(kept.begin(), kept.end(), lowest) != kept.end());
+
+  // all points in one column
+  std::vector<double> same(10, 1.), values = {5, 1, 7, 3, 9, 0, 2, 4, 6, 8};
+  REQUIRE(decimate_minmax(same, values, 1) == std::vector<std::size_t>({4, 5}));
+}
+
+TEST_CASE( "Test LTTB decimation", "[decimation]" ) {
+
+  std::vector<double> x, y;
+  make_signal(100000, 4321, x, y);
+
+  std::vector<std::size_t> kept = decimate_lttb(x, y, 1000);
+  REQUIRE(kept.size() == 1000);
+  REQUIRE(std::is_sorted(kept.begin(), kept.end()));
+  REQUIRE(std::adjacent_find(kept.begin(), kept.end()) == kept.end());
+  REQUIRE(kept.front() == 0);
+  REQUIRE(kept.back() == 99999);
+  REQUIRE(std::find(kept.begin(), kept.end(), 4321) != kept.end());
+
+  // points out of order are bucketed along x
+  std::vector<double> rx(x.rbegin(), x.rend()), ry(y.rbegin(), y.rend());
+  std::vector<std::size_t> reversed = decimate_lttb(rx, ry, 1000);
+  REQUIRE(reversed.size() == 1000);
+  REQUIRE(std::find(reversed.begin(), reversed.end(), 99999 - 4321) != reversed.end());
+
+  REQUIRE(decimate(Decimation::LTTB, x, y, 500).size() == 1000);
+}
@@ -1,10 +1,18 @@
 #include "environment.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 
+#include "arena.hpp"
+#include "data_import.hpp"
 #include "environment.hpp"
+#include "memo_cache.hpp"
+#include "numeric_kernels.hpp"
+#include "numeric_list.hpp"
 #include "semantic_error.hpp"
+#include "stream_plot.hpp"
 
 /***********************************************************************
 Helper Functions
@@ -21,6 +29,139 @@ bool is_num_type(const Expression & e) {
   return a.isComplex() || a.isNumber();
 }
 
+// predicate, at least one argument is a list
+bool has_list_arg(const std::vector<Expression> & args) {
+  for(auto & a : args){
+    if(a.isList()) return true;
+  }
+  return false;
+}
+
+// an operand of an elementwise operation: a numeric list or a broadcast scalar
+struct Operand {
+  std::shared_ptr<const NumericList> owned; // set when the list was packed here
+  const NumericList * list = nullptr;       // nullptr for a scalar
+  std::complex<double> scalar;
+  bool complex = false;
+};
+
+// pack a list mixing real and complex numbers as complex, nullptr if an item is not a number
+std::shared_ptr<const NumericList> pack_promoted(const std::vector<Expression> & items) {
+  std::vector<std::complex<double>> values;
+  values.reserve(items.size());
+  for(auto & e : items){
+    if(!e.isNone() || e.hasProperties() || !(e.head().isNumber() || e.head().isComplex())){
+      return nullptr;
+    }
+    values.push_back(e.head().asComplex());
+  }
+  return std::make_shared<NumericList>(std::move(values));
+}
+
+Operand make_operand(const Expression & e, const std::string & name) {
+
+  Operand op;
+  if(e.isList()){
+    op.list = e.numericList();
+    if(op.list == nullptr){
+      op.owned = e.tailLength() == 0 ?
+        std::make_shared<NumericList>(std::vector<double>()) : NumericList::pack(e.contents());
+      if(!op.owned){
+        op.owned = pack_promoted(e.contents());
+      }
+      op.list = op.owned.get();
+    }
+    if(op.list == nullptr){
+      throw SemanticError("Error: in call to " + name + ", list argument not all numbers");
+    }
+    op.complex = op.list->isComplex();
+  }
+  else if(is_num_type(e)){
+    op.scalar = e.head().asComplex();
+    op.complex = e.head().isComplex();
+  }
+  else{
+    throw SemanticError("Error: in call to " + name + ", argument not a number");
+  }
+  return op;
+}
+
+// copy the values of an operand into complex storage
+std::vector<std::complex<double>> complex_values(const Operand & op) {
+  if(op.list == nullptr) return {op.scalar};
+  if(op.list->isComplex()) return op.list->complex();
+  return std::vector<std::complex<double>>(op.list->real().begin(), op.list->real().end());
+}
+
+Operand combine(BinaryOp code, const Operand & a, const Operand & b, const std::string & name) {
+
+  if(a.list && b.list && a.list->size() != b.list->size()){
+    throw SemanticError("Error: in call to " + name + ", list arguments of different length");
+  }
+  bool scalar = !a.list && !b.list;
+  std::size_t n = scalar ? 1 : (a.list ? a.list->size() : b.list->size());
+
+  Operand result;
+  result.complex = a.complex || b.complex;
+
+  if(result.complex){
+    std::vector<std::complex<double>> left = complex_values(a), right = complex_values(b);
+    std::vector<std::complex<double>> out(n);
+    binary_kernel(code, left.data(), !a.list, right.data(), !b.list, out.data(), n);
+    if(scalar){
+      result.scalar = out[0];
+      return result;
+    }
+    result.owned = std::make_shared<NumericList>(std::move(out));
+  }
+  else{
+    double left = a.scalar.real(), right = b.scalar.real();
+    std::vector<double> out(n);
+    binary_kernel(code, a.list ? a.list->real().data() : &left, !a.list,
+                  b.list ? b.list->real().data() : &right, !b.list, out.data(), n);
+    if(scalar){
+      result.scalar = out[0];
+      return result;
+    }
+    result.owned = std::make_shared<NumericList>(std::move(out));
+  }
+  result.list = result.owned.get();
+  return result;
+}
+
+Expression to_expression(const Operand & op) {
+  if(op.list == nullptr){
+    return op.complex ? Expression(op.scalar) : Expression(op.scalar.real());
+  }
+  return make_packed_list(op.owned);
+}
+
+// apply code elementwise across all arguments, broadcasting scalars
+Expression fold_elementwise(BinaryOp code, const std::vector<Expression> & args, const std::string & name) {
+  Operand result = make_operand(args[0], name);
+  for(std::size_t i = 1; i < args.size(); ++i){
+    result = combine(code, result, make_operand(args[i], name), name);
+  }
+  if(!result.owned && result.list){
+    // a single list argument passes through unchanged
+    return args[0];
+  }
+  return to_expression(result);
+}
+
+// apply code to every item of a numeric list argument
+Expression unary_elementwise(UnaryOp code, const Expression & arg, const std::string & name) {
+  Operand op = make_operand(arg, name);
+  if(op.complex){
+    std::vector<std::complex<double>> out(op.list->size());
+    unary_kernel(code, op.list->complex().data(), out.data(), out.size());
+    return make_numeric_list(std::move(out));
+  }
+  std::vector<double> out(op.list->size());
+  unary_kernel(code, op.list->real().data(), out.data(), out.size());
+  return make_numeric_list(std::move(out));
+}
+
 /***********************************************************************
 Each of the functions below have the signature that corresponds to the
 typedef'd Procedure function pointer.
@@ -34,6 +175,10 @@ Expression default_proc(const std::vector<Expression> & args){
 
 Expression add(const std::vector<Expression> & args){
 
+  if(has_list_arg(args)){
+    return fold_elementwise(BinaryOp::Add, args, "add");
+  }
+
   std::complex<double> result;
   bool noComplexArgs = true;
   // check all aruments are numbers, while adding
@@ -61,6 +206,10 @@ Expression add(const std::vector<Expression> & args){
 
 Expression mul(const std::vector<Expression> & args){
 
+  if(has_list_arg(args)){
+    return fold_elementwise(BinaryOp::Mul, args, "mul");
+  }
+
   // check all aruments are numbers, while multiplying
   std::complex<double> result = 1.0;
   bool noComplexArgs = true;
@@ -89,6 +238,13 @@ Expression mul(const std::vector<Expression> & args){
 
 Expression subneg(const std::vector<Expression> & args){
 
+  if(has_list_arg(args) && nargs_equal(args,1)){
+    return unary_elementwise(UnaryOp::Neg, args[0], "negate");
+  }
+  else if(has_list_arg(args) && nargs_equal(args,2)){
+    return fold_elementwise(BinaryOp::Sub, args, "subtraction");
+  }
+
   std::complex<double> result = 0;
 
   // preconditions
@@ -127,6 +283,13 @@ Expression subneg(const std::vector<Expression> & args){
 
 Expression div(const std::vector<Expression> & args) {
 
+  if(has_list_arg(args) && nargs_equal(args,1)){
+    return unary_elementwise(UnaryOp::Inv, args[0], "division");
+  }
+  else if(has_list_arg(args) && nargs_equal(args,2)){
+    return fold_elementwise(BinaryOp::Div, args, "division");
+  }
+
   std::complex<double> result;
   bool noComplexArgs = true;
 
@@ -164,6 +327,21 @@ Expression div(const std::vector<Expression> & args) {
 };
 
 Expression sqrt(const std::vector<Expression> & args) {
+
+  if(nargs_equal(args, 1) && args[0].isList()) {
+    Operand op = make_operand(args[0], "sqrt");
+    bool negative = !op.complex && std::any_of(op.list->real().begin(), op.list->real().end(),
+                                               [](double x){ return x < 0; });
+    if(negative) {
+      // negative items become complex while the others stay real
+      std::vector<Expression> result;
+      for(std::size_t i = 0; i < op.list->size(); ++i) {
+        result.push_back(sqrt({op.list->at(i)}));
+      }
+      return make_list(std::move(result));
+    }
+    return unary_elementwise(UnaryOp::Sqrt, args[0], "sqrt");
+  }
 	double result = 0;
   std::complex<double> cresult;
 
@@ -187,9 +365,16 @@ Expression sqrt(const std::vector<Expression> & args) {
 
 Expression pow(const std::vector<Expression> & args) {
 
+	if (nargs_equal(args, 2) && has_list_arg(args)) {
+		return fold_elementwise(BinaryOp::Pow, args, "power function");
+	}
+
 	std::complex<double> result(0,0);
 
 	if (nargs_equal(args, 2)) {
+		if(args[0].head().isNumber() && args[1].head().isNumber()) {
+			return Expression(real_power(args[0].head().asNumber(), args[1].head().asNumber()));
+		}
 		if(is_num_type(args[0]) && is_num_type(args[1])) {
 			result = std::pow(args[0].head().asComplex(), args[1].head().asComplex());
 		}
@@ -210,6 +395,15 @@ Expression pow(const std::vector<Expression> & args) {
 };
 
 Expression ln(const std::vector<Expression> & args) {
+
+    if (nargs_equal(args, 1) && args[0].isList()) {
+        Operand op = make_operand(args[0], "ln");
+        if (op.complex || std::any_of(op.list->real().begin(), op.list->real().end(),
+                                      [](double x){ return !(x > 0); })) {
+            throw SemanticError("Error: in call to ln: invalid argument.");
+        }
+        return unary_elementwise(UnaryOp::Ln, args[0], "ln");
+    }
     double result = 0;
 
     if (nargs_equal(args, 1)) {
@@ -227,6 +421,13 @@ Expression ln(const std::vector<Expression> & args) {
 };
 
 Expression sin(const std::vector<Expression> & args) {
+
+    if (nargs_equal(args, 1) && args[0].isList()) {
+        if (make_operand(args[0], "sin").complex) {
+            throw SemanticError("Error: in call to sin: invalid argument.");
+        }
+        return unary_elementwise(UnaryOp::Sin, args[0], "sin");
+    }
     double result = 0;
 
     if (nargs_equal(args, 1)) {
@@ -244,6 +445,13 @@ Expression sin(const std::vector<Expression> & args) {
 };
 
 Expression cos(const std::vector<Expression> & args) {
+
+    if (nargs_equal(args, 1) && args[0].isList()) {
+        if (make_operand(args[0], "cos").complex) {
+            throw SemanticError("Error: in call to cos: invalid argument.");
+        }
+        return unary_elementwise(UnaryOp::Cos, args[0], "cos");
+    }
     double result = 0;
 
     if (nargs_equal(args, 1)) {
@@ -261,6 +469,13 @@ Expression cos(const std::vector<Expression> & args) {
 };
 
 Expression tan(const std::vector<Expression> & args) {
+
+    if (nargs_equal(args, 1) && args[0].isList()) {
+        if (make_operand(args[0], "tan").complex) {
+            throw SemanticError("Error: in call to tan: invalid argument.");
+        }
+        return unary_elementwise(UnaryOp::Tan, args[0], "tan");
+    }
     double result = 0;
 
     if (nargs_equal(args, 1)) {
@@ -378,6 +593,9 @@ Expression first(const std::vector<Expression> & args) {
 	if (nargs_equal(args, 1)) {
 		if(args[0].isList()) {
 			if (args[0].tailLength() > 0) {
+				if (args[0].isNumericList()) {
+					return args[0].numericList()->at(0);
+				}
 				Expression result = *args[0].tailConstBegin();
 				return Expression(result);
 			}
@@ -398,13 +616,20 @@ Expression rest(const std::vector<Expression> & args) {
       throw SemanticError("Error: in call to rest: not a list argument.");
     else {
       if(args[0].tailLength() > 0) {
+        const NumericList * values = args[0].numericList();
+        if(values && values->isComplex()) {
+          return make_numeric_list(std::vector<std::complex<double>>(values->complex().begin() + 1, values->complex().end()));
+        }
+        else if(values) {
+          return make_numeric_list(std::vector<double>(values->real().begin() + 1, values->real().end()));
+        }
         std::vector<Expression> result;
         auto e = args[0].tailConstBegin();
         e++;
         while(e != args[0].tailConstEnd()){
           result.emplace_back(*e++);
         }
-        return Expression(result);
+        return make_list(std::move(result));
       }
       else
         throw SemanticError("Error: argument to rest is an empty list.");
@@ -427,17 +652,43 @@ Expression length(const std::vector<Expression> & args) {
     throw SemanticError("Error: invalid number of arguments for length.");
 };
 
+// append the items of a packed list to values, returns false if the kinds differ
+bool append_packed(const NumericList * list, std::vector<double> & real, std::vector<std::complex<double>> & complex) {
+  if(list->isComplex()) {
+    if(!real.empty()) return false;
+    complex.insert(complex.end(), list->complex().begin(), list->complex().end());
+  }
+  else {
+    if(!complex.empty()) return false;
+    real.insert(real.end(), list->real().begin(), list->real().end());
+  }
+  return true;
+}
+
 Expression append(const std::vector<Expression> & args) {
   if(nargs_equal(args, 2)) {
     if(!args[0].isList())
       throw SemanticError("Error: first argument not a list.");
     else {
+      const NumericList * values = args[0].numericList();
+      bool plain = args[1].isNone() && !args[1].hasProperties();
+      if(values && plain && values->isComplex() && args[1].head().isComplex()) {
+        std::vector<std::complex<double>> result(values->complex());
+        result.push_back(args[1].head().asComplex());
+        return make_numeric_list(std::move(result));
+      }
+      else if(values && plain && !values->isComplex() && args[1].head().isNumber()) {
+        std::vector<double> result(values->real());
+        result.push_back(args[1].head().asNumber());
+        return make_numeric_list(std::move(result));
+      }
+
       std::vector<Expression> result;
       for(auto e = args[0].tailConstBegin(); e != args[0].tailConstEnd(); e++){
         result.emplace_back(*e);
       }
       result.emplace_back(args[1]);
-      return Expression(result);
+      return make_list(std::move(result));
     }
   }
   else
@@ -449,6 +700,17 @@ Expression join(const std::vector<Expression> & args) {
     if(!args[0].isList() || !args[1].isList())
       throw SemanticError("Error: an argument to join not a list.");
     else {
+      if(args[0].isNumericList() && args[1].isNumericList()) {
+        std::vector<double> real;
+        std::vector<std::complex<double>> complex;
+        if(append_packed(args[0].numericList(), real, complex) &&
+           append_packed(args[1].numericList(), real, complex)) {
+          if(!complex.empty())
+            return make_numeric_list(std::move(complex));
+          return make_numeric_list(std::move(real));
+        }
+      }
+
       std::vector<Expression> result;
       for(auto e = args[0].tailConstBegin(); e != args[0].tailConstEnd(); e++){
         result.emplace_back(*e);
@@ -456,7 +718,7 @@ Expression join(const std::vector<Expression> & args) {
       for(auto e = args[1].tailConstBegin(); e != args[1].tailConstEnd(); e++){
         result.emplace_back(*e);
       }
-      return Expression(result);
+      return make_list(std::move(result));
     }
   }
   else
@@ -473,7 +735,6 @@ Expression range(const std::vector<Expression> & args) {
   if (args[0].head().asNumber() > args[1].head().asNumber())
     throw SemanticError("Error: begin greater than end in range");
 
-  std::vector<Expression> result;
   double start, stop, step;
   start = args[0].head().asNumber();
   stop = args[1].head().asNumber();
@@ -490,10 +751,8 @@ Expression range(const std::vector<Expression> & args) {
     step = 1.0;
   }
 
-  for(double i = start; i <= stop; i += step) {
-    result.push_back(Expression(Atom(i)));
-  } 
-  return Expression(result);
+  // the numbers are stored only if they are read by position
+  return make_packed_list(std::make_shared<NumericList>(NumericList::Sequence{start, stop, step}));
 };
 
 const double PI = std::atan2(0, -1);
@@ -501,36 +760,106 @@ const double EXP = std::exp(1);
 const std::complex<double> IMG (0.0,1.0);
 const std::complex<double> NEG_IMG (0.0,-1.0);
 
-Environment::Environment(){
+namespace {
+
+// versions 0 and 1 mean unbound and built-in
+std::atomic<std::uint64_t> last_version(1);
+
+std::uint64_t next_version(){
+  return ++last_version;
+}
+
+}
+
+Environment::Environment(): parent(nullptr){
 
   reset();
 }
 
+Environment::Environment(const Environment * parent): parent(parent){
+}
+
 Environment & Environment::operator=(const Environment & a){
 
+  // the bindings are shared until either environment changes them
   envmap = a.envmap;
+  parent = a.parent;
   return *this;
 }
 
+Environment::EnvMap & Environment::local(){
+
+  if(!envmap && parent != nullptr){
+    // a frame lasts no longer than the evaluation applying the lambda
+    envmap = std::allocate_shared<EnvMap>(ArenaAllocator<EnvMap>());
+  }
+  else if(!envmap){
+    envmap = std::make_shared<EnvMap>();
+  }
+  else if(envmap.use_count() > 1){
+    envmap = std::make_shared<EnvMap>(*envmap);
+  }
+  return *envmap;
+}
+
+const Environment::EnvResult * Environment::find(const Atom & sym, SlotHint * hint) const{
+  if(!sym.isSymbol()) return nullptr;
+
+  SymbolId key = sym.symbolId();
+  for(const Environment * frame = this; ; frame = frame->parent){
+    const EnvResult * result = nullptr;
+    if(frame->envmap){
+      result = hint ? frame->envmap->find(key, *hint) : frame->envmap->find(key);
+    }
+    if(frame->parent == nullptr){
+      // what a frame binds is bound by the evaluation itself, so only the
+      // reads reaching the global environment matter to the memo cache
+      note_read(sym, result ? result->version : 0);
+      return result;
+    }
+    if(result != nullptr){
+      return result;
+    }
+  }
+}
+
+const Environment::EnvResult * Environment::find_quietly(SymbolId key) const{
+
+  for(const Environment * frame = this; frame != nullptr; frame = frame->parent){
+    if(!frame->envmap) continue;
+    const EnvResult * result = frame->envmap->find(key);
+    if(result != nullptr){
+      return result;
+    }
+  }
+  return nullptr;
+}
+
+const Environment::EnvResult * Environment::lookup(const Atom & sym) const{
+
+  return find(sym, nullptr);
+}
+
+const Environment::EnvResult * Environment::lookup(const Atom & sym, SlotHint & hint) const{
+
+  return find(sym, &hint);
+}
+
 bool Environment::is_known(const Atom & sym) const{
-  if(!sym.isSymbol()) return false;
 
-  return envmap.find(sym.asString()) != envmap.end();
+  return find(sym, nullptr) != nullptr;
 }
 
 void Environment::__shadowing_helper(const Atom & sym, const Expression & new_sym_val){
 
-  if(this->envmap.find(sym.asString()) != this->envmap.end()){
-    this->envmap.erase(sym.asString());
-  }
+  // add_exp only writes into this frame, so the parents are left untouched
   this->add_exp(sym, new_sym_val);
- }
+}
 
 bool Environment::is_exp(const Atom & sym) const{
-  if(!sym.isSymbol()) return false;
 
-  auto result = envmap.find(sym.asString());
-  return (result != envmap.end()) && (result->second.type == ExpressionType);
+  const EnvResult * result = find(sym, nullptr);
+  return (result != nullptr) && (result->type == ExpressionType);
 }
 
 Expression Environment::evaluate_an_exp(Expression & e){
@@ -541,11 +870,9 @@ Expression Environment::get_exp(const Atom & sym) const{
 
   Expression exp;
 
-  if(sym.isSymbol()){
-    auto result = envmap.find(sym.asString());
-    if((result != envmap.end()) && (result->second.type == ExpressionType)){
-      exp = result->second.exp;
-    }
+  const EnvResult * result = find(sym, nullptr);
+  if((result != nullptr) && (result->type == ExpressionType)){
+    exp = result->exp;
   }
 
   return exp;
@@ -557,119 +884,151 @@ void Environment::add_exp(const Atom & sym, const Expression & exp){
         throw SemanticError("Error: during add_exp: Attempt to add non-symbol to environment");
     }
 
-    // error if overwriting symbol map
-    if(envmap.find(sym.asString()) != envmap.end()){
-        envmap.erase(sym.asString());
+    // the root outlives any evaluation, so its bindings may not be transient
+    Expression value(exp);
+    if(parent == nullptr){
+      promote_to_heap(value);
     }
 
-    envmap.emplace(sym.asString(), EnvResult(ExpressionType, exp));
+    // overwrite any existing binding in this frame, keeping its version
+    // when the value is the very same, as when a cell is evaluated again
+    EnvResult & binding = local()[sym.symbolId()];
+    if(binding.type == ExpressionType && binding.version > 1 && binding.exp.identical(value)){
+      return;
+    }
+    binding = EnvResult(ExpressionType, value);
+    binding.version = next_version();
 }
 
-bool Environment::is_proc(const Atom & sym) const{
-  if(!sym.isSymbol()) return false;
-
-  auto result = envmap.find(sym.asString());
-  return (result != envmap.end()) && (result->second.type == ProcedureType);
+bool Environment::is_root() const noexcept{
+  return parent == nullptr;
 }
 
-Procedure Environment::get_proc(const Atom & sym) const{
+std::uint64_t Environment::version(const Atom & sym) const{
+
+  const EnvResult * result = sym.isSymbol() ? find_quietly(sym.symbolId()) : nullptr;
+  return result ? result->version : 0;
+}
 
-  Procedure proc = default_proc;
+std::vector<std::pair<std::string, Expression>> Environment::definitions() const{
 
-  if(sym.isSymbol()){
-    auto result = envmap.find(sym.asString());
-    if((result != envmap.end()) && (result->second.type == ProcedureType)){
-      return result->second.proc;
+  std::vector<std::pair<std::string, Expression>> result;
+  if(envmap){
+    for(const auto & binding : *envmap){
+      // the built-ins are the bindings of version 1
+      if(binding.value.type == ExpressionType && binding.value.version > 1){
+        result.emplace_back(SymbolTable::name(binding.key), binding.value.exp);
+      }
     }
   }
-
-  return default_proc;
+  std::sort(result.begin(), result.end(), [](const std::pair<std::string, Expression> & a,
+                                             const std::pair<std::string, Expression> & b){
+    return a.first < b.first;
+  });
+  return result;
 }
 
-/*
-Reset the environment to the default state. First remove all entries and
-then re-add the default ones.
- */
-void Environment::reset(){
-
-  envmap.clear();
-
-  // Built-In value of pi
-  envmap.emplace("pi", EnvResult(ExpressionType, Expression(PI)));
-
-  // Built-In value of e
-  envmap.emplace("e", EnvResult(ExpressionType, Expression(EXP)));
-
-  // Built-In value of i
-  envmap.emplace("I", EnvResult(ExpressionType, Expression(IMG)));
-
-  // Built-In value of -i
-  envmap.emplace("-I", EnvResult(ExpressionType, Expression(NEG_IMG)));
-
-  // Procedure: add;
-  envmap.emplace("+", EnvResult(ProcedureType, add));
-
-  // Procedure: subneg;
-  envmap.emplace("-", EnvResult(ProcedureType, subneg));
-
-  // Procedure: mul;
-  envmap.emplace("*", EnvResult(ProcedureType, mul));
+bool Environment::is_proc(const Atom & sym) const{
 
-  // Procedure: div;
-  envmap.emplace("/", EnvResult(ProcedureType, div));
+  const EnvResult * result = find(sym, nullptr);
+  return (result != nullptr) && (result->type == ProcedureType);
+}
 
-  // Procedure: sqrt;
-  envmap.emplace("sqrt", EnvResult(ProcedureType, sqrt));
+Procedure Environment::get_proc(const Atom & sym) const{
 
-  // Procedure: pow;
-  envmap.emplace("^", EnvResult(ProcedureType, pow));
+  const EnvResult * result = find(sym, nullptr);
+  if((result != nullptr) && (result->type == ProcedureType)){
+    return result->proc;
+  }
 
-  // Procedure: ln;
-  envmap.emplace("ln", EnvResult(ProcedureType, ln));
+  return default_proc;
+}
 
-  // Procedure: sin;
-  envmap.emplace("sin", EnvResult(ProcedureType, sin));
+namespace {
 
-  // Procedure: cos;
-  envmap.emplace("cos", EnvResult(ProcedureType, cos));
+struct BuiltinProcedure {
+  const char * name;
+  Procedure proc;
+  // the value depends on the arguments alone, and calling it does nothing else
+  bool pure;
+};
 
-  // Procedure: tan;
-  envmap.emplace("tan", EnvResult(ProcedureType, tan));
+// the table is fixed at compile time, so building the default bindings only
+// copies it into the map
+constexpr BuiltinProcedure BUILTIN_PROCEDURES[] = {
+  {"+", add, true},
+  {"-", subneg, true},
+  {"*", mul, true},
+  {"/", div, true},
+  {"sqrt", sqrt, true},
+  {"^", pow, true},
+  {"ln", ln, true},
+  {"sin", sin, true},
+  {"cos", cos, true},
+  {"tan", tan, true},
+  {"real", real, true},
+  {"imag", imag, true},
+  {"mag", mag, true},
+  {"arg", arg, true},
+  {"conj", conj, true},
+  {"list", list, true},
+  {"first", first, true},
+  {"rest", rest, true},
+  {"length", length, true},
+  {"append", append, true},
+  {"join", join, true},
+  {"range", range, true},
+  {"read-csv", read_csv, false},
+  {"read-binary", read_binary, false},
+  {"stream-plot", stream_plot, false},
+  {"stream-append", stream_append, false},
+};
 
-  // Procedure: real;
-  envmap.emplace("real", EnvResult(ProcedureType, real));
+}
 
-  // Procedure: imag;
-  envmap.emplace("imag", EnvResult(ProcedureType, imag));
+/*
+Reset the environment to the default state, sharing the bindings of the
+built-ins, which are only made once.
+ */
+void Environment::reset(){
 
-  // Procedure: mag;
-  envmap.emplace("mag", EnvResult(ProcedureType, mag));
+  static const std::shared_ptr<EnvMap> defaults = default_bindings();
+  envmap = defaults;
+  parent = nullptr;
+}
 
-  // Procedure: arg;
-  envmap.emplace("arg", EnvResult(ProcedureType, arg));
+bool is_pure_procedure(Procedure proc) noexcept{
 
-  // Procedure: conj;
-  envmap.emplace("conj", EnvResult(ProcedureType, conj));
+  for(const BuiltinProcedure & builtin : BUILTIN_PROCEDURES){
+    if(builtin.proc == proc){
+      return builtin.pure;
+    }
+  }
+  return false;
+}
 
-  // Procedure: list as procedure;
-  envmap.emplace("list", EnvResult(ProcedureType, list));
+std::shared_ptr<Environment::EnvMap> Environment::default_bindings(){
 
-  // Procedure: first;
-  envmap.emplace("first", EnvResult(ProcedureType, first));
+  // the bindings outlive any evaluation that happens to be running
+  ArenaScope suspend(nullptr);
+  auto result = std::make_shared<EnvMap>();
+  EnvMap & bindings = *result;
 
-  // Procedure: rest;
-  envmap.emplace("rest", EnvResult(ProcedureType, rest));
+  // Built-In value of pi
+  bindings[SymbolTable::intern("pi")] = EnvResult(ExpressionType, Expression(PI));
 
-  // Procedure: length;
-  envmap.emplace("length", EnvResult(ProcedureType, length));
+  // Built-In value of e
+  bindings[SymbolTable::intern("e")] = EnvResult(ExpressionType, Expression(EXP));
 
-  // Procedure: append;
-  envmap.emplace("append", EnvResult(ProcedureType, append));
+  // Built-In value of i
+  bindings[SymbolTable::intern("I")] = EnvResult(ExpressionType, Expression(IMG));
 
-  // Procedure: join;
-  envmap.emplace("join", EnvResult(ProcedureType, join));
+  // Built-In value of -i
+  bindings[SymbolTable::intern("-I")] = EnvResult(ExpressionType, Expression(NEG_IMG));
 
-  // Procedure: range;
-  envmap.emplace("range", EnvResult(ProcedureType, range));
+  for(const BuiltinProcedure & builtin : BUILTIN_PROCEDURES){
+    bindings[SymbolTable::intern(builtin.name)] = EnvResult(ProcedureType, builtin.proc);
+  }
 
+  return result;
 }
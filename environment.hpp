@@ -11,11 +11,16 @@ needed.
 #define ENVIRONMENT_HPP
 
 // system includes
-#include <map>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 // module includes
 #include "atom.hpp"
 #include "expression.hpp"
+#include "symbol_map.hpp"
 
 /*! \typedef Procedure
 \brief A Procedure is a C++ function pointer taking a vector of
@@ -23,6 +28,11 @@ needed.
 */
 typedef Expression (*Procedure)(const std::vector<Expression> & args);
 
+/*! Predicate, proc is a built-in procedure whose value depends on its
+  arguments alone and which does nothing else, such as reading a file
+ */
+bool is_pure_procedure(Procedure proc) noexcept;
+
 /*! \class Environment
 \brief A class representing the interpreter environment.
 
@@ -36,13 +46,48 @@ return you can obtain
 the mapped-to value using get_exp or get_proc.
 
 To add an symbol to expression mapping use the add_exp member function.
+
+An Environment may also be a frame chained to a parent environment, as
+created when a lambda is applied. Lookups that miss in the local frame
+continue in the parent, while additions only ever write into the local
+frame, so creating a frame costs nothing beyond the bindings put in it.
+
+Copying an Environment takes constant time: the copies share their bindings
+until one of them adds a binding, which first copies the map of its frame.
+
+The bindings of a frame are held in a SymbolMap keyed by the interned
+identifier of the symbol (see symbol_map.hpp). When the caller needs both
+the kind and the value of a binding, lookup finds it once rather than a
+predicate and a getter each searching for it.
  */
 class Environment {
 public:
+
+  // Environment is a mapping from symbols to expressions or procedures
+  enum EnvResultType { ExpressionType, ProcedureType };
+
+  /// A binding of a symbol, as returned by lookup
+  struct EnvResult {
+    EnvResultType type;
+    Expression exp; // used when type is ExpressionType
+    Procedure proc; // used when type is ProcedureType
+    std::uint64_t version = 1; // the built-ins all have version 1
+
+    // constructors for use in container emplace
+    EnvResult() : type(ExpressionType), version(0){};
+    EnvResult(EnvResultType t, Expression e) : type(t), exp(e){};
+    EnvResult(EnvResultType t, Procedure p) : type(t), proc(p){};
+  };
   /*! Construct the default environment with built-in procedures and
    * definitions. */
   Environment();
 
+  /*! Construct an empty frame chained to a parent environment.
+    \param parent the environment to continue lookups in, which must outlive
+    this frame
+   */
+  explicit Environment(const Environment * parent);
+
   /*! Assignment operator for an expression
    * definitions. */
   Environment & operator=(const Environment & a);
@@ -53,6 +98,20 @@ public:
    */
   bool is_known(const Atom &sym) const;
 
+  /*! Find the innermost binding of a symbol.
+    \param sym the symbol to lookup
+    \return the binding, or nullptr if sym is unbound; the binding is valid
+    until the next addition to the frame holding it
+   */
+  const EnvResult * lookup(const Atom & sym) const;
+
+  /*! Find the innermost binding of a symbol, trying the slot of hint first.
+    \param sym the symbol to lookup
+    \param hint the slot sym was last found in, updated where it is found
+    \return as lookup
+   */
+  const EnvResult * lookup(const Atom & sym, SlotHint & hint) const;
+
   /*! Determine if a symbol has been defined as an expression.
     \param sym the sumbol to lookup
     \return true if the symbol has been defined in the environment as an
@@ -60,6 +119,10 @@ public:
    */
   bool is_exp(const Atom &sym) const;
 
+  /*! Bind sym in the local frame, hiding any binding of it in the parents.
+    \param sym the symbol to bind
+    \param new_sym the expression the symbol should map to
+   */
   void __shadowing_helper(const Atom & sym, const Expression & new_sym);
   Expression evaluate_an_exp(Expression & e);
 
@@ -90,27 +153,49 @@ public:
   */
   Procedure get_proc(const Atom &sym) const;
 
-  /*! Reset the environment to its default state. */
+  /*! Reset the environment to its default state, detaching it from any
+    parent. */
   void reset();
 
+  /// predicate, this is the global environment rather than a frame
+  bool is_root() const noexcept;
+
+  /*! Get the version of the binding of a symbol, which changes whenever the
+    symbol is bound to a different value.
+    \param sym the symbol to lookup
+    \return the version, or 0 if sym is unbound
+   */
+  std::uint64_t version(const Atom & sym) const;
+
+  /*! Get the symbols the local frame binds to expressions, other than the
+    built-ins, e.g. to save the global environment (see snapshot.hpp).
+    \return the symbols and their expressions, ordered by symbol
+   */
+  std::vector<std::pair<std::string, Expression>> definitions() const;
+
 private:
 
-  // Environment is a mapping from symbols to expressions or procedures
-  enum EnvResultType { ExpressionType, ProcedureType };
+  typedef SymbolMap<EnvResult> EnvMap;
 
-  struct EnvResult {
-    EnvResultType type;
-    Expression exp; // used when type is ExpressionType
-    Procedure proc; // used when type is ProcedureType
+  // the environment map of the local frame, shared with the copies of this
+  // environment until one of them writes, and null until the frame binds
+  std::shared_ptr<EnvMap> envmap;
 
-    // constructors for use in container emplace
-    EnvResult(){};
-    EnvResult(EnvResultType t, Expression e) : type(t), exp(e){};
-    EnvResult(EnvResultType t, Procedure p) : type(t), proc(p){};
-  };
+  // the enclosing frame, or nullptr for the global environment
+  const Environment * parent;
+
+  // find the innermost binding of sym, or nullptr if it is unbound, noting
+  // the read of the global environment for the memo cache
+  const EnvResult * find(const Atom & sym, SlotHint * hint) const;
+
+  // find without noting the read
+  const EnvResult * find_quietly(SymbolId key) const;
+
+  // the map of the local frame, made unshared for writing
+  EnvMap & local();
 
-  // the environment map
-  std::map<std::string, EnvResult> envmap;
+  // the bindings of the built-ins
+  static std::shared_ptr<EnvMap> default_bindings();
 };
 
 #endif
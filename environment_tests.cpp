@@ -532,4 +532,51 @@ TEST_CASE("Testing range procedure", "[environment]") {
 
     std::vector<Expression> two_arg = { Expression(1), Expression(3) };
     REQUIRE(prange(two_arg) == Expression(resultList));
-}
\ No newline at end of file
+}
+TEST_CASE( "Test chained frames", "[environment]" ) {
+  Environment env;
+  env.add_exp(Atom("x"), Expression(1.0));
+  env.add_exp(Atom("y"), Expression(2.0));
+
+  Environment frame(&env);
+  REQUIRE(frame.is_exp(Atom("pi")));
+  REQUIRE(frame.is_proc(Atom("+")));
+  REQUIRE(frame.get_exp(Atom("y")) == Expression(2.0));
+
+  frame.__shadowing_helper(Atom("x"), Expression(10.0));
+  frame.add_exp(Atom("z"), Expression(3.0));
+  REQUIRE(frame.get_exp(Atom("x")) == Expression(10.0));
+  REQUIRE(frame.is_exp(Atom("z")));
+
+  REQUIRE(env.get_exp(Atom("x")) == Expression(1.0));
+  REQUIRE(!env.is_known(Atom("z")));
+}
+
+TEST_CASE( "Test lookup of bindings", "[environment]" ) {
+  Environment env;
+  env.add_exp(Atom("x"), Expression(1.0));
+
+  const Environment::EnvResult * binding = env.lookup(Atom("x"));
+  REQUIRE(binding != nullptr);
+  REQUIRE(binding->type == Environment::ExpressionType);
+  REQUIRE(binding->exp == Expression(1.0));
+
+  binding = env.lookup(Atom("+"));
+  REQUIRE(binding != nullptr);
+  REQUIRE(binding->type == Environment::ProcedureType);
+  REQUIRE(binding->proc == env.get_proc(Atom("+")));
+
+  REQUIRE(env.lookup(Atom("unbound")) == nullptr);
+  REQUIRE(env.lookup(Atom(1.0)) == nullptr);
+  REQUIRE(env.lookup(Atom("\"x\"")) == nullptr);
+
+  // the same hint serves the lookups through a frame and after a redefinition
+  SlotHint hint;
+  Environment frame(&env);
+  frame.add_exp(Atom("x"), Expression(2.0));
+  REQUIRE(frame.lookup(Atom("x"), hint)->exp == Expression(2.0));
+  REQUIRE(env.lookup(Atom("x"), hint)->exp == Expression(1.0));
+  env.add_exp(Atom("x"), Expression(3.0));
+  REQUIRE(env.lookup(Atom("x"), hint)->exp == Expression(3.0));
+  REQUIRE(frame.lookup(Atom("x"), hint)->exp == Expression(2.0));
+}
@@ -1,9 +1,20 @@
 #include "expression.hpp"
 
+#include <cmath>
+#include <exception>
 #include <sstream>
 #include <list>
+#include <set>
 
+#include "cancellation.hpp"
+#include "decimation.hpp"
 #include "environment.hpp"
+#include "graphics.hpp"
+#include "memo_cache.hpp"
+#include "numeric_list.hpp"
+#include "profiler.hpp"
+#include "sampling.hpp"
+#include "thread_pool.hpp"
 #include "semantic_error.hpp"
 
 Expression::Expression(): m_type(ExpType::None)
@@ -13,25 +24,22 @@ Expression::Expression(): m_type(ExpType::None)
 Expression::Expression(const Atom & a): m_head(a), m_type(ExpType::Singleton)
 {}
 
-// recursive copy
-Expression::Expression(const Expression & a) {
-
-  m_type = a.m_type;
-  m_head = a.m_head;
-  m_properties = a.m_properties;
-  for(auto e : a.m_tail){
-    m_tail.push_back(e);
-  }
+// Constructor for lists
+Expression::Expression(const std::vector<Expression> & items): m_tail(items) {
+  m_type = ExpType::List;
 }
 
-// Constructor for lists
-Expression::Expression(const std::vector<Expression> & items) {
+Expression::Expression(std::vector<Expression> && items): m_tail(std::move(items)) {
   m_type = ExpType::List;
-  m_tail = items;
 }
 
+// Constructor for parsed expressions, which keep the type of their head
+Expression::Expression(const Atom & a, std::vector<Expression> && tail):
+  m_head(a), m_tail(std::move(tail)), m_type(ExpType::Singleton)
+{}
+
 //Constructor for Lambda functions
-Expression::Expression(const std::vector<Expression> & args, Expression & func) {
+Expression::Expression(const std::vector<Expression> & args, const Expression & func) {
 
   m_type = ExpType::Lambda;
   m_tail.push_back(args);
@@ -46,22 +54,29 @@ Expression::Expression(std::string type, const std::vector<Expression> & data) {
   m_tail = data;
 }
 
-Expression & Expression::operator=(const Expression & a){
+Expression::~Expression(){
 
-  // prevent self-assignment
-  if(this != &a){
-      m_type = a.m_type;
-      m_head = a.m_head;
-      m_properties = a.m_properties;
-      m_tail.clear();
-      for(auto e : a.m_tail)
-        m_tail.push_back(e);
+  if(m_tail.size() == 0){
+    return;
+  }
+  bool deep = std::any_of(m_tail.begin(), m_tail.end(), [](const Expression & e){
+    return e.m_tail.size() > 0;
+  });
+  if(!deep){
+    return;
   }
 
-  return *this;
+  // take the trees no other expression shares apart one level at a time,
+  // so that each expression is destroyed with an empty tail
+  std::vector<Expression> pending;
+  m_tail.release(pending);
+  while(!pending.empty()){
+    Expression e = std::move(pending.back());
+    pending.pop_back();
+    e.m_tail.release(pending);
+  }
 }
 
-
 Atom & Expression::head(){
   return m_head;
 }
@@ -78,6 +93,25 @@ bool Expression::isList() const noexcept {
 	return (m_type == ExpType::List);
 }
 
+bool Expression::isNumericList() const noexcept {
+  return m_numeric != nullptr;
+}
+
+const NumericList * Expression::numericList() const noexcept {
+  return m_numeric.get();
+}
+
+bool Expression::hasProperties() const noexcept {
+  return !m_properties.empty();
+}
+
+void Expression::unpack(){
+  if(m_numeric){
+    m_tail = SharedVector<Expression>(m_numeric->boxed());
+    m_numeric.reset();
+  }
+}
+
 bool Expression::isLambda() const noexcept {
   return (m_type == ExpType::Lambda);
 }
@@ -86,73 +120,170 @@ bool Expression::isEmpty() const noexcept {
   return m_type == ExpType::None;
 }
 
+Expression::ObjectKind Expression::objectKind() const noexcept {
+
+  static const std::string key = "\"object-name\"";
+  static const std::pair<std::string, ObjectKind> names[] = {
+    {"\"point\"", ObjectKind::Point}, {"\"line\"", ObjectKind::Line},
+    {"\"text\"", ObjectKind::Text}, {"\"polyline\"", ObjectKind::Polyline},
+    {"\"stream-plot\"", ObjectKind::StreamPlot}, {"\"stream-data\"", ObjectKind::StreamData},
+  };
+
+  auto property = m_properties.find(key);
+  if(property == m_properties.end()){
+    return ObjectKind::None;
+  }
+  const Expression & name = property->second;
+  if(name.tailLength() == 0 && !name.hasProperties()){
+    for(const auto & entry : names){
+      if(name.m_head.isStringOf(entry.first)){
+        return entry.second;
+      }
+    }
+  }
+  return ObjectKind::Other;
+}
+
+// predicate, the type property is the plain symbol plot
+static bool has_plot_type(const SharedMap<std::string, Expression> & properties, const Atom & plot){
+
+  static const std::string key = "type";
+  auto property = properties.find(key);
+  return property != properties.end() && property->second.tailLength() == 0 &&
+         !property->second.hasProperties() && property->second.head() == plot;
+}
+
 bool Expression::isDP() const noexcept {
 
-  std::string target = "type";
-  if (m_properties.find(target) != m_properties.end()) {
-    return m_properties.at(target) == Expression(Atom("DP"));
+  static const Atom dp("DP");
+  if (m_properties.find("type") != m_properties.end()) {
+    return has_plot_type(m_properties, dp);
   }
 
   return m_type == ExpType::Plot;
 }
 
 bool Expression::isCP() const noexcept {
-  for(auto &p : m_properties){
-    if(p.first.compare("type")){
-      return p.second == Expression(Atom("CP"));
-    }
-  }
-  return false;
+
+  static const Atom cp("CP");
+  return has_plot_type(m_properties, cp);
 }
 
 void Expression::append(const Atom & a){
+  unpack();
   m_tail.emplace_back(a);
 }
 
 Expression * Expression::tail(){
   Expression * ptr = nullptr;
+  unpack();
 
   if(m_tail.size() > 0){
-    ptr = &m_tail.back();
+    ptr = &m_tail.write().back();
   }
 
   return ptr;
 }
 
-std::vector<Expression> Expression::contents() const noexcept {
-  return m_tail;
+const std::vector<Expression> & Expression::contents() const noexcept {
+  return m_numeric ? m_numeric->boxed() : m_tail.items();
 }
 
 size_t Expression::tailLength() const noexcept{
-  return m_tail.size();
+  return m_numeric ? m_numeric->size() : m_tail.size();
 }
 
 Expression::ConstIteratorType Expression::tailConstBegin() const noexcept{
-  return m_tail.cbegin();
+  return contents().cbegin();
 }
 
 Expression::ConstIteratorType Expression::tailConstEnd() const noexcept{
-  return m_tail.cend();
+  return contents().cend();
+}
+
+static Expression call(const Atom & op, const Environment::EnvResult * callee,
+                       const std::vector<Expression> & args, const Environment & env);
+
+// predicate, the binding is of a lambda
+static bool is_lambda(const Environment::EnvResult * binding){
+  return binding != nullptr && binding->type == Environment::ExpressionType &&
+         binding->exp.isLambda();
 }
 
-Expression apply(const Atom & op, const std::vector<Expression> & args, const Environment & env){
+// bind the parameters of lambda to args in frame
+static void bind_arguments(const Expression & lambda, const std::vector<Expression> & args,
+                           Environment & frame){
 
-  if ( env.get_exp(op).isLambda() ) {
-    Environment inner_scope = env;
+  Expression arg_template = *lambda.tailConstBegin();
 
-    Expression lambda = inner_scope.get_exp(op);
-    Expression arg_template = *lambda.tailConstBegin();
+  if(args.size() != arg_template.tailLength()){
+    throw SemanticError("Error: during apply: Error in call to procedure: invalid number of arguments.");
+  }
 
-    if(args.size() != arg_template.tailLength()){
-      throw SemanticError("Error: during apply: Error in call to procedure: invalid number of arguments.");
+  size_t count = 0;
+  for(auto p = arg_template.tailConstBegin(); p != arg_template.tailConstEnd(); p++){
+    frame.__shadowing_helper(p->head(), args[count++]);
+  }
+}
+
+/* Call lambda with args in a fresh frame chained to env. A lambda called in
+tail position reuses the frame rather than chaining another to it: the
+caller has nothing left to evaluate, and the parameters of the callee hide
+those of the caller in the frame just as they would from a frame chained to
+it, so a chain of tail calls runs in constant space. */
+static Expression apply_lambda(const Expression & lambda, const std::vector<Expression> & args,
+                               const Environment & env){
+
+  Environment inner_scope(&env);
+  bind_arguments(lambda, args, inner_scope);
+
+  Expression callee = lambda;
+  while(true){
+    const Expression * body = &callee.contents().back();
+
+    // the last expression of a begin is in tail position
+    while(body->head().specialForm() == BeginForm && body->tailLength() > 0){
+      for(auto e = body->tailConstBegin(); e + 1 != body->tailConstEnd(); ++e){
+        e->eval(inner_scope);
+      }
+      body = &body->contents().back();
     }
 
-    size_t count = 0;
-    for(auto p = arg_template.tailConstBegin(); p != arg_template.tailConstEnd(); p++){
-      inner_scope.__shadowing_helper(p->head(), args[count++]);
+    if(body->head().specialForm() != NotSpecialForm || body->tailLength() == 0){
+      return body->eval(inner_scope);
     }
 
-    return lambda.tail()->eval(inner_scope);
+    // a call, evaluated as by eval_form up to the application
+    check_interrupt();
+    std::vector<Expression> values;
+    for(auto e = body->tailConstBegin(); e != body->tailConstEnd(); ++e){
+      values.push_back(e->eval(inner_scope));
+    }
+    const Environment::EnvResult * binding = inner_scope.lookup(body->head(), body->slotHint());
+    if(!is_lambda(binding)){
+      return call(body->head(), binding, values, inner_scope);
+    }
+    // copied, as binding the arguments may move the binding
+    Expression next = binding->exp;
+
+    Profiler * profiler = Profiler::current();
+    if(profiler != nullptr){
+      // the frame of the caller ends where that of the callee begins
+      profiler->leave();
+      profiler->enter(Profiler::LambdaKind, body->head());
+    }
+    bind_arguments(next, values, inner_scope);
+    callee = std::move(next);
+  }
+}
+
+// call the lambda or procedure op is bound to, callee being its binding in env
+static Expression call(const Atom & op, const Environment::EnvResult * callee,
+                       const std::vector<Expression> & args, const Environment & env){
+
+  if(is_lambda(callee)) {
+    ProfileFrame frame(Profiler::LambdaKind, op);
+    return apply_lambda(callee->exp, args, env);
   }
 
   // head must be a symbol
@@ -161,22 +292,28 @@ Expression apply(const Atom & op, const std::vector<Expression> & args, const En
   }
 
   // must map to a proc
-  if(!env.is_proc(op)){
+  if(callee == nullptr || callee->type != Environment::ProcedureType){
     throw SemanticError("Error during evaluation: symbol does not name a procedure");
   }
 
-  // map from symbol to proc
-  Procedure proc = env.get_proc(op);
-
   // call proc with args
-  return proc(args);
+  ProfileFrame frame(Profiler::ProcedureKind, op);
+  return callee->proc(args);
+}
+
+// call what op is bound to in env, looking it up from the slot of hint
+static Expression apply(const Atom & op, const std::vector<Expression> & args,
+                        const Environment & env, SlotHint & hint){
+
+  return call(op, env.lookup(op, hint), args, env);
 }
 
-Expression Expression::handle_lookup(const Atom & head, const Environment & env){
+Expression Expression::handle_lookup(const Atom & head, const Environment & env) const{
 
     if(head.isSymbol()) { // if symbol is in env return value
-      if(env.is_exp(head)) {
-	      return env.get_exp(head);
+      const Environment::EnvResult * binding = env.lookup(head, m_slot);
+      if(binding != nullptr && binding->type == Environment::ExpressionType) {
+	      return binding->exp;
       }
       else {
 	      throw SemanticError("Error during handle lookup: unknown symbol " + head.asString());
@@ -190,18 +327,7 @@ Expression Expression::handle_lookup(const Atom & head, const Environment & env)
     }
 }
 
-Expression Expression::handle_begin(Environment & env){
-
-  Expression result;
-  for(Expression::IteratorType it = m_tail.begin(); it != m_tail.end(); ++it){
-    result = it->eval(env);
-  }
-
-  // go through a whole "program" and return the last result
-  return result;
-}
-
-Expression Expression::handle_define(Environment & env){
+Expression Expression::handle_define(Environment & env) const{
 
   // check expected tail size
   if(m_tail.size() != 2){
@@ -215,7 +341,8 @@ Expression Expression::handle_define(Environment & env){
 
   // but tail[0] must not be a special-form or procedure
   std::string s = m_tail[0].head().asSymbol();
-  if((s == "define") || (s == "begin") || (s == "lambda") || (s == "list")) {
+  SpecialForm form = m_tail[0].head().specialForm();
+  if((form == DefineForm) || (form == BeginForm) || (form == LambdaForm) || (form == ListForm)) {
     throw SemanticError("Error during handle define: attempt to redefine a special-form");
   }
   else if(env.is_proc(m_tail[0].head())) {
@@ -235,17 +362,7 @@ Expression Expression::handle_define(Environment & env){
   }
 }
 
-Expression Expression::handle_list(Environment & env){
-
-  std::vector<Expression> listItems;
-  for(auto e = m_tail.begin(); e != m_tail.end(); e++){
-    listItems.push_back(e->eval(env));
-  }
-
-  return Expression(listItems);
-}
-
-Expression Expression::handle_lambda(Environment & env) {
+Expression Expression::handle_lambda(Environment & env) const {
 
   std::vector<Expression> argument_template;
   argument_template.emplace_back(Expression(m_tail[0].head()));
@@ -257,70 +374,251 @@ Expression Expression::handle_lambda(Environment & env) {
   return return_exp;
 }
 
-Expression Expression::handle_apply(Environment & env){
+// throw if op, the first argument of a map, does not name a procedure
+static void check_map_procedure(const Expression & op, const Environment & env){
 
-  if(m_tail.size() != 2){
-    throw SemanticError("Error during apply: invalid number of arguments");
+  const Environment::EnvResult * found = env.lookup(op.head(), op.slotHint());
+  if(!is_lambda(found)){
+    if(found == nullptr || found->type != Environment::ProcedureType || op.tailLength() > 0){
+      throw SemanticError("Error: first argument to map not a procedure");
+    }
   }
+}
 
-  Atom op =  m_tail[0].head();
-  if ( env.get_exp(op).isLambda() ) {
+namespace {
+
+// the results of a map, packed as they come while they are all real numbers
+class MapResults {
+public:
+  void reserve(std::size_t n){
+    reals.reserve(n);
   }
-  else {
-    if(!env.is_proc(op) || m_tail[0].tailLength() > 0){ 
-      throw SemanticError("Error: first argument to apply not a procedure");
+
+  void push(Expression && value){
+    if(packing){
+      if(value.isNone() && !value.hasProperties() && value.head().isNumber()){
+        reals.push_back(value.head().asNumber());
+        return;
+      }
+      packing = false;
+      boxed.reserve(reals.capacity());
+      for(double x : reals){
+        boxed.emplace_back(Atom(x));
+      }
+      std::vector<double>().swap(reals);
     }
+    boxed.push_back(std::move(value));
   }
 
-  Expression arguments = m_tail[1].eval(env);
-  if(!arguments.isList()){
+  Expression list(){
+    if(packing){
+      return reals.empty() ? Expression(std::vector<Expression>()) : make_numeric_list(std::move(reals));
+    }
+    // results that are all complex numbers come back packed too
+    return make_list(std::move(boxed));
+  }
+
+private:
+  bool packing = true;
+  std::vector<double> reals;
+  std::vector<Expression> boxed;
+};
+
+// the arguments of an apply
+struct ApplyArguments {
+  void reserve(std::size_t n){
+    items.reserve(n);
+  }
+
+  void push(Expression && value){
+    items.push_back(std::move(value));
+  }
+
+  std::vector<Expression> items;
+};
+
+// a map fused into a stream of items
+struct MapStage {
+  Atom op;
+  Environment::EnvResult callee;
+};
+
+}
+
+/* Evaluate list, the list argument of a map or an apply, passing its items
+   in order to results. The maps that list nests, down to the first list
+   that is not a map, are fused into a single pass over the items of that
+   source list, each item going through every map before the next is taken.
+   Neither the lists between the maps nor, when it is a range, the source
+   list are stored.
+
+   The maps are checked, and looked up once the source is evaluated, as they
+   would be one after the other, and the error thrown is the one they would
+   throw: that of the innermost map failing, at its first failing item. The
+   calls of the maps on different items interleave, so only the order of
+   their side effects, such as a stream-append, differs.
+ */
+template <typename Results>
+static void stream_list(const Expression & list, Environment & env, Results & results){
+
+  const Expression * source = &list;
+  std::vector<const Expression *> maps;
+  while(source->head().specialForm() == MapForm && source->tailLength() == 2){
+    check_map_procedure(source->contents()[0], env);
+    maps.push_back(source);
+    source = &source->contents()[1];
+  }
+
+  Expression items = source->eval(env);
+  if(!items.isList()){
     throw SemanticError("Error: second argument to apply not a list");
   }
 
-  std::vector<Expression> list_args;
-  for(auto e = arguments.tailConstBegin(); e != arguments.tailConstEnd(); e++){
-    list_args.push_back(*e);
+  // the innermost map is called first
+  std::vector<MapStage> stages;
+  for(auto m = maps.rbegin(); m != maps.rend(); ++m){
+    const Expression & op = (*m)->contents()[0];
+    const Environment::EnvResult * found = env.lookup(op.head(), op.slotHint());
+    stages.push_back(MapStage{op.head(), found ? *found : Environment::EnvResult()});
+  }
+
+  std::size_t n = items.tailLength();
+  const NumericList * values = items.numericList();
+  const NumericList::Sequence * sequence = values ? values->sequence() : nullptr;
+  double x = sequence ? sequence->start : 0;
+
+  // after a map fails, only the maps inside of it go on, as their errors
+  // would come first
+  std::size_t live = stages.size();
+  std::exception_ptr failure;
+
+  results.reserve(n);
+  std::vector<Expression> argument(1);
+  for(std::size_t i = 0; i < n; ++i){
+    check_interrupt();
+    Expression value;
+    if(sequence){
+      // summed as range sums them
+      value = Expression(Atom(x));
+      x += sequence->step;
+    }
+    else{
+      value = values ? values->at(i) : items.contents()[i];
+    }
+
+    std::size_t k = 0;
+    try{
+      for(; k < live; ++k){
+        argument[0] = std::move(value);
+        value = call(stages[k].op, &stages[k].callee, argument, env);
+      }
+    }
+    catch(const SemanticError &){
+      failure = std::current_exception();
+      live = k;
+      if(live == 0){
+        break;
+      }
+      continue;
+    }
+    if(!failure){
+      results.push(std::move(value));
+    }
   }
 
-  return apply(op, list_args, env);
+  if(failure){
+    std::rethrow_exception(failure);
+  }
 }
 
-Expression Expression::handle_map(Environment & env){
+Expression Expression::handle_apply(Environment & env) const{
 
   if(m_tail.size() != 2){
-    throw SemanticError("Error during map: invalid number of arguments");
+    throw SemanticError("Error during apply: invalid number of arguments");
   }
 
   Atom op =  m_tail[0].head();
-  if ( env.get_exp(op).isLambda() ) {
-  }
-  else {
-    if(!env.is_proc(op) || m_tail[0].tailLength() > 0){ 
-      throw SemanticError("Error: first argument to map not a procedure");
+  const Environment::EnvResult * callee = env.lookup(op, m_tail[0].slotHint());
+  if(!is_lambda(callee)){
+    if(callee == nullptr || callee->type != Environment::ProcedureType || m_tail[0].tailLength() > 0){
+      throw SemanticError("Error: first argument to apply not a procedure");
     }
   }
 
+  // a list of maps is passed as it is made
+  ApplyArguments arguments;
+  stream_list(m_tail[1], env, arguments);
+
+  return apply(op, arguments.items, env, m_tail[0].slotHint());
+}
+
+Expression Expression::handle_map(Environment & env, bool parallel) const{
+
+  if(m_tail.size() != 2){
+    throw SemanticError("Error during map: invalid number of arguments");
+  }
+
+  if(!parallel){
+    MapResults results;
+    stream_list(*this, env, results);
+    return results.list();
+  }
+
+  // pmap splits the items among threads, so it reads the list by position
+  check_map_procedure(m_tail[0], env);
+  Atom op =  m_tail[0].head();
 
   Expression list_evaled = m_tail[1].eval(env);
   if(!list_evaled.isList()){
     throw SemanticError("Error: second argument to apply not a list");
   }
 
-  std::vector<Expression> return_args;
-  std::vector<Expression> temp;
-  Expression temp_e;
+  // the list may have rebound op, so it is looked up again, once for all
+  // of the items
+  const Environment::EnvResult * found = env.lookup(op, m_tail[0].slotHint());
+  const Environment::EnvResult callee = found ? *found : Environment::EnvResult();
 
-  for(auto e = list_evaled.tailConstBegin(); e != list_evaled.tailConstEnd(); e++){
-    temp.emplace_back(*e);
-    temp_e = apply(m_tail[0].head(), temp, env);
-    return_args.push_back(temp_e);
-    temp.clear();
-  }
+  std::size_t n = list_evaled.tailLength();
+  std::vector<Expression> return_args(n);
+  const NumericList * values = list_evaled.numericList();
+
+  auto body = [&](std::size_t begin, std::size_t end){
+    std::vector<Expression> temp(1);
+    for(std::size_t i = begin; i < end; ++i){
+      check_interrupt();
+      temp[0] = values ? values->at(i) : list_evaled.contents()[i];
+      return_args[i] = call(op, &callee, temp, env);
+    }
+  };
+
+  // every result has its own slot and env is only read, so ranges are
+  // independent; the error of the lowest item wins as it would serially
+  // the arena of the evaluation is not thread-safe, so the ranges allocate
+  // from the heap in its name, and they watch the token of the evaluation
+  // and note what they read for it
+  Arena * arena = Arena::current();
+  const CancellationToken * token = CancellationToken::current();
+  ReadLog * reads = ReadLog::current();
+  auto in_arena = [&](std::size_t begin, std::size_t end){
+    ArenaScope scope(arena, false);
+    CancellationScope watch(token);
+    ReadLog local;
+    {
+      ReadLogScope record(reads ? &local : nullptr);
+      body(begin, end);
+    }
+    if(reads){
+      reads->merge(local.reads());
+    }
+  };
+  ThreadPool & pool = ThreadPool::shared();
+  pool.parallel_for(n, std::max<std::size_t>(1, n / (8 * (pool.size() + 1))), in_arena);
 
-  return Expression(return_args);
+  // results that are all numbers of one kind come back packed
+  return make_list(std::move(return_args));
 }
 
-Expression Expression::handle_set_property(Environment & env) {
+Expression Expression::handle_set_property(Environment & env) const {
 
   Expression result;
 
@@ -346,7 +644,7 @@ Expression Expression::handle_set_property(Environment & env) {
   return result;
 }
 
-Expression Expression::handle_get_property(Environment & env){
+Expression Expression::handle_get_property(Environment & env) const{
   Expression target, result;
   if(m_tail.size()==2) {
     target = m_tail[1].eval(env);
@@ -371,7 +669,7 @@ Expression Expression::__getProperty(std::string key) const {
   return Expression();
 }
 
-Expression Expression::handle_discrete_plot(Environment & env){
+Expression Expression::handle_discrete_plot(Environment & env) const{
 
   if(m_tail.size() != 2){
     throw SemanticError("Error: invalid number of arguments for discrete-plot");
@@ -384,54 +682,113 @@ Expression Expression::handle_discrete_plot(Environment & env){
     throw SemanticError("Error: An argument to discrete-plot is not a list");
   }
   
-  std::vector<Expression> result;
   size_t numpoints = DATA.tailLength();
 
-  // Find the max and min values of x and y inside DATA
-  double xmax = -999, xmin = 999, ymax = -999, ymin = 999, xval, yval;
-  for(auto & p : DATA.m_tail){
-
-    xval = p.m_tail[0].head().asNumber();
-    xmax = std::max(xval, xmax);
-    xmin = std::min(xval, xmin);
+  // Read the coordinates, either from a list of points or from the two
+  // columns of data read as columns, as by read-csv
+  std::vector<double> xs, ys;
+  if(DATA.checkProperty("layout", "columns")){
+    // packed columns are copied whole
+    auto column = [](const Expression & c, std::vector<double> & values){
+      const NumericList * packed = c.numericList();
+      if(packed != nullptr && !packed->isComplex()){
+        values = packed->real();
+        return true;
+      }
+      for(const Expression & e : c.contents()){
+        if(e.tailLength() != 0 || !e.head().isNumber()) return false;
+        values.push_back(e.head().asNumber());
+      }
+      return c.isList();
+    };
+    if(numpoints != 2 || !column(DATA.contents()[0], xs) || !column(DATA.contents()[1], ys) ||
+       xs.size() != ys.size()){
+      throw SemanticError("Error: the columns of discrete-plot are not two lists of numbers of the same length");
+    }
+    numpoints = xs.size();
+  }
+  else{
+    xs.resize(numpoints);
+    ys.resize(numpoints);
+    for(size_t i = 0; i < numpoints; ++i){
+
+      const Expression & p = DATA.contents()[i];
+      if(!p.isList() || p.tailLength() != 2 ||
+         !p.contents()[0].head().isNumber() || !p.contents()[1].head().isNumber()){
+        throw SemanticError("Error: a point of discrete-plot is not a list of two numbers");
+      }
 
-    yval = p.m_tail[1].head().asNumber();
-    ymax = std::max(yval, ymax);
-    ymin = std::min(yval, ymin);
+      xs[i] = p.contents()[0].head().asNumber();
+      ys[i] = p.contents()[1].head().asNumber();
+    }
   }
 
-  // Create scale factors using the max and min edges of the data
-  // double xscale = 20/(xmax-xmin), yscale = 20/(ymax-ymin);
-  // Scale bounds of the box ??
+  // Find the max and min values of x and y
+  double xmax = -999, xmin = 999, ymax = -999, ymin = 999;
+  for(size_t i = 0; i < numpoints; ++i){
+    xmax = std::max(xs[i], xmax);
+    xmin = std::min(xs[i], xmin);
+    ymax = std::max(ys[i], ymax);
+    ymin = std::min(ys[i], ymin);
+  }
 
   double AL = xmin, AU = xmax, OL = ymin, OU = ymax;
-  double xmiddle = (xmax+xmin)/2;
-  double ymiddle = (ymin-ymax)/2;
-
-  // Make an expression for each point of the bounding box
-  Expression topLeft, topMid, topRight, midLeft, midMid, midRight, botLeft, botMid, botRight;
-  topLeft = apply(Atom("make-point"), {Expression(xmin), Expression(ymax)}, env);
-  topMid = apply(Atom("make-point"), {Expression(xmiddle), Expression(ymax)}, env);
-  topRight = apply(Atom("make-point"), {Expression(xmax), Expression(ymax)}, env);
-  midLeft = apply(Atom("make-point"), {Expression(xmin), Expression(ymiddle)}, env);
-  midMid = apply(Atom("make-point"), {Expression(xmiddle), Expression(ymiddle)}, env);
-  midRight = apply(Atom("make-point"), {Expression(xmax), Expression(ymiddle)}, env);
-  botLeft = apply(Atom("make-point"), {Expression(xmin), Expression(ymin)}, env);
-  botMid = apply(Atom("make-point"), {Expression(xmiddle), Expression(ymin)}, env);
-  botRight = apply(Atom("make-point"), {Expression(xmax), Expression(ymin)}, env);
-
-  // Make an expression to hold each line of the bounding rect 
-  Expression leftLine = apply(Atom("make-line"), {topLeft, botLeft}, env);
-  Expression rightLine = apply(Atom("make-line"), {topRight, botRight}, env);
-  Expression topLine = apply(Atom("make-line"), {topLeft, topRight}, env);
-  Expression botLine = apply(Atom("make-line"), {botLeft, botRight}, env);
-  assert(leftLine.checkProperty("object-name", "line"));
+
+  // Read the options, those choosing the level of detail are not drawn;
+  // every point is kept unless a decimation is asked for
+  Decimation decimation = Decimation::None;
+  double columns = 0;
+  std::vector<Expression> options;
+  for(auto &opt : OPTIONS.contents()){
+    if(opt.tailLength() != 2){
+      throw SemanticError("Error: an option of discrete-plot is not a list of a name and a value");
+    }
+    const Atom & name = opt.contents()[0].head();
+    const Atom & value = opt.contents()[1].head();
+    if(name.isString() && name.asString() == "\"decimation\""){
+      if(value.asString() == "\"none\"") decimation = Decimation::None;
+      else if(value.asString() == "\"minmax\"") decimation = Decimation::MinMax;
+      else if(value.asString() == "\"lttb\"") decimation = Decimation::LTTB;
+      else throw SemanticError("Error: decimation of discrete-plot not one of \"none\", \"minmax\" or \"lttb\"");
+    }
+    else if(name.isString() && name.asString() == "\"decimation-width\""){
+      if(!value.isNumber() || !(value.asNumber() >= 1)){
+        throw SemanticError("Error: decimation-width of discrete-plot not a positive number");
+      }
+      columns = value.asNumber();
+    }
+    else{
+      options.push_back(opt.contents()[1]);
+    }
+  }
+
+  // Keep only as many points as can be told apart at the drawn width,
+  // which is that of the view drawing the plot unless it is given
+  if(decimation != Decimation::None && columns == 0){
+    // the width is read from outside of the program
+    note_outside_read();
+    columns = static_cast<double>(PlotWidthScope::current());
+    if(columns == 0){
+      throw SemanticError("Error: decimation of discrete-plot needs a decimation-width where the plot width is unknown");
+    }
+  }
+  std::vector<size_t> kept = decimate(decimation, xs, ys, static_cast<size_t>(columns));
+
+  size_t numoptions = options.size();
+  std::vector<Expression> result;
+  result.reserve(8 + numoptions + 2 * kept.size() + 2);
+
+  // Make an expression for each corner of the bounding box
+  Expression topLeft = make_point(xmin, ymax);
+  Expression topRight = make_point(xmax, ymax);
+  Expression botLeft = make_point(xmin, ymin);
+  Expression botRight = make_point(xmax, ymin);
 
   // Add bounding box lines to the resulting expression
-  result.push_back(leftLine);
-  result.push_back(rightLine);
-  result.push_back(topLine);
-  result.push_back(botLine);
+  result.push_back(make_line(topLeft, botLeft));
+  result.push_back(make_line(topRight, botRight));
+  result.push_back(make_line(topLeft, topRight));
+  result.push_back(make_line(botLeft, botRight));
 
   // Add the x and y bound labels
   result.push_back(Expression(Atom("\""+ std::to_string(AL) +"\"")));
@@ -440,295 +797,369 @@ Expression Expression::handle_discrete_plot(Environment & env){
   result.push_back(Expression(Atom("\""+ std::to_string(OU) +"\"")));
 
   // Add each option to the output
-  for(auto &opt : OPTIONS.m_tail){
-    result.push_back(opt.m_tail[1]);
-  }
-  size_t numoptions = OPTIONS.tailLength();
-
-  // Add all data points and stem lines
-  Expression new_point, stem_bottom, stemline; 
+  result.insert(result.end(), options.begin(), options.end());
 
   /* If the bottom of the graph is above the orign,
   draw the stemlines down to the bottom line only */
   double stembottomy = std::max(0.0, ymin) * -1;
 
-  for(auto & point : DATA.m_tail){
-    double x = point.m_tail[0].head().asNumber();
-    double y = point.m_tail[1].head().asNumber() * -1;
-
-    new_point = apply(Atom("make-point"), {Expression(x), Expression(y)}, env);
-    stem_bottom = apply(Atom("make-point"), {Expression(x), Expression(stembottomy)}, env);
-
-    stemline = apply(Atom("make-line"), {new_point, stem_bottom}, env);
-    result.push_back(new_point);
-    result.push_back(stemline);
+  // Add all data points and stem lines
+  for(size_t i : kept){
+    Expression new_point = make_point(xs[i], ys[i] * -1);
+    Expression stemline = make_line(new_point, make_point(xs[i], stembottomy));
+    result.push_back(std::move(new_point));
+    result.push_back(std::move(stemline));
   }
 
   // Add draw axis lines if either zero line is within the boundaries
   if(0 < OU || 0 > OL){
-    Expression xAxisStart, xAxisEnd, xaxis;
-    xAxisStart = apply(Atom("make-point"), {Expression(xmax), Expression(0.0)}, env);
-    xAxisEnd = apply(Atom("make-point"), {Expression(xmin), Expression(0.0)}, env);
-    xaxis = apply(Atom("make-line"), {xAxisStart, xAxisEnd}, env);
-    result.push_back(xaxis);
+    result.push_back(make_line(make_point(xmax, 0.0), make_point(xmin, 0.0)));
   }
 
   if(0 < AU || 0 > AL){
-    Expression yAxisStart, yAxisEnd, yaxis;
-    yAxisStart = apply(Atom("make-point"), {Expression(0.0), Expression(ymax)}, env);
-    yAxisEnd = apply(Atom("make-point"), {Expression(0.0), Expression(ymin)}, env);
-
-    yaxis = apply(Atom("make-line"), {yAxisStart, yAxisEnd}, env);
-    result.push_back(yaxis);
+    result.push_back(make_line(make_point(0.0, ymax), make_point(0.0, ymin)));
   }
 
   Expression dp = Expression("DP", result);
-  dp.m_properties["numpoints"] = Expression(Atom(numpoints));
+  dp.m_properties["numpoints"] = Expression(Atom(static_cast<double>(kept.size())));
   dp.m_properties["numoptions"] = Expression(Atom(numoptions));
   return dp;
 }
 
-Expression Expression::handle_cont_plot(Environment & env){
+/* predicate, e evaluated with param bound to a list of numbers gives what it
+gives at each number in turn: e is param, a number, a symbol bound to a number,
+or a call of a broadcasting builtin on such expressions */
+static bool is_elementwise(const Expression & e, const Atom & param, const Environment & env){
+
+  static const std::set<std::string> broadcasting = {
+    "+", "-", "*", "/", "^", "sqrt", "ln", "sin", "cos", "tan"
+  };
+
+  const Atom & head = e.head();
+  if(e.isNone() && !e.hasProperties()){
+    if(head.isNumber() || head == param){
+      return true;
+    }
+    if(!head.isSymbol()){
+      return false;
+    }
+    const Environment::EnvResult * binding = env.lookup(head);
+    return binding && binding->type == Environment::ExpressionType &&
+      binding->exp.isNone() && binding->exp.head().isNumber();
+  }
+
+  if(head.specialForm() != NotSpecialForm || !head.isSymbol() || head == param ||
+     broadcasting.count(head.asSymbol()) == 0){
+    return false;
+  }
+  const Environment::EnvResult * binding = env.lookup(head);
+  if(!binding || binding->type != Environment::ProcedureType){
+    return false;
+  }
+  for(auto arg = e.tailConstBegin(); arg != e.tailConstEnd(); ++arg){
+    if(!is_elementwise(*arg, param, env)){
+      return false;
+    }
+  }
+  return true;
+}
+
+Expression Expression::handle_cont_plot(Environment & env) const{
   if(m_tail.size() != 2 && m_tail.size() != 3){
     throw SemanticError("Error: invalid number of arguments for continuous plot");
   }
 
-  std::vector<Expression> result;
-  Expression FUNC = m_tail[0];
-  Expression BOUNDS = m_tail[1];
+  Expression FUNC = m_tail[0].eval(env);
+  Expression BOUNDS = m_tail[1].eval(env);
+  Expression OPTIONS = (m_tail.size() == 3) ? m_tail[2].eval(env) : Expression(std::vector<Expression>());
 
-  if(!FUNC.eval(env).isLambda()) {
+  if(!FUNC.isLambda()) {
     throw SemanticError("Error: first argument to continuous plot not a lambda");
   }
-  if(!BOUNDS.eval(env).isList()){
+  if(!BOUNDS.isList()){
     throw SemanticError("Error: second argument to continuous plot not a list");
   }
-  if(m_tail.size() == 3 && !m_tail[2].eval(env).isList()){
+  if(!OPTIONS.isList()){
     throw SemanticError("Error: third argument to continuous plot not a list");
   }
+  if(BOUNDS.tailLength() != 2 || !BOUNDS.contents()[0].head().isNumber() ||
+     !BOUNDS.contents()[1].head().isNumber() ||
+     !(BOUNDS.contents()[0].head().asNumber() < BOUNDS.contents()[1].head().asNumber())){
+    throw SemanticError("Error: bounds of continuous plot not two increasing numbers");
+  }
+
+  // Evaluate the function over a whole batch of samples in one call when its
+  // body is known to broadcast over lists, and one sample at a time otherwise
+  const Expression & parameters = FUNC.contents().front();
+  bool batched = parameters.tailLength() == 1 &&
+    is_elementwise(FUNC.contents().back(), parameters.contents().front().head(), env);
+  auto evaluate = [&](const std::vector<double> & xs) -> std::vector<double> {
+    if(batched){
+      try{
+        Expression ys = apply_lambda(FUNC, {make_numeric_list(std::vector<double>(xs))}, env);
+        const NumericList * values = ys.numericList();
+        if(values && !values->isComplex() && values->size() == xs.size()){
+          return values->real();
+        }
+      }
+      catch(const SemanticError &){
+        // fall back to single samples, which report any real error
+      }
+      batched = false;
+    }
 
-  return Expression();
-  // std::vector<Expression> x_bounds, y_bounds;
-  // x_bounds = BOUNDS.eval(env).m_tail;
-  // y_bounds = apply(Atom("map"), {FUNC, BOUNDS}, env).m_tail;
-
-  // double N = 20, A = 3, B = 3, C = 2, D = 2;
-  // double xscale, yscale, AL, AU, OL, OU, xmin, xmax, ymin, ymax;
-
-  // AL = std::min(x_bounds.begin()->head().asNumber(), (x_bounds.end()-1)->head().asNumber());
-  // AU = std::max(x_bounds.begin()->head().asNumber(), (x_bounds.end()-1)->head().asNumber());
-
-  // OL = std::min(y_bounds.begin()->head().asNumber(), (y_bounds.end()-1)->head().asNumber());
-  // OU = std::max(y_bounds.begin()->head().asNumber(), (y_bounds.end()-1)->head().asNumber());
-
-  // // // Create scale factors using the max and min edges of the data
-  // xscale = N/(AU-AL);
-  // yscale = N/(OU-OL)  * -1;
-
-  // // // Scale bounds of the box
-  // xmin = AL * xscale;
-  // xmax = AU * xscale;
-  // ymin = OL * yscale;
-  // ymax = OU  * yscale;
-
-  // double xmiddle = (xmax+xmin)/2, ymiddle = (ymin+ymax)/2;
-
-  // // Make an expression for each point of the bounding box
-  // Expression topLeft, topMid, topRight, midLeft, midMid, midRight, botLeft, botMid, botRight;
-  // topLeft = apply(Atom("make-point"), {Expression(xmin), Expression(ymax)}, env);
-  // topMid = apply(Atom("make-point"), {Expression(xmiddle), Expression(ymax)}, env);
-  // topRight = apply(Atom("make-point"), {Expression(xmax), Expression(ymax)}, env);
-  // midLeft = apply(Atom("make-point"), {Expression(xmin), Expression(ymiddle)}, env);
-  // midMid = apply(Atom("make-point"), {Expression(xmiddle), Expression(ymiddle)}, env);
-  // midRight = apply(Atom("make-point"), {Expression(xmax), Expression(ymiddle)}, env);
-  // botLeft = apply(Atom("make-point"), {Expression(xmin), Expression(ymin)}, env);
-  // botMid = apply(Atom("make-point"), {Expression(xmiddle), Expression(ymin)}, env);
-  // botRight = apply(Atom("make-point"), {Expression(xmax), Expression(ymin)}, env);
-
-  // // Make an expression to hold each line of the bounding rect
-  // Expression leftLine, topLine, rightLine, botLine, xaxis, yaxis;
-  // leftLine = apply(Atom("make-line"), {topLeft, botLeft}, env);
-  // rightLine = apply(Atom("make-line"), {topRight, botRight}, env);
-  // topLine = apply(Atom("make-line"), {topLeft, topRight}, env);
-  // botLine = apply(Atom("make-line"), {botLeft, botRight}, env);
-
-  // result.push_back(leftLine.eval(env));
-  // result.push_back(rightLine.eval(env));
-  // result.push_back(topLine.eval(env));
-  // result.push_back(botLine.eval(env));
-
-  // // Add draw axis lines if either zero line is within the boundaries
-  // if(0 < OU || 0 > OL){
-  //   Expression xAxisStart, xAxisEnd;
-  //   xAxisStart = apply(Atom("make-point"), {Expression(xmax), Expression(0.0)}, env);
-  //   xAxisEnd = apply(Atom("make-point"), {Expression(xmin), Expression(0.0)}, env);
-  //   xaxis = apply(Atom("make-line"), {xAxisStart, xAxisEnd}, env);
-  //   result.push_back(xaxis.eval(env));
-  // }
-
-  // if(0 < AU || 0 > AL){
-  //   Expression yAxisStart, yAxisEnd;
-  //   yAxisStart = apply(Atom("make-point"), {Expression(0.0), Expression(ymax)}, env);
-  //   yAxisEnd = apply(Atom("make-point"), {Expression(0.0), Expression(ymin)}, env);
-
-  //   yaxis = apply(Atom("make-line"), {yAxisStart, yAxisEnd}, env);
-  //   result.push_back(yaxis.eval(env));
-  // }
-
-  // // Number of data points for a continuous plot
-  // size_t M = 50;
-
-  // double stepsize = (AU-AL)/M;
-
-  // std::vector<double> domain, range;
-  // std::vector<Expression> domain_exp, range_exp;
-
-  // for(double x = AL; x <= AU+stepsize; x+=stepsize){
-  //   domain.emplace_back(x);
-  //   domain_exp.emplace_back(Expression(x));
-  // }
-
-  // range_exp = apply(Atom("map"), {FUNC, Expression(domain_exp)}, env).m_tail;
-
-  // Expression point;
-  // std::vector<Expression> points;
-  // size_t pos = 0;
-
-
-  // for(auto _ : range_exp){
-  //   range.push_back(range_exp[pos].head().asNumber());
-  //   pos++;
-  // }
-
-  // pos = 0;
-  // double scaled_X = 0, scaled_Y = 0;
-  // for(auto _ : range_exp){
-  //   scaled_X = domain[pos] * xscale;
-  //   scaled_Y = range[pos] * yscale;
-  //   if(scaled_X < 0.001 && scaled_X > -0.001)
-  //     scaled_X = 0.0;
-  //   if(scaled_Y < 0.001 && scaled_Y > -0.001)
-  //     scaled_Y = 0.0;
-
-  //   point = apply(Atom("make-point"), {Expression(scaled_X), Expression(scaled_Y)}, env);
-  //   points.push_back(point);
-  //   pos++;
-  // }
-
-  // Expression line;
-  // for(size_t i = 1; i < points.size(); i++){
-  //   line = apply(Atom("make-line"), {points[i-1], points[i]}, env);
-  //   result.push_back(line);
-  // }
-
-  // // Add the bounds of the data as strings for making labels
-  // Expression boundLabel, boundPos;
-  // boundLabel = apply(Atom("make-text"), {Expression(Atom("\""+Atom(AL).asString()+"\""))}, env);
-  // boundPos = apply(Atom("make-point"), {Expression(xmin), Expression(ymin + C)}, env);
-  // boundLabel.setTextPosition(boundPos);
-  // result.push_back(boundLabel);
-
-  // boundLabel = apply(Atom("make-text"), {Expression(Atom("\""+Atom(AU).asString()+"\""))}, env);
-  // boundPos = apply(Atom("make-point"), {Expression(xmax), Expression(ymin + C)}, env);
-  // boundLabel.setTextPosition(boundPos);
-  // result.push_back(boundLabel);
-
-  // boundLabel = apply(Atom("make-text"), {Expression(Atom("\""+Atom(OL).asString()+"\""))}, env);
-  // boundPos = apply(Atom("make-point"), {Expression(xmin-D), Expression(ymin)}, env);
-  // boundLabel.setTextPosition(boundPos);
-  // result.push_back(boundLabel);
-
-  // boundLabel = apply(Atom("make-text"), {Expression(Atom("\""+Atom(OU).asString()+"\""))}, env);
-  // boundPos = apply(Atom("make-point"), {Expression(xmin-D), Expression(ymax)}, env);
-  // boundLabel.setTextPosition(boundPos);
-  // result.push_back(boundLabel);
-
-  // if(m_tail.size() == 3){
-  //   Expression OPTIONS = m_tail[2];
-  //   // Add each option to the output
-
-  //   Expression textItem, textPos, ffffff;
-  //   for(auto &opt : OPTIONS.m_tail){
+    std::vector<double> ys(xs.size());
+    for(std::size_t i = 0; i < xs.size(); ++i){
+      Expression y = apply_lambda(FUNC, {Expression(Atom(xs[i]))}, env);
+      if(!y.head().isNumber() || y.tailLength() != 0){
+        throw SemanticError("Error: function of continuous plot did not return a number");
+      }
+      ys[i] = y.head().asNumber();
+    }
+    return ys;
+  };
+
+  double AL = BOUNDS.contents()[0].head().asNumber();
+  double AU = BOUNDS.contents()[1].head().asNumber();
+  Samples samples = sample_adaptive(evaluate, AL, AU);
+
+  auto range = std::minmax_element(samples.y.begin(), samples.y.end());
+  double OL = *range.first, OU = *range.second;
+  if(!std::isfinite(OL) || !std::isfinite(OU)){
+    throw SemanticError("Error: function of continuous plot not finite over the bounds");
+  }
+  if(OL == OU){
+    OL -= 1;
+    OU += 1;
+  }
+
+  // Scale the plot to a box of side N, with y pointing up
+  const double N = 20, A = 3, B = 3, C = 2, D = 2;
+  double xscale = N/(AU-AL), yscale = N/(OU-OL) * -1;
+  double xmin = AL * xscale, xmax = AU * xscale;
+  double ymin = OL * yscale, ymax = OU * yscale;
+  double xmiddle = (xmax+xmin)/2, ymiddle = (ymin+ymax)/2;
+
+  // Read the options, the text scale applies to every label
+  std::vector<Expression> option_labels;
+  Expression text_scale;
+  auto label = [&](const Expression & text, double x, double y, double rotation){
+    Expression t = make_text(text);
+    t.m_properties["\"position\""] = make_point(x, y);
+    if(rotation != 0) t.m_properties["\"text-rotation\""] = Expression(Atom(rotation));
+    if(!text_scale.isEmpty()) t.m_properties["\"text-scale\""] = text_scale;
+    return t;
+  };
+  for(auto & opt : OPTIONS.contents()){
+    if(opt.tailLength() != 2 || !opt.contents()[0].head().isString()){
+      throw SemanticError("Error: an option of continuous plot is not a list of a name and a value");
+    }
+    if(opt.contents()[0].head().asString() == "\"text-scale\""){
+      text_scale = opt.contents()[1];
+    }
+  }
+  for(auto & opt : OPTIONS.contents()){
+    std::string name = opt.contents()[0].head().asString();
+    const Expression & text = opt.contents()[1];
+    if(name == "\"title\""){
+      option_labels.push_back(label(text, xmiddle, ymax - A, 0));
+    }
+    else if(name == "\"abscissa-label\""){
+      option_labels.push_back(label(text, xmiddle, ymin + A, 0));
+    }
+    else if(name == "\"ordinate-label\""){
+      option_labels.push_back(label(text, xmin - B, ymiddle, -std::atan2(0, -1) / 2));
+    }
+  }
 
+  std::vector<Expression> result;
+  result.reserve(14 + option_labels.size());
+
+  // Add bounding box lines
+  Expression topLeft = make_point(xmin, ymax);
+  Expression topRight = make_point(xmax, ymax);
+  Expression botLeft = make_point(xmin, ymin);
+  Expression botRight = make_point(xmax, ymin);
+  result.push_back(make_line(topLeft, botLeft));
+  result.push_back(make_line(topRight, botRight));
+  result.push_back(make_line(topLeft, topRight));
+  result.push_back(make_line(botLeft, botRight));
+
+  // Add the bounds of the data as labels
+  auto bound = [](double value){ return Expression(Atom("\"" + Atom(value).asString() + "\"")); };
+  result.push_back(label(bound(AL), xmin, ymin + C, 0));
+  result.push_back(label(bound(AU), xmax, ymin + C, 0));
+  result.push_back(label(bound(OL), xmin - D, ymin, 0));
+  result.push_back(label(bound(OU), xmin - D, ymax, 0));
+
+  result.insert(result.end(), option_labels.begin(), option_labels.end());
 
-  //     temp.clear();
+  // Add draw axis lines if either zero line is within the boundaries
+  if(OL < 0 && 0 < OU){
+    result.push_back(make_line(make_point(xmin, 0.0), make_point(xmax, 0.0)));
+  }
+  if(AL < 0 && 0 < AU){
+    result.push_back(make_line(make_point(0.0, ymax), make_point(0.0, ymin)));
+  }
 
-  //     if(opt.m_tail[0].head().asString() == "\"title\""){
-  //       temp.push_back(Expression(Atom(xmiddle)));
-  //       temp.push_back(Expression(Atom(ymax-A)));
-  //     }
-  //     else if(opt.m_tail[0].head().asString() == "\"abscissa-label\""){
-  //       temp.push_back(Expression(Atom(xmiddle)));
-  //       temp.push_back(Expression(Atom(ymin+A)));
-  //     }
-  //     else if(opt.m_tail[0].head().asString() == "\"ordinate-label\""){
-  //       temp.push_back(Expression(Atom(xmin-B)));
-  //       temp.push_back(Expression(Atom(ymiddle)));
-  //     }
+  // Add the curve as one packed polyline
+  std::vector<double> xy(2 * samples.x.size());
+  for(std::size_t i = 0; i < samples.x.size(); ++i){
+    xy[2*i] = samples.x[i] * xscale;
+    xy[2*i + 1] = samples.y[i] * yscale;
+  }
+  result.push_back(make_polyline(std::move(xy)));
 
-  //     textPos = apply(Atom("make-point"), {temp).eval(env);
-  //     temp.clear();
-  //     temp = { Expression(Atom(opt.m_tail[1].head().asString())) };
-  //     textItem = Expression(Atom("make-text"), temp);
+  Expression cp = Expression("CP", result);
+  cp.m_properties["numpoints"] = Expression(Atom(static_cast<double>(samples.x.size())));
+  cp.m_properties["numoptions"] = Expression(Atom(static_cast<double>(OPTIONS.tailLength())));
+  return cp;
+}
 
-  //     temp = {Expression(Atom("\"position\"")), textPos, textItem};
-  //     ffffff = Expression(Atom("\"set-property\""), temp);
+Expression Expression::eval(Environment & env) const{
 
-  //     result.push_back(ffffff.eval(env));
-  //   }
+  check_interrupt();
 
-  // }
+  // pure subexpressions of the program evaluated at the top level may have
+  // been computed before
+  MemoCache * memo = MemoCache::current();
+  if(memo != nullptr && env.is_root() && memo->watches(*this)){
+    return memo->evaluate(*this, env, [this, &env]{ return eval_form(env); });
+  }
 
-  // return Expression("CP", result, M);
+  return eval_form(env);
 }
 
-sig_atomic_t global_status_flag = 0;
-
-Expression Expression::eval(Environment & env){
+Expression Expression::eval_form(Environment & env) const{
 
-  if(global_status_flag > 0){
-    throw SemanticError("Error: interpreter kernal interupted");
-  }
+  // the special form was resolved when the head symbol was interned
+  SpecialForm form = m_head.specialForm();
 
-  if (m_head.asSymbol() == "list") {
-    return handle_list(env);   
-  }
-  if(m_tail.empty()){
+  if(form != ListForm && m_tail.empty()){
     return handle_lookup(m_head, env);
   }
-  if(m_head.asSymbol() == "begin"){
-    return handle_begin(env);
-  }
-  if(m_head.asSymbol() == "define"){
-    return handle_define(env);
-  }
-  if(m_head.asSymbol() == "lambda"){
-    return handle_lambda(env);
-  }
-  else if(m_head.asSymbol() == "apply"){
-    return handle_apply(env);
-  }
-  if(m_head.asSymbol() == "map"){
-    return handle_map(env);
+
+  // the value was computed when the program was optimized
+  if(form == ConstantForm){
+    return m_tail[0];
+  }
+
+  if(form != NotSpecialForm){
+    ProfileFrame frame(Profiler::SpecialFormKind, m_head);
+    switch(form){
+      case ListForm:
+      case BeginForm:
+        return eval_nested(env);
+      case DefineForm:
+        return handle_define(env);
+      case LambdaForm:
+        return handle_lambda(env);
+      case ApplyForm:
+        return handle_apply(env);
+      case MapForm:
+        return handle_map(env, false);
+      case PMapForm:
+        return handle_map(env, true);
+      case SetPropertyForm:
+        return handle_set_property(env);
+      case GetPropertyForm:
+        return handle_get_property(env);
+      case DiscretePlotForm:
+        return handle_discrete_plot(env);
+      case ContinuousPlotForm:
+        return handle_cont_plot(env);
+      default:
+        break;
+    }
   }
-  if(m_head.asSymbol() == "set-property"){
-    return handle_set_property(env);
+
+  return eval_nested(env);
+}
+
+// predicate, e is evaluated by eval_nested in the frame of its parent
+static bool nests(const Expression & e, const Environment & env){
+
+  SpecialForm form = e.head().specialForm();
+  if(form != NotSpecialForm && form != ListForm && form != BeginForm){
+    return false;
   }
-  if(m_head.asSymbol() == "get-property"){
-    return handle_get_property(env);
+  if(form != ListForm && e.tailLength() == 0){
+    return false;
   }
-  if(m_head.asSymbol() == "discrete-plot"){
-    return handle_discrete_plot(env);
+  // the memo cache looks each of them up on its own
+  MemoCache * memo = MemoCache::current();
+  return memo == nullptr || !env.is_root() || !memo->watches(e);
+}
+
+Expression Expression::eval_nested(Environment & env) const{
+
+  // the expressions being evaluated, each with the values of its children
+  struct Frame {
+    const Expression * node;
+    std::size_t next;
+    std::vector<Expression> values;
+    bool profiled;
+  };
+  std::vector<Frame> frames;
+  frames.push_back(Frame{this, 0, {}, false});
+
+  Profiler * profiler = Profiler::current();
+  try{
+    while(true){
+      Frame & top = frames.back();
+      const Expression & node = *top.node;
+      SpecialForm form = node.m_head.specialForm();
+
+      if(top.next < node.m_tail.size()){
+        const Expression & child = node.m_tail[top.next++];
+        if(form == BeginForm){
+          // only the last value of a begin is kept
+          top.values.clear();
+        }
+        if(nests(child, env)){
+          check_interrupt();
+          bool profiled = profiler != nullptr && child.m_head.specialForm() != NotSpecialForm;
+          if(profiled){
+            profiler->enter(Profiler::SpecialFormKind, child.m_head);
+          }
+          frames.push_back(Frame{&child, 0, {}, profiled});
+        }
+        else{
+          top.values.push_back(child.eval(env));
+        }
+        continue;
+      }
+
+      Expression value;
+      if(form == ListForm){
+        value = Expression(std::move(top.values));
+      }
+      else if(form == BeginForm){
+        value = std::move(top.values.back());
+      }
+      else{
+        value = apply(node.m_head, top.values, env, node.m_slot);
+      }
+
+      if(top.profiled){
+        profiler->leave();
+      }
+      frames.pop_back();
+      if(frames.empty()){
+        return value;
+      }
+      frames.back().values.push_back(std::move(value));
+    }
   }
-  if(m_head.asSymbol() == "continuous-plot"){
-    return handle_cont_plot(env);
+  catch(...){
+    // close the frames the profiler has for the expressions left unfinished
+    for(const Frame & frame : frames){
+      if(frame.profiled){
+        profiler->leave();
+      }
+    }
+    throw;
   }
-
-  std::vector<Expression> results;
-  for(Expression::IteratorType it = m_tail.begin(); it != m_tail.end(); ++it){
-    results.push_back(it->eval(env));
-  } 
-  return apply(m_head, results, env);
 }
 
 std::ostream & operator<<(std::ostream & out, const Expression & exp){
@@ -745,7 +1176,23 @@ std::ostream & operator<<(std::ostream & out, const Expression & exp){
       out << exp.head().asString();
     }
 
-    for(auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e){
+    if(exp.isNumericList()){
+      // render packed items the same way as their boxed Expressions
+      const NumericList * values = exp.numericList();
+      for(std::size_t i = 0; i < values->size(); ++i){
+        if(values->isComplex()){
+          out << Atom(values->complex()[i]).asString();
+        }
+        else{
+          out << "(" << Atom(values->real()[i]).asString() << ")";
+        }
+        if((i + 1) != values->size()){
+          out << " ";
+        }
+      }
+    }
+
+    for(auto e = exp.tailConstBegin(); !exp.isNumericList() && e != exp.tailConstEnd(); ++e){
       out << *e;
       if((e + 1) != exp.tailConstEnd()){
         out << " ";
@@ -758,32 +1205,175 @@ std::ostream & operator<<(std::ostream & out, const Expression & exp){
   return out;
 }
 
+namespace {
+
+std::size_t combine_hash(std::size_t seed, std::size_t value) noexcept{
+  return seed ^ (value + static_cast<std::size_t>(0x9e3779b97f4a7c15ull) + (seed << 6) + (seed >> 2));
+}
+
+}
+
+std::size_t Expression::tailHash() const noexcept{
+
+  if(m_numeric){
+    // the items hash as the plain numbers they box would
+    static const std::size_t real_item = Expression(Atom(0.)).hash();
+    static const std::size_t complex_item = Expression(Atom(std::complex<double>())).hash();
+    std::size_t item = m_numeric->isComplex() ? complex_item : real_item;
+    std::size_t h = 0;
+    for(std::size_t i = 0; i < m_numeric->size(); ++i){
+      h = combine_hash(h, item);
+    }
+    return h;
+  }
+
+  std::size_t h = m_tail.cached();
+  if(h == 0 && !m_tail.empty()){
+    for(const Expression & e : m_tail){
+      h = combine_hash(h, e.hash());
+    }
+    // 0 means not cached
+    h = h == 0 ? 1 : h;
+    m_tail.cache(h);
+  }
+  return h;
+}
+
+std::size_t Expression::hash() const noexcept{
+
+  std::size_t h = combine_hash(m_head.hash(), tailLength());
+  h = combine_hash(h, tailHash());
+  for(const auto & property : m_properties){
+    h = combine_hash(h, combine_hash(std::hash<std::string>()(property.first), property.second.hash()));
+  }
+  return h;
+}
+
 bool Expression::operator==(const Expression & exp) const noexcept{
 
   bool result = (m_head == exp.m_head);
 
-  result = result && (m_tail.size() == exp.m_tail.size());
+  result = result && (tailLength() == exp.tailLength()) &&
+           (m_properties.size() == exp.m_properties.size());
 
-  if(result){
-    for(auto lefte = m_tail.begin(), righte = exp.m_tail.begin();
-	(lefte != m_tail.end()) && (righte != exp.m_tail.end());
-	++lefte, ++righte){
-      result = result && (*lefte == *righte);
+  if(result && !m_properties.sameStorage(exp.m_properties)){
+    for(auto left = m_properties.begin(), right = exp.m_properties.begin();
+        result && left != m_properties.end(); ++left, ++right){
+      result = left->first == right->first && left->second == right->second;
     }
   }
 
+  // copies sharing the same storage are trivially equal
+  if(!result || (m_numeric && m_numeric == exp.m_numeric) ||
+     (!m_numeric && !exp.m_numeric && m_tail.sameStorage(exp.m_tail))){
+    return result;
+  }
+
+  // boxed tails that differ in structure differ in hash, and the hashes are
+  // kept for the next comparison of either tail, so a mismatch found deep in
+  // a tree is found at its root from then on
+  if(!m_numeric && !exp.m_numeric && tailHash() != exp.tailHash()){
+    return false;
+  }
+
+  if(m_numeric && exp.m_numeric && !m_numeric->isComplex() && !exp.m_numeric->isComplex()){
+    const std::vector<double> & left = m_numeric->real();
+    const std::vector<double> & right = exp.m_numeric->real();
+    for(std::size_t i = 0; result && i < left.size(); ++i){
+      result = (Atom(left[i]) == Atom(right[i]));
+    }
+    return result;
+  }
+
+  for(auto lefte = tailConstBegin(), righte = exp.tailConstBegin();
+      result && (lefte != tailConstEnd()) && (righte != exp.tailConstEnd());
+      ++lefte, ++righte){
+    result = (*lefte == *righte);
+  }
+
   return result;
 }
 
+bool Expression::identical(const Expression & exp) const noexcept{
+
+  // numbers are compared exactly, not within the tolerance of ==
+  bool same_head = m_head == exp.m_head &&
+                   (!m_head.isNumber() || m_head.asNumber() == exp.m_head.asNumber()) &&
+                   (!m_head.isComplex() || m_head.asComplex() == exp.m_head.asComplex());
+
+  return m_type == exp.m_type && same_head &&
+         m_numeric == exp.m_numeric && m_tail.sameStorage(exp.m_tail) &&
+         m_properties.sameStorage(exp.m_properties);
+}
+
+void Expression::promote(const Arena & arena){
+
+  // promoted from a stack rather than recursively, as the tree may be deep;
+  // the storage made here is not in the current arena, so write never copies it
+  std::vector<Expression *> pending(1, this);
+  while(!pending.empty()){
+    Expression & exp = *pending.back();
+    pending.pop_back();
+
+    if(exp.m_tail.inArena(arena)){
+      exp.m_tail = SharedVector<Expression>(exp.m_tail.items());
+      for(auto & e : exp.m_tail.write()){
+        pending.push_back(&e);
+      }
+    }
+
+    if(exp.m_properties.inArena(arena)){
+      SharedMap<std::string, Expression> properties;
+      for(auto & p : exp.m_properties){
+        properties[p.first] = p.second;
+      }
+      exp.m_properties = properties;
+      for(auto & p : exp.m_properties.write()){
+        pending.push_back(&p.second);
+      }
+    }
+  }
+}
+
+bool Expression::inArena(const Arena & arena) const noexcept{
+
+  return m_tail.inArena(arena) || m_properties.inArena(arena);
+}
+
+SlotHint & Expression::slotHint() const noexcept{
+  return m_slot;
+}
+
+void promote_to_heap(Expression & exp){
+
+  Arena * arena = Arena::current();
+  if(arena){
+    ArenaScope suspend(nullptr);
+    exp.promote(*arena);
+  }
+}
+
 bool operator!=(const Expression & left, const Expression & right) noexcept{
 
   return !(left == right);
 }
 
-bool Expression::checkProperty(std::string key, std::string value) const noexcept {
-  std::string left = "\"" + key + "\"";
-  std::string right = "\"" + value + "\"";
-  return __getProperty(left) == Expression(Atom(right));
+void Expression::setProperty(const std::string & key, const Expression & value) {
+  m_properties[key] = value;
+}
+
+bool Expression::checkProperty(const std::string & key, const std::string & value) const noexcept {
+
+  // the keys and the string values are kept with their quotes
+  auto property = m_properties.find("\"" + key + "\"");
+  if(property == m_properties.end()){
+    return false;
+  }
+  const Expression & e = property->second;
+  if(e.tailLength() != 0 || e.hasProperties()){
+    return false;
+  }
+  return e.m_head.isStringOf("\"" + value + "\"");
 }
 
 std::tuple<double, double, double, double> Expression::getTextProperties() const noexcept{
@@ -801,8 +1391,8 @@ std::tuple<double, double, double, double> Expression::getTextProperties() const
   }
 
   if(m_properties.find("\"position\"") != m_properties.end()){
-    Expression point = m_properties.at("\"position\"");
-    std::vector<Expression> cor = point.contents();
+    const Expression & point = m_properties.at("\"position\"");
+    const std::vector<Expression> & cor = point.contents();
     x = cor[0].head().asNumber();
     y = cor[1].head().asNumber();
     return {x, y, sf, rot};
@@ -815,7 +1405,7 @@ std::tuple<double, double, double, double> Expression::getTextProperties() const
 double Expression::getNumericalProperty(std::string prop) const noexcept {
   double size_value = -1;
   if(m_properties.find(prop) != m_properties.end()){
-    Expression point_size = m_properties.at(prop);
+    const Expression & point_size = m_properties.at(prop);
     size_value = point_size.head().asNumber();
   }
   return size_value;
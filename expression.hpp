@@ -9,6 +9,8 @@ Defines the Expression type and assiciated functions.
 
 #include "token.hpp"
 #include "atom.hpp"
+#include "shared_storage.hpp"
+#include "symbol_map.hpp"
 
 #include <map>
 #include <utility>
@@ -16,13 +18,14 @@ Defines the Expression type and assiciated functions.
 #include <iostream>
 #include <numeric>
 #include <cassert>
-#include <csignal>
 #include <cstdlib>
-extern sig_atomic_t global_status_flag;
 
 // forward declare Environment
 class Environment;
 
+// forward declare the packed storage of numeric lists
+class NumericList;
+
 /*! \class Expression
 \brief An expression is a tree of Atoms.
 
@@ -42,20 +45,35 @@ public:
   */
   Expression(const Atom & a);
 
-  /// deep-copy construct an expression (recursive)
-  Expression(const Expression & a);
+  /// copy construct an expression, sharing its tail and properties (O(1))
+  Expression(const Expression & a) = default;
+
+  /// move construct an expression
+  Expression(Expression && a) noexcept = default;
 
   /// constructor for list
   Expression(const std::vector<Expression> & listItems);
 
+  /// constructor for list, taking over the items
+  Expression(std::vector<Expression> && listItems);
+
+  /// constructor for a parsed expression with head a and the given tail
+  Expression(const Atom & a, std::vector<Expression> && tail);
+
   /// constructor for lambda functions
-  Expression(const std::vector<Expression> & args, Expression & func);
+  Expression(const std::vector<Expression> & args, const Expression & func);
 
   /// Constructor for plots
   Expression(std::string type, const std::vector<Expression> & back);
 
-  /// deep-copy assign an expression  (recursive)
-  Expression & operator=(const Expression & a);
+  /// copy assign an expression, sharing its tail and properties (O(1))
+  Expression & operator=(const Expression & a) = default;
+
+  /// move assign an expression
+  Expression & operator=(Expression && a) noexcept = default;
+
+  /// destroy an expression, tearing down deep trees without recursion
+  ~Expression();
 
   /// return a reference to the head Atom
   Atom & head();
@@ -69,8 +87,8 @@ public:
   /// return a pointer to the last expression in the tail, or nullptr
   Expression * tail();
 
-  /// return a vector of the items in the Expression's tail
-  std::vector<Expression> contents() const noexcept;
+  /// return a const-reference to the items in the Expression's tail
+  const std::vector<Expression> & contents() const noexcept;
 
   /// return the number of items in the tail vector
   size_t tailLength() const noexcept;
@@ -87,12 +105,27 @@ public:
   /// member when determines if the expression is a list
   bool isList() const noexcept;
 
+  /// member when determines if the expression is a list held in packed numeric storage
+  bool isNumericList() const noexcept;
+
+  /// return the packed storage of a numeric list, or nullptr for any other expression
+  const NumericList * numericList() const noexcept;
+
+  /// member when determines if the expression has any properties set
+  bool hasProperties() const noexcept;
+
   /// member when determines if the expression is a Lambda function
   bool isLambda() const noexcept;
 
   /// member when determines if the expression is actually empty
   bool isEmpty() const noexcept;
 
+  /// The graphic objects an expression is drawn as, named by its object-name property
+  enum class ObjectKind {None, Point, Line, Text, Polyline, StreamPlot, StreamData, Other};
+
+  /// return the kind of graphic object of the expression, None if it has no object-name
+  ObjectKind objectKind() const noexcept;
+
   // Check exp type for discrete-plots
   bool isDP() const noexcept;
 
@@ -100,18 +133,46 @@ public:
   bool isCP() const noexcept;
 
   /// Evaluate expression using a post-order traversal (recursive)
-  Expression eval(Environment & env);
+  Expression eval(Environment & env) const;
 
-  /// equality comparison for two expressions (recursive)
+  /*! Equality comparison for two expressions, their properties included
+    (recursive). Lists whose hashes differ compare unequal without their
+    items being compared.
+   */
   bool operator==(const Expression & exp) const noexcept;
 
+  /*! Return a hash of the structure of the expression, equal for equal
+    expressions. Numbers, which == compares within a tolerance, hash by
+    their kind only. The hash of a tail is cached with its storage, so it
+    is computed once for a tree however often it is compared.
+   */
+  std::size_t hash() const noexcept;
+
+  /// predicate, exp is a copy of this expression, sharing all of its storage
+  bool identical(const Expression & exp) const noexcept;
+
+  /*! Rebuild any storage of the expression that belongs to arena outside of
+    it, so that the expression outlives the arena. Storage that
+    does not belong to arena is kept shared, as nothing under it does.
+    \param arena the arena, which must not be current
+   */
+  void promote(const Arena & arena);
+
+  /// determine if the storage of the expression, but not its items, belongs to arena
+  bool inArena(const Arena & arena) const noexcept;
+
+  /// the slot the head symbol was last found in by an environment lookup
+  SlotHint & slotHint() const noexcept;
+
   /// helper methods for output widget
-  bool checkProperty(std::string key, std::string value) const noexcept;
+  bool checkProperty(const std::string & key, const std::string & value) const noexcept;
   double getNumericalProperty(std::string) const noexcept;
   std::tuple<double, double, double, double> getTextProperties() const noexcept;
-  Atom getProperty(std::string p) {
-    if (m_properties.find(p) != m_properties.end()) {
-      return m_properties.at(p).head();
+  void setProperty(const std::string & key, const Expression & value);
+  Atom getProperty(std::string p) const {
+    auto found = m_properties.find(p);
+    if (found != m_properties.end()) {
+      return found->second.head();
     }
     return Atom();
   };
@@ -125,30 +186,57 @@ private:
   // the head of the expression
   Atom m_head;
 
-  std::vector<Expression> m_tail;
+  // the tail, shared copy-on-write between copies of the expression
+  SharedVector<Expression> m_tail;
+
+  // the items of a numeric list, used in place of m_tail when set
+  std::shared_ptr<const NumericList> m_numeric;
 
   // state variable of the expression
   enum class ExpType {None, Singleton, List, Lambda, Graphic, Plot};
   ExpType m_type;
 
-  // list of the expression's properties
-  std::map<std::string, Expression> m_properties;
+  // the hint of the lookups of the head, kept across evaluations
+  mutable SlotHint m_slot;
+
+  // list of the expression's properties, shared copy-on-write
+  SharedMap<std::string, Expression> m_properties;
 
-  // convenience typedef
-  typedef std::vector<Expression>::iterator IteratorType;
+  // evaluate without consulting the memo cache
+  Expression eval_form(Environment & env) const;
+
+  // evaluate a call, list or begin, and the calls, lists and begins nested
+  // in it, with an explicit stack of frames rather than by recursion
+  Expression eval_nested(Environment & env) const;
 
   // internal helper methods
-  Expression handle_lookup(const Atom & head, const Environment & env);
-  Expression handle_define(Environment & env);
-  Expression handle_begin(Environment & env);
-  Expression handle_list(Environment & env);
-  Expression handle_lambda(Environment & env);
-  Expression handle_apply(Environment & env);
-  Expression handle_map(Environment & env);
-  Expression handle_set_property(Environment & env);
-  Expression handle_get_property(Environment & env);
-  Expression handle_discrete_plot(Environment & env);
-  Expression handle_cont_plot(Environment & env);
+  Expression handle_lookup(const Atom & head, const Environment & env) const;
+  Expression handle_define(Environment & env) const;
+  Expression handle_lambda(Environment & env) const;
+  Expression handle_apply(Environment & env) const;
+  Expression handle_map(Environment & env, bool parallel) const;
+  Expression handle_set_property(Environment & env) const;
+  Expression handle_get_property(Environment & env) const;
+  Expression handle_discrete_plot(Environment & env) const;
+  Expression handle_cont_plot(Environment & env) const;
+
+  // convert a packed numeric list into the generic tail before modifying it
+  void unpack();
+
+  // the hash of the items of the tail, the part of hash() that is cached
+  std::size_t tailHash() const noexcept;
+
+  // builds list expressions over packed storage (see numeric_list.hpp)
+  friend Expression make_packed_list(std::shared_ptr<const NumericList> values);
+
+  // build graphic objects with shared styles (see graphics.hpp)
+  friend Expression make_point(double x, double y, double size);
+  friend Expression make_line(const Expression & p1, const Expression & p2, double thickness);
+  friend Expression make_text(const Expression & text);
+  friend Expression make_polyline(std::vector<double> && xy, double thickness);
+
+  // saves expressions into environment snapshots (see snapshot.hpp)
+  friend class SnapshotCodec;
 
   /* Returns the matching Expression from the interal properties map
   or the empty Expression if not found
@@ -156,6 +244,9 @@ private:
   Expression __getProperty(std::string key) const ;
 };
 
+/// Promote exp out of the current arena of the thread, if there is one
+void promote_to_heap(Expression & exp);
+
 /// Render expression to output stream
 std::ostream & operator<<(std::ostream & out, const Expression & exp);
 
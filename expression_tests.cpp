@@ -1,5 +1,7 @@
 #include "catch.hpp"
 #include "expression.hpp"
+#include "graphics.hpp"
+#include "numeric_list.hpp"
 
 TEST_CASE( "Test default expression", "[expression]" ) {
 
@@ -77,3 +79,79 @@ TEST_CASE( "Test constructor plots", "[expression]") {
   REQUIRE(a.isDP());
 }
 
+
+TEST_CASE( "Test copies share the tail until modified", "[expression]") {
+  Expression li(std::vector<Expression>{Expression(1.), Expression(2.)});
+  Expression copy = li;
+
+  REQUIRE(&*copy.tailConstBegin() == &*li.tailConstBegin());
+  REQUIRE(copy == li);
+
+  copy.append(Atom(3.));
+  REQUIRE(li.tailLength() == 2);
+  REQUIRE(copy.tailLength() == 3);
+  REQUIRE(copy != li);
+
+  Expression moved = std::move(copy);
+  REQUIRE(moved.tailLength() == 3);
+  REQUIRE(moved.isList());
+}
+
+TEST_CASE( "Test equal expressions hash alike", "[expression]") {
+  Expression words(std::vector<Expression>{Expression(Atom("\"a\"")), Expression(Atom("b"))});
+  Expression same(std::vector<Expression>{Expression(Atom("\"a\"")), Expression(Atom("b"))});
+  Expression other(std::vector<Expression>{Expression(Atom("\"a\"")), Expression(Atom("c"))});
+
+  REQUIRE(words == same);
+  REQUIRE(words.hash() == same.hash());
+  REQUIRE(words.hash() != other.hash());
+  REQUIRE(words != other);
+
+  // numbers equal within the tolerance of == hash alike
+  Expression near(std::vector<Expression>{Expression(1.), Expression(2.)});
+  Expression nearer(std::vector<Expression>{Expression(1. + 1e-16), Expression(2.)});
+  REQUIRE(near == nearer);
+  REQUIRE(near.hash() == nearer.hash());
+
+  // as do packed and boxed lists of the same numbers
+  Expression packed = make_numeric_list(std::vector<double>{1., 2.});
+  REQUIRE(packed == near);
+  REQUIRE(packed.hash() == near.hash());
+
+  // the cached hash of a tail is dropped when it is modified
+  std::size_t before = words.hash();
+  words.append(Atom("d"));
+  REQUIRE(words.hash() != before);
+  REQUIRE(words != same);
+  same.append(Atom("d"));
+  REQUIRE(words == same);
+}
+
+TEST_CASE( "Test equality compares properties", "[expression]") {
+  Expression plain(std::vector<Expression>{Expression(1.), Expression(2.)});
+  Expression marked = plain;
+  marked.setProperty("\"layout\"", Expression(Atom("\"columns\"")));
+
+  REQUIRE(plain != marked);
+  REQUIRE(plain.hash() != marked.hash());
+  REQUIRE(marked.checkProperty("layout", "columns"));
+  REQUIRE(!marked.checkProperty("layout", "rows"));
+  REQUIRE(!plain.checkProperty("layout", "columns"));
+
+  Expression remarked = plain;
+  remarked.setProperty("\"layout\"", Expression(Atom("\"columns\"")));
+  REQUIRE(marked == remarked);
+  remarked.setProperty("\"layout\"", Expression(Atom("\"rows\"")));
+  REQUIRE(marked != remarked);
+}
+
+TEST_CASE( "Test the kinds of graphic objects", "[expression]") {
+  REQUIRE(Expression(1.).objectKind() == Expression::ObjectKind::None);
+  REQUIRE(make_point(0, 0).objectKind() == Expression::ObjectKind::Point);
+  REQUIRE(make_line(make_point(0, 0), make_point(1, 1), 1).objectKind() == Expression::ObjectKind::Line);
+  REQUIRE(make_text(Expression(Atom("\"t\""))).objectKind() == Expression::ObjectKind::Text);
+
+  Expression named(1.);
+  named.setProperty("\"object-name\"", Expression(Atom("\"circle\"")));
+  REQUIRE(named.objectKind() == Expression::ObjectKind::Other);
+}
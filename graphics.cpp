@@ -0,0 +1,90 @@
+#include "graphics.hpp"
+
+#include "numeric_list.hpp"
+
+namespace {
+
+typedef SharedMap<std::string, Expression> Style;
+
+// property keys and string values are kept with their quotes, as parsed
+std::string quoted(const char * s){
+  return std::string("\"") + s + "\"";
+}
+
+Style make_style(const char * name, const char * key, const Expression & value){
+
+  Style style;
+  style[quoted("object-name")] = Expression(Atom(quoted(name)));
+  style[quoted(key)] = value;
+  return style;
+}
+
+// the default styles outlive any evaluation, so are built outside its arena
+const Style & point_style(){
+  static const Style style = [](){
+    ArenaScope suspend(nullptr);
+    return make_style("point", "size", Expression(Atom(0.)));
+  }();
+  return style;
+}
+
+const Style & line_style(){
+  static const Style style = [](){
+    ArenaScope suspend(nullptr);
+    return make_style("line", "thickness", Expression(Atom(1.)));
+  }();
+  return style;
+}
+
+const Style & polyline_style(){
+  static const Style style = [](){
+    ArenaScope suspend(nullptr);
+    return make_style("polyline", "thickness", Expression(Atom(1.)));
+  }();
+  return style;
+}
+
+const Style & text_style(){
+  static const Style style = [](){
+    ArenaScope suspend(nullptr);
+    return make_style("text", "position", make_point(0, 0));
+  }();
+  return style;
+}
+
+}
+
+Expression make_point(double x, double y, double size){
+
+  Expression point(std::vector<Expression>{Expression(Atom(x)), Expression(Atom(y))});
+  point.m_properties = (size == 0) ? point_style() : make_style("point", "size", Expression(Atom(size)));
+  return point;
+}
+
+Expression make_line(const Expression & p1, const Expression & p2, double thickness){
+
+  Expression line(std::vector<Expression>{p1, p2});
+  line.m_properties = (thickness == 1) ? line_style() : make_style("line", "thickness", Expression(Atom(thickness)));
+  return line;
+}
+
+Expression make_text(const Expression & text){
+
+  Expression result(text);
+  if(result.m_properties.empty()){
+    result.m_properties = text_style();
+  }
+  else{
+    for(auto & p : text_style()){
+      result.m_properties[p.first] = p.second;
+    }
+  }
+  return result;
+}
+
+Expression make_polyline(std::vector<double> && xy, double thickness){
+
+  Expression polyline = make_numeric_list(std::move(xy));
+  polyline.m_properties = (thickness == 1) ? polyline_style() : make_style("polyline", "thickness", Expression(Atom(thickness)));
+  return polyline;
+}
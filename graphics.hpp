@@ -0,0 +1,30 @@
+/*! \file graphics.hpp
+Defines native constructors for the graphic objects of plotscript.
+
+The objects built here are the same as those of the make-point, make-line
+and make-text procedures of the startup file, without evaluating them. The
+property maps of the default styles are built once and shared by every
+object using them.
+
+A polyline has no procedure of its own: it is the packed numeric list of
+the coordinates of its vertices, x0 y0 x1 y1 ..., so that a curve of any
+length is a single Expression.
+ */
+#ifndef GRAPHICS_HPP
+#define GRAPHICS_HPP
+
+#include "expression.hpp"
+
+/// Build a point at (x, y), as (make-point x y) with the "size" property set
+Expression make_point(double x, double y, double size = 0);
+
+/// Build a line from p1 to p2, as (make-line p1 p2) with the "thickness" property set
+Expression make_line(const Expression & p1, const Expression & p2, double thickness = 1);
+
+/// Build a text object, as (make-text text)
+Expression make_text(const Expression & text);
+
+/// Build a polyline through the vertices at the interleaved coordinates xy
+Expression make_polyline(std::vector<double> && xy, double thickness = 1);
+
+#endif
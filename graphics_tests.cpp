@@ -0,0 +1,123 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "decimation.hpp"
+#include "graphics.hpp"
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "startup_config.hpp"
+
+// evaluate program with the startup file loaded
+static Expression evaluate_with_startup(const std::string & program){
+
+  Interpreter interp;
+
+  std::ifstream startup(STARTUP_FILE);
+  REQUIRE(interp.parseStream(startup));
+  REQUIRE_NOTHROW(interp.evaluate());
+
+  std::istringstream iss(program);
+  INFO(program);
+  REQUIRE(interp.parseStream(iss));
+  return interp.evaluate();
+}
+
+// require a native graphic to match the one built by the startup file
+static void require_same_graphic(const Expression & native, const Expression & scripted,
+                                 const std::string & name, const std::string & key){
+
+  REQUIRE(native == scripted);
+  REQUIRE(native.checkProperty("object-name", name));
+  REQUIRE(scripted.checkProperty("object-name", name));
+  REQUIRE(native.getNumericalProperty("\"" + key + "\"") ==
+          scripted.getNumericalProperty("\"" + key + "\""));
+}
+
+TEST_CASE( "Test native graphics match the startup procedures", "[graphics]" ) {
+
+  require_same_graphic(make_point(1, -2), evaluate_with_startup("(make-point 1 -2)"),
+                       "point", "size");
+  require_same_graphic(make_point(3, 4, 2), evaluate_with_startup("(set-property \"size\" 2 (make-point 3 4))"),
+                       "point", "size");
+  require_same_graphic(make_line(make_point(0, 0), make_point(3, 3)),
+                       evaluate_with_startup("(make-line (make-point 0 0) (make-point 3 3))"),
+                       "line", "thickness");
+  require_same_graphic(make_line(make_point(0, 0), make_point(3, 3), 4),
+                       evaluate_with_startup("(set-property \"thickness\" 4 (make-line (make-point 0 0) (make-point 3 3)))"),
+                       "line", "thickness");
+
+  Expression text = make_text(Expression(Atom("\"hello\"")));
+  Expression scripted = evaluate_with_startup("(make-text \"hello\")");
+  REQUIRE(text == scripted);
+  REQUIRE(text.checkProperty("object-name", "text"));
+  REQUIRE(text.getTextProperties() == scripted.getTextProperties());
+
+  // properties already set on the text are kept
+  Expression scaled = evaluate_with_startup("(set-property \"text-scale\" 2 \"hello\")");
+  REQUIRE(make_text(scaled).getNumericalProperty("\"text-scale\"") == 2);
+  REQUIRE(make_text(scaled).checkProperty("object-name", "text"));
+}
+
+TEST_CASE( "Test discrete-plot builds its graphics natively", "[graphics]" ) {
+
+  std::string program = "(begin (define square (lambda (x) (list x (* x x)))) "
+                        "(discrete-plot (map square (range -50 49)) (list (list \"title\" \"Squares\"))))";
+  Expression plot = evaluate_with_startup(program);
+  REQUIRE(plot.isDP());
+
+  // the box and labels, one option, each point with its stem line, and both axes
+  REQUIRE(plot.tailLength() == 8 + 1 + 2 * 100 + 2);
+  const Expression & first_point = plot.contents()[9];
+  REQUIRE(first_point == make_point(-50, -2500));
+  REQUIRE(first_point.checkProperty("object-name", "point"));
+  REQUIRE(plot.contents()[10].checkProperty("object-name", "line"));
+
+  // the startup file is not needed to build a plot
+  Interpreter bare;
+  std::istringstream iss("(discrete-plot (list (list 1 1) (list 2 4)) (list))");
+  REQUIRE(bare.parseStream(iss));
+  REQUIRE(bare.evaluate().isDP());
+
+  std::istringstream bad("(discrete-plot (list (list 1 1) (list 2)) (list))");
+  REQUIRE(bare.parseStream(bad));
+  REQUIRE_THROWS_AS(bare.evaluate(), SemanticError);
+}
+
+TEST_CASE( "Test discrete-plot decimates large data", "[graphics]" ) {
+
+  std::string data = "(begin (define f (lambda (x) (list x (sin (/ x 100))))) (define data (map f (range 0 9999))) ";
+
+  // by default every point is kept
+  Expression plot = evaluate_with_startup(data + "(discrete-plot data (list (list \"title\" \"T\"))))");
+  REQUIRE(plot.getProperty("numpoints").asNumber() == 10000);
+  REQUIRE(plot.getProperty("numoptions").asNumber() == 1);
+  REQUIRE(plot.contents()[8] == Expression(Atom("\"T\"")));
+  REQUIRE(evaluate_with_startup(data + "(discrete-plot data (list)))").getProperty("numpoints").asNumber() == 10000);
+
+  // a decimation asked for keeps at most two points per column of the view
+  {
+    PlotWidthScope width(1000);
+    plot = evaluate_with_startup(data + "(discrete-plot data (list (list \"decimation\" \"minmax\"))))");
+    REQUIRE(plot.getProperty("numpoints").asNumber() <= 2000);
+    REQUIRE(plot.getProperty("numpoints").asNumber() > 1000);
+    REQUIRE(plot.getProperty("numoptions").asNumber() == 0);
+  }
+  // and needs a width where no view draws the plot
+  REQUIRE_THROWS_AS(evaluate_with_startup(data + "(discrete-plot data (list (list \"decimation\" \"minmax\"))))"),
+                    SemanticError);
+
+  plot = evaluate_with_startup(data + "(discrete-plot data (list (list \"decimation\" \"lttb\") (list \"decimation-width\" 100))))");
+  REQUIRE(plot.getProperty("numpoints").asNumber() == 200);
+  REQUIRE(plot.getProperty("numoptions").asNumber() == 0);
+
+  plot = evaluate_with_startup(data + "(discrete-plot data (list (list \"decimation\" \"none\"))))");
+  REQUIRE(plot.getProperty("numpoints").asNumber() == 10000);
+
+  REQUIRE_THROWS_AS(evaluate_with_startup(data + "(discrete-plot data (list (list \"decimation\" \"all\"))))"),
+                    SemanticError);
+  REQUIRE_THROWS_AS(evaluate_with_startup(data + "(discrete-plot data (list (list \"decimation-width\" 0))))"),
+                    SemanticError);
+}
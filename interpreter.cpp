@@ -1,15 +1,105 @@
 #include "interpreter.hpp"
 
+#include "arena.hpp"
+#include "constant_folding.hpp"
+#include "lexer.hpp"
+
 bool Interpreter::parseStream(std::istream & expression) noexcept{
 
-  TokenSequenceType tokens = tokenize(expression);
+  // the tree is built as the stream is read, without holding its tokens
+  StreamSource source(expression);
+  Lexer<StreamSource> lexer(source);
 
-  ast = parse(tokens);
+  ast = parse(lexer, parse_error);
+  program.reset();
+  folded = false;
 
-  return (ast != Expression());
+  // a failed parse leaves the empty expression
+  return !ast.isEmpty();
 };
 
+bool Interpreter::parseBuffer(const char * begin, const char * end) noexcept{
+
+  // the tokens view the buffer, the AST built from them copies what it keeps
+  BufferSource source(begin, end);
+  Lexer<BufferSource> lexer(source);
+
+  ast = parse(lexer, parse_error);
+  program.reset();
+  folded = false;
+
+  return !ast.isEmpty();
+}
+
+const ParseError & Interpreter::parseError() const noexcept{
+  return parse_error;
+}
+
+void Interpreter::setBackend(Backend b) noexcept{
+  backend = b;
+}
+
+Interpreter::Backend Interpreter::getBackend() const noexcept{
+  return backend;
+}
+
+void Interpreter::setMemoize(bool on, std::chrono::microseconds admit){
+  memoize = on;
+  memo = MemoCache(256, admit);
+}
+
+bool Interpreter::getMemoize() const noexcept{
+  return memoize;
+}
+
+const MemoCache & Interpreter::getMemoCache() const noexcept{
+  return memo;
+}
+
+void Interpreter::setFoldConstants(bool on) noexcept{
+  fold = on;
+}
+
+bool Interpreter::getFoldConstants() const noexcept{
+  return fold;
+}
+
 Expression Interpreter::evaluate(){
 
-  return ast.eval(env);
+  // the lambdas of the environment are known once the program is about to run
+  if(fold && !folded){
+    ast = fold_constants(ast, env);
+    folded = true;
+  }
+
+  if(backend == Backend::Bytecode && !program){
+    program = compile_program(ast, env);
+  }
+
+  bool cached = memoize && backend == Backend::TreeWalker;
+  if(cached){
+    memo.prepare(ast);
+  }
+  MemoScope cache(cached ? &memo : nullptr);
+
+  // the intermediate values of the evaluation are freed with the arena,
+  // the environment keeps its own copies of anything defined
+  Arena arena;
+  ArenaScope scope(&arena);
+  Expression result = backend == Backend::TreeWalker ? ast.eval(env) : vm.run(*program, env);
+  promote_to_heap(result);
+  return result;
+}
+
+Environment Interpreter::snapshot() const{
+
+  // the copy shares the bindings until either side defines something
+  return env;
+}
+
+void Interpreter::restore(const Environment & state){
+
+  env = state;
+  // the program was compiled against the environment it replaces
+  program.reset();
 }
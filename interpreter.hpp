@@ -8,16 +8,21 @@ It maintains an environment during evaluation.
 #define INTERPRETER_HPP
 
 // system includes
+#include <chrono>
 #include <istream>
+#include <memory>
 #include <string>
 #include <stdexcept>
 
 // module includes
 #include "environment.hpp"
 #include "expression.hpp"
+#include "memo_cache.hpp"
 #include "token.hpp"
 #include "parse.hpp"
 #include "semantic_error.hpp"
+#include "bytecode.hpp"
+#include "vm.hpp"
 
 /*! \class Interpreter
 \brief Class to parse and evaluate an expression (program)
@@ -25,22 +30,76 @@ It maintains an environment during evaluation.
 Interpreter has an Environment, which starts at a default.
 The parse method builds an internal AST.
 The eval method updates Environment and returns last result.
+
+The AST is evaluated either by walking the tree, which is the default and
+the reference implementation, or by compiling it to bytecode that runs on
+a VirtualMachine.
 */
 class Interpreter {
 public:
 
+  /// The strategies evaluate can use
+  enum class Backend { TreeWalker, Bytecode };
+
+  /// Select the strategy used by evaluate
+  void setBackend(Backend b) noexcept;
+
+  /// return the strategy used by evaluate
+  Backend getBackend() const noexcept;
+
+  /*! Cache the values of pure subexpressions between evaluations (see
+    memo_cache.hpp), which the tree-walker does, starting with an empty cache.
+    \param on true to cache
+    \param admit the least evaluation time of a value worth caching
+   */
+  void setMemoize(bool on, std::chrono::microseconds admit = std::chrono::microseconds(100));
+
+  /// return true if evaluate caches values
+  bool getMemoize() const noexcept;
+
+  /// return the cache of values
+  const MemoCache & getMemoCache() const noexcept;
+
+  /*! Fold the constant subexpressions of each parsed program when it is
+    first evaluated (see constant_folding.hpp)
+    \param on true to fold
+   */
+  void setFoldConstants(bool on) noexcept;
+
+  /// return true if evaluate folds constants
+  bool getFoldConstants() const noexcept;
+
   /*! Parse into an internal Expression from a stream
     \param expression the raw text stream repreenting the candidate expression
     \return true on successful parsing
    */
   bool parseStream(std::istream &expression) noexcept;
 
-  /*! Evaluate the Expression by walking the tree, returning the result.
+  /*! Parse into an internal Expression from a contiguous buffer, such as a
+    memory-mapped file, without copying it
+    \param begin the first character of the program text
+    \param end one past the last character of the program text
+    \return true on successful parsing
+   */
+  bool parseBuffer(const char * begin, const char * end) noexcept;
+
+  /// return where and why the last parse failed, with offsets in bytes
+  const ParseError & parseError() const noexcept;
+
+  /*! Evaluate the Expression using the selected backend, returning the result.
     \return the Expression resulting from the evaluation in the current environment
     \throws SemanticError when a semantic error is encountered
    */
   Expression evaluate();
 
+  /// return the state of the environment, in constant time
+  Environment snapshot() const;
+
+  /*! Return the environment to a state from snapshot, in constant time
+    \param state the state to return to, which is left unchanged
+   */
+  void restore(const Environment & state);
+
 private:
 
   // the environment
@@ -48,6 +107,26 @@ private:
 
   // the AST
   Expression ast;
+
+  // the failure of the last parse
+  ParseError parse_error;
+
+  // the strategy of evaluate
+  Backend backend = Backend::TreeWalker;
+
+  // the AST compiled on first evaluation with the bytecode backend
+  std::shared_ptr<const Chunk> program;
+
+  // the machine running program, which caches compiled lambda bodies
+  VirtualMachine vm;
+
+  // the values of pure subexpressions, kept between evaluations
+  bool memoize = false;
+  MemoCache memo;
+
+  // whether to fold the AST, and whether it has been since it was parsed
+  bool fold = false;
+  bool folded = false;
 };
 
 #endif
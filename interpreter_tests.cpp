@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
+#include <cmath>
 #include <string>
+#include <tuple>
 #include <sstream>
 #include <fstream>
 #include <iostream>
@@ -498,10 +500,13 @@ TEST_CASE("Test handle get/set property", "[expression]"){
   Expression result = run(program);
   std::string program2 = "(list 0 1 2 3)";
   Expression expected_result = run(program2);
-  REQUIRE(result == expected_result);
+  // the properties are compared too
+  REQUIRE(result != expected_result);
+  REQUIRE(result.contents() == expected_result.contents());
+  REQUIRE(result == run("(set-property \"type\" \"number_list\" (list 0 1 2 3))"));
 
   std::string overwrite_property = "(define myList (set-property \"type\" \"HAHAHA GOTTEM\" (set-property \"type\" \"number_list\" (list 0 1 2 3))))";
-  REQUIRE(run(overwrite_property)== expected_result);
+  REQUIRE(run(overwrite_property) == run("(set-property \"type\" \"HAHAHA GOTTEM\" (list 0 1 2 3))"));
 
   std::string first_arg_error = "(define myList (set-property not_a_string \"WILL FAIL\" (list 0 1 2 3)))";
   REQUIRE(run_and_expect_error(first_arg_error));
@@ -571,15 +576,54 @@ TEST_CASE("Test handle discrete-plot", "[expression]") {
 
 TEST_CASE("Test handle continuous-plot", "[expression]") {
   std::string program;
-  // program = "(begin (define f (lambda (x) (+ (* 2 x) 1))) (continuous-plot f (list -2 2)))";
-  // Expression e = run(program);
+  program = "(begin (define f (lambda (x) (+ (* 2 x) 1))) (continuous-plot f (list -2 2)))";
+  Expression e = run(program);
+
+  // the box, the bound labels, both axes and the curve
+  REQUIRE(e.isCP());
+  REQUIRE(!e.isDP());
+  REQUIRE(e.tailLength() == 11);
+  REQUIRE(e.tailConstBegin()->checkProperty("object-name", "line"));
+  REQUIRE(e.contents()[4].checkProperty("object-name", "text"));
+  REQUIRE(e.contents()[4].head() == Atom("\"-2\""));
+  REQUIRE(e.contents()[7].head() == Atom("\"5\""));
+
+  // a straight line needs no more than the first samples
+  const Expression & curve = e.contents().back();
+  REQUIRE(curve.checkProperty("object-name", "polyline"));
+  REQUIRE(curve.isNumericList());
+  REQUIRE(curve.tailLength() == 2 * 51);
+  REQUIRE(e.getProperty("numpoints").asNumber() == 51);
+
+  program = R"((begin (define f (lambda (x) (+ (* 2 x) 1))) (continuous-plot f (list -2 2) (list (list "title" "The Title") (list "abscissa-label" "X Label") (list "ordinate-label" "Y Label")) )))";
+  Expression r = run(program);
+  REQUIRE(r.isCP());
+  REQUIRE(r.tailLength() == 14);
+  REQUIRE(r.contents()[8].head() == Atom("\"The Title\""));
+  REQUIRE(r.contents()[10].getTextProperties() == std::make_tuple(-13., -2.5, 1., -std::atan2(0, -1) / 2));
+
+  // functions that do not broadcast over lists are sampled one at a time
+  program = "(begin (define f (lambda (x) (first (list x x)))) (continuous-plot f (list 0 1)))";
+  REQUIRE(run(program).getProperty("numpoints").asNumber() == 51);
+
+  program = "(begin (define f (lambda (x) (list x))) (continuous-plot f (list 0 1)))";
+  REQUIRE(run_and_expect_error(program));
 
-  // REQUIRE(e.isCP());
-  // REQUIRE(e.tailLength() == 60);
-  // REQUIRE(e.tailConstBegin()->checkProperty("object-name", "line"));
+  // a body that is not elementwise sees single samples, as a call of f would
+  program = "(begin (define f (lambda (x) (- x (first x)))) (f 1.5))";
+  REQUIRE(run_and_expect_error(program));
+  program = "(begin (define f (lambda (x) (- x (first x)))) (continuous-plot f (list 1 2)))";
+  REQUIRE(run_and_expect_error(program));
+  program = "(continuous-plot (lambda (x) (- x (first x))) (list 1 2))";
+  REQUIRE(run_and_expect_error(program));
 
-  // program = R"(define f (lambda (x) (+ (* 2 x) 1))) (continuous-plot f (list -2 2) (list (list "title" "The Title") (list "abscissa-label" "X Label") (list "ordinate-label" "Y Label")) )";
-  // Expression r = run(program);
+  // an elementwise body draws the same curve batched as sampled one at a time
+  Expression batched = run("(begin (define f (lambda (x) (sin (* pi x)))) (continuous-plot f (list 0 2)))");
+  Expression single = run("(begin (define f (lambda (x) (first (list (sin (* pi x)))))) (continuous-plot f (list 0 2)))");
+  REQUIRE(batched == single);
+
+  program = "(begin (define f (lambda (x) x)) (continuous-plot f (list 1 0)))";
+  REQUIRE(run_and_expect_error(program));
 
   program = "(begin (continuous-plot (* 1) (list -2 2)))";
   REQUIRE(run_and_expect_error(program));
@@ -592,4 +636,123 @@ TEST_CASE("Test handle continuous-plot", "[expression]") {
 
   program = "(begin (define f (lambda (x) (+ (* 2 x) 1))) (continuous-plot f (list 1 1 -1 -1) \"not a list\"))";
   REQUIRE(run_and_expect_error(program));
-}
\ No newline at end of file
+}
+TEST_CASE("Test lambda parameters do not leak into the caller", "[interpreter]"){
+
+  std::string program = "(begin (define x 1) (define f (lambda (x) (* 2 x))) (+ (f 5) x))";
+  Expression result = run(program);
+  REQUIRE(result == Expression(11.));
+
+  program = "(begin (define g (lambda (y) (+ y n))) (define h (lambda (n) (g 1))) (h 41))";
+  result = run(program);
+  REQUIRE(result == Expression(42.));
+}
+
+TEST_CASE("Test map over a packed range", "[interpreter]"){
+
+  std::string program = "(begin (define f (lambda (x) (* 2 x))) (map f (range 0 3)))";
+  Expression result = run(program);
+  REQUIRE(result.isNumericList());
+  REQUIRE(result == run("(list 0 2 4 6)"));
+
+  program = "(begin (define g (lambda (x) (make-point x x))) (map g (range 0 1)))";
+  result = run(program);
+  REQUIRE(result.isList());
+  REQUIRE(!result.isNumericList());
+}
+
+TEST_CASE("Test pmap", "[interpreter]"){
+
+  std::string program = "(begin (define f (lambda (x) (* 2 x))) (pmap f (range 0 999)))";
+  Expression result = run(program);
+  REQUIRE(result.isNumericList());
+  REQUIRE(result == run("(begin (define f (lambda (x) (* 2 x))) (map f (range 0 999)))"));
+
+  result = run("(pmap sin (list 0 0))");
+  REQUIRE(result == run("(list 0 0)"));
+
+  REQUIRE(run_and_expect_error("(pmap first (range 0 999))"));
+  REQUIRE(run_and_expect_error("(pmap 1 (list 1 2))"));
+}
+
+TEST_CASE("Test snapshot and restore", "[interpreter]"){
+
+  Interpreter interp;
+  std::istringstream define("(define a 1)");
+  REQUIRE(interp.parseStream(define));
+  REQUIRE_NOTHROW(interp.evaluate());
+
+  Environment before = interp.snapshot();
+
+  std::istringstream redefine("(begin (define b 2) (define a 3))");
+  REQUIRE(interp.parseStream(redefine));
+  REQUIRE_NOTHROW(interp.evaluate());
+
+  // the snapshot does not see later definitions
+  REQUIRE(before.get_exp(Atom("a")) == Expression(1.));
+  REQUIRE(!before.is_known(Atom("b")));
+
+  interp.restore(before);
+  std::istringstream lookup("(+ a 10)");
+  REQUIRE(interp.parseStream(lookup));
+  REQUIRE(interp.evaluate() == Expression(11.));
+
+  std::istringstream undefined("(+ b 10)");
+  REQUIRE(interp.parseStream(undefined));
+  REQUIRE_THROWS_AS(interp.evaluate(), SemanticError);
+}
+
+TEST_CASE("Test lambdas called in tail position", "[interpreter]"){
+
+  // the callee sees the bindings of the caller, as from a chained frame
+  std::string program = "(begin (define g (lambda (y) (+ x y))) (define f (lambda (x) (g 1))) (f 10))";
+  REQUIRE(run(program) == Expression(11.));
+
+  program = "(begin (define h (lambda (x) (list x))) (define k (lambda (x y) (h y))) (k 1 2))";
+  REQUIRE(run(program) == run("(list 2)"));
+
+  program = "(begin (define g (lambda (y) (* z y))) "
+            "(define f (lambda (x) (begin (define z 5) (g x)))) (f 3))";
+  REQUIRE(run(program) == Expression(15.));
+
+  // nothing the callee binds is seen by the caller of the chain
+  program = "(begin (define x 1) (define g (lambda (x) x)) (define f (lambda (y) (g 2))) (+ (f 0) x))";
+  REQUIRE(run(program) == Expression(3.));
+
+  REQUIRE(run_and_expect_error("(begin (define g (lambda (y) y)) (define f (lambda (x) (g 1 2))) (f 10))"));
+}
+
+TEST_CASE("Test a long chain of tail calls", "[interpreter]"){
+
+  // each lambda calls the one defined before it, far deeper than the
+  // native stack would allow
+  const int depth = 50000;
+  std::ostringstream program;
+  program << "(begin (define f0 (lambda (x) (+ x 1)))";
+  for(int i = 1; i < depth; ++i){
+    program << " (define f" << i << " (lambda (x) (f" << i - 1 << " (+ x 1))))";
+  }
+  program << " (f" << depth - 1 << " 0))";
+
+  REQUIRE(run(program.str()) == Expression(double(depth)));
+}
+
+TEST_CASE("Test deeply nested expressions", "[interpreter]"){
+
+  const int depth = 50000;
+  std::string program;
+  for(int i = 0; i < depth; ++i){
+    program += "(+ 1 ";
+  }
+  program += "0" + std::string(depth, ')');
+  REQUIRE(run(program) == Expression(double(depth)));
+
+  program.clear();
+  for(int i = 0; i < depth; ++i){
+    program += "(begin (list ";
+  }
+  program += "1" + std::string(2 * depth, ')');
+  Expression nested;
+  REQUIRE_NOTHROW(nested = run(program));
+  REQUIRE(nested.isList());
+}
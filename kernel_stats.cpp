@@ -0,0 +1,175 @@
+#include "kernel_stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+const char * const STAGE_NAMES[KernelStats::STAGES] = {"queued", "evaluated", "delivered"};
+
+// raise peak to value, unless it is larger already
+template <class T>
+void raise(std::atomic<T> & peak, T value) noexcept{
+
+  T seen = peak.load(std::memory_order_relaxed);
+  while(seen < value && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)){
+  }
+}
+
+// a latency in microseconds, in the unit that suits it
+std::string format_latency(double us){
+
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(1);
+  if(us < 1000){
+    os << us << "us";
+  }
+  else if(us < 1e6){
+    os << us / 1e3 << "ms";
+  }
+  else{
+    os << us / 1e6 << "s";
+  }
+  return os.str();
+}
+
+}
+
+LatencyHistogram::LatencyHistogram() noexcept{
+  clear();
+}
+
+void LatencyHistogram::record(LatencyClock::duration latency) noexcept{
+
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  std::uint64_t value = us > 0 ? static_cast<std::uint64_t>(us) : 0;
+
+  std::size_t bucket = 0;
+  while(bucket + 1 < BUCKETS && (std::uint64_t(1) << bucket) <= value){
+    ++bucket;
+  }
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  total_us.fetch_add(value, std::memory_order_relaxed);
+  raise(max_us, value);
+}
+
+std::uint64_t LatencyHistogram::count() const noexcept{
+
+  std::uint64_t n = 0;
+  for(const auto & bucket : buckets){
+    n += bucket.load(std::memory_order_relaxed);
+  }
+  return n;
+}
+
+double LatencyHistogram::quantile(double q) const noexcept{
+
+  std::uint64_t n = count();
+  if(n == 0){
+    return 0;
+  }
+  // the rank of the quantile, counting from 1
+  std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * n + 0.5));
+  std::uint64_t seen = 0;
+  for(std::size_t b = 0; b < BUCKETS; ++b){
+    seen += buckets[b].load(std::memory_order_relaxed);
+    if(seen >= rank){
+      // no bound is above the largest latency itself
+      return std::min(static_cast<double>(std::uint64_t(1) << b), max());
+    }
+  }
+  return max();
+}
+
+double LatencyHistogram::mean() const noexcept{
+
+  std::uint64_t n = count();
+  return n == 0 ? 0 : static_cast<double>(total_us.load(std::memory_order_relaxed)) / n;
+}
+
+double LatencyHistogram::max() const noexcept{
+  return static_cast<double>(max_us.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::clear() noexcept{
+
+  for(auto & bucket : buckets){
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  total_us.store(0, std::memory_order_relaxed);
+  max_us.store(0, std::memory_order_relaxed);
+}
+
+void KernelStats::record(Stage stage, LatencyClock::time_point sent) noexcept{
+  stages[stage].record(LatencyClock::now() - sent);
+}
+
+void KernelStats::noteInputDepth(std::size_t depth) noexcept{
+  input_depth.store(depth, std::memory_order_relaxed);
+  raise(input_peak, depth);
+}
+
+void KernelStats::noteOutputDepth(std::size_t depth) noexcept{
+  output_depth.store(depth, std::memory_order_relaxed);
+  raise(output_peak, depth);
+}
+
+const LatencyHistogram & KernelStats::histogram(Stage stage) const noexcept{
+  return stages[stage];
+}
+
+std::pair<std::size_t, std::size_t> KernelStats::inputDepth() const noexcept{
+  return {input_depth.load(std::memory_order_relaxed), input_peak.load(std::memory_order_relaxed)};
+}
+
+std::pair<std::size_t, std::size_t> KernelStats::outputDepth() const noexcept{
+  return {output_depth.load(std::memory_order_relaxed), output_peak.load(std::memory_order_relaxed)};
+}
+
+void KernelStats::clear() noexcept{
+
+  for(auto & stage : stages){
+    stage.clear();
+  }
+  input_depth = 0;
+  input_peak = 0;
+  output_depth = 0;
+  output_peak = 0;
+}
+
+void KernelStats::write_report(std::ostream & out) const{
+
+  std::ios::fmtflags flags = out.flags();
+  out << std::left << std::setw(12) << "stage" << std::right << std::setw(10) << "count"
+      << std::setw(12) << "mean (ms)" << std::setw(12) << "p50 (ms)" << std::setw(12) << "p90 (ms)"
+      << std::setw(12) << "p99 (ms)" << std::setw(12) << "max (ms)" << "\n";
+  out << std::fixed << std::setprecision(3);
+  for(std::size_t s = 0; s < STAGES; ++s){
+    const LatencyHistogram & h = stages[s];
+    out << std::left << std::setw(12) << STAGE_NAMES[s] << std::right << std::setw(10) << h.count()
+        << std::setw(12) << h.mean() / 1e3 << std::setw(12) << h.quantile(0.5) / 1e3
+        << std::setw(12) << h.quantile(0.9) / 1e3 << std::setw(12) << h.quantile(0.99) / 1e3
+        << std::setw(12) << h.max() / 1e3 << "\n";
+  }
+  out.flags(flags);
+
+  auto input = inputDepth();
+  auto output = outputDepth();
+  out << "queue depth: input " << input.first << " (peak " << input.second << "), output "
+      << output.first << " (peak " << output.second << ")\n";
+  out << "quantiles are bucket upper bounds, within a factor of two\n";
+}
+
+std::string KernelStats::status_line() const{
+
+  const LatencyHistogram & evaluated = stages[Evaluated];
+  std::ostringstream os;
+  os << "requests " << evaluated.count()
+     << " | eval p50 " << format_latency(evaluated.quantile(0.5))
+     << " p99 " << format_latency(evaluated.quantile(0.99))
+     << " | queued p99 " << format_latency(stages[Queued].quantile(0.99))
+     << " | delivered p99 " << format_latency(stages[Delivered].quantile(0.99))
+     << " | depth " << inputDepth().first << "/" << outputDepth().first;
+  return os.str();
+}
@@ -0,0 +1,137 @@
+/*! \file kernel_stats.hpp
+Defines the latency instrumentation of the queues between a front end (the
+REPL or the notebook) and its interpreter kernel.
+
+The messages of the queues are Stamped with the time they were sent. From
+the stamps, KernelStats records how long each request spent in the stages
+of its round trip:
+
+- queued: from being pushed on the input queue until the kernel pops it
+- evaluated: from being popped until its result is pushed on the output queue
+- delivered: from being pushed on the output queue until the front end pops it
+
+Each stage is a LatencyHistogram of power of two buckets of microseconds,
+counted by atomics so that the kernel and the front end record from their
+own threads without a lock. The depths of the queues are sampled as the
+messages are popped.
+ */
+#ifndef KERNEL_STATS_HPP
+#define KERNEL_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+
+/// The clock of the stamps and of the latencies
+typedef std::chrono::steady_clock LatencyClock;
+
+/*! \class Stamped
+\brief A queue message with the time it was sent.
+*/
+template <class T>
+struct Stamped {
+  T value;
+  LatencyClock::time_point sent;
+
+  Stamped(): value(), sent(){}
+
+  /// Construct the message of value, sent now
+  explicit Stamped(T value): value(std::move(value)), sent(LatencyClock::now()){}
+};
+
+/// return the message of value, sent now
+template <class T>
+Stamped<T> stamp(T value){
+  return Stamped<T>(std::move(value));
+}
+
+/*! \class LatencyHistogram
+\brief Counts latencies in buckets of powers of two of microseconds.
+
+The quantiles are known to within a factor of two: a quantile is reported
+as the upper bound of the bucket holding it.
+*/
+class LatencyHistogram {
+public:
+
+  /// bucket 0 holds latencies under 1us, bucket b those under 2^b us
+  static const std::size_t BUCKETS = 40;
+
+  LatencyHistogram() noexcept;
+
+  /// count a latency, safe from any thread
+  void record(LatencyClock::duration latency) noexcept;
+
+  /// return the number of latencies counted
+  std::uint64_t count() const noexcept;
+
+  /// return the upper bound in microseconds of the q quantile, 0 if empty
+  double quantile(double q) const noexcept;
+
+  /// return the mean latency in microseconds, 0 if empty
+  double mean() const noexcept;
+
+  /// return the largest latency in microseconds
+  double max() const noexcept;
+
+  /// forget every latency counted
+  void clear() noexcept;
+
+private:
+  std::atomic<std::uint64_t> buckets[BUCKETS];
+  std::atomic<std::uint64_t> total_us;
+  std::atomic<std::uint64_t> max_us;
+};
+
+/*! \class KernelStats
+\brief The latencies of the stages of the requests of a kernel, and the
+depths of its queues.
+
+The members may be called from any thread.
+*/
+class KernelStats {
+public:
+
+  /// The stages of a request, in the order it goes through them
+  enum Stage { Queued, Evaluated, Delivered, STAGES };
+
+  /// count the latency of a stage ending now for a message sent at sent
+  void record(Stage stage, LatencyClock::time_point sent) noexcept;
+
+  /// note the depth of the input queue, on popping from it
+  void noteInputDepth(std::size_t depth) noexcept;
+
+  /// note the depth of the output queue, on popping from it
+  void noteOutputDepth(std::size_t depth) noexcept;
+
+  /// return the histogram of a stage
+  const LatencyHistogram & histogram(Stage stage) const noexcept;
+
+  /// return the last and the largest noted depth of the input queue
+  std::pair<std::size_t, std::size_t> inputDepth() const noexcept;
+
+  /// return the last and the largest noted depth of the output queue
+  std::pair<std::size_t, std::size_t> outputDepth() const noexcept;
+
+  /// forget everything recorded
+  void clear() noexcept;
+
+  /// Write the quantiles of every stage, and the depths, as a table
+  void write_report(std::ostream & out) const;
+
+  /// return a one line summary, for a status bar
+  std::string status_line() const;
+
+private:
+  LatencyHistogram stages[STAGES];
+  std::atomic<std::size_t> input_depth{0};
+  std::atomic<std::size_t> input_peak{0};
+  std::atomic<std::size_t> output_depth{0};
+  std::atomic<std::size_t> output_peak{0};
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kernel_stats.hpp"
+#include "TSmessage.hpp"
+
+TEST_CASE( "Test latency histogram quantiles", "[kernel_stats]" ) {
+
+  LatencyHistogram h;
+  REQUIRE(h.count() == 0);
+  REQUIRE(h.quantile(0.5) == 0);
+  REQUIRE(h.mean() == 0);
+
+  // the bound of a bucket is within a factor of two of its latencies
+  for(int i = 0; i < 90; ++i){
+    h.record(std::chrono::microseconds(100));
+  }
+  for(int i = 0; i < 10; ++i){
+    h.record(std::chrono::milliseconds(10));
+  }
+  REQUIRE(h.count() == 100);
+  REQUIRE(h.quantile(0.5) >= 100);
+  REQUIRE(h.quantile(0.5) < 200);
+  REQUIRE(h.quantile(0.9) < 200);
+  REQUIRE(h.quantile(0.99) == 10000);
+  REQUIRE(h.max() == 10000);
+  REQUIRE(h.mean() == Approx(1090));
+
+  h.record(std::chrono::microseconds(-5));
+  REQUIRE(h.count() == 101);
+  REQUIRE(h.quantile(0) == 1);
+
+  h.clear();
+  REQUIRE(h.count() == 0);
+  REQUIRE(h.max() == 0);
+}
+
+TEST_CASE( "Test recording from several threads", "[kernel_stats]" ) {
+
+  LatencyHistogram h;
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 4; ++t){
+    threads.emplace_back([&h, t]{
+      for(int i = 0; i < 1000; ++i){
+        h.record(std::chrono::microseconds(t * 1000 + i));
+      }
+    });
+  }
+  for(auto & thread : threads){
+    thread.join();
+  }
+  REQUIRE(h.count() == 4000);
+  REQUIRE(h.max() == 3999);
+}
+
+TEST_CASE( "Test the stages of stamped messages", "[kernel_stats]" ) {
+
+  KernelStats stats;
+  TSmessage<Stamped<std::string>> queue;
+
+  queue.push(stamp(std::string("(+ 1 2)")));
+  queue.push(stamp(std::string("(+ 3 4)")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+  Stamped<std::string> message;
+  REQUIRE(queue.try_pop(message));
+  stats.noteInputDepth(queue.size());
+  stats.record(KernelStats::Queued, message.sent);
+  REQUIRE(message.value == "(+ 1 2)");
+  REQUIRE(stats.histogram(KernelStats::Queued).count() == 1);
+  REQUIRE(stats.histogram(KernelStats::Queued).max() >= 2000);
+  REQUIRE(stats.histogram(KernelStats::Evaluated).count() == 0);
+  REQUIRE(stats.inputDepth().first == 1);
+  REQUIRE(stats.inputDepth().second == 1);
+
+  stats.noteInputDepth(0);
+  REQUIRE(stats.inputDepth().first == 0);
+  REQUIRE(stats.inputDepth().second == 1);
+  REQUIRE(stats.outputDepth().second == 0);
+
+  std::ostringstream report;
+  stats.write_report(report);
+  REQUIRE(report.str().find("queued") != std::string::npos);
+  REQUIRE(report.str().find("input 0 (peak 1)") != std::string::npos);
+  REQUIRE(stats.status_line().find("requests 0") == 0);
+
+  stats.clear();
+  REQUIRE(stats.histogram(KernelStats::Queued).count() == 0);
+  REQUIRE(stats.inputDepth().second == 0);
+}
@@ -0,0 +1,215 @@
+/*! \file lexer.hpp
+Defines the Lexer, which reads Tokens one at a time, and the character
+sources it can read from.
+
+The lexing rules are those of tokenize: a token is one of OPEN or CLOSE or
+any space-delimited string, a quoted string may contain spaces and parens,
+and comments run from any ";" to the end of the line. The Lexer looks at
+most one token ahead, so parsing with it never holds more than the current
+token of the input.
+ */
+#ifndef LEXER_HPP
+#define LEXER_HPP
+
+#include <cctype>
+#include <cstddef>
+#include <istream>
+#include <string>
+
+#include "token.hpp"
+
+/*! \class BufferSource
+\brief Characters of a contiguous buffer, producing Tokens that view it.
+
+The buffer must outlive the Tokens taken from the source. A token that a
+comment splits in two is the only one that is copied.
+*/
+class BufferSource {
+public:
+
+  /// Construct a source over [begin, end)
+  BufferSource(const char * begin, const char * end): begin(begin), p(begin), end(end) {}
+
+  /// return the next character as an unsigned char, or EOF at the end
+  int get() noexcept { return p == end ? EOF : static_cast<unsigned char>(*p++); }
+
+  /// return the offset of the next character
+  std::size_t offset() const noexcept { return static_cast<std::size_t>(p - begin); }
+
+  /// add the character last returned by get to the pending token
+  void append(){
+    const char * c = p - 1;
+    if(length == 0 && spliced.empty()){
+      start = c;
+      first = offset() - 1;
+    }
+    else if(spliced.empty() && start + length != c){
+      spliced.assign(start, length);
+    }
+    if(spliced.empty()) ++length;
+    else spliced.push_back(*c);
+  }
+
+  /// predicate, a token is pending
+  bool pending() const noexcept { return length != 0 || !spliced.empty(); }
+
+  /// return the offset of the first character of the pending token
+  std::size_t pendingOffset() const noexcept { return first; }
+
+  /// take the pending token
+  Token take(){
+    Token token = spliced.empty() ? Token(start, length) : Token(spliced);
+    length = 0;
+    spliced.clear();
+    return token;
+  }
+
+private:
+  const char * begin;
+  const char * p;
+  const char * end;
+
+  const char * start = nullptr;
+  std::size_t length = 0;
+  std::size_t first = 0;
+  std::string spliced;
+};
+
+/*! \class StreamSource
+\brief Characters of a std::istream, producing Tokens that own their text.
+*/
+class StreamSource {
+public:
+
+  /// Construct a source reading from stream
+  explicit StreamSource(std::istream & stream): stream(stream) {}
+
+  /// return the next character as an unsigned char, or EOF at the end
+  int get(){
+    char c;
+    if(!stream.get(c)) return EOF;
+    ++count;
+    last = c;
+    return static_cast<unsigned char>(c);
+  }
+
+  /// return the offset of the next character
+  std::size_t offset() const noexcept { return count; }
+
+  /// add the character last returned by get to the pending token
+  void append(){
+    if(text.empty()) first = count - 1;
+    text.push_back(last);
+  }
+
+  /// predicate, a token is pending
+  bool pending() const noexcept { return !text.empty(); }
+
+  /// return the offset of the first character of the pending token
+  std::size_t pendingOffset() const noexcept { return first; }
+
+  /// take the pending token
+  Token take(){
+    Token token(text);
+    text.clear();
+    return token;
+  }
+
+private:
+  std::istream & stream;
+  std::size_t count = 0;
+  std::size_t first = 0;
+  char last = 0;
+  std::string text;
+};
+
+/*! \class Lexer
+\brief Reads Tokens one at a time from a Source.
+
+Source is BufferSource or StreamSource, or any class with their members.
+*/
+template <class Source>
+class Lexer {
+public:
+
+  /// Construct a lexer reading from source, which must outlive it
+  explicit Lexer(Source & source): source(source), queued(Token::OPEN) {}
+
+  /*! Read the next token.
+    \param token set to the token read
+    \param at set to the offset of the first character of the token
+    \return false at the end of the input
+   */
+  bool next(Token & token, std::size_t & at){
+
+    if(has_queued){
+      has_queued = false;
+      token = queued;
+      at = queued_at;
+      return true;
+    }
+
+    while(true){
+      int c = source.get();
+      if(c == EOF){
+        return take(token, at);
+      }
+
+      if(c == ';'){
+        // chomp until the end of the line, which is consumed with it
+        while(c != EOF && c != '\n') c = source.get();
+        if(c == EOF) return take(token, at);
+      }
+      else if(c == '(' || c == ')'){
+        Token paren(c == '(' ? Token::OPEN : Token::CLOSE);
+        std::size_t paren_at = source.offset() - 1;
+        if(take(token, at)){
+          // the paren ends the pending token, and comes next
+          queued = paren;
+          queued_at = paren_at;
+          has_queued = true;
+        }
+        else{
+          token = paren;
+          at = paren_at;
+        }
+        return true;
+      }
+      else if(c == '"'){
+        source.append();
+        c = source.get();
+        while(c != EOF && c != '"'){
+          source.append();
+          c = source.get();
+        }
+        if(c != EOF) source.append(); // the ending quote
+        return take(token, at);
+      }
+      else if(std::isspace(c)){
+        if(take(token, at)) return true;
+      }
+      else{
+        source.append();
+      }
+    }
+  }
+
+  /// return the offset of the next unread character
+  std::size_t offset() const noexcept { return source.offset(); }
+
+private:
+
+  bool take(Token & token, std::size_t & at){
+    if(!source.pending()) return false;
+    at = source.pendingOffset();
+    token = source.take();
+    return true;
+  }
+
+  Source & source;
+  Token queued;
+  std::size_t queued_at = 0;
+  bool has_queued = false;
+};
+
+#endif
@@ -0,0 +1,66 @@
+// Build tool saving the environment left by a program as C++ source, which
+// defines STARTUP_SNAPSHOT (see snapshot.hpp and startup_config.hpp).
+//
+// usage: make_snapshot <program file> <output source file>
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "snapshot.hpp"
+
+int main(int argc, char *argv[])
+{
+  if(argc != 3){
+    std::cerr << "usage: make_snapshot <program file> <output source file>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream program(argv[1]);
+  if(!program){
+    std::cerr << "Error: Could not open file " << argv[1] << " for reading." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Interpreter interp;
+  if(!interp.parseStream(program)){
+    std::cerr << "Error: Invalid Startup Program. Could not parse." << std::endl;
+    return EXIT_FAILURE;
+  }
+  try{
+    interp.evaluate();
+  }
+  catch(const SemanticError & ex){
+    std::cerr << "Start-up failed " << std::endl;
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string bytes = write_snapshot(interp.snapshot());
+
+  std::ofstream out(argv[2]);
+  out << "// generated by make_snapshot from " << argv[1] << ", do not edit\n\n"
+      << "#include \"startup_config.hpp\"\n\n"
+      << "// octal escapes, so the bytes do not depend on the signedness of char\n"
+      << "const char STARTUP_SNAPSHOT[] =";
+  for(std::size_t i = 0; i < bytes.size(); ++i){
+    if(i % 16 == 0){
+      out << (i == 0 ? "\n  \"" : "\"\n  \"");
+    }
+    out << '\\' << std::oct << std::setw(3) << std::setfill('0')
+        << static_cast<unsigned>(static_cast<unsigned char>(bytes[i]));
+  }
+  out << "\";\n\n"
+      << "const std::size_t STARTUP_SNAPSHOT_SIZE = sizeof(STARTUP_SNAPSHOT) - 1;\n";
+
+  out.close();
+  if(!out){
+    std::cerr << "Error: Could not write file " << argv[2] << "." << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+#include "memo_cache.hpp"
+
+#include <algorithm>
+#include <complex>
+#include <functional>
+#include <iterator>
+
+#include "arena.hpp"
+#include "environment.hpp"
+
+namespace {
+
+thread_local ReadLog * current_log = nullptr;
+thread_local MemoCache * current_cache = nullptr;
+
+// no symbol is bound with this version, so a value that read it is never valid
+const ReadLog::Read OUTSIDE_READ(std::string(), UINT64_MAX);
+
+std::size_t combine(std::size_t seed, std::size_t value){
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+std::size_t hash_atom(const Atom & a){
+
+  if(a.isNumber()){
+    return combine(1, std::hash<double>()(a.asNumber()));
+  }
+  if(a.isComplex()){
+    std::complex<double> c = a.asComplex();
+    return combine(combine(2, std::hash<double>()(c.real())), std::hash<double>()(c.imag()));
+  }
+  if(a.symbolId() != NoSymbol){
+    return combine(3, a.symbolId());
+  }
+  if(a.isString()){
+    // string literals are not interned
+    return combine(4, std::hash<std::string>()(a.asString()));
+  }
+  return 0;
+}
+
+}
+
+void ReadLog::note(const std::string & symbol, std::uint64_t version){
+
+  std::lock_guard<std::mutex> lock(mutex);
+  items.emplace_back(symbol, version);
+}
+
+void ReadLog::merge(const std::vector<Read> & other){
+
+  std::lock_guard<std::mutex> lock(mutex);
+  items.insert(items.end(), other.begin(), other.end());
+}
+
+std::vector<ReadLog::Read> ReadLog::reads(){
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::sort(items.begin(), items.end());
+  items.erase(std::unique(items.begin(), items.end()), items.end());
+  return items;
+}
+
+bool ReadLog::outside(const std::vector<Read> & reads){
+  return std::find(reads.begin(), reads.end(), OUTSIDE_READ) != reads.end();
+}
+
+ReadLog * ReadLog::current() noexcept{
+  return current_log;
+}
+
+ReadLogScope::ReadLogScope(ReadLog * log) noexcept: previous(current_log){
+  current_log = log;
+}
+
+ReadLogScope::~ReadLogScope(){
+  current_log = previous;
+}
+
+void note_read(const Atom & symbol, std::uint64_t version){
+
+  // the name is only made when it is recorded
+  if(current_log != nullptr){
+    current_log->note(symbol.asString(), version);
+  }
+}
+
+void note_outside_read(){
+
+  if(current_log != nullptr){
+    current_log->note(OUTSIDE_READ.first, OUTSIDE_READ.second);
+  }
+}
+
+MemoCache::MemoCache(std::size_t capacity, std::chrono::microseconds admit):
+  capacity(capacity), admit(admit){
+}
+
+void MemoCache::prepare(const Expression & program){
+
+  index.clear();
+
+  // hash bottom-up, returning whether the node is pure
+  std::function<bool(const Expression &, std::size_t &)> visit =
+    [&](const Expression & e, std::size_t & hash){
+      hash = hash_atom(e.head());
+      // a folded value is told apart by comparison, not by a hash of all of it
+      if(e.head().specialForm() == ConstantForm){
+        hash = combine(hash, e.contents()[0].tailLength());
+        return true;
+      }
+      bool pure = e.head().specialForm() != DefineForm;
+      for(auto p = e.tailConstBegin(); p != e.tailConstEnd(); ++p){
+        std::size_t child;
+        pure = visit(*p, child) && pure;
+        hash = combine(hash, child);
+      }
+      hash = combine(hash, e.tailLength());
+      if(pure && e.tailLength() > 0){
+        index.emplace(&e, hash);
+      }
+      return pure;
+    };
+
+  std::size_t hash;
+  visit(program, hash);
+}
+
+bool MemoCache::watches(const Expression & e) const noexcept{
+  return index.find(&e) != index.end();
+}
+
+const MemoCache::Entry * MemoCache::lookup(const Expression & e, const Environment & env){
+
+  std::size_t hash = index.at(&e);
+  auto range = by_hash.equal_range(hash);
+  for(auto candidate = range.first; candidate != range.second; ++candidate){
+    EntryList::iterator entry = candidate->second;
+    if(!(entry->key == e)){
+      continue;
+    }
+
+    bool valid = std::all_of(entry->reads.begin(), entry->reads.end(),
+                             [&env](const ReadLog::Read & read){
+                               return env.version(Atom(read.first)) == read.second;
+                             });
+    if(!valid){
+      // a binding it read has changed, so it will never be valid again
+      by_hash.erase(candidate);
+      entries.erase(entry);
+      return nullptr;
+    }
+
+    entries.splice(entries.begin(), entries, entry);
+    ++hit_count;
+    return &*entry;
+  }
+  return nullptr;
+}
+
+const Expression & MemoCache::store(const Expression & e, const Expression & value,
+                                    std::vector<ReadLog::Read> && reads){
+
+  if(capacity == 0){
+    return value;
+  }
+  if(entries.size() == capacity){
+    // forget the least recently used value
+    auto last = std::prev(entries.end());
+    auto range = by_hash.equal_range(last->hash);
+    for(auto p = range.first; p != range.second; ++p){
+      if(p->second == last){
+        by_hash.erase(p);
+        break;
+      }
+    }
+    entries.erase(last);
+  }
+
+  // the cache outlives the evaluation, so nothing it keeps may be transient
+  std::size_t hash = index.at(&e);
+  Entry entry{hash, e, value, std::move(reads)};
+  promote_to_heap(entry.key);
+  promote_to_heap(entry.value);
+  entries.push_front(std::move(entry));
+  by_hash.emplace(hash, entries.begin());
+  return entries.front().value;
+}
+
+void MemoCache::clear(){
+
+  entries.clear();
+  by_hash.clear();
+}
+
+std::size_t MemoCache::size() const noexcept{
+  return entries.size();
+}
+
+std::size_t MemoCache::hits() const noexcept{
+  return hit_count;
+}
+
+MemoCache * MemoCache::current() noexcept{
+  return current_cache;
+}
+
+MemoScope::MemoScope(MemoCache * cache) noexcept: previous(current_cache){
+  current_cache = cache;
+}
+
+MemoScope::~MemoScope(){
+  current_cache = previous;
+}
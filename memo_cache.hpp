@@ -0,0 +1,214 @@
+/*! \file memo_cache.hpp
+Defines the cache of the values of the pure subexpressions of programs.
+
+While a MemoCache is current on a thread, the subexpressions of the program
+it was prepared for that are evaluated in the global environment are looked
+up by content before being evaluated, so evaluating a program again, or a
+program sharing subexpressions with an earlier one, only recomputes what
+changed. A subexpression is pure unless it contains a define.
+
+The value of a pure subexpression depends on the bindings it reads, which
+are recorded in a ReadLog while it is evaluated, including those read by
+the lambdas it calls. Every binding made by Environment::add_exp has a new
+version, so a cached value is used only while each binding it read still
+has the version it had when the value was computed.
+ */
+#ifndef MEMO_CACHE_HPP
+#define MEMO_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "expression.hpp"
+
+class Environment;
+
+/*! \class ReadLog
+\brief The bindings of the global environment read by an evaluation.
+
+Other threads working for the evaluation keep their own logs and merge them
+into it, so merge may be called from any thread.
+*/
+class ReadLog {
+public:
+
+  /// a symbol and the version of its binding, 0 if it was unbound
+  typedef std::pair<std::string, std::uint64_t> Read;
+
+  ReadLog() = default;
+  ReadLog(const ReadLog &) = delete;
+  ReadLog & operator=(const ReadLog &) = delete;
+
+  /// record a read, by the thread owning the log
+  void note(const std::string & symbol, std::uint64_t version);
+
+  /// record the reads of another log, or of a cached value
+  void merge(const std::vector<Read> & other);
+
+  /// return the distinct reads recorded
+  std::vector<Read> reads();
+
+  /// predicate, reads hold a read outside of the program
+  static bool outside(const std::vector<Read> & reads);
+
+  /// return the log current on the calling thread, or nullptr
+  static ReadLog * current() noexcept;
+
+private:
+  std::mutex mutex;
+  std::vector<Read> items;
+};
+
+/*! \class ReadLogScope
+\brief Makes a log current on the calling thread for its lifetime.
+*/
+class ReadLogScope {
+public:
+  explicit ReadLogScope(ReadLog * log) noexcept;
+  ~ReadLogScope();
+
+  ReadLogScope(const ReadLogScope &) = delete;
+  ReadLogScope & operator=(const ReadLogScope &) = delete;
+
+private:
+  ReadLog * previous;
+};
+
+/// record a read of the global environment in the current log, if any
+void note_read(const Atom & symbol, std::uint64_t version);
+
+/*! Record in the current log, if any, that the evaluation read something
+  outside of the program, such as a file, so that its value is not cached.
+ */
+void note_outside_read();
+
+/*! \class MemoCache
+\brief A bounded cache of values keyed by the content of subexpressions.
+
+Only values that took at least the admission time to compute are kept, and
+the least recently used value is dropped when the cache is full.
+*/
+class MemoCache {
+public:
+
+  /*! Construct an empty cache.
+    \param capacity the number of values kept
+    \param admit the least evaluation time of a value worth keeping
+   */
+  explicit MemoCache(std::size_t capacity = 256,
+                     std::chrono::microseconds admit = std::chrono::microseconds(100));
+
+  /// index the subexpressions of program, which must outlive the evaluation
+  void prepare(const Expression & program);
+
+  /// predicate, e is a pure compound subexpression of the prepared program
+  bool watches(const Expression & e) const noexcept;
+
+  /*! Evaluate a watched subexpression in the global environment, through
+    the cache.
+    \param e the subexpression
+    \param env the global environment
+    \param evaluate computes the value of e when it is not cached
+   */
+  template <class Evaluate>
+  Expression evaluate(const Expression & e, const Environment & env, Evaluate evaluate);
+
+  /// drop every cached value
+  void clear();
+
+  /// return the number of cached values
+  std::size_t size() const noexcept;
+
+  /// return the number of evaluations answered by the cache
+  std::size_t hits() const noexcept;
+
+  /// return the cache current on the calling thread, or nullptr
+  static MemoCache * current() noexcept;
+
+private:
+
+  struct Entry {
+    std::size_t hash;
+    Expression key;
+    Expression value;
+    std::vector<ReadLog::Read> reads;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  // the value cached for e, if every binding it read is unchanged
+  const Entry * lookup(const Expression & e, const Environment & env);
+  const Expression & store(const Expression & e, const Expression & value,
+                           std::vector<ReadLog::Read> && reads);
+
+  std::size_t capacity;
+  std::chrono::microseconds admit;
+
+  // the content hash of every pure compound node of the prepared program
+  std::unordered_map<const Expression *, std::size_t> index;
+
+  // most recently used first
+  EntryList entries;
+  std::unordered_multimap<std::size_t, EntryList::iterator> by_hash;
+
+  std::size_t hit_count = 0;
+};
+
+/*! \class MemoScope
+\brief Makes a cache current on the calling thread for its lifetime.
+*/
+class MemoScope {
+public:
+  explicit MemoScope(MemoCache * cache) noexcept;
+  ~MemoScope();
+
+  MemoScope(const MemoScope &) = delete;
+  MemoScope & operator=(const MemoScope &) = delete;
+
+private:
+  MemoCache * previous;
+};
+
+template <class Evaluate>
+Expression MemoCache::evaluate(const Expression & e, const Environment & env, Evaluate evaluate){
+
+  ReadLog * outer = ReadLog::current();
+
+  const Entry * hit = lookup(e, env);
+  if(hit != nullptr){
+    // whatever is computed from this value depends on what it read
+    if(outer != nullptr){
+      outer->merge(hit->reads);
+    }
+    return hit->value;
+  }
+
+  ReadLog log;
+  auto start = std::chrono::steady_clock::now();
+  Expression value;
+  {
+    ReadLogScope scope(&log);
+    value = evaluate();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  std::vector<ReadLog::Read> reads = log.reads();
+  if(outer != nullptr){
+    outer->merge(reads);
+  }
+  if(elapsed >= admit && !ReadLog::outside(reads)){
+    // a define of the value then shares the storage of the cached one, so
+    // defining it again from the cache keeps the version of the binding
+    return store(e, value, std::move(reads));
+  }
+  return value;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "memo_cache.hpp"
+
+static Expression evaluate_in(Interpreter & interp, const std::string & program){
+
+  std::istringstream iss(program);
+  REQUIRE(interp.parseStream(iss));
+  return interp.evaluate();
+}
+
+static Interpreter memoizing(){
+
+  // keep every value, however cheap, so that small programs are cached
+  Interpreter interp;
+  interp.setMemoize(true, std::chrono::microseconds(0));
+  return interp;
+}
+
+TEST_CASE( "Test evaluating a program again uses the cache", "[memo_cache]" ) {
+
+  Interpreter interp = memoizing();
+  std::string cell =
+    "(begin (define f (lambda (x) (* x x))) (define data (map f (range 0 100))) (length data))";
+
+  Expression first = evaluate_in(interp, cell);
+  std::size_t hits = interp.getMemoCache().hits();
+  REQUIRE(interp.getMemoCache().size() > 0);
+
+  // defining data again from the cache keeps it unchanged, so the length is
+  // not recomputed either
+  Expression second = evaluate_in(interp, cell);
+  REQUIRE(second == first);
+  REQUIRE(interp.getMemoCache().hits() >= hits + 2);
+}
+
+TEST_CASE( "Test redefining a symbol invalidates what read it", "[memo_cache]" ) {
+
+  Interpreter interp = memoizing();
+  evaluate_in(interp, "(begin (define n 2) (define g (lambda (x) (* x n))))");
+
+  // n is only read inside the lambda
+  REQUIRE(evaluate_in(interp, "(map g (list 1 2 3))") == evaluate_in(interp, "(list 2 4 6)"));
+  evaluate_in(interp, "(define n 3)");
+  REQUIRE(evaluate_in(interp, "(map g (list 1 2 3))") == evaluate_in(interp, "(list 3 6 9)"));
+
+  // as when it is read by the workers of pmap
+  Expression before = evaluate_in(interp, "(pmap g (range 0 999))");
+  evaluate_in(interp, "(define n 4)");
+  Expression after = evaluate_in(interp, "(pmap g (range 0 999))");
+  REQUIRE(after == evaluate_in(interp, "(map g (range 0 999))"));
+  REQUIRE(!(after == before));
+}
+
+TEST_CASE( "Test defines are always evaluated", "[memo_cache]" ) {
+
+  Interpreter interp = memoizing();
+  evaluate_in(interp, "(define k 0)");
+  for(int i = 0; i < 3; ++i){
+    evaluate_in(interp, "(define k (+ k 1))");
+  }
+  REQUIRE(evaluate_in(interp, "(begin k)") == Expression(3.));
+}
+
+TEST_CASE( "Test programs share the values of equal subexpressions", "[memo_cache]" ) {
+
+  Interpreter interp = memoizing();
+  evaluate_in(interp, "(define f (lambda (x) (* x x)))");
+  Expression data = evaluate_in(interp, "(map f (range 0 100))");
+
+  std::size_t hits = interp.getMemoCache().hits();
+  REQUIRE(evaluate_in(interp, "(first (map f (range 0 100)))") == Expression(0.));
+  REQUIRE(interp.getMemoCache().hits() == hits + 1);
+
+  // as part of a different program, the lambda is bound anew
+  evaluate_in(interp, "(define f (lambda (x) (+ x x)))");
+  REQUIRE(evaluate_in(interp, "(first (rest (map f (range 0 100))))") == Expression(2.));
+}
+
+TEST_CASE( "Test cheap values are not cached by default", "[memo_cache]" ) {
+
+  Interpreter interp;
+  interp.setMemoize(true);
+  REQUIRE(interp.getMemoize());
+  evaluate_in(interp, "(+ 1 2)");
+  REQUIRE(interp.getMemoCache().size() == 0);
+
+  Interpreter plain;
+  REQUIRE_FALSE(plain.getMemoize());
+}
@@ -1,9 +1,14 @@
 #include "notebook_app.hpp"
 
-Consumer::Consumer(InputQueue * inq, OutputQueue * outq, Interpreter & inter): cThread() {
+Consumer::Consumer(InputQueue * inq, OutputQueue * outq, KernelStats * st, Interpreter & inter,
+                   std::function<void()> notify): cThread(), notify(notify) {
     iqueue = inq;
     oqueue = outq;
+    stats = st;
     cInterp = inter;
+    // cells are edited and evaluated again, mostly unchanged
+    cInterp.setMemoize(true);
+    initial = cInterp.snapshot();
 }
 Consumer::Consumer(){
 }
@@ -11,7 +16,10 @@ Consumer & Consumer::operator=(Consumer & c) noexcept{
     if(this!=&c){
         iqueue = c.iqueue;
         oqueue = c.oqueue;
+        stats = c.stats;
         cInterp = c.cInterp;
+        initial = c.initial;
+        notify = c.notify;
         cThread.swap(c.cThread);
     }
     return *this;
@@ -22,27 +30,56 @@ Consumer::~Consumer(){
 Consumer::Consumer(Consumer & c){
     iqueue = c.iqueue;
     oqueue = c.oqueue;
+    stats = c.stats;
     cInterp = c.cInterp;
+    initial = c.initial;
+    notify = c.notify;
     cThread.swap(c.cThread);
 }
 void Consumer::ThreadFunction() {
+    // the interrupt button reaches the kernel only through its token
+    CancellationScope watch(&token);
+    // the points appended to streaming plots are queued as they are made,
+    // ahead of the result of the cell appending them
+    StreamSink sink([this](const Expression & data){
+        oqueue->push(stamp(std::make_tuple(data, std::string(), true)));
+        if(notify){
+            notify();
+        }
+    });
+    StreamScope streams(&sink);
     Expression result;
     std::string error;
     bool succ;
 
-    std::string line;
+    Stamped<std::string> message;
     while(isRunning()){
 
-        iqueue->wait_and_pop(line);
+        // sleep until there is input, or the kernel is stopped
+        if(!iqueue->wait_and_pop(message)){
+            break;
+        }
+        stats->noteInputDepth(iqueue->size());
+        stats->record(KernelStats::Queued, message.sent);
+        LatencyClock::time_point popped = LatencyClock::now();
+        const std::string & line = message.value;
+
+        // an interrupt sent while idle was meant for an earlier cell
+        token.reset();
+        if(reset_requested.exchange(false)){
+            cInterp.restore(initial);
+        }
 
+        // the plots of the cell are decimated to the view it is drawn in
+        PlotWidthScope width(plot_width.load());
         std::istringstream expression(line);
-        if(line == "quit" || std::all_of(line.begin(), line.end(),isspace)){
+        if(std::all_of(line.begin(), line.end(),isspace)){
             continue;
         }
 
         succ = false;
         error = "";
-        output_type output;
+        Environment before = cInterp.snapshot();
 
         if(!cInterp.parseStream(expression)){
             error = "Error: Invalid Expression. Could not parse.";
@@ -54,58 +91,77 @@ void Consumer::ThreadFunction() {
             }
             catch(const SemanticError & ex){
                 error = ex.what();
+                // an interrupted cell leaves nothing half defined
+                if(token.cancelled()){
+                    cInterp.restore(before);
+                }
             }
         }
-        output = std::make_tuple(result, error, succ);
-        oqueue->push(output);
+        // the result is stamped as it is sent, ending the evaluation
+        Stamped<output_type> output(std::make_tuple(result, error, succ));
+        stats->record(KernelStats::Evaluated, popped);
+        oqueue->push(std::move(output));
+        if(notify){
+            notify();
+        }
     }
 }
 bool Consumer::isRunning(){
-    return running;
+    return running.load();
 }
 void Consumer::startThread(){
-    if(!running){
-        running = true;
+    if(!running.exchange(true)){
         cThread = std::thread(&Consumer::ThreadFunction, this);
     }
 }
 void Consumer::stopThread(){
-    if(running){
-        running = false;
-        std::string quit = "quit";
-        iqueue->push(quit);
-        if(cThread.joinable())
-            cThread.join();
-        iqueue->try_pop(quit);
+    if(running.exchange(false)){
+        iqueue->shutdown();
+        // a bounded output queue may be full, with the kernel waiting for
+        // room that only this thread would make by reading it
+        oqueue->shutdown();
     }
+    if(cThread.joinable())
+        cThread.join();
+    iqueue->restart();
+    oqueue->restart();
 }
-void Consumer::resetThread(Interpreter *original){
-    if(running){
-        stopThread();
-    }
-    cInterp = *original;
+void Consumer::interrupt(){
+    token.cancel();
+}
+void Consumer::setPlotWidth(std::size_t columns){
+    plot_width = columns;
+}
+void Consumer::reset(){
+    reset_requested = true;
+    interrupt();
     startThread();
 }
 
 NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent) {
     setObjectName("notebook");
 
-    std::ifstream startip_str(STARTUP_FILE);
-    if(!mrInterpret->parseStream(startip_str)){
-        emit send_failure("Error: Invalid Startup Program. Could not parse.");
+    Environment startup;
+    if(read_snapshot(STARTUP_SNAPSHOT, STARTUP_SNAPSHOT_SIZE, startup)){
+        // the startup file was evaluated when the notebook was built
+        mrInterpret->restore(startup);
     }
     else{
-        try{
-            Expression exp = mrInterpret->evaluate();
+        std::ifstream startip_str(STARTUP_FILE);
+        if(!mrInterpret->parseStream(startip_str)){
+            emit send_failure("Error: Invalid Startup Program. Could not parse.");
         }
-        catch(const SemanticError & ex){
-            emit send_failure(ex.what());
+        else{
+            try{
+                Expression exp = mrInterpret->evaluate();
+            }
+            catch(const SemanticError & ex){
+                emit send_failure(ex.what());
+            }
         }
     }
 
-    default_state = mrInterpret;
-
-    c1 = new Consumer(inputQ, outputQ, *mrInterpret);
+    c1 = new Consumer(inputQ, outputQ, &stats, *mrInterpret, [this]{ emit kernel_finished(); });
     c1->startThread();
 
     in = new InputWidget(this); //child widgets of notebook
@@ -125,15 +181,16 @@ NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent) {
     interuptButton->setObjectName("interrupt");
     row->addWidget(interuptButton);
 
+    statusLine = new QLabel(QString::fromStdString(stats.status_line()), this);
+    statusLine->setObjectName("stats");
+
     auto layout = new QVBoxLayout(this); // add the widgets to a vertical layout
     layout->addLayout(row);
     layout->addWidget(in, 1);
     layout->addWidget(out, 1);
+    layout->addWidget(statusLine);
     setLayout(layout);
 
-    timer = new QTimer(this);
-    timer->start(100);
-
     // connect input to this notebook for evaluating
     QObject::connect(in, SIGNAL(send_input(QString)), this, SLOT(catch_input(QString)));
 
@@ -152,14 +209,19 @@ NotebookApp::NotebookApp(QWidget *parent) : QWidget(parent) {
     QObject::connect(resetButton, SIGNAL(clicked()), this, SLOT(reset_kernal()));
     QObject::connect(interuptButton, SIGNAL(clicked()), this, SLOT(interupt_kernAl()));
 
-    QObject::connect(timer, SIGNAL(timeout()), this, SLOT(time_ran_out()));
+    // results are handed over on the GUI thread as soon as the kernel queues them
+    QObject::connect(this, SIGNAL(kernel_finished()), this, SLOT(collect_results()), Qt::QueuedConnection);
 }
 void NotebookApp::catch_input(QString s){
 
-    global_status_flag = 0;
+    std::string line = s.toStdString();
+    if(std::all_of(line.begin(), line.end(), isspace)) {
+        return;
+    }
     if(c1->isRunning()) {
-        inputQ->push(s.toStdString());
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ++pending;
+        c1->setPlotWidth(out->plotWidth());
+        inputQ->push(stamp(std::move(line)));
     }
     else {
         emit send_failure("Error: Interpreter kernal is not running");
@@ -172,27 +234,52 @@ void NotebookApp::start_kernal() {
 
 void NotebookApp::stop_kernal() {
     c1->stopThread();
+    discard_pending();
 }
 
 void NotebookApp::reset_kernal() {
-    mrInterpret = default_state;
-    c1->resetThread(default_state);
+    c1->reset();
 }
 
 void NotebookApp::interupt_kernAl(){
-    global_status_flag = 1;
+    c1->interrupt();
 }
 
-void NotebookApp::time_ran_out(){
-    output_type results; /// Tuple with { Expression e, std::string ex.what(), bool success }
-    if(c1->isRunning() && outputQ->try_pop(results)){
+bool NotebookApp::isEvaluating() const {
+    return pending > 0;
+}
+
+const KernelStats & NotebookApp::kernelStats() const {
+    return stats;
+}
+
+void NotebookApp::collect_results(){
+    Stamped<output_type> message;
+    bool collected = false;
+    while(outputQ->try_pop(message)){
+        stats.noteOutputDepth(outputQ->size());
+        stats.record(KernelStats::Delivered, message.sent);
+        collected = true;
+        const output_type & results = message.value; /// Tuple with { Expression e, std::string ex.what(), bool success }
+        // the points of a streaming plot answer no input
+        if(pending > 0 && !is_stream_data(std::get<0>(results))) {
+            --pending;
+        }
         if(std::get<2>(results)) {
             emit send_result(std::get<0>(results));
         }
         else {
             emit send_failure(std::get<1>(results));
         }
-        c1->stopThread();
-        c1->startThread();
     }
-}
\ No newline at end of file
+    if(collected) {
+        statusLine->setText(QString::fromStdString(stats.status_line()));
+    }
+}
+
+void NotebookApp::discard_pending(){
+    // input the stopped kernel never read will not be answered
+    inputQ->clear();
+    collect_results();
+    pending = 0;
+}
@@ -2,35 +2,63 @@
 #define NOTEBOOK_APP_H
 
 #include <QWidget>
+#include <QLabel>
 #include <QLayout>
 #include <QPushButton>
-#include <QTimer>
 
 #include "input_widget.hpp"
 #include "output_widget.hpp"
 
+#include "cancellation.hpp"
+#include "decimation.hpp"
 #include "interpreter.hpp"
+#include "kernel_stats.hpp"
 #include "semantic_error.hpp"
+#include "snapshot.hpp"
 #include "startup_config.hpp"
+#include "stream_plot.hpp"
+#ifdef PLOTSCRIPT_SPSC_QUEUES
+#include "SPSCmessage.hpp"
+#else
 #include "TSmessage.hpp"
+#endif
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <functional>
 #include <sstream>
 
 
-typedef TSmessage<std::string> InputQueue;
+// the messages carry the time they were sent, for the status line
 typedef std::tuple<Expression, std::string, bool> output_type;
-typedef TSmessage<output_type> OutputQueue;
+#ifdef PLOTSCRIPT_SPSC_QUEUES
+typedef SPSCmessage<Stamped<std::string>> InputQueue;
+typedef SPSCmessage<Stamped<output_type>> OutputQueue;
+#else
+typedef TSmessage<Stamped<std::string>> InputQueue;
+typedef TSmessage<Stamped<output_type>> OutputQueue;
+#endif
 
 class Consumer {
   private:
     InputQueue * iqueue;
     OutputQueue * oqueue;
+    KernelStats * stats = nullptr;
     Interpreter cInterp;
-    bool running = false;
+    Environment initial;
+    CancellationToken token;
+    std::atomic<bool> reset_requested{false};
+    std::atomic<std::size_t> plot_width{0};
+    // read by the kernel loop, written by the thread starting and stopping it
+    std::atomic<bool> running{false};
     std::thread cThread;
+    std::function<void()> notify;
   public:
-    Consumer(InputQueue * inq, OutputQueue * outq, Interpreter &inter);
+    /// notify is called on the kernel thread after each result is queued;
+    /// the latencies of the requests are recorded in stats
+    Consumer(InputQueue * inq, OutputQueue * outq, KernelStats * stats, Interpreter &inter,
+             std::function<void()> notify = std::function<void()>());
     Consumer();
     Consumer & operator=(Consumer & c) noexcept;
     ~Consumer();
@@ -39,7 +67,12 @@ class Consumer {
     bool isRunning();
     void startThread();
     void stopThread();
-    void resetThread(Interpreter *i);
+    /// stop the cell being evaluated, safe from any thread
+    void interrupt();
+    /// return to the initial state before the next cell, without a new thread
+    void reset();
+    /// set the width, in pixels, the plots of the next cells are decimated to
+    void setPlotWidth(std::size_t columns);
 };
 
 class NotebookApp : public QWidget {
@@ -48,29 +81,41 @@ class NotebookApp : public QWidget {
     public:
         NotebookApp(QWidget *parent = nullptr);
 
+        /// predicate, some submitted input has not been answered yet
+        bool isEvaluating() const;
+
+        /// return the latencies of the requests answered so far
+        const KernelStats & kernelStats() const;
+
     signals:
         void send_result(Expression exp);
         void send_failure(std::string message);
 
+        /// emitted from the kernel thread when a result has been queued
+        void kernel_finished();
+
      private slots:
         void catch_input(QString r);
         void start_kernal();
         void stop_kernal();
         void reset_kernal();
         void interupt_kernAl();
-        void time_ran_out();
+        void collect_results();
 
     private:
         InputWidget* in;
         OutputWidget* out;
         Interpreter* mrInterpret = new Interpreter;
-        Interpreter* default_state = new Interpreter;
         InputQueue* inputQ = new InputQueue;
         OutputQueue* outputQ = new OutputQueue;
+        KernelStats stats;
+        QLabel* statusLine;
         Consumer* c1;
         QPushButton* startButton, stopButton, resetButton, interuptButton;
         bool interupt_signal = false;
-        QTimer * timer;
+        int pending = 0;
+
+        void discard_pending();
 };
 
 #endif
\ No newline at end of file
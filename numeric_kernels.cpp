@@ -0,0 +1,140 @@
+#include "numeric_kernels.hpp"
+
+#include <cmath>
+
+namespace {
+
+// one loop per broadcasting pattern keeps every loop body branch free
+template <class T, class Op>
+void binary_loop(const T * __restrict a, bool a_scalar, const T * __restrict b, bool b_scalar,
+                 T * __restrict out, std::size_t n, Op op){
+
+  if(a_scalar && b_scalar){
+    for(std::size_t i = 0; i < n; ++i) out[i] = op(a[0], b[0]);
+  }
+  else if(a_scalar){
+    const T s = a[0];
+    for(std::size_t i = 0; i < n; ++i) out[i] = op(s, b[i]);
+  }
+  else if(b_scalar){
+    const T s = b[0];
+    for(std::size_t i = 0; i < n; ++i) out[i] = op(a[i], s);
+  }
+  else{
+    for(std::size_t i = 0; i < n; ++i) out[i] = op(a[i], b[i]);
+  }
+}
+
+template <class T, class Op>
+void unary_loop(const T * __restrict a, T * __restrict out, std::size_t n, Op op){
+  for(std::size_t i = 0; i < n; ++i) out[i] = op(a[i]);
+}
+
+double power(double x, double y){
+  return real_power(x, y);
+}
+
+std::complex<double> power(std::complex<double> x, std::complex<double> y){
+  return std::pow(x, y);
+}
+
+template <class T>
+void binary_dispatch(BinaryOp op, const T * a, bool a_scalar, const T * b, bool b_scalar,
+                     T * out, std::size_t n){
+  switch(op){
+    case BinaryOp::Add:
+      binary_loop(a, a_scalar, b, b_scalar, out, n, [](T x, T y){ return x + y; });
+      break;
+    case BinaryOp::Sub:
+      binary_loop(a, a_scalar, b, b_scalar, out, n, [](T x, T y){ return x - y; });
+      break;
+    case BinaryOp::Mul:
+      binary_loop(a, a_scalar, b, b_scalar, out, n, [](T x, T y){ return x * y; });
+      break;
+    case BinaryOp::Div:
+      binary_loop(a, a_scalar, b, b_scalar, out, n, [](T x, T y){ return x / y; });
+      break;
+    case BinaryOp::Pow:
+      binary_loop(a, a_scalar, b, b_scalar, out, n, [](T x, T y){ return power(x, y); });
+      break;
+  }
+}
+
+}
+
+double real_power(double x, double y){
+
+  if(x >= 0 || std::trunc(y) == y){
+    return std::pow(x, y);
+  }
+  return std::pow(std::complex<double>(x), std::complex<double>(y)).real();
+}
+
+void binary_kernel(BinaryOp op, const double * a, bool a_scalar,
+                   const double * b, bool b_scalar, double * out, std::size_t n){
+
+  binary_dispatch(op, a, a_scalar, b, b_scalar, out, n);
+}
+
+void binary_kernel(BinaryOp op, const std::complex<double> * a, bool a_scalar,
+                   const std::complex<double> * b, bool b_scalar,
+                   std::complex<double> * out, std::size_t n){
+
+  binary_dispatch(op, a, a_scalar, b, b_scalar, out, n);
+}
+
+void unary_kernel(UnaryOp op, const double * a, double * out, std::size_t n){
+
+  switch(op){
+    case UnaryOp::Neg:
+      unary_loop(a, out, n, [](double x){ return -x; });
+      break;
+    case UnaryOp::Inv:
+      unary_loop(a, out, n, [](double x){ return 1.0 / x; });
+      break;
+    case UnaryOp::Sqrt:
+      unary_loop(a, out, n, [](double x){ return std::sqrt(x); });
+      break;
+    case UnaryOp::Ln:
+      unary_loop(a, out, n, [](double x){ return std::log(x); });
+      break;
+    case UnaryOp::Sin:
+      unary_loop(a, out, n, [](double x){ return std::sin(x); });
+      break;
+    case UnaryOp::Cos:
+      unary_loop(a, out, n, [](double x){ return std::cos(x); });
+      break;
+    case UnaryOp::Tan:
+      unary_loop(a, out, n, [](double x){ return std::tan(x); });
+      break;
+  }
+}
+
+void unary_kernel(UnaryOp op, const std::complex<double> * a,
+                  std::complex<double> * out, std::size_t n){
+
+  typedef std::complex<double> C;
+  switch(op){
+    case UnaryOp::Neg:
+      unary_loop(a, out, n, [](C x){ return -x; });
+      break;
+    case UnaryOp::Inv:
+      unary_loop(a, out, n, [](C x){ return C(1.0, 0) / x; });
+      break;
+    case UnaryOp::Sqrt:
+      unary_loop(a, out, n, [](C x){ return std::sqrt(x); });
+      break;
+    case UnaryOp::Ln:
+      unary_loop(a, out, n, [](C x){ return std::log(x); });
+      break;
+    case UnaryOp::Sin:
+      unary_loop(a, out, n, [](C x){ return std::sin(x); });
+      break;
+    case UnaryOp::Cos:
+      unary_loop(a, out, n, [](C x){ return std::cos(x); });
+      break;
+    case UnaryOp::Tan:
+      unary_loop(a, out, n, [](C x){ return std::tan(x); });
+      break;
+  }
+}
@@ -0,0 +1,52 @@
+/*! \file numeric_kernels.hpp
+Defines the elementwise kernels used by the arithmetic procedures when they
+are applied to packed numeric lists.
+
+Each kernel is a single loop over contiguous arrays with no aliasing between
+input and output, written so that the compiler can vectorize it. Scalars are
+broadcast by passing a pointer to a single value and setting the matching
+scalar flag.
+ */
+#ifndef NUMERIC_KERNELS_HPP
+#define NUMERIC_KERNELS_HPP
+
+#include <complex>
+#include <cstddef>
+
+/*! \enum BinaryOp
+\brief The elementwise binary operations.
+*/
+enum class BinaryOp { Add, Sub, Mul, Div, Pow };
+
+/*! \enum UnaryOp
+\brief The elementwise unary operations.
+*/
+enum class UnaryOp { Neg, Inv, Sqrt, Ln, Sin, Cos, Tan };
+
+/*! Compute out[i] = a[i] op b[i] over real arrays
+  \param a the left operand, a single value if a_scalar
+  \param b the right operand, a single value if b_scalar
+  \param out the result, n values not overlapping a or b
+ */
+void binary_kernel(BinaryOp op, const double * a, bool a_scalar,
+                   const double * b, bool b_scalar, double * out, std::size_t n);
+
+/// Compute out[i] = a[i] op b[i] over complex arrays
+void binary_kernel(BinaryOp op, const std::complex<double> * a, bool a_scalar,
+                   const std::complex<double> * b, bool b_scalar,
+                   std::complex<double> * out, std::size_t n);
+
+/*! Raise x to the power y, with real arithmetic where the result is real
+  (x not negative, or y a whole number) and as the real part of the complex
+  power otherwise; shared by the scalar procedure and the real kernel.
+ */
+double real_power(double x, double y);
+
+/// Compute out[i] = op(a[i]) over real arrays
+void unary_kernel(UnaryOp op, const double * a, double * out, std::size_t n);
+
+/// Compute out[i] = op(a[i]) over complex arrays
+void unary_kernel(UnaryOp op, const std::complex<double> * a,
+                  std::complex<double> * out, std::size_t n);
+
+#endif
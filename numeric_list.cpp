@@ -0,0 +1,117 @@
+#include "numeric_list.hpp"
+
+NumericList::NumericList(std::vector<double> && values):
+  m_complex(false), m_lazy(false), m_sequence(), m_size(values.size()), m_real(std::move(values))
+{}
+
+NumericList::NumericList(std::vector<std::complex<double>> && values):
+  m_complex(true), m_lazy(false), m_sequence(), m_size(values.size()), m_cplx(std::move(values))
+{}
+
+NumericList::NumericList(const Sequence & sequence):
+  m_complex(false), m_lazy(true), m_sequence(sequence), m_size(0)
+{
+  // counted as they are summed, so that the count agrees with the numbers
+  for(double x = sequence.start; x <= sequence.stop; x += sequence.step){
+    ++m_size;
+  }
+}
+
+bool NumericList::isComplex() const noexcept{
+  return m_complex;
+}
+
+std::size_t NumericList::size() const noexcept{
+  return m_size;
+}
+
+const std::vector<double> & NumericList::real() const{
+
+  if(m_lazy){
+    std::call_once(m_real_once, [this](){
+      m_real.reserve(m_size);
+      for(double x = m_sequence.start; x <= m_sequence.stop; x += m_sequence.step){
+        m_real.push_back(x);
+      }
+    });
+  }
+  return m_real;
+}
+
+const NumericList::Sequence * NumericList::sequence() const noexcept{
+  return m_lazy ? &m_sequence : nullptr;
+}
+
+const std::vector<std::complex<double>> & NumericList::complex() const noexcept{
+  return m_cplx;
+}
+
+Expression NumericList::at(std::size_t i) const{
+  return m_complex ? Expression(m_cplx[i]) : Expression(real()[i]);
+}
+
+const std::vector<Expression> & NumericList::boxed() const{
+
+  std::call_once(m_boxed_once, [this](){
+    m_boxed.reserve(size());
+    for(std::size_t i = 0; i < size(); ++i){
+      m_boxed.push_back(at(i));
+    }
+  });
+  return m_boxed;
+}
+
+std::shared_ptr<const NumericList> NumericList::pack(const std::vector<Expression> & items){
+
+  if(items.empty()){
+    return nullptr;
+  }
+
+  // only plain numbers without properties can be packed
+  bool complex = items.front().head().isComplex();
+  for(auto & e : items){
+    bool plain = e.isNone() && !e.hasProperties();
+    if(!plain || (complex ? !e.head().isComplex() : !e.head().isNumber())){
+      return nullptr;
+    }
+  }
+
+  if(complex){
+    std::vector<std::complex<double>> values;
+    values.reserve(items.size());
+    for(auto & e : items){
+      values.push_back(e.head().asComplex());
+    }
+    return std::make_shared<NumericList>(std::move(values));
+  }
+
+  std::vector<double> values;
+  values.reserve(items.size());
+  for(auto & e : items){
+    values.push_back(e.head().asNumber());
+  }
+  return std::make_shared<NumericList>(std::move(values));
+}
+
+Expression make_packed_list(std::shared_ptr<const NumericList> values){
+  Expression result = Expression(std::vector<Expression>());
+  result.m_numeric = values;
+  return result;
+}
+
+Expression make_numeric_list(std::vector<double> && values){
+  return make_packed_list(std::make_shared<NumericList>(std::move(values)));
+}
+
+Expression make_numeric_list(std::vector<std::complex<double>> && values){
+  return make_packed_list(std::make_shared<NumericList>(std::move(values)));
+}
+
+Expression make_list(std::vector<Expression> && items){
+
+  std::shared_ptr<const NumericList> packed = NumericList::pack(items);
+  if(packed){
+    return make_packed_list(packed);
+  }
+  return Expression(std::move(items));
+}
@@ -0,0 +1,103 @@
+/*! \file numeric_list.hpp
+Defines the packed storage used for lists whose items are all numbers.
+
+A list of plain real numbers, or of plain complex numbers, is stored as one
+contiguous array of doubles (or std::complex<double>) instead of one
+Expression per item. Such lists are still ordinary list Expressions to the
+rest of the interpreter; code that does not know about the packed storage
+sees the items through a boxed copy that is built on first use.
+
+The numbers of a range are not stored until they are read by position: a
+consumer reading them in order, as map does, generates them from their
+Sequence instead, so that a range of any length takes constant space.
+ */
+#ifndef NUMERIC_LIST_HPP
+#define NUMERIC_LIST_HPP
+
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "expression.hpp"
+
+/*! \class NumericList
+\brief Immutable contiguous storage for a homogeneous numeric list.
+
+A NumericList is shared between Expressions through a shared_ptr and never
+modified after construction, so it may be read from several threads.
+*/
+class NumericList {
+public:
+
+  /// The numbers start, start + step, ... up to stop, summed in that order
+  struct Sequence {
+    double start;
+    double stop;
+    double step;
+  };
+
+  /// Construct a list of real numbers, taking over values
+  explicit NumericList(std::vector<double> && values);
+
+  /// Construct a list of complex numbers, taking over values
+  explicit NumericList(std::vector<std::complex<double>> && values);
+
+  /// Construct the real numbers of sequence, stored on first use (thread-safe)
+  explicit NumericList(const Sequence & sequence);
+
+  /// predicate to determine if the items are complex numbers
+  bool isComplex() const noexcept;
+
+  /// return the number of items
+  std::size_t size() const noexcept;
+
+  /// return the real items, empty if the list is complex
+  const std::vector<double> & real() const;
+
+  /// return the sequence of the items, or nullptr if they were given
+  const Sequence * sequence() const noexcept;
+
+  /// return the complex items, empty if the list is real
+  const std::vector<std::complex<double>> & complex() const noexcept;
+
+  /// return the item at position i as an Expression
+  Expression at(std::size_t i) const;
+
+  /// return the items as Expressions, built once on first use (thread-safe)
+  const std::vector<Expression> & boxed() const;
+
+  /*! Pack items into numeric storage if they are all plain numbers of the
+    same kind.
+    \param items the candidate list items
+    \return the packed storage, or nullptr if items is heterogeneous
+   */
+  static std::shared_ptr<const NumericList> pack(const std::vector<Expression> & items);
+
+private:
+
+  bool m_complex;
+  bool m_lazy;
+  Sequence m_sequence;
+  std::size_t m_size;
+  mutable std::once_flag m_real_once;
+  mutable std::vector<double> m_real;
+  std::vector<std::complex<double>> m_cplx;
+
+  mutable std::once_flag m_boxed_once;
+  mutable std::vector<Expression> m_boxed;
+};
+
+/// Build a list Expression over existing packed storage
+Expression make_packed_list(std::shared_ptr<const NumericList> values);
+
+/// Build a packed list Expression of real numbers
+Expression make_numeric_list(std::vector<double> && values);
+
+/// Build a packed list Expression of complex numbers
+Expression make_numeric_list(std::vector<std::complex<double>> && values);
+
+/// Build a list Expression, packing items when they are homogeneous numbers
+Expression make_list(std::vector<Expression> && items);
+
+#endif
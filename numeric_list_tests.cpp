@@ -0,0 +1,203 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <complex>
+#include <sstream>
+#include <string>
+
+#include "numeric_list.hpp"
+#include "environment.hpp"
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+
+static Expression evaluate_in(Interpreter & interp, const std::string & program){
+
+  std::istringstream iss(program);
+  INFO(program);
+  REQUIRE(interp.parseStream(iss));
+  return interp.evaluate();
+}
+
+// the message of the error evaluating program throws
+static std::string error_of(const std::string & program){
+
+  Interpreter interp;
+  try{
+    evaluate_in(interp, program);
+  }
+  catch(const SemanticError & error){
+    return error.what();
+  }
+  FAIL("no error in " << program);
+  return "";
+}
+
+TEST_CASE( "Test packing homogeneous lists", "[numeric_list]" ) {
+
+  Expression reals = make_list({Expression(1.), Expression(2.), Expression(3.)});
+  REQUIRE(reals.isList());
+  REQUIRE(reals.isNumericList());
+  REQUIRE(!reals.numericList()->isComplex());
+  REQUIRE(reals.tailLength() == 3);
+  REQUIRE(reals == Expression(std::vector<Expression>{Expression(1.), Expression(2.), Expression(3.)}));
+
+  Expression complexes = make_list({Expression(std::complex<double>(0, 1)), Expression(std::complex<double>(1, 1))});
+  REQUIRE(complexes.isNumericList());
+  REQUIRE(complexes.numericList()->isComplex());
+  REQUIRE(*complexes.tailConstBegin() == Expression(std::complex<double>(0, 1)));
+
+  Expression mixed = make_list({Expression(1.), Expression(std::complex<double>(0, 1))});
+  REQUIRE(mixed.isList());
+  REQUIRE(!mixed.isNumericList());
+
+  Expression nested = make_list({Expression(1.), Expression(std::vector<Expression>{})});
+  REQUIRE(!nested.isNumericList());
+}
+
+TEST_CASE( "Test packed lists through the list procedures", "[numeric_list]" ) {
+
+  Environment env;
+  Expression range = env.get_proc(Atom("range"))({Expression(0.), Expression(4.)});
+  REQUIRE(range.isNumericList());
+  REQUIRE(range.tailLength() == 5);
+
+  std::ostringstream os;
+  os << range;
+  REQUIRE(os.str() == "((0) (1) (2) (3) (4))");
+
+  REQUIRE(env.get_proc(Atom("first"))({range}) == Expression(0.));
+  REQUIRE(env.get_proc(Atom("rest"))({range}).isNumericList());
+  REQUIRE(env.get_proc(Atom("length"))({range}) == Expression(5.));
+
+  Expression appended = env.get_proc(Atom("append"))({range, Expression(5.)});
+  REQUIRE(appended.isNumericList());
+  REQUIRE(appended.tailLength() == 6);
+
+  Expression heterogeneous = env.get_proc(Atom("append"))({range, Expression(Atom("\"six\""))});
+  REQUIRE(!heterogeneous.isNumericList());
+  REQUIRE(heterogeneous.tailLength() == 6);
+
+  Expression joined = env.get_proc(Atom("join"))({range, appended});
+  REQUIRE(joined.isNumericList());
+  REQUIRE(joined.tailLength() == 11);
+
+  Expression modified = range;
+  modified.append(Atom("x"));
+  REQUIRE(!modified.isNumericList());
+  REQUIRE(modified.tailLength() == 6);
+  REQUIRE(range.tailLength() == 5);
+}
+
+TEST_CASE( "Test elementwise arithmetic over lists", "[numeric_list]" ) {
+
+  Environment env;
+  Expression a = make_numeric_list(std::vector<double>{1., 2., 3.});
+  Expression b = make_numeric_list(std::vector<double>{4., 5., 6.});
+  std::complex<double> I(0, 1);
+
+  Expression sum = env.get_proc(Atom("+"))({a, b, Expression(1.)});
+  REQUIRE(sum.isNumericList());
+  REQUIRE(sum == make_numeric_list(std::vector<double>{6., 8., 10.}));
+
+  REQUIRE(env.get_proc(Atom("*"))({Expression(2.), a}) ==
+          make_numeric_list(std::vector<double>{2., 4., 6.}));
+  REQUIRE(env.get_proc(Atom("-"))({b, a}) ==
+          make_numeric_list(std::vector<double>{3., 3., 3.}));
+  REQUIRE(env.get_proc(Atom("-"))({a}) ==
+          make_numeric_list(std::vector<double>{-1., -2., -3.}));
+  REQUIRE(env.get_proc(Atom("/"))({a, Expression(2.)}) ==
+          make_numeric_list(std::vector<double>{0.5, 1., 1.5}));
+  Expression squares = env.get_proc(Atom("^"))({a, Expression(2.)});
+  REQUIRE(*(squares.tailConstBegin() + 2) == env.get_proc(Atom("^"))({Expression(3.), Expression(2.)}));
+
+  // a complex operand promotes the whole result
+  Expression shifted = env.get_proc(Atom("+"))({a, Expression(I)});
+  REQUIRE(shifted.numericList()->isComplex());
+  REQUIRE(shifted == make_numeric_list(std::vector<std::complex<double>>{1. + I, 2. + I, 3. + I}));
+
+  // a list mixing real and complex numbers is promoted to complex
+  Expression mixed(std::vector<Expression>{Expression(1.), Expression(I)});
+  Expression doubled = env.get_proc(Atom("*"))({mixed, Expression(2.)});
+  REQUIRE(doubled.numericList()->isComplex());
+  REQUIRE(doubled == make_numeric_list(std::vector<std::complex<double>>{2., 2. * I}));
+  REQUIRE(env.get_proc(Atom("+"))({mixed, make_numeric_list(std::vector<double>{1., 1.})}) ==
+          make_numeric_list(std::vector<std::complex<double>>{2., 1. + I}));
+
+  // real powers stay real, a negative base to a fractional power does not
+  Expression powers = env.get_proc(Atom("^"))({make_numeric_list(std::vector<double>{2., -2., 0.}), Expression(3.)});
+  REQUIRE(!powers.numericList()->isComplex());
+  REQUIRE(powers == make_numeric_list(std::vector<double>{8., -8., 0.}));
+  REQUIRE(env.get_proc(Atom("^"))({Expression(0.), Expression(0.)}) == Expression(1.));
+  REQUIRE(env.get_proc(Atom("^"))({Expression(-8.), Expression(1. / 3.)}) ==
+          Expression(std::pow(std::complex<double>(-8.), 1. / 3.).real()));
+
+  // unpacked numeric lists broadcast as well
+  Expression boxed(std::vector<Expression>{Expression(1.), Expression(4.)});
+  REQUIRE(env.get_proc(Atom("sqrt"))({boxed}) ==
+          make_numeric_list(std::vector<double>{1., 2.}));
+
+  Expression roots = env.get_proc(Atom("sqrt"))({make_numeric_list(std::vector<double>{4., -4.})});
+  REQUIRE(*roots.tailConstBegin() == Expression(2.));
+  REQUIRE(*(roots.tailConstBegin() + 1) == Expression(2. * I));
+
+  REQUIRE(env.get_proc(Atom("sin"))({make_numeric_list(std::vector<double>{0.})}) ==
+          make_numeric_list(std::vector<double>{0.}));
+
+  Expression different = make_numeric_list(std::vector<double>{1., 2.});
+  REQUIRE_THROWS_AS(env.get_proc(Atom("+"))({a, different}), SemanticError);
+  REQUIRE_THROWS_AS(env.get_proc(Atom("ln"))({make_numeric_list(std::vector<double>{1., 0.})}), SemanticError);
+  REQUIRE_THROWS_AS(env.get_proc(Atom("sin"))({shifted}), SemanticError);
+  Expression words(std::vector<Expression>{Expression(Atom("\"a\""))});
+  REQUIRE_THROWS_AS(env.get_proc(Atom("*"))({a, words}), SemanticError);
+}
+
+TEST_CASE( "Test ranges are generated as they are read", "[numeric_list]" ) {
+
+  NumericList lazy(NumericList::Sequence{0, 1, 0.1});
+  REQUIRE(lazy.sequence() != nullptr);
+  REQUIRE(lazy.size() == 11);
+  REQUIRE(!lazy.isComplex());
+
+  // the numbers are those of summing the step, as a range always had them
+  std::vector<double> summed;
+  for(double x = 0; x <= 1; x += 0.1){
+    summed.push_back(x);
+  }
+  REQUIRE(lazy.at(10) == Expression(summed[10]));
+  REQUIRE(lazy.real() == summed);
+  REQUIRE(NumericList(std::vector<double>{1.}).sequence() == nullptr);
+
+  Environment env;
+  Expression range = env.get_proc(Atom("range"))({Expression(0.), Expression(1.), Expression(0.1)});
+  REQUIRE(range.numericList()->sequence() != nullptr);
+  REQUIRE(range == make_numeric_list(std::move(summed)));
+}
+
+TEST_CASE( "Test maps over a map are fused", "[numeric_list]" ) {
+
+  Interpreter interp;
+  evaluate_in(interp, "(define f (lambda (x) (* x 2)))");
+  evaluate_in(interp, "(define g (lambda (x) (list x)))");
+  evaluate_in(interp, "(define h (lambda (x) (first x)))");
+
+  Expression fused = evaluate_in(interp, "(map h (map g (map f (range 0 100 1))))");
+  evaluate_in(interp, "(define doubled (map f (range 0 100 1)))");
+  Expression boxed = evaluate_in(interp, "(define boxed (map g doubled))");
+  REQUIRE(fused == evaluate_in(interp, "(map h boxed)"));
+  REQUIRE(fused.isNumericList());
+  REQUIRE(!boxed.isNumericList());
+
+  REQUIRE(evaluate_in(interp, "(apply + (map f (range 1 3 1)))") == Expression(12.));
+  REQUIRE(evaluate_in(interp, "(map f (map f (list)))") == Expression(std::vector<Expression>()));
+  REQUIRE(evaluate_in(interp, "(map sqrt (map - (list 4 9)))") ==
+          make_numeric_list(std::vector<std::complex<double>>{{0, 2}, {0, 3}}));
+
+  // the error is that of the innermost map, as if they ran one after the other
+  // first fails on the first item, but sqrt fails on the second before
+  // first is called on it
+  std::string inner = error_of("(map sqrt (list 4 \"a\"))");
+  REQUIRE(error_of("(map first (map sqrt (list 4 \"a\")))") == inner);
+  REQUIRE(error_of("(map first (map sqrt (list 4 9)))") == error_of("(first 2)"));
+  REQUIRE(error_of("(map f (map 1 (list 1)))") == "Error: first argument to map not a procedure");
+  REQUIRE(error_of("(map first (map - 1))") == "Error: second argument to apply not a list");
+}
@@ -1,5 +1,37 @@
 #include "output_widget.hpp"
 
+#include <QPainterPath>
+#include <QTimer>
+
+#include <algorithm>
+
+#include "numeric_list.hpp"
+#include "plot_item.hpp"
+#include "stream_plot.hpp"
+
+namespace {
+
+// the size of the frame of a streaming plot, and the offsets of its labels, as of a discrete plot
+const double N = 20, A = 3, B = 3, C = 2, D = 2;
+
+// the frame of a streaming plot grows past the data by this share of its span,
+// so that it is not redrawn for every point beyond its edge
+const double GROWTH = 0.25;
+
+bool holds(const QRectF & frame, const QRectF & data) {
+    return frame.left() <= data.left() && data.right() <= frame.right() &&
+           frame.top() <= data.top() && data.bottom() <= frame.bottom();
+}
+
+// set the text of label, keeping it centered at (x, y)
+void place(QGraphicsTextItem * label, const QString & text, double x, double y) {
+    label->setPlainText(text);
+    QRectF rect = label->boundingRect();
+    label->setPos(x - rect.width()/2, y - rect.height()/2);
+}
+
+}
+
 OutputWidget::OutputWidget(QWidget * parent) : QWidget(parent) {
     setObjectName("output");
     auto layout = new QHBoxLayout(this);
@@ -7,12 +39,50 @@ OutputWidget::OutputWidget(QWidget * parent) : QWidget(parent) {
     view->setScene(scene);
 }
 
+std::size_t OutputWidget::plotWidth() const {
+    return static_cast<std::size_t>(std::max(1, view->viewport()->width()));
+}
+
 void OutputWidget::catch_result(Expression e){
-    if(clear_on_print){
-        clear_screen();
+
+    // the points of a streaming plot extend it; they come ahead of the result
+    // of the cell, so those of a plot newer than the one shown start it
+    if (is_stream_data(e)) {
+        if (stream_id(e) > stream.id) {
+            clear_screen();
+            startStream(e);
+            rescale();
+        }
+        appendStream(e);
+        return;
+    }
+    if (is_stream_plot(e)) {
+        // a cell appending to the plot shown returns its handle
+        if (stream_id(e) != stream.id) {
+            clear_screen();
+            startStream(e);
+            rescale();
+        }
+        stream.appended = false;
+        return;
     }
 
-    if(e.checkProperty("object-name", "point")) {
+    // whatever else a cell appending to the plot shown returns leaves it shown
+    if (stream.appended) {
+        stream.appended = false;
+        return;
+    }
+
+    clear_screen();
+    draw(e);
+    flush();
+    rescale();
+}
+
+void OutputWidget::draw(const Expression & e){
+
+    Expression::ObjectKind kind = e.objectKind();
+    if(kind == Expression::ObjectKind::Point) {
 
         std::vector<Expression> coordinates = e.contents();
         double x = coordinates[0].head().asNumber();
@@ -24,14 +94,14 @@ void OutputWidget::catch_result(Expression e){
         }
         drawPoint(x, y, diam);
     }
-    else if (e.checkProperty("object-name", "line")) {
+    else if (kind == Expression::ObjectKind::Line) {
 
         Expression p1, p2;
         std::vector<Expression> list = e.contents();
         p1 = list[0];
         p2 = list[1];
 
-        if(p1.checkProperty("object-name", "point") && p2.checkProperty("object-name", "point")){
+        if(p1.objectKind() == Expression::ObjectKind::Point && p2.objectKind() == Expression::ObjectKind::Point){
             double a = p1.tailConstBegin()->head().asNumber();
             double b = p1.tailConstEnd()->head().asNumber();
             double c = p2.tailConstBegin()->head().asNumber();
@@ -48,7 +118,7 @@ void OutputWidget::catch_result(Expression e){
             return;
         }
     }
-    else if (e.checkProperty("object-name", "text")) {
+    else if (kind == Expression::ObjectKind::Text) {
 
         std::string text_string = e.head().asSymbol();
 
@@ -58,20 +128,29 @@ void OutputWidget::catch_result(Expression e){
         
         drawText(QString::fromStdString(text_string), scaleFactor, rotDeg, xcor, ycor);
     }
+    else if (kind == Expression::ObjectKind::Polyline) {
+
+        const NumericList * xy = e.numericList();
+        double thicc = e.getNumericalProperty("\"thickness\"");
+        if(xy == nullptr || xy->isComplex() || thicc < 0){
+            catch_failure("Error: invalid polyline");
+            return;
+        }
+        drawPolyline(xy->real(), thicc);
+    }
     else if (e.isList()) {
-        clear_on_print = false;
         for (auto &item: e.contents()) {
             drawListItem(item);
         }
-        clear_on_print = true;
     }
     else if (e.isDP()) {
-        clear_on_print = false;
         drawDP(e);
     }
     else if (e.isCP()){
-        clear_on_print = false;
-        //TODO
+        // every item of a continuous plot draws itself
+        for (auto &item: e.contents()) {
+            draw(item);
+        }
     }
     else if(e.isLambda()) {
         return;
@@ -81,8 +160,36 @@ void OutputWidget::catch_result(Expression e){
         os << e;
         scene->addText(QString::fromStdString(os.str()));
     }
-    clear_on_print = true;
-    rescale();
+}
+
+void OutputWidget::flush() {
+
+    // a few primitives stay separate items, any more are drawn by one item
+    if (batch.size() > MAX_SEPARATE_ITEMS) {
+        scene->addItem(new PlotItem(std::move(batch)));
+        batch.clear();
+        return;
+    }
+
+    for (auto &group: batch.points) {
+        for (auto &p: group.second) {
+            QRectF corners = QRectF(p.x(), p.y(), group.first, group.first);
+            corners.moveCenter(p);
+            scene->addEllipse(corners, QPen(Qt::PenStyle::NoPen), QBrush(Qt::BrushStyle::SolidPattern));
+        }
+    }
+    for (auto &group: batch.lines) {
+        for (auto &l: group.second) {
+            QGraphicsLineItem *line = scene->addLine(l);
+            line->setPen(QPen(QBrush(), group.first));
+        }
+    }
+    for (auto &polyline: batch.polylines) {
+        QPainterPath path;
+        path.addPolygon(polyline.second);
+        scene->addPath(path, QPen(QBrush(), polyline.first));
+    }
+    batch.clear();
 }
 
 void OutputWidget::catch_failure(std::string message) {
@@ -93,6 +200,8 @@ void OutputWidget::catch_failure(std::string message) {
 
 void OutputWidget::clear_screen() {
     scene->clear();
+    batch.clear();
+    stream = Stream();
 }
 
 void OutputWidget::resizeEvent(QResizeEvent *event) {
@@ -101,12 +210,23 @@ void OutputWidget::resizeEvent(QResizeEvent *event) {
 }
 
 void OutputWidget::rescale() {
+
+    // refitting invalidates the cached drawing of every item, so only refit
+    // when the scene or the view actually changed
+    QRectF rect = scene->sceneRect();
+    QSize size = view->viewport()->size();
+    if (rect == fitted_rect && size == fitted_size) {
+        return;
+    }
+    fitted_rect = rect;
+    fitted_size = size;
+
     view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    view->fitInView(scene->sceneRect(), Qt::KeepAspectRatio);
+    view->fitInView(rect, Qt::KeepAspectRatio);
 }
 
-void OutputWidget::drawText(QString qstr, double scaleFactor, double rotationAngle, double X, double Y) {
+QGraphicsTextItem * OutputWidget::drawText(QString qstr, double scaleFactor, double rotationAngle, double X, double Y) {
     QGraphicsTextItem *text = scene->addText(qstr);
     auto font = QFont("Courier");
     font.setStyleHint(QFont::TypeWriter);
@@ -121,23 +241,39 @@ void OutputWidget::drawText(QString qstr, double scaleFactor, double rotationAng
     text->setTransformOriginPoint(_center);
     text->setRotation(rotationAngle);
     text->setScale(scaleFactor);
+    return text;
 }
 
 void OutputWidget::drawLine(double x1, double y1, double x2, double y2, double thicc){
+    batch.addLine(x1, y1, x2, y2, thicc);
+}
 
-    QGraphicsLineItem *line = scene->addLine(x1, y1, x2, y2);
-    line->setPen(QPen(QBrush(), thicc));
+void OutputWidget::drawPolyline(const std::vector<double> & xy, double thicc){
+
+    QPolygonF polyline;
+    polyline.reserve(static_cast<int>(xy.size() / 2));
+    for(std::size_t i = 0; i + 1 < xy.size(); i += 2) {
+        polyline << QPointF(xy[i], xy[i+1]);
+    }
+    batch.addPolyline(std::move(polyline), thicc);
 }
 
 void OutputWidget::drawPoint(double X, double Y, double Diam){
-    QRectF corners = QRectF(X, Y, Diam, Diam);
-    corners.moveCenter(QPointF(X, Y));
-    scene->addEllipse(corners, QPen(Qt::PenStyle::NoPen), QBrush(Qt::BrushStyle::SolidPattern));
+    batch.addPoint(X, Y, Diam);
 }
 
-void OutputWidget::drawListItem(Expression e) {
+void OutputWidget::drawListItem(const Expression & e) {
+
+    // graphics in a list are drawn without their text
+    Expression::ObjectKind kind = e.objectKind();
+    if (kind == Expression::ObjectKind::Point || kind == Expression::ObjectKind::Line ||
+        kind == Expression::ObjectKind::Text || kind == Expression::ObjectKind::Polyline) {
+        draw(e);
+        return;
+    }
+
     if (!e.isNone()) {
-        catch_result(e);
+        draw(e);
     }
     std::string val;
     std::ostringstream os;
@@ -147,7 +283,7 @@ void OutputWidget::drawListItem(Expression e) {
     scene->addText(qstr);
 }
 
-void OutputWidget::drawDP(Expression e) {
+void OutputWidget::drawDP(const Expression & e) {
 
     // Graph constants
     double N = 20, A = 3, B = 3, C = 2, D = 2, P = 0.5;
@@ -157,7 +293,7 @@ void OutputWidget::drawDP(Expression e) {
 
     // Draw bounding box lines
     for(i; i < 4; i++) {
-        catch_result(data[i]);
+        draw(data[i]);
     }
 
     // Draw axis bounds and labels
@@ -181,7 +317,7 @@ void OutputWidget::drawDP(Expression e) {
 
     size_t num_opt = (int)e.getProperty("numoptions").asNumber();
     for (i; i < 11; i++) {
-        catch_result(data[i]);
+        draw(data[i]);
     }
     double text_scale = 1;
     if (num_opt == 4) {
@@ -189,23 +325,93 @@ void OutputWidget::drawDP(Expression e) {
     }
 
 
-    size_t num_data = (int)e.getProperty("numpoints").asNumber();
-    for (i; i < 15; i++) {
-        catch_result(data[i]);
+    // Draw data points, stem lines and the axes; the interpreter already
+    // decimated the points to the resolution of the plot
+    for (; i < data.size(); i++) {
+        draw(data[i]);
     }
+}
 
-    // Draw data points and stem lines
-    for(i; i < num_data; i++) {
-        catch_result(data[i]);
+void OutputWidget::startStream(Expression e) {
+
+    stream.id = stream_id(e);
+
+    drawLine(0, 0, N, 0, 0);
+    drawLine(0, N, N, N, 0);
+    drawLine(0, 0, 0, N, 0);
+    drawLine(N, 0, N, N, 0);
+    flush();
+
+    // the labels of the axes are fixed, those of the bounds follow the frame
+    if (e.getProperty("\"title\"").isString()) {
+        drawText(QString::fromStdString(e.getProperty("\"title\"").asSymbol()), 1, 0, N/2, -A);
+    }
+    if (e.getProperty("\"abscissa-label\"").isString()) {
+        drawText(QString::fromStdString(e.getProperty("\"abscissa-label\"").asSymbol()), 1, 0, N/2, N+A);
+    }
+    if (e.getProperty("\"ordinate-label\"").isString()) {
+        drawText(QString::fromStdString(e.getProperty("\"ordinate-label\"").asSymbol()), 1, -90, -B, N/2);
     }
+    for (auto &label: stream.labels) {
+        label = drawText(QString());
+    }
+
+    stream.item = new StreamItem;
+    scene->addItem(stream.item);
+}
+
+void OutputWidget::appendStream(const Expression & e) {
+
+    // the points of a plot no longer shown are dropped
+    const NumericList * xy = e.numericList();
+    if (stream.item == nullptr || stream_id(e) != stream.id || xy == nullptr || xy->isComplex()) {
+        return;
+    }
+    stream.appended = true;
 
-    // Draw x axis if needed
-    if (i < data.size()) {
-        catch_result(data[i++]);
+    QRectF added = stream.item->append(xy->real());
+    if (stream.due) {
+        return;
+    }
+    if (!holds(stream.item->frame(), added) || stream.item->frame().isEmpty()) {
+        // the frame grows once the queued results are drawn, however many there are
+        stream.due = true;
+        QTimer::singleShot(0, this, SLOT(update_stream()));
+        return;
     }
-    // Draw y axis if needed
-    if (i < data.size()) {
-        catch_result(data[i++]);
+
+    // only the area of the new points is painted again, as wide as their dots
+    QTransform device = stream.item->deviceTransform(view->viewportTransform());
+    qreal mx = StreamItem::DOT / qMax(qAbs(device.m11()), qreal(1e-12));
+    qreal my = StreamItem::DOT / qMax(qAbs(device.m22()), qreal(1e-12));
+    stream.item->update(added.adjusted(-mx, -my, mx, my));
+}
+
+void OutputWidget::update_stream() {
+
+    if (stream.item == nullptr || !stream.due) {
+        return;
     }
+    stream.due = false;
 
-} 
\ No newline at end of file
+    QRectF data = stream.item->dataBounds();
+    QRectF frame = stream.item->frame();
+    if (frame.isEmpty() || !holds(frame, data)) {
+        // a span of no width, as of a single point, is given one
+        qreal w = data.width() > 0 ? data.width() : qMax(qAbs(data.left()), qreal(1));
+        qreal h = data.height() > 0 ? data.height() : qMax(qAbs(data.top()), qreal(1));
+        frame = data.adjusted(-GROWTH*w, -GROWTH*h, GROWTH*w, GROWTH*h);
+        stream.item->setFrame(frame);
+
+        // map the frame onto the box of the plot, the y axis pointing up
+        qreal sx = N / frame.width(), sy = N / frame.height();
+        stream.item->setTransform(QTransform(sx, 0, 0, -sy, -frame.left()*sx, N + frame.top()*sy));
+
+        place(stream.labels[0], QString::number(frame.left()), 0, N+C);
+        place(stream.labels[1], QString::number(frame.right()), N, N+C);
+        place(stream.labels[2], QString::number(frame.top()), -D, N);
+        place(stream.labels[3], QString::number(frame.bottom()), -D, 0);
+    }
+    stream.item->update();
+    rescale();
+}
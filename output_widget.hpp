@@ -8,7 +8,11 @@
 #include <QGraphicsItem>
 #include <QApplication>
 #include <QtMath>
+#include <cstddef>
+#include <cstdint>
+
 #include "interpreter.hpp"
+#include "plot_item.hpp"
 
 class OutputWidget: public QWidget {
     Q_OBJECT
@@ -16,22 +20,52 @@ class OutputWidget: public QWidget {
     public:
         OutputWidget(QWidget * parent = (QWidget *)nullptr);
 
+        /// return the width, in pixels, the view draws plots at
+        std::size_t plotWidth() const;
+
     private slots:
         void catch_result(Expression e);
         void catch_failure(std::string message);
         void clear_screen();
+        void update_stream();
 
     private:
         QGraphicsView * view = new QGraphicsView(this);
         QGraphicsScene * scene = new QGraphicsScene(this);
-        bool clear_on_print = true;
 
+        // the primitives of the result being drawn, added to the scene by flush
+        PlotBatch batch;
+        static const std::size_t MAX_SEPARATE_ITEMS = 256;
+
+        // what the view was last fitted to
+        QRectF fitted_rect;
+        QSize fitted_size;
+
+        // the streaming plot shown, which appends extend until a cell that did
+        // not append to it returns, or the screen is cleared
+        struct Stream {
+            std::uint64_t id = 0;
+            StreamItem * item = nullptr;
+            // the bounds of the frame, at the corners of the plot
+            QGraphicsTextItem * labels[4] = {nullptr, nullptr, nullptr, nullptr};
+            // an update of the frame is due once the queued results are drawn
+            bool due = false;
+            // points were appended since the last result of a cell
+            bool appended = false;
+        };
+        Stream stream;
+
+        void draw(const Expression & e);
+        void flush();
         void resizeEvent(QResizeEvent *event) override;
-        void drawText(QString str, double sf = 1, double rot = 0, double x = 0, double y = 0);
+        QGraphicsTextItem * drawText(QString str, double sf = 1, double rot = 0, double x = 0, double y = 0);
         void drawLine(double, double, double, double, double);
         void drawPoint(double, double, double);
-        void drawListItem(Expression e);
-        void drawDP(Expression e);
+        void drawPolyline(const std::vector<double> & xy, double thicc);
+        void drawListItem(const Expression & e);
+        void drawDP(const Expression & e);
+        void startStream(Expression e);
+        void appendStream(const Expression & e);
         void rescale();
 };
 
@@ -4,9 +4,27 @@ Defines the parse function.
 #ifndef PARSE_HPP
 #define PARSE_HPP
 
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "token.hpp"
 #include "expression.hpp"
 
+/*! \struct ParseError
+\brief Where and why parsing failed.
+*/
+struct ParseError {
+  /// the offset of the offending input, in the units of the lexer
+  std::size_t offset = 0;
+
+  /// a description of the failure, empty if parsing succeeded
+  std::string message;
+};
+
 /*! \fn parse
 \brief parse a sequence of tokens into an expression (abstract syntax tree)
 
@@ -15,4 +33,89 @@ Defines the parse function.
  */
 Expression parse(const TokenSequenceType & tokens) noexcept;
 
+/*! \fn parse
+\brief parse tokens as they are read into an expression (abstract syntax tree)
+
+The tree is built as the tokens arrive, so no sequence of tokens is held.
+A Lexer<BufferSource> or Lexer<StreamSource> reports offsets in bytes.
+
+\param lexer the source of tokens, with the members of Lexer
+\param error set to the location and reason of a failure
+\returns the expression resulting from parsing or the None Expression on failure
+ */
+template <class TokenLexer>
+Expression parse(TokenLexer & lexer, ParseError & error) noexcept {
+
+  // the expressions still open, each with its head and the tail read so far
+  struct Open {
+    Atom head;
+    std::vector<Expression> tail;
+  };
+  std::vector<Open> open;
+
+  Token token(Token::OPEN);
+  std::size_t at = 0;
+
+  auto fail = [&](std::size_t offset, const char * message){
+    error.offset = offset;
+    error.message = message;
+    return Expression();
+  };
+
+  error = ParseError();
+  try{
+    if(!lexer.next(token, at)){
+      return fail(lexer.offset(), "empty input");
+    }
+    if(token.type() != Token::OPEN){
+      return fail(at, "expected '(' at the start of the program");
+    }
+
+    bool at_head = true;
+    while(lexer.next(token, at)){
+
+      if(at_head){
+        if(token.type() != Token::STRING){
+          return fail(at, "expected an atom after '('");
+        }
+        Atom head(token);
+        if(head.isNone()){
+          return fail(at, "invalid atom");
+        }
+        open.push_back(Open{std::move(head), {}});
+        at_head = false;
+      }
+      else if(token.type() == Token::OPEN){
+        at_head = true;
+      }
+      else if(token.type() == Token::CLOSE){
+        Expression done(std::move(open.back().head), std::move(open.back().tail));
+        open.pop_back();
+        if(open.empty()){
+          if(lexer.next(token, at)){
+            return fail(at, "unexpected input after the end of the program");
+          }
+          return done;
+        }
+        open.back().tail.push_back(std::move(done));
+      }
+      else{
+        Atom item(token);
+        if(item.isNone()){
+          return fail(at, "invalid atom");
+        }
+        open.back().tail.emplace_back(std::move(item));
+      }
+    }
+    return fail(lexer.offset(), "unexpected end of input");
+  }
+  catch(const std::bad_alloc &){
+    return fail(lexer.offset(), "out of memory");
+  }
+  catch(const std::exception & ex){
+    // the parse cannot throw, so any other failure is reported as it is
+    return fail(lexer.offset(), ex.what());
+  }
+}
+
 #endif
@@ -1,6 +1,10 @@
 #include "catch.hpp"
 
 #include "parse.hpp"
+#include "lexer.hpp"
+
+#include <sstream>
+#include <stdexcept>
 
 TEST_CASE("Test parser with expected input", "[parse]") {
 
@@ -66,4 +70,62 @@ TEST_CASE( "Test open quotes", "[parse]" ) {
   TokenSequenceType tokens = tokenize(iss);
 
   REQUIRE(parse(tokens) == Expression());
-}
\ No newline at end of file
+}
+TEST_CASE( "Test parse reports the offset of errors", "[parse]" ) {
+
+  struct Case { const char * program; std::size_t offset; };
+  Case cases[] = {
+    {"", 0},
+    {"+ 1 2", 0},
+    {"(define a 1.2abc)", 10},
+    {"(+ 1 (2 (f)) ( ) 3)", 15},
+    {"(+ 1 2) (+ 3 4)", 8},
+    {"(begin (+ 1 2)", 14}
+  };
+
+  for(auto & c : cases){
+    INFO(c.program);
+    std::string program = c.program;
+    BufferSource source(program.data(), program.data() + program.size());
+    Lexer<BufferSource> lexer(source);
+    ParseError error;
+    REQUIRE(parse(lexer, error) == Expression());
+    REQUIRE(!error.message.empty());
+    REQUIRE(error.offset == c.offset);
+  }
+}
+
+TEST_CASE( "Test parse from a stream matches the token sequence", "[parse]" ) {
+
+  std::string program = "(begin (define r 10) ; radius\n (* pi (* r r)) \"a (string)\")";
+
+  std::istringstream tokens_in(program);
+  Expression expected = parse(tokenize(tokens_in));
+
+  std::istringstream stream_in(program);
+  StreamSource source(stream_in);
+  Lexer<StreamSource> lexer(source);
+  ParseError error;
+  Expression streamed = parse(lexer, error);
+
+  REQUIRE(streamed != Expression());
+  REQUIRE(streamed == expected);
+  REQUIRE(error.message.empty());
+}
+
+TEST_CASE( "Test parse reports a failing stream with its own message", "[parse]" ) {
+
+  struct FailingBuffer: public std::streambuf {
+    int_type underflow() override { throw std::runtime_error("stream failed"); }
+  };
+
+  FailingBuffer buffer;
+  std::istream stream_in(&buffer);
+  stream_in.exceptions(std::ios::badbit);
+  StreamSource source(stream_in);
+  Lexer<StreamSource> lexer(source);
+  ParseError error;
+
+  REQUIRE(parse(lexer, error) == Expression());
+  REQUIRE(error.message == "stream failed");
+}
@@ -0,0 +1,200 @@
+#include "plot_item.hpp"
+
+#include <QPainter>
+#include <QPen>
+#include <QStyleOptionGraphicsItem>
+
+namespace {
+
+// grow rect by half the width w of what is drawn on its edge, and by a
+// little more so that a line of width 0 still has an area
+QRectF grown(const QRectF & rect, qreal w) {
+    qreal margin = qMax(w/2, qreal(1e-3));
+    return rect.normalized().adjusted(-margin, -margin, margin, margin);
+}
+
+}
+
+void PlotBatch::addPoint(qreal x, qreal y, qreal diameter) {
+    points[diameter].emplace_back(x, y);
+}
+
+void PlotBatch::addLine(qreal x1, qreal y1, qreal x2, qreal y2, qreal thickness) {
+    lines[thickness].emplace_back(x1, y1, x2, y2);
+}
+
+void PlotBatch::addPolyline(QPolygonF polyline, qreal thickness) {
+    polylines.emplace_back(thickness, std::move(polyline));
+}
+
+std::size_t PlotBatch::size() const {
+    std::size_t n = polylines.size();
+    for (auto &group: points) n += group.second.size();
+    for (auto &group: lines) n += group.second.size();
+    return n;
+}
+
+void PlotBatch::clear() {
+    points.clear();
+    lines.clear();
+    polylines.clear();
+}
+
+PlotItem::PlotItem(PlotBatch && batch, QGraphicsItem * parent) : QGraphicsItem(parent), plot(std::move(batch)) {
+
+    // the bounds include half of the width of anything drawn at the edge
+    for (auto &group: plot.points) {
+        for (auto &p: group.second) {
+            bounds |= grown(QRectF(p, QSizeF()), group.first);
+        }
+    }
+    for (auto &group: plot.lines) {
+        for (auto &l: group.second) {
+            bounds |= grown(QRectF(l.p1(), l.p2()), group.first);
+        }
+    }
+    for (auto &polyline: plot.polylines) {
+        bounds |= grown(polyline.second.boundingRect(), polyline.first);
+    }
+
+    // repaint from a pixmap until the view is transformed, as on a resize
+    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF PlotItem::boundingRect() const {
+    return bounds;
+}
+
+void PlotItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget *) {
+
+    const QRectF exposed = option->exposedRect;
+    QPen pen(QBrush(Qt::SolidPattern), 0);
+
+    // a point is a dot of a round pen as wide as its diameter
+    std::vector<QPointF> visible_points;
+    pen.setCapStyle(Qt::RoundCap);
+    for (auto &group: plot.points) {
+        if (group.first <= 0) {
+            continue;
+        }
+        QRectF area = grown(exposed, group.first);
+        visible_points.clear();
+        for (auto &p: group.second) {
+            if (area.contains(p)) visible_points.push_back(p);
+        }
+        pen.setWidthF(group.first);
+        painter->setPen(pen);
+        painter->drawPoints(visible_points.data(), static_cast<int>(visible_points.size()));
+    }
+
+    std::vector<QLineF> visible_lines;
+    pen.setCapStyle(Qt::SquareCap);
+    for (auto &group: plot.lines) {
+        visible_lines.clear();
+        for (auto &l: group.second) {
+            if (grown(QRectF(l.p1(), l.p2()), group.first).intersects(exposed)) {
+                visible_lines.push_back(l);
+            }
+        }
+        pen.setWidthF(group.first);
+        painter->setPen(pen);
+        painter->drawLines(visible_lines.data(), static_cast<int>(visible_lines.size()));
+    }
+
+    for (auto &polyline: plot.polylines) {
+        if (grown(polyline.second.boundingRect(), polyline.first).intersects(exposed)) {
+            pen.setWidthF(polyline.first);
+            painter->setPen(pen);
+            painter->drawPolyline(polyline.second);
+        }
+    }
+}
+
+constexpr qreal StreamItem::DOT;
+
+StreamItem::StreamItem(QGraphicsItem * parent) : QGraphicsItem(parent) {
+    setCacheMode(QGraphicsItem::DeviceCoordinateCache);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF StreamItem::append(const std::vector<double> & xy) {
+
+    qreal l = 0, r = 0, b = 0, t = 0;
+    for (std::size_t i = 0; i + 1 < xy.size(); i += 2) {
+        if (chunks.empty() || chunks.back().points.size() == CHUNK_SIZE) {
+            chunks.push_back(Chunk{{}, xy[i], xy[i], xy[i+1], xy[i+1]});
+            chunks.back().points.reserve(CHUNK_SIZE);
+        }
+        Chunk &chunk = chunks.back();
+        chunk.points.emplace_back(xy[i], xy[i+1]);
+        chunk.xmin = qMin(chunk.xmin, qreal(xy[i]));
+        chunk.xmax = qMax(chunk.xmax, qreal(xy[i]));
+        chunk.ymin = qMin(chunk.ymin, qreal(xy[i+1]));
+        chunk.ymax = qMax(chunk.ymax, qreal(xy[i+1]));
+
+        if (i == 0) {
+            l = r = xy[i];
+            b = t = xy[i+1];
+        }
+        l = qMin(l, qreal(xy[i]));
+        r = qMax(r, qreal(xy[i]));
+        b = qMin(b, qreal(xy[i+1]));
+        t = qMax(t, qreal(xy[i+1]));
+    }
+    if (xy.size() < 2) {
+        return QRectF();
+    }
+
+    if (count == 0) {
+        xmin = l; xmax = r; ymin = b; ymax = t;
+    }
+    else {
+        xmin = qMin(xmin, l); xmax = qMax(xmax, r);
+        ymin = qMin(ymin, b); ymax = qMax(ymax, t);
+    }
+    count += xy.size() / 2;
+    return QRectF(QPointF(l, b), QPointF(r, t));
+}
+
+QRectF StreamItem::dataBounds() const {
+    return QRectF(QPointF(xmin, ymin), QPointF(xmax, ymax));
+}
+
+void StreamItem::setFrame(const QRectF & frame) {
+    if (frame != shown) {
+        prepareGeometryChange();
+        shown = frame;
+    }
+}
+
+QRectF StreamItem::boundingRect() const {
+    return shown;
+}
+
+void StreamItem::paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget *) {
+
+    // the exposed area, grown by the radius of a dot in the coordinates of the data
+    const QTransform &device = painter->worldTransform();
+    qreal mx = DOT / qMax(qAbs(device.m11()), qreal(1e-12));
+    qreal my = DOT / qMax(qAbs(device.m22()), qreal(1e-12));
+    QRectF area = option->exposedRect.normalized().adjusted(-mx, -my, mx, my) & shown;
+
+    QPen pen(QBrush(Qt::SolidPattern), DOT);
+    pen.setCosmetic(true);
+    pen.setCapStyle(Qt::RoundCap);
+    painter->setPen(pen);
+
+    std::vector<QPointF> visible;
+    for (auto &chunk: chunks) {
+        // the rectangle is in the coordinates of the data, its top the least y
+        if (chunk.xmax < area.left() || chunk.xmin > area.right() ||
+            chunk.ymax < area.top() || chunk.ymin > area.bottom()) {
+            continue;
+        }
+        for (auto &p: chunk.points) {
+            if (area.contains(p)) visible.push_back(p);
+        }
+    }
+    painter->drawPoints(visible.data(), static_cast<int>(visible.size()));
+}
@@ -0,0 +1,97 @@
+#ifndef PLOT_ITEM_HPP
+#define PLOT_ITEM_HPP
+
+#include <QGraphicsItem>
+#include <QLineF>
+#include <QPointF>
+#include <QPolygonF>
+
+#include <map>
+#include <vector>
+
+/*
+PlotBatch - the points, lines and polylines of one result, grouped by size
+            so that each group is drawn with one pen
+ */
+struct PlotBatch {
+    std::map<qreal, std::vector<QPointF>> points;
+    std::map<qreal, std::vector<QLineF>> lines;
+    std::vector<std::pair<qreal, QPolygonF>> polylines;
+
+    void addPoint(qreal x, qreal y, qreal diameter);
+    void addLine(qreal x1, qreal y1, qreal x2, qreal y2, qreal thickness);
+    void addPolyline(QPolygonF polyline, qreal thickness);
+
+    std::size_t size() const;
+    void clear();
+};
+
+/*
+PlotItem - a retained-mode item drawing a whole PlotBatch in one paint call,
+           skipping what lies outside of the exposed area
+ */
+class PlotItem : public QGraphicsItem {
+
+    public:
+        explicit PlotItem(PlotBatch && batch, QGraphicsItem * parent = nullptr);
+
+        enum { Type = UserType + 1 };
+        int type() const override { return Type; }
+
+        QRectF boundingRect() const override;
+        void paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget) override;
+
+        const PlotBatch & batch() const { return plot; }
+
+    private:
+        PlotBatch plot;
+        QRectF bounds;
+};
+
+/*
+StreamItem - the points of a streaming plot, in the coordinates of the data,
+             mapped into the frame of the plot by the transform of the item;
+             appending draws the new points without touching the others
+ */
+class StreamItem : public QGraphicsItem {
+
+    public:
+        explicit StreamItem(QGraphicsItem * parent = nullptr);
+
+        enum { Type = UserType + 2 };
+        int type() const override { return Type; }
+
+        // the diameter of the points in pixels, whatever the scale of the plot
+        static constexpr qreal DOT = 4;
+
+        /// add the points at the interleaved coordinates xy, returning their bounds
+        QRectF append(const std::vector<double> & xy);
+
+        /// the smallest rectangle holding every point, which may have no area
+        QRectF dataBounds() const;
+
+        /// the rectangle of the data drawn in the frame, beyond which nothing is painted
+        void setFrame(const QRectF & frame);
+        QRectF frame() const { return shown; }
+
+        std::size_t size() const { return count; }
+
+        QRectF boundingRect() const override;
+        void paint(QPainter * painter, const QStyleOptionGraphicsItem * option, QWidget * widget) override;
+
+    private:
+        // the points are kept in chunks with their bounds, so that painting
+        // a small area skips most of them without testing each
+        struct Chunk {
+            std::vector<QPointF> points;
+            qreal xmin, xmax, ymin, ymax;
+        };
+        static const std::size_t CHUNK_SIZE = 4096;
+
+        std::vector<Chunk> chunks;
+        std::size_t count = 0;
+        qreal xmin = 0, xmax = 0, ymin = 0, ymax = 0;
+        QRectF shown;
+};
+
+#endif
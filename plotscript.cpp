@@ -2,22 +2,47 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <algorithm>
 #include <cassert>
-
+#include <cstdlib>
+#include <csignal>
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "cancellation.hpp"
 #include "interpreter.hpp"
+#include "kernel_stats.hpp"
+#include "profiler.hpp"
 #include "semantic_error.hpp"
+#include "session_manager.hpp"
+#include "snapshot.hpp"
 #include "startup_config.hpp"
+#ifdef PLOTSCRIPT_SPSC_QUEUES
+#include "SPSCmessage.hpp"
+#else
 #include "TSmessage.hpp"
+#endif
+
+// Ctrl-C cancels the program run from the command line directly, while the
+// REPL forwards it to the kernel evaluating the current line
+volatile sig_atomic_t interrupt_flag = 0;
+CancellationToken command_token;
 
 #if defined(_WIN64) || defined(_WIN32)
 #include <windows.h>
 BOOL WINAPI interrupt_handler(DWORD fdwCtrlType) {
   switch (fdwCtrlType) {
   case CTRL_C_EVENT:
-    if (global_status_flag > 0) {
+    if (interrupt_flag > 0) {
       exit(EXIT_FAILURE);
     }
-    ++global_status_flag;
+    ++interrupt_flag;
+    command_token.cancel();
     return TRUE;
 
   default:
@@ -29,10 +54,15 @@ inline void install_handler() { SetConsoleCtrlHandler(interrupt_handler, TRUE);
 
 #elif defined(__APPLE__) || defined(__linux) || defined(__unix) || defined(__posix)
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAVE_MMAP
 
 void interrupt_handler(int signal_num) {
   if(signal_num == SIGINT){
-    global_status_flag = 1;
+    interrupt_flag = 1;
+    command_token.cancel();
   }
 }
 
@@ -48,9 +78,15 @@ inline void install_handler() {
 }
 #endif
 
-typedef TSmessage<std::string> InputQueue;
+// the messages carry the time they were sent, for %stats
 typedef std::tuple<Expression, std::string, bool> output_type;
-typedef TSmessage<output_type> OutputQueue;
+#ifdef PLOTSCRIPT_SPSC_QUEUES
+typedef SPSCmessage<Stamped<std::string>> InputQueue;
+typedef SPSCmessage<Stamped<output_type>> OutputQueue;
+#else
+typedef TSmessage<Stamped<std::string>> InputQueue;
+typedef TSmessage<Stamped<output_type>> OutputQueue;
+#endif
 
 class Producer {
   private:
@@ -58,7 +94,7 @@ class Producer {
   public:
     Producer(InputQueue * a) : iqueue(a){}
     void operator()(std::string & str) const {
-      iqueue->push(str);
+      iqueue->push(stamp(str));
     }
 };
 
@@ -66,31 +102,52 @@ class Consumer {
   private:
     InputQueue * iqueue;
     OutputQueue * oqueue;
+    KernelStats * stats;
     Interpreter cInterp;
-    bool running = false;
+    Environment initial;
+    CancellationToken token;
+    std::atomic<bool> reset_requested{false};
+    // the profile is read and cleared by the REPL while the kernel waits for
+    // input, the flag may be toggled while a line is being evaluated
+    Profiler profiler;
+    std::atomic<bool> profiling{false};
+    // read by the kernel loop, written by the thread starting and stopping it
+    std::atomic<bool> running{false};
     std::thread cThread;
   public:
-    Consumer(InputQueue * inq, OutputQueue * outq, Interpreter & inter) {
+    Consumer(InputQueue * inq, OutputQueue * outq, KernelStats * st, Interpreter & inter) {
       iqueue = inq;
       oqueue = outq;
+      stats = st;
       cInterp = inter;
+      initial = cInterp.snapshot();
     }
     ~Consumer(){
-      if(cThread.joinable()) {
-        std::string temp;
-        iqueue->push(temp);
-        cThread.join();
-      }
+      stopThread();
     }
     void ThreadFunction() {
+      // Ctrl-C reaches the kernel only through its token
+      CancellationScope watch(&token);
       bool succ;
-      while(isRunning() && global_status_flag == 0){
-        std::string line;
+      while(isRunning()){
+        Stamped<std::string> message;
         succ = false;
 
-        if(!iqueue->try_pop(line)){
-          continue;
+        // sleep until there is input, or the kernel is stopped
+        if(!iqueue->wait_and_pop(message)){
+          break;
+        }
+        stats->noteInputDepth(iqueue->size());
+        stats->record(KernelStats::Queued, message.sent);
+        LatencyClock::time_point popped = LatencyClock::now();
+        const std::string & line = message.value;
+
+        // an interrupt sent while idle was meant for an earlier line
+        token.reset();
+        if(reset_requested.exchange(false)){
+          cInterp.restore(initial);
         }
+
         std::istringstream expression(line);
 
         if(line == "")
@@ -98,48 +155,74 @@ class Consumer {
 
         Expression result;
         std::string error;
+        Environment before = cInterp.snapshot();
 
         if(!cInterp.parseStream(expression)){
           error = "Invalid Expression. Could not parse.";
         }
         else{
           try{
+            ProfilerScope profile(profiling.load() ? &profiler : nullptr);
             result = cInterp.evaluate();
             succ = true;
           }
           catch(const SemanticError & ex){
             error = ex.what();
+            // an interrupted line leaves nothing half defined
+            if(token.cancelled()){
+              cInterp.restore(before);
+            }
           }
         }
 
-        output_type output = std::make_tuple(result, error, succ);
-        oqueue->push(output);
+        // the result is stamped as it is sent, ending the evaluation
+        Stamped<output_type> output(std::make_tuple(result, error, succ));
+        stats->record(KernelStats::Evaluated, popped);
+        oqueue->push(std::move(output));
       }
     }
 
     bool isRunning(){
-      return running;
+      return running.load();
     }
     void startThread(){
-      if(!running){
-        running = true;
+      if(!running.exchange(true)){
         cThread = std::thread(&Consumer::ThreadFunction, this);
       }
     }
     void stopThread(){
-      if(running){
-        running = false;
-        std::string empty;
-        iqueue->push(empty);
+      if(running.exchange(false)){
+        iqueue->shutdown();
+        // a bounded output queue may be full, with the kernel waiting for
+        // room that only this thread would make by reading it
+        oqueue->shutdown();
+      }
+      if(cThread.joinable()){
         cThread.join();
-        iqueue->try_pop(empty);
       }
+      iqueue->restart();
+      oqueue->restart();
     }
-    void resetThread(Interpreter & newinter){
-      if(running){
-        stopThread();
-      }
-      cInterp = newinter;
+    // record the lines evaluated from now on, until stopProfiling
+    void startProfiling(){
+      profiler.clear();
+      profiling.store(true);
+    }
+    const Profiler & stopProfiling(){
+      profiling.store(false);
+      return profiler;
+    }
+    bool isProfiling() const{
+      return profiling.load();
+    }
+    // stop the line being evaluated, safe from any thread
+    void interrupt(){
+      token.cancel();
+    }
+    // return to the initial state before the next line, without a new thread
+    void reset(){
+      reset_requested = true;
+      interrupt();
       startThread();
     }
 };
@@ -166,10 +249,13 @@ void info(const std::string & err_str){
   std::cout << "Info: " << err_str << std::endl;
 }
 
-int eval_from_stream(std::istream & stream, Interpreter &interp){
+// evaluate and print the program parsed into interp
+int eval_parsed(bool parsed, Interpreter &interp){
 
-  if(!interp.parseStream(stream)){
-    error("Invalid Program. Could not parse.");
+  if(!parsed){
+    const ParseError & where = interp.parseError();
+    error("Invalid Program. Could not parse. At byte " + std::to_string(where.offset) +
+          ": " + where.message + ".");
     return EXIT_FAILURE;
   }
   else{
@@ -186,8 +272,33 @@ int eval_from_stream(std::istream & stream, Interpreter &interp){
   return EXIT_SUCCESS;
 }
 
+int eval_from_stream(std::istream & stream, Interpreter &interp){
+
+  return eval_parsed(interp.parseStream(stream), interp);
+}
+
 int eval_from_file(std::string filename, Interpreter &interp){
 
+#ifdef HAVE_MMAP
+  // tokenize the file in place rather than reading it through a stream
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd >= 0){
+    struct stat info;
+    void * data = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && info.st_size > 0){
+      data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if(data != MAP_FAILED){
+      const char * text = static_cast<const char *>(data);
+      bool parsed = interp.parseBuffer(text, text + info.st_size);
+      munmap(data, info.st_size);
+      return eval_parsed(parsed, interp);
+    }
+  }
+#endif
+
   std::ifstream ifs(filename);
 
   if(!ifs){
@@ -205,31 +316,162 @@ int eval_from_command(std::string argexp, Interpreter &interp){
   return eval_from_stream(expression, interp);
 }
 
+// the flame graph stacks of %profile
+const std::string PROFILE_FILE = "plotscript.folded";
+
+// write the flame graph stacks of a profile, returning false on failure
+bool write_folded(const Profiler & profile, const std::string & filename){
+
+  std::ofstream out(filename);
+  profile.write_folded(out);
+  out.close();
+  if(!out){
+    error("Could not write the profile to " + filename + ".");
+    return false;
+  }
+  return true;
+}
+
+// evaluate the file, then show where the time went
+int profile_file(const std::string & filename, Interpreter & interp){
+
+  Profiler profile;
+  int status;
+  {
+    ProfilerScope scope(&profile);
+    status = eval_from_file(filename, interp);
+  }
+
+  // the program prints its result to stdout, so the profile goes to stderr
+  profile.write_report(std::cerr);
+  if(!write_folded(profile, filename + ".folded")){
+    return EXIT_FAILURE;
+  }
+  std::cerr << "Info: Wrote the flame graph stacks to " << filename << ".folded" << std::endl;
+  return status;
+}
+
+// read the whole of a file into text, returning false if it cannot be read
+bool read_file(const std::string & filename, std::string & text){
+
+  std::ifstream ifs(filename, std::ios::binary);
+  if(!ifs){
+    return false;
+  }
+  std::ostringstream contents;
+  contents << ifs.rdbuf();
+  text = contents.str();
+  return true;
+}
+
+// evaluate each file in a session of its own, started from interp, on jobs
+// workers, printing the results in the order of the files as eval_from_file
+// would; fails if any file does
+int batch(const std::vector<std::string> & filenames, std::size_t jobs, Interpreter & interp){
+
+  struct Pending {
+    SessionManager::SessionId session;
+    std::future<EvaluationResult> result;
+    bool readable;
+  };
+
+  SessionManager manager(jobs);
+  std::deque<Pending> pending;
+  std::size_t next = 0;
+  int status = EXIT_SUCCESS;
+
+  while(next < filenames.size() || !pending.empty()){
+
+    // a few programs per worker are read ahead, so that no worker waits on
+    // the printing while the rest of a long batch is not held in memory
+    while(next < filenames.size() && pending.size() < 4 * jobs){
+      Pending job;
+      std::string program;
+      job.readable = read_file(filenames[next++], program);
+      // opening copies interp in constant time, sharing its startup bindings
+      job.session = manager.open(interp);
+      if(job.readable){
+        job.result = manager.submit(job.session, program);
+      }
+      pending.push_back(std::move(job));
+    }
+
+    Pending job = std::move(pending.front());
+    pending.pop_front();
+    if(!job.readable){
+      error("Could not open file for reading.");
+      status = EXIT_FAILURE;
+      manager.close(job.session);
+      continue;
+    }
+
+    // Ctrl-C abandons the batch, and the manager interrupts what is running
+    while(job.result.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready){
+      if(interrupt_flag > 0){
+        std::cerr << "Error: interpreter kernel interrupted" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    EvaluationResult result = job.result.get();
+    manager.close(job.session);
+    if(result.success){
+      std::cout << result.value << std::endl;
+    }
+    else{
+      std::cerr << result.error << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+
+  return status;
+}
+
+// the arguments after --batch: the files and, anywhere among them, -j N
+int batch_from_arguments(int argc, char *argv[], Interpreter & interp){
+
+  std::vector<std::string> filenames;
+  std::size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  for(int i = 2; i < argc; ++i){
+    std::string arg(argv[i]);
+    if(arg == "-j"){
+      char * end = nullptr;
+      long count = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+      if(end == nullptr || *end != '\0' || count < 1){
+        error("The -j option takes a number of jobs of at least 1.");
+        return EXIT_FAILURE;
+      }
+      jobs = static_cast<std::size_t>(count);
+      ++i;
+    }
+    else{
+      filenames.push_back(arg);
+    }
+  }
+  if(filenames.empty()){
+    error("No files to evaluate in batch.");
+    return EXIT_FAILURE;
+  }
+  return batch(filenames, jobs, interp);
+}
+
 // A REPL is a repeated read-eval-print loop
 void repl(Interpreter &interp){
 
-  Interpreter copy, default_state = interp;
-
   InputQueue * input = new InputQueue;
   OutputQueue * output = new OutputQueue;
+  KernelStats stats;
 
   Producer p1(input);
-  Consumer c1(input, output, interp);
+  Consumer c1(input, output, &stats, interp);
   c1.startThread();
 
   while(!std::cin.eof()){
 
-    if(global_status_flag > 0){
-      input->clear();
-      output->clear();
-    }
-    global_status_flag = 0;
-
-    copy = interp;
+    interrupt_flag = 0;
 
     prompt();
     std::string line = readline();
-    output_type result;
+    Stamped<output_type> message;
 
     if(line.empty()) continue;
     if(line == "%stop"){
@@ -239,7 +481,23 @@ void repl(Interpreter &interp){
       c1.startThread();
     }
     else if (line == "%reset"){
-      c1.resetThread(default_state);
+      c1.reset();
+    }
+    else if (line == "%profile"){
+      if(!c1.isProfiling()){
+        c1.startProfiling();
+        info("Profiling, enter %profile again to show the profile.");
+      }
+      else{
+        const Profiler & profile = c1.stopProfiling();
+        profile.write_report(std::cout);
+        if(write_folded(profile, PROFILE_FILE)){
+          info("Wrote the flame graph stacks to " + PROFILE_FILE);
+        }
+      }
+    }
+    else if (line == "%stats"){
+      stats.write_report(std::cout);
     }
     else if (line == "%exit"){
       c1.stopThread();
@@ -251,23 +509,31 @@ void repl(Interpreter &interp){
     else {
       p1(line);
 
-      while(output->empty()){
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        if (global_status_flag > 0) {
-          std::cerr << "\nError: interpreter kernel interrupted [1]\n";
-          c1.resetThread(copy);
-          break;
+      // block until the result arrives, waking now and then only to notice
+      // an interrupt, which a signal handler cannot notify; the interrupt is
+      // repeated in case the kernel had not yet started on the line
+      bool interrupted = false;
+      while(!output->wait_and_pop(message, std::chrono::milliseconds(50))){
+        if(interrupt_flag > 0){
+          interrupt_flag = 0;
+          interrupted = true;
+        }
+        if(interrupted){
+          c1.interrupt();
         }
       }
+      stats.noteOutputDepth(output->size());
+      stats.record(KernelStats::Delivered, message.sent);
+      const output_type & result = message.value;
 
-      if(global_status_flag == 0){
-        output->try_pop(result);
-        if(std::get<2>(result)) {
-            std::cout << std::get<0>(result) << std::endl;
-        }
-        else {
-            std::cerr << std::get<1>(result) << std::endl;
-        }
+      if(interrupted){
+        std::cerr << "\nError: interpreter kernel interrupted [1]\n";
+      }
+      else if(std::get<2>(result)) {
+          std::cout << std::get<0>(result) << std::endl;
+      }
+      else {
+          std::cerr << std::get<1>(result) << std::endl;
       }
     }
   }
@@ -278,14 +544,20 @@ void repl(Interpreter &interp){
 int main(int argc, char *argv[])
 {
   install_handler();
+  CancellationScope watch(&command_token);
 
   Interpreter interp;
-  std::ifstream startup_stream(STARTUP_FILE);
-  if(!interp.parseStream(startup_stream)){
-    error("Error: Invalid Startup Program. Could not parse.");
-    return EXIT_FAILURE;
+  Environment startup;
+  if(read_snapshot(STARTUP_SNAPSHOT, STARTUP_SNAPSHOT_SIZE, startup)){
+    // the startup file was evaluated when plotscript was built
+    interp.restore(startup);
   }
   else{
+    std::ifstream startup_stream(STARTUP_FILE);
+    if(!interp.parseStream(startup_stream)){
+      error("Error: Invalid Startup Program. Could not parse.");
+      return EXIT_FAILURE;
+    }
     try{
       Expression exp = interp.evaluate();
     }
@@ -296,13 +568,24 @@ int main(int argc, char *argv[])
     }
   }
 
-  if(argc == 2){
+  if(argc >= 2 && std::string(argv[1]) == "--batch"){
+    return batch_from_arguments(argc, argv, interp);
+  }
+  else if(argc == 2){
     return eval_from_file(argv[1], interp);
   }
   else if(argc == 3){
     if(std::string(argv[1]) == "-e"){
       return eval_from_command(argv[2], interp);
     }
+    else if(std::string(argv[1]) == "--profile"){
+      return profile_file(argv[2], interp);
+    }
+    else if(std::string(argv[1]) == "--fold"){
+      // a file is a single program, so no later lambda can shadow what is folded
+      interp.setFoldConstants(true);
+      return eval_from_file(argv[2], interp);
+    }
     else{
       error("Incorrect number of command line arguments.");
     }
@@ -0,0 +1,308 @@
+// Benchmarks of the interpreter hot paths, printing the results as JSON.
+//
+// usage: plotscript_bench [--filter text] [--repeat n] [--min-time ms]
+//                         [--backend tree|bytecode] [--label text] [--quick]
+//
+// Each benchmark runs its body in batches long enough to time reliably, and
+// reports the time per run of the fastest, median and slowest of the
+// batches. The output of two builds can be compared with
+// scripts/compare_bench.py.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "environment.hpp"
+#include "expression.hpp"
+#include "interpreter.hpp"
+#include "parse.hpp"
+#include "token.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// results are folded into the sink, so the compiler cannot drop the work
+volatile std::size_t sink = 0;
+
+struct Options {
+  std::string filter;
+  std::string label;
+  std::size_t repeat = 5;
+  std::chrono::milliseconds min_time{50};
+  Interpreter::Backend backend = Interpreter::Backend::TreeWalker;
+  bool quick = false;
+};
+
+struct Benchmark {
+  std::string name;
+  std::size_t size;
+  // prepares the inputs, returning the body to time
+  std::function<std::function<void()>()> setup;
+};
+
+struct Result {
+  std::string name;
+  std::size_t size;
+  std::size_t iterations;
+  double min_ns, median_ns, max_ns;
+};
+
+double time_batch(const std::function<void()> & body, std::size_t iterations){
+
+  auto start = Clock::now();
+  for(std::size_t i = 0; i < iterations; ++i){
+    body();
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  return elapsed.count();
+}
+
+Result run(const Benchmark & bench, const Options & options){
+
+  std::function<void()> body = bench.setup();
+
+  // double the batch until it takes at least the minimum time
+  std::size_t iterations = 1;
+  double min_ns = std::chrono::duration<double, std::nano>(options.min_time).count();
+  while(time_batch(body, iterations) < min_ns && iterations < (std::size_t(1) << 30)){
+    iterations *= 2;
+  }
+
+  std::vector<double> per_run;
+  for(std::size_t r = 0; r < options.repeat; ++r){
+    per_run.push_back(time_batch(body, iterations) / iterations);
+  }
+  std::sort(per_run.begin(), per_run.end());
+
+  return Result{bench.name, bench.size, iterations,
+                per_run.front(), per_run[per_run.size() / 2], per_run.back()};
+}
+
+// a program of n numbers in nested lists of ten, as a notebook cell might hold
+std::string list_program(std::size_t n){
+
+  std::ostringstream program;
+  program << "(list";
+  for(std::size_t i = 0; i < n; ++i){
+    if(i % 10 == 0) program << (i == 0 ? " (list" : ") (list");
+    program << " " << i << "." << (i % 7);
+  }
+  program << "))";
+  return program.str();
+}
+
+Interpreter interpreter(const Options & options, const std::string & setup){
+
+  Interpreter interp;
+  interp.setBackend(options.backend);
+  std::istringstream stream(setup);
+  if(!interp.parseStream(stream)){
+    throw std::runtime_error("Error: could not parse the benchmark setup " + setup);
+  }
+  interp.evaluate();
+  return interp;
+}
+
+// time the evaluation of program, already parsed, in the state left by setup
+std::function<void()> evaluation(const Options & options, const std::string & setup,
+                                 const std::string & program){
+
+  auto interp = std::make_shared<Interpreter>(interpreter(options, setup));
+  std::istringstream stream(program);
+  if(!interp->parseStream(stream)){
+    throw std::runtime_error("Error: could not parse the benchmark program " + program);
+  }
+  return [interp]{
+    sink += interp->evaluate().tailLength();
+  };
+}
+
+// a list of n pairs of a number and a string, boxed rather than packed
+Expression nested_list(const Options & options, std::size_t n){
+
+  Interpreter interp = interpreter(options, "(define pair (lambda (x) (list x \"text\")))");
+  std::istringstream stream("(map pair (range 0 " + std::to_string(n - 1) + " 1))");
+  interp.parseStream(stream);
+  return interp.evaluate();
+}
+
+std::vector<Benchmark> benchmarks(const Options & options){
+
+  std::vector<std::size_t> sizes = {1000, 10000, 100000, 1000000};
+  if(options.quick){
+    sizes = {1000, 10000};
+  }
+
+  std::vector<Benchmark> result;
+
+  result.push_back({"tokenize", 10000, []{
+    auto text = std::make_shared<std::string>(list_program(10000));
+    return std::function<void()>([text]{
+      sink += tokenize(text->data(), text->data() + text->size()).size();
+    });
+  }});
+
+  result.push_back({"parse", 10000, []{
+    auto tokens = std::make_shared<TokenSequenceType>();
+    std::istringstream stream(list_program(10000));
+    *tokens = tokenize(stream);
+    return std::function<void()>([tokens]{
+      sink += parse(*tokens).tailLength();
+    });
+  }});
+
+  result.push_back({"environment-lookup", 1000, []{
+    // the lookups miss in two lambda frames before reaching the root
+    auto root = std::make_shared<Environment>();
+    auto names = std::make_shared<std::vector<Atom>>();
+    for(std::size_t i = 0; i < 1000; ++i){
+      names->push_back(Atom("symbol" + std::to_string(i)));
+      root->add_exp(names->back(), Expression(double(i)));
+    }
+    auto outer = std::make_shared<Environment>(root.get());
+    outer->add_exp(Atom("x"), Expression(1.));
+    auto inner = std::make_shared<Environment>(outer.get());
+    inner->add_exp(Atom("y"), Expression(2.));
+    return std::function<void()>([root, outer, inner, names]{
+      for(const Atom & name : *names){
+        sink += inner->is_exp(name);
+      }
+    });
+  }});
+
+  result.push_back({"lambda-apply", 1, [&options]{
+    return evaluation(options, "(define f (lambda (x y) (+ (* x x) y)))", "(f 3 4)");
+  }});
+
+  for(std::size_t n : sizes){
+    result.push_back({"map-range", n, [&options, n]{
+      return evaluation(options, "(define f (lambda (x) (* x x)))",
+                        "(map f (range 0 " + std::to_string(n - 1) + " 1))");
+    }});
+  }
+
+  for(std::size_t n : sizes){
+    result.push_back({"discrete-plot", n, [&options, n]{
+      return evaluation(options,
+                        "(begin (define point (lambda (x) (list x (sin x))))"
+                        " (define data (map point (range 0 " + std::to_string(n - 1) + " 1))))",
+                        "(discrete-plot data (list (list \"title\" \"benchmark\")))");
+    }});
+  }
+
+  result.push_back({"expression-copy", 100000, [&options]{
+    auto list = std::make_shared<Expression>(nested_list(options, 100000));
+    return std::function<void()>([list]{
+      Expression copy(*list);
+      sink += copy.tailLength();
+    });
+  }});
+
+  result.push_back({"expression-compare", 100000, [&options]{
+    auto left = std::make_shared<Expression>(nested_list(options, 100000));
+    auto right = std::make_shared<Expression>(nested_list(options, 100000));
+    return std::function<void()>([left, right]{
+      sink += (*left == *right);
+    });
+  }});
+
+  return result;
+}
+
+// the label is given on the command line, so it may need escaping
+std::string quoted(const std::string & text){
+
+  std::string result = "\"";
+  for(char c : text){
+    if(c == '"' || c == '\\') result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+void print_json(const std::vector<Result> & results, const Options & options){
+
+  std::cout << "{\n"
+            << "  \"label\": " << quoted(options.label) << ",\n"
+            << "  \"backend\": \""
+            << (options.backend == Interpreter::Backend::TreeWalker ? "tree" : "bytecode") << "\",\n"
+            << "  \"repeat\": " << options.repeat << ",\n"
+            << "  \"benchmarks\": [";
+  for(std::size_t i = 0; i < results.size(); ++i){
+    const Result & r = results[i];
+    std::cout << (i == 0 ? "\n" : ",\n")
+              << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+              << ", \"iterations\": " << r.iterations
+              << ", \"min_ns\": " << r.min_ns << ", \"median_ns\": " << r.median_ns
+              << ", \"max_ns\": " << r.max_ns << "}";
+  }
+  std::cout << "\n  ]\n}" << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  Options options;
+  for(int i = 1; i < argc; ++i){
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if(arg == "--filter" && has_value){
+      options.filter = argv[++i];
+    }
+    else if(arg == "--label" && has_value){
+      options.label = argv[++i];
+    }
+    else if(arg == "--repeat" && has_value){
+      options.repeat = std::max(1, std::atoi(argv[++i]));
+    }
+    else if(arg == "--min-time" && has_value){
+      options.min_time = std::chrono::milliseconds(std::max(1, std::atoi(argv[++i])));
+    }
+    else if(arg == "--backend" && has_value){
+      std::string backend = argv[++i];
+      if(backend == "bytecode"){
+        options.backend = Interpreter::Backend::Bytecode;
+      }
+      else if(backend != "tree"){
+        std::cerr << "Error: unknown backend " << backend << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+    else if(arg == "--quick"){
+      options.quick = true;
+    }
+    else{
+      std::cerr << "usage: plotscript_bench [--filter text] [--repeat n] [--min-time ms]"
+                << " [--backend tree|bytecode] [--label text] [--quick]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<Result> results;
+  try{
+    for(const Benchmark & bench : benchmarks(options)){
+      if(bench.name.find(options.filter) == std::string::npos){
+        continue;
+      }
+      // progress goes to stderr, so stdout holds only the results
+      std::cerr << bench.name << " " << bench.size << std::endl;
+      results.push_back(run(bench, options));
+    }
+  }
+  catch(const std::exception & ex){
+    std::cerr << ex.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  print_json(results, options);
+  return EXIT_SUCCESS;
+}
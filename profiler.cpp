@@ -0,0 +1,174 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+
+#include "arena.hpp"
+
+namespace {
+
+thread_local Profiler * current_profiler = nullptr;
+
+const std::size_t ROOT = 0;
+
+const char * kind_name(Profiler::Kind kind){
+  switch(kind){
+    case Profiler::SpecialFormKind:
+      return "special-form";
+    case Profiler::ProcedureKind:
+      return "procedure";
+    default:
+      return "lambda";
+  }
+}
+
+}
+
+Profiler::Profiler(){
+  clear();
+}
+
+void Profiler::clear(){
+
+  callees.clear();
+  index.clear();
+  depth.clear();
+  nodes.assign(1, Node());
+  nodes[ROOT].parent = ROOT;
+  stack.clear();
+}
+
+std::size_t Profiler::entry_of(Kind kind, const Atom & name){
+
+  // every callee is named by a symbol, other atoms share one entry per kind
+  std::uint64_t key = (static_cast<std::uint64_t>(kind) << 32) | name.symbolId();
+  auto found = index.find(key);
+  if(found != index.end()){
+    return found->second;
+  }
+
+  Entry entry;
+  entry.kind = kind;
+  entry.name = name.symbolId() != NoSymbol ? name.asString() : "?";
+  callees.push_back(entry);
+  depth.push_back(0);
+  index.emplace(key, callees.size() - 1);
+  return callees.size() - 1;
+}
+
+void Profiler::enter(Kind kind, const Atom & name){
+
+  std::size_t entry = entry_of(kind, name);
+  ++callees[entry].calls;
+  ++depth[entry];
+
+  std::size_t parent = stack.empty() ? ROOT : stack.back().node;
+  std::size_t node;
+  auto child = nodes[parent].children.find(entry);
+  if(child != nodes[parent].children.end()){
+    node = child->second;
+  }
+  else{
+    node = nodes.size();
+    Node created;
+    created.entry = entry;
+    created.parent = parent;
+    nodes.push_back(std::move(created));
+    nodes[parent].children.emplace(entry, node);
+  }
+
+  // the clock is read last, so the bookkeeping above is not counted
+  stack.push_back(Open{node, Clock::time_point(), arena_allocations(), 0, 0});
+  stack.back().start = Clock::now();
+}
+
+void Profiler::leave(){
+
+  Clock::time_point end = Clock::now();
+  Open frame = stack.back();
+  stack.pop_back();
+
+  std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    end - frame.start).count();
+  std::size_t allocations = arena_allocations() - frame.allocations;
+  std::uint64_t exclusive = elapsed > frame.child_ns ? elapsed - frame.child_ns : 0;
+
+  Node & node = nodes[frame.node];
+  node.exclusive_ns += exclusive;
+
+  Entry & entry = callees[node.entry];
+  entry.exclusive_ns += exclusive;
+  entry.allocations += allocations - frame.child_allocations;
+  if(--depth[node.entry] == 0){
+    entry.inclusive_ns += elapsed;
+  }
+
+  if(!stack.empty()){
+    stack.back().child_ns += elapsed;
+    stack.back().child_allocations += allocations;
+  }
+}
+
+std::vector<Profiler::Entry> Profiler::entries() const{
+
+  std::vector<Entry> result(callees);
+  std::stable_sort(result.begin(), result.end(), [](const Entry & a, const Entry & b){
+    return a.exclusive_ns > b.exclusive_ns;
+  });
+  return result;
+}
+
+void Profiler::write_folded(std::ostream & out) const{
+
+  // depth first, so that the stacks sharing a prefix are written together
+  std::function<void(std::size_t, const std::string &)> visit =
+    [&](std::size_t n, const std::string & prefix){
+      const Node & node = nodes[n];
+      std::string path = prefix;
+      if(n != ROOT){
+        path += (prefix.empty() ? "" : ";") + callees[node.entry].name;
+        if(node.exclusive_ns > 0){
+          out << path << " " << node.exclusive_ns << "\n";
+        }
+      }
+      std::vector<std::size_t> children;
+      for(const auto & child : node.children){
+        children.push_back(child.second);
+      }
+      std::sort(children.begin(), children.end());
+      for(std::size_t child : children){
+        visit(child, path);
+      }
+    };
+  visit(ROOT, "");
+}
+
+void Profiler::write_report(std::ostream & out) const{
+
+  std::ios::fmtflags flags = out.flags();
+  out << std::left << std::setw(14) << "kind" << std::setw(20) << "name"
+      << std::right << std::setw(10) << "calls" << std::setw(16) << "inclusive (ms)"
+      << std::setw(16) << "exclusive (ms)" << std::setw(14) << "allocations" << "\n";
+  out << std::fixed << std::setprecision(3);
+  for(const Entry & entry : entries()){
+    out << std::left << std::setw(14) << kind_name(entry.kind) << std::setw(20) << entry.name
+        << std::right << std::setw(10) << entry.calls
+        << std::setw(16) << entry.inclusive_ns / 1e6
+        << std::setw(16) << entry.exclusive_ns / 1e6
+        << std::setw(14) << entry.allocations << "\n";
+  }
+  out.flags(flags);
+}
+
+Profiler * Profiler::current() noexcept{
+  return current_profiler;
+}
+
+ProfilerScope::ProfilerScope(Profiler * profiler) noexcept: previous(current_profiler){
+  current_profiler = profiler;
+}
+
+ProfilerScope::~ProfilerScope(){
+  current_profiler = previous;
+}
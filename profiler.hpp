@@ -0,0 +1,147 @@
+/*! \file profiler.hpp
+Defines the profiler of evaluations.
+
+While a Profiler is current on a thread, every special form, built-in
+procedure and lambda the evaluation on that thread calls opens a frame,
+which measures the time and the allocations it takes. The profiler
+aggregates the frames per call stack, to draw flame graphs from, and per
+callee, with the number of calls, the inclusive and exclusive time and the
+allocations made by the callee itself.
+
+The frames are opened by ProfileFrame, which costs a test of a thread-local
+pointer when no profiler is current. The workers of pmap have no profiler,
+so their work is counted in the frame of the pmap.
+ */
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "atom.hpp"
+
+/*! \class Profiler
+\brief Records the frames of evaluations on one thread.
+*/
+class Profiler {
+public:
+
+  /// The kinds of callee a frame is opened for
+  enum Kind { SpecialFormKind, ProcedureKind, LambdaKind };
+
+  /// The totals of a callee over every call
+  struct Entry {
+    Kind kind;
+    std::string name;
+    std::size_t calls = 0;
+    /// time from entry to exit, counting recursive calls once
+    std::uint64_t inclusive_ns = 0;
+    /// time not spent in the frames opened by the callee
+    std::uint64_t exclusive_ns = 0;
+    /// allocations not made in the frames opened by the callee
+    std::size_t allocations = 0;
+  };
+
+  Profiler();
+
+  /// forget everything recorded, which must not happen inside a frame
+  void clear();
+
+  /// open a frame for the callee named by name
+  void enter(Kind kind, const Atom & name);
+
+  /// close the innermost frame
+  void leave();
+
+  /// return the totals of every callee, most exclusive time first
+  std::vector<Entry> entries() const;
+
+  /*! Write the exclusive time of every call stack in the folded format read
+    by flame graph tools, one stack per line: the callees from the outermost
+    separated by ';', a space and the nanoseconds.
+   */
+  void write_folded(std::ostream & out) const;
+
+  /// Write the totals of every callee as a table
+  void write_report(std::ostream & out) const;
+
+  /// return the profiler current on the calling thread, or nullptr
+  static Profiler * current() noexcept;
+
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  // a node of the call tree, reached by the callees from the root
+  struct Node {
+    std::size_t entry = 0;
+    std::size_t parent = 0;
+    std::unordered_map<std::size_t, std::size_t> children;
+    std::uint64_t exclusive_ns = 0;
+  };
+
+  struct Open {
+    std::size_t node;
+    Clock::time_point start;
+    std::size_t allocations;
+    std::uint64_t child_ns;
+    std::size_t child_allocations;
+  };
+
+  std::size_t entry_of(Kind kind, const Atom & name);
+
+  std::vector<Entry> callees;
+  // index of the callees by kind and symbol
+  std::unordered_map<std::uint64_t, std::size_t> index;
+  // how many frames of each callee are open, to count recursion once
+  std::vector<std::size_t> depth;
+
+  std::vector<Node> nodes;
+  std::vector<Open> stack;
+};
+
+/*! \class ProfilerScope
+\brief Makes a profiler current on the calling thread for its lifetime.
+*/
+class ProfilerScope {
+public:
+  explicit ProfilerScope(Profiler * profiler) noexcept;
+  ~ProfilerScope();
+
+  ProfilerScope(const ProfilerScope &) = delete;
+  ProfilerScope & operator=(const ProfilerScope &) = delete;
+
+private:
+  Profiler * previous;
+};
+
+/*! \class ProfileFrame
+\brief Opens a frame in the current profiler, if any, for its lifetime.
+*/
+class ProfileFrame {
+public:
+  ProfileFrame(Profiler::Kind kind, const Atom & name): profiler(Profiler::current()){
+    if(profiler != nullptr){
+      profiler->enter(kind, name);
+    }
+  }
+
+  ~ProfileFrame(){
+    if(profiler != nullptr){
+      profiler->leave();
+    }
+  }
+
+  ProfileFrame(const ProfileFrame &) = delete;
+  ProfileFrame & operator=(const ProfileFrame &) = delete;
+
+private:
+  Profiler * profiler;
+};
+
+#endif
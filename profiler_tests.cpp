@@ -0,0 +1,147 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.hpp"
+#include "profiler.hpp"
+#include "semantic_error.hpp"
+
+static Expression profile_in(Interpreter & interp, Profiler & profiler, const std::string & program){
+
+  std::istringstream iss(program);
+  INFO(program);
+  REQUIRE(interp.parseStream(iss));
+  ProfilerScope scope(&profiler);
+  return interp.evaluate();
+}
+
+static Profiler::Entry entry(const Profiler & profiler, const std::string & name){
+
+  for(const Profiler::Entry & e : profiler.entries()){
+    if(e.name == name){
+      return e;
+    }
+  }
+  FAIL("no entry for " << name);
+  return Profiler::Entry();
+}
+
+static std::vector<std::string> folded_stacks(const Profiler & profiler){
+
+  std::ostringstream out;
+  profiler.write_folded(out);
+  std::istringstream lines(out.str());
+  std::vector<std::string> stacks;
+  std::string line;
+  while(std::getline(lines, line)){
+    // every line is a stack, a space and a positive count
+    std::size_t space = line.rfind(' ');
+    REQUIRE(space != std::string::npos);
+    REQUIRE(std::stoull(line.substr(space + 1)) > 0);
+    stacks.push_back(line.substr(0, space));
+  }
+  return stacks;
+}
+
+TEST_CASE( "Test the profiler counts calls per callee", "[profiler]" ) {
+
+  Interpreter interp;
+  Profiler profiler;
+  profile_in(interp, profiler, "(begin (define f (lambda (x) (* x x))) (map f (range 1 10 1)))");
+
+  Profiler::Entry f = entry(profiler, "f");
+  REQUIRE(f.kind == Profiler::LambdaKind);
+  REQUIRE(f.calls == 10);
+  REQUIRE(entry(profiler, "*").kind == Profiler::ProcedureKind);
+  REQUIRE(entry(profiler, "*").calls == 10);
+  REQUIRE(entry(profiler, "range").calls == 1);
+  REQUIRE(entry(profiler, "map").kind == Profiler::SpecialFormKind);
+  REQUIRE(entry(profiler, "map").calls == 1);
+  REQUIRE(entry(profiler, "begin").calls == 1);
+
+  // the time of a callee includes that of the frames it opens
+  Profiler::Entry map = entry(profiler, "map");
+  REQUIRE(map.inclusive_ns >= f.inclusive_ns);
+  REQUIRE(f.inclusive_ns >= f.exclusive_ns);
+  REQUIRE(f.inclusive_ns >= entry(profiler, "*").inclusive_ns);
+
+  // allocations are counted by arena_allocate, which packed lists bypass
+  REQUIRE(entry(profiler, "range").allocations == 0);
+
+  std::vector<Profiler::Entry> entries = profiler.entries();
+  for(std::size_t i = 1; i < entries.size(); ++i){
+    REQUIRE(entries[i - 1].exclusive_ns >= entries[i].exclusive_ns);
+  }
+}
+
+TEST_CASE( "Test the profiler writes folded call stacks", "[profiler]" ) {
+
+  Interpreter interp;
+  Profiler profiler;
+  profile_in(interp, profiler, "(begin (define f (lambda (x) (list (sin x) x))) (map f (range 1 100 1)))");
+
+  std::vector<std::string> stacks = folded_stacks(profiler);
+  REQUIRE(!stacks.empty());
+  for(const std::string & stack : stacks){
+    INFO(stack);
+    REQUIRE(stack.find("begin") == 0);
+  }
+  // the arguments of a call are evaluated inside of its frame
+  REQUIRE(std::find(stacks.begin(), stacks.end(), "begin;map;f;list;sin") != stacks.end());
+  REQUIRE(std::find(stacks.begin(), stacks.end(), "begin;map;f;list") != stacks.end());
+
+  // every list allocates its items
+  REQUIRE(entry(profiler, "list").allocations >= 100);
+}
+
+TEST_CASE( "Test nothing is recorded without a current profiler", "[profiler]" ) {
+
+  REQUIRE(Profiler::current() == nullptr);
+
+  Interpreter interp;
+  Profiler profiler;
+  {
+    ProfilerScope scope(&profiler);
+    REQUIRE(Profiler::current() == &profiler);
+  }
+  REQUIRE(Profiler::current() == nullptr);
+
+  std::istringstream program("(+ 1 2)");
+  REQUIRE(interp.parseStream(program));
+  REQUIRE(interp.evaluate() == Expression(3.));
+  REQUIRE(profiler.entries().empty());
+
+  profile_in(interp, profiler, "(+ 1 2)");
+  REQUIRE(profiler.entries().size() == 1);
+  profiler.clear();
+  REQUIRE(profiler.entries().empty());
+  REQUIRE(folded_stacks(profiler).empty());
+}
+
+TEST_CASE( "Test errors close the frames they unwind", "[profiler]" ) {
+
+  Interpreter interp;
+  Profiler profiler;
+  REQUIRE_THROWS_AS(profile_in(interp, profiler, "(begin (define f (lambda (x) (+ x y))) (f 1))"),
+                    SemanticError);
+
+  // the stacks of the next program start from the top again
+  profile_in(interp, profiler, "(list 1 2)");
+  std::vector<std::string> stacks = folded_stacks(profiler);
+  REQUIRE(std::find(stacks.begin(), stacks.end(), "list") != stacks.end());
+  REQUIRE(entry(profiler, "f").calls == 1);
+}
+
+TEST_CASE( "Test the profiler records the bytecode backend", "[profiler]" ) {
+
+  Interpreter interp;
+  interp.setBackend(Interpreter::Backend::Bytecode);
+  Profiler profiler;
+  profile_in(interp, profiler, "(begin (define f (lambda (x) (* x x))) (+ (f 2) (f 3)))");
+
+  REQUIRE(entry(profiler, "f").calls == 2);
+  REQUIRE(entry(profiler, "+").calls == 1);
+}
@@ -0,0 +1,81 @@
+#include "sampling.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double PI = std::atan2(0, -1);
+
+// predicate, the drawn curve bends at sample i by more than min_angle allows
+bool bends(const Samples & s, std::size_t i, double xscale, double yscale, double min_cos){
+
+  double ax = (s.x[i - 1] - s.x[i]) * xscale, ay = (s.y[i - 1] - s.y[i]) * yscale;
+  double bx = (s.x[i + 1] - s.x[i]) * xscale, by = (s.y[i + 1] - s.y[i]) * yscale;
+  double norms = std::sqrt((ax * ax + ay * ay) * (bx * bx + by * by));
+  if(norms == 0){
+    return false;
+  }
+
+  // the angle is less than min_angle exactly when its cosine is greater
+  return (ax * bx + ay * by) / norms > min_cos;
+}
+
+}
+
+Samples sample_adaptive(const BatchFunction & f, double a, double b, const SamplingOptions & options){
+
+  std::size_t n = std::max<std::size_t>(1, options.initial_segments);
+
+  Samples s;
+  s.x.resize(n + 1);
+  for(std::size_t i = 0; i <= n; ++i){
+    s.x[i] = a + (b - a) * static_cast<double>(i) / static_cast<double>(n);
+  }
+  s.y = f(s.x);
+
+  // scale both axes to unit length, using the range of the first samples
+  auto range = std::minmax_element(s.y.begin(), s.y.end());
+  double xscale = 1 / (b - a);
+  double yscale = (*range.second > *range.first) ? 1 / (*range.second - *range.first) : 1;
+  double min_cos = std::cos(options.min_angle * PI / 180);
+
+  for(unsigned round = 0; round < options.max_rounds; ++round){
+
+    // mark both segments next to every sample where the curve bends
+    std::vector<bool> split(s.x.size() - 1, false);
+    bool any = false;
+    for(std::size_t i = 1; i + 1 < s.x.size(); ++i){
+      if(bends(s, i, xscale, yscale, min_cos)){
+        split[i - 1] = split[i] = any = true;
+      }
+    }
+    if(!any){
+      break;
+    }
+
+    std::vector<double> midpoints;
+    for(std::size_t i = 0; i < split.size(); ++i){
+      if(split[i]) midpoints.push_back((s.x[i] + s.x[i + 1]) / 2);
+    }
+    std::vector<double> values = f(midpoints);
+
+    // merge the midpoints in after the segments they split
+    Samples merged;
+    merged.x.reserve(s.x.size() + midpoints.size());
+    merged.y.reserve(s.x.size() + midpoints.size());
+    std::size_t m = 0;
+    for(std::size_t i = 0; i < s.x.size(); ++i){
+      merged.x.push_back(s.x[i]);
+      merged.y.push_back(s.y[i]);
+      if(i < split.size() && split[i]){
+        merged.x.push_back(midpoints[m]);
+        merged.y.push_back(values[m]);
+        ++m;
+      }
+    }
+    s = std::move(merged);
+  }
+
+  return s;
+}
@@ -0,0 +1,47 @@
+/*! \file sampling.hpp
+Defines the adaptive sampling of functions used by continuous-plot.
+
+A function is first sampled at evenly spaced points, then every segment
+next to a sample where the curve bends by more than a given angle is split
+at its midpoint, for a bounded number of rounds. Angles are measured with
+both axes scaled to the same length, as the curve is drawn, so the samples
+gather where the drawn curve bends and straight stretches stay coarse. The
+samples of each round are evaluated in one batch.
+ */
+#ifndef SAMPLING_HPP
+#define SAMPLING_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/// A function evaluated at a batch of points, returning one value per point
+typedef std::function<std::vector<double>(const std::vector<double> &)> BatchFunction;
+
+/// The options of sample_adaptive
+struct SamplingOptions {
+  /// the number of evenly spaced segments sampled first
+  std::size_t initial_segments = 50;
+  /// the maximum number of rounds of splitting
+  unsigned max_rounds = 10;
+  /// the smallest angle in degrees at a sample that is left unsplit
+  double min_angle = 175;
+};
+
+/// The points at which a function was sampled, in increasing order of x
+struct Samples {
+  std::vector<double> x;
+  std::vector<double> y;
+};
+
+/*! Sample f over [a, b] adaptively.
+  \param f the function to sample, which is called once per round
+  \param a the lower bound, less than b
+  \param b the upper bound
+  \param options the sampling options
+  \return the samples, including both bounds
+ */
+Samples sample_adaptive(const BatchFunction & f, double a, double b,
+                        const SamplingOptions & options = SamplingOptions());
+
+#endif
@@ -0,0 +1,68 @@
+#include "catch.hpp"
+
+#include <cmath>
+
+#include "sampling.hpp"
+
+// wrap f as a batch function counting its calls
+template <class F>
+static BatchFunction counting(F f, unsigned & calls){
+  return [f, &calls](const std::vector<double> & xs){
+    ++calls;
+    std::vector<double> ys;
+    for(double x : xs) ys.push_back(f(x));
+    return ys;
+  };
+}
+
+TEST_CASE( "Test sampling a straight line", "[sampling]" ) {
+
+  unsigned calls = 0;
+  Samples s = sample_adaptive(counting([](double x){ return 3 * x - 1; }, calls), -2, 2);
+
+  REQUIRE(calls == 1);
+  REQUIRE(s.x.size() == 51);
+  REQUIRE(s.y.size() == 51);
+  REQUIRE(s.x.front() == -2);
+  REQUIRE(s.x.back() == 2);
+  REQUIRE(s.y.front() == -7);
+  REQUIRE(s.y.back() == Approx(5));
+}
+
+TEST_CASE( "Test sampling gathers where the curve bends", "[sampling]" ) {
+
+  unsigned calls = 0;
+  Samples s = sample_adaptive(counting([](double x){ return std::abs(x - 0.01); }, calls), -1, 1);
+
+  REQUIRE(calls > 1);
+  REQUIRE(calls <= 11);
+  REQUIRE(s.x.size() > 51);
+
+  // the samples are in order, and the new ones are all next to the kink
+  for(std::size_t i = 1; i < s.x.size(); ++i){
+    REQUIRE(s.x[i - 1] < s.x[i]);
+    if(s.x[i] - s.x[i - 1] < 0.04 - 1e-12){
+      REQUIRE(std::abs(s.x[i] - 0.01) <= 0.08);
+    }
+  }
+}
+
+TEST_CASE( "Test sampling options", "[sampling]" ) {
+
+  SamplingOptions options;
+  options.initial_segments = 4;
+  options.max_rounds = 0;
+
+  unsigned calls = 0;
+  Samples s = sample_adaptive(counting([](double x){ return std::sin(x); }, calls), 0, 10, options);
+  REQUIRE(calls == 1);
+  REQUIRE(s.x.size() == 5);
+
+  // splitting stops after the given number of rounds
+  options.max_rounds = 3;
+  calls = 0;
+  s = sample_adaptive(counting([](double x){ return std::sin(x); }, calls), 0, 10, options);
+  REQUIRE(calls <= 4);
+  REQUIRE(s.x.size() > 5);
+  REQUIRE(s.x.size() <= 4 * 8 + 1);
+}
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Compare two result files of plotscript_bench, e.g. of two commits:
+#
+#   ./plotscript_bench --label before > before.json
+#   ./plotscript_bench --label after > after.json
+#   python3 compare_bench.py before.json after.json
+#
+# Prints the change in median time of every benchmark found in both files,
+# and exits with status 1 if any is slower than the threshold allows.
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)
+    return {(b['name'], b['size']): b for b in results['benchmarks']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare plotscript_bench results.')
+    parser.add_argument('before')
+    parser.add_argument('after')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='percent slowdown reported as a regression (default 10)')
+    args = parser.parse_args()
+
+    before = load(args.before)
+    after = load(args.after)
+
+    regressed = False
+    print('%-22s %9s %14s %14s %9s' % ('benchmark', 'size', 'before (ns)', 'after (ns)', 'change'))
+    for key in sorted(before.keys() & after.keys()):
+        old = before[key]['median_ns']
+        new = after[key]['median_ns']
+        change = 100.0 * (new - old) / old if old > 0 else 0.0
+        flag = ''
+        if change > args.threshold:
+            flag = '  slower'
+            regressed = True
+        elif change < -args.threshold:
+            flag = '  faster'
+        print('%-22s %9d %14.1f %14.1f %+8.1f%%%s' % (key[0], key[1], old, new, change, flag))
+
+    for key in sorted(before.keys() ^ after.keys()):
+        print('%-22s %9d only in %s' % (key[0], key[1], args.before if key in before else args.after))
+
+    return 1 if regressed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
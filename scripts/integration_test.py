@@ -39,6 +39,13 @@ class TestREPL(unittest.TestCase):
         def test_error(self):
                 output = self.wrapper.run_command(u'(define begin True)')
                 self.assertTrue(output.strip().startswith('Error'))
+
+        def test_stats(self):
+                self.wrapper.run_command(u'(+ 1 2)')
+                output = self.wrapper.run_command(u'%stats')
+                self.assertTrue(output.strip().startswith('stage'))
+                self.assertIn('evaluated', output)
+                self.assertIn('queue depth', output)
                                 
 class TestExecuteCommandline(unittest.TestCase):
                 
@@ -74,5 +81,29 @@ class TestExecuteFromFile(unittest.TestCase):
                 self.assertNotEqual(retcode, 0)
                 self.assertTrue(output.strip().startswith(b'Error'))
 
+class TestExecuteBatch(unittest.TestCase):
+
+        def test_order(self):
+                args = ' --batch /vagrant/tests/unix/test.pls /there/is/no/such/file -j 2 /vagrant/tests/win/test.pls'
+                (output, retcode) = pexpect.run(cmd+args, withexitstatus=True, extra_args=args)
+                self.assertNotEqual(retcode, 0)
+                lines = output.strip().splitlines()
+                self.assertEqual(len(lines), 3)
+                self.assertEqual(lines[0].strip(), b"(-4)")
+                self.assertTrue(lines[1].startswith(b'Error'))
+                self.assertEqual(lines[2].strip(), b"(-4)")
+
+        def test_success(self):
+                args = ' --batch /vagrant/tests/unix/test.pls /vagrant/tests/win/test.pls'
+                (output, retcode) = pexpect.run(cmd+args, withexitstatus=True, extra_args=args)
+                self.assertEqual(retcode, 0)
+                self.assertEqual(output.split(), [b"(-4)", b"(-4)"])
+
+        def test_jobs(self):
+                args = ' --batch /vagrant/tests/unix/test.pls -j 0'
+                (output, retcode) = pexpect.run(cmd+args, withexitstatus=True, extra_args=args)
+                self.assertNotEqual(retcode, 0)
+                self.assertTrue(output.strip().startswith(b'Error'))
+
 # run the tests
 unittest.main()
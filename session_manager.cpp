@@ -0,0 +1,229 @@
+#include "session_manager.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include "semantic_error.hpp"
+
+namespace {
+
+EvaluationResult failure(const std::string & message){
+  EvaluationResult result;
+  result.error = message;
+  return result;
+}
+
+}
+
+SessionManager::Session::Session(const Interpreter & initial):
+  interp(initial), initial(interp.snapshot()){
+}
+
+SessionManager::SessionManager(std::size_t count){
+
+  count = std::max<std::size_t>(1, count);
+  workers.reserve(count);
+  for(std::size_t i = 0; i < count; ++i){
+    workers.emplace_back(&SessionManager::work, this);
+  }
+}
+
+SessionManager::~SessionManager(){
+
+  std::vector<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    for(auto & entry : sessions){
+      Session & session = *entry.second;
+      if(session.running){
+        session.token.cancel();
+      }
+      std::move(session.jobs.begin(), session.jobs.end(), std::back_inserter(dropped));
+      session.jobs.clear();
+    }
+  }
+  ready_cond.notify_all();
+
+  for(auto & job : dropped){
+    job.promise.set_value(failure("Error: session closed"));
+  }
+  for(auto & worker : workers){
+    worker.join();
+  }
+}
+
+SessionManager::SessionId SessionManager::open(const Interpreter & initial){
+
+  // copying the interpreter shares its bindings, so opening is cheap
+  std::shared_ptr<Session> session = std::make_shared<Session>(initial);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  SessionId id = next_id++;
+  sessions.emplace(id, std::move(session));
+  return id;
+}
+
+void SessionManager::close(SessionId id){
+
+  std::deque<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = sessions.find(id);
+    if(entry == sessions.end()){
+      return;
+    }
+    // a worker still running the session keeps it alive until it is done
+    Session & session = *entry->second;
+    if(session.running){
+      session.token.cancel();
+    }
+    dropped.swap(session.jobs);
+    sessions.erase(entry);
+  }
+
+  for(auto & job : dropped){
+    job.promise.set_value(failure("Error: session closed"));
+  }
+}
+
+std::future<EvaluationResult> SessionManager::submit(SessionId id, const std::string & program){
+
+  Job job;
+  job.program = program;
+  std::future<EvaluationResult> result = job.promise.get_future();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = sessions.find(id);
+    if(entry == sessions.end()){
+      throw std::out_of_range("Error: unknown session");
+    }
+    Session & session = *entry->second;
+    session.jobs.push_back(std::move(job));
+    if(!session.scheduled){
+      session.scheduled = true;
+      ready.push_back(entry->second);
+    }
+  }
+  ready_cond.notify_one();
+
+  return result;
+}
+
+void SessionManager::interrupt(SessionId id){
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Session & session = find(id);
+  // the token is cleared before each program, so only a running one is hit
+  if(session.running){
+    session.token.cancel();
+  }
+}
+
+void SessionManager::reset(SessionId id){
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Session & session = find(id);
+  session.reset_requested = true;
+  if(session.running){
+    session.token.cancel();
+  }
+}
+
+std::size_t SessionManager::size() const{
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return sessions.size();
+}
+
+SessionManager::Session & SessionManager::find(SessionId id) const{
+
+  auto entry = sessions.find(id);
+  if(entry == sessions.end()){
+    throw std::out_of_range("Error: unknown session");
+  }
+  return *entry->second;
+}
+
+void SessionManager::work(){
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true){
+    ready_cond.wait(lock, [this]{ return stopping || !ready.empty(); });
+    if(ready.empty()){
+      return;
+    }
+
+    std::shared_ptr<Session> session = std::move(ready.front());
+    ready.pop_front();
+    if(session->jobs.empty()){
+      // the session was closed while it waited
+      session->scheduled = false;
+      continue;
+    }
+
+    Job job = std::move(session->jobs.front());
+    session->jobs.pop_front();
+    session->running = true;
+    session->token.reset();
+    bool reset = session->reset_requested;
+    session->reset_requested = false;
+    lock.unlock();
+
+    // only this worker touches the interpreter while the session is scheduled
+    if(reset){
+      session->interp.restore(session->initial);
+    }
+    EvaluationResult result = evaluate(*session, job.program);
+
+    lock.lock();
+    session->running = false;
+    if(session->jobs.empty()){
+      session->scheduled = false;
+    }
+    else{
+      ready.push_back(session);
+      ready_cond.notify_one();
+    }
+
+    lock.unlock();
+    job.promise.set_value(std::move(result));
+    lock.lock();
+  }
+}
+
+EvaluationResult SessionManager::evaluate(Session & session, const std::string & program){
+
+  CancellationScope watch(&session.token);
+  Interpreter & interp = session.interp;
+  Environment before = interp.snapshot();
+
+  EvaluationResult result;
+  std::istringstream stream(program);
+  if(!interp.parseStream(stream)){
+    const ParseError & where = interp.parseError();
+    result.error = "Error: Invalid Program. Could not parse. At byte " +
+                   std::to_string(where.offset) + ": " + where.message + ".";
+    return result;
+  }
+
+  try{
+    result.value = interp.evaluate();
+    result.success = true;
+  }
+  catch(const SemanticError & ex){
+    result.error = ex.what();
+    // an interrupted program leaves nothing half defined
+    if(session.token.cancelled()){
+      interp.restore(before);
+    }
+  }
+  catch(const std::exception & ex){
+    // a worker serves every session, so nothing may escape it
+    result.error = std::string("Error: ") + ex.what();
+  }
+  return result;
+}
@@ -0,0 +1,131 @@
+/*! \file session_manager.hpp
+Defines the server hosting many independent interpreter sessions.
+
+Each session has its own Interpreter, so its definitions are seen by no
+other session, and its own cancellation token, so interrupting it affects
+no other session. The programs submitted to a session are evaluated one at
+a time in the order submitted, while the sessions share a fixed pool of
+worker threads and are evaluated concurrently. A session waiting for a
+worker goes to the back of the line after each program, so no session can
+starve the others by submitting many programs.
+ */
+#ifndef SESSION_MANAGER_HPP
+#define SESSION_MANAGER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cancellation.hpp"
+#include "environment.hpp"
+#include "expression.hpp"
+#include "interpreter.hpp"
+
+/// The outcome of a program evaluated in a session
+struct EvaluationResult {
+  /// the value of the program, when success
+  Expression value;
+  /// the message of the error, when not success
+  std::string error;
+  bool success = false;
+};
+
+/*! \class SessionManager
+\brief Evaluates the programs of independent sessions on a pool of workers.
+
+The members may be called from any thread.
+*/
+class SessionManager {
+public:
+
+  typedef std::uint64_t SessionId;
+
+  /// Construct a manager and start the given number of workers (at least 1)
+  explicit SessionManager(std::size_t workers);
+
+  /// Interrupt the running programs, fail the queued ones and join the workers
+  ~SessionManager();
+
+  SessionManager(const SessionManager &) = delete;
+  SessionManager & operator=(const SessionManager &) = delete;
+
+  /*! Open a session.
+    \param initial the interpreter the session starts as a copy of, e.g. one
+    that has evaluated the startup program
+    \return the id of the new session
+   */
+  SessionId open(const Interpreter & initial);
+
+  /*! Close a session. A running program is interrupted and queued ones
+    fail; an unknown id is ignored.
+   */
+  void close(SessionId id);
+
+  /*! Queue a program for evaluation in a session.
+    \param id the session
+    \param program the text of the program
+    \return the future result of the program
+    \throws std::out_of_range if the session is not open
+   */
+  std::future<EvaluationResult> submit(SessionId id, const std::string & program);
+
+  /*! Interrupt the program the session is running, if any. Its definitions
+    are undone and programs queued after it still run.
+    \throws std::out_of_range if the session is not open
+   */
+  void interrupt(SessionId id);
+
+  /*! Return the session to its initial state before its next program,
+    interrupting the program it is running, if any.
+    \throws std::out_of_range if the session is not open
+   */
+  void reset(SessionId id);
+
+  /// return the number of open sessions
+  std::size_t size() const;
+
+private:
+
+  struct Job {
+    std::string program;
+    std::promise<EvaluationResult> promise;
+  };
+
+  struct Session {
+    explicit Session(const Interpreter & initial);
+
+    Interpreter interp;
+    Environment initial;
+    CancellationToken token;
+
+    // the fields below are guarded by the mutex of the manager
+    std::deque<Job> jobs;
+    // in the ready queue or running
+    bool scheduled = false;
+    bool running = false;
+    bool reset_requested = false;
+  };
+
+  void work();
+  Session & find(SessionId id) const;
+
+  // evaluate one program in the state of the session, on its worker
+  static EvaluationResult evaluate(Session & session, const std::string & program);
+
+  mutable std::mutex mutex;
+  std::condition_variable ready_cond;
+  std::unordered_map<SessionId, std::shared_ptr<Session>> sessions;
+  std::deque<std::shared_ptr<Session>> ready;
+  SessionId next_id = 1;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "catch.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "session_manager.hpp"
+#include "startup_config.hpp"
+
+static Interpreter started(){
+
+  Interpreter interp;
+  std::ifstream startup(STARTUP_FILE);
+  REQUIRE(interp.parseStream(startup));
+  REQUIRE_NOTHROW(interp.evaluate());
+  return interp;
+}
+
+// interrupt the session until the program it runs has finished
+static EvaluationResult interrupt_until_done(SessionManager & manager, SessionManager::SessionId id,
+                                             std::future<EvaluationResult> & future){
+
+  while(future.wait_for(std::chrono::milliseconds(5)) != std::future_status::ready){
+    manager.interrupt(id);
+  }
+  return future.get();
+}
+
+const std::string LONG_PROGRAM =
+  "(begin (define f (lambda (x) (* x x))) (define a 99) (map f (range 0 1000000)))";
+
+TEST_CASE( "Test sessions are isolated", "[session_manager]" ) {
+
+  SessionManager manager(2);
+  Interpreter initial = started();
+  SessionManager::SessionId a = manager.open(initial);
+  SessionManager::SessionId b = manager.open(initial);
+  REQUIRE(a != b);
+  REQUIRE(manager.size() == 2);
+
+  REQUIRE(manager.submit(a, "(define x 1)").get().success);
+  REQUIRE(manager.submit(b, "(define x 2)").get().success);
+
+  EvaluationResult ra = manager.submit(a, "(+ x 10)").get();
+  EvaluationResult rb = manager.submit(b, "(+ x 10)").get();
+  REQUIRE(ra.success);
+  REQUIRE(ra.value == Expression(11.));
+  REQUIRE(rb.value == Expression(12.));
+
+  // the startup program is seen by both, the sessions by neither
+  REQUIRE(manager.submit(a, "(real I)").get().success);
+  std::istringstream lookup("(+ x 1)");
+  REQUIRE(initial.parseStream(lookup));
+  REQUIRE_THROWS_AS(initial.evaluate(), SemanticError);
+}
+
+TEST_CASE( "Test a session runs its programs in order", "[session_manager]" ) {
+
+  SessionManager manager(4);
+  SessionManager::SessionId id = manager.open(started());
+
+  std::vector<std::future<EvaluationResult>> results;
+  results.push_back(manager.submit(id, "(define n 0)"));
+  for(int i = 1; i <= 20; ++i){
+    results.push_back(manager.submit(id, "(define n (+ n 1))"));
+  }
+  for(int i = 0; i <= 20; ++i){
+    EvaluationResult r = results[i].get();
+    REQUIRE(r.success);
+    REQUIRE(r.value == Expression(double(i)));
+  }
+}
+
+TEST_CASE( "Test evaluation errors are reported", "[session_manager]" ) {
+
+  SessionManager manager(1);
+  SessionManager::SessionId id = manager.open(started());
+
+  EvaluationResult r = manager.submit(id, "(+ 1 undefined-thing)").get();
+  REQUIRE_FALSE(r.success);
+  REQUIRE(r.error.find("Error") == 0);
+
+  r = manager.submit(id, "(+ 1").get();
+  REQUIRE_FALSE(r.success);
+  REQUIRE(r.error.find("Could not parse") != std::string::npos);
+
+  REQUIRE_THROWS_AS(manager.submit(id + 100, "(+ 1 2)"), std::out_of_range);
+  REQUIRE_THROWS_AS(manager.interrupt(id + 100), std::out_of_range);
+}
+
+TEST_CASE( "Test interrupting one session leaves the others running", "[session_manager]" ) {
+
+  SessionManager manager(2);
+  Interpreter initial = started();
+  SessionManager::SessionId a = manager.open(initial);
+  SessionManager::SessionId b = manager.open(initial);
+
+  REQUIRE(manager.submit(a, "(define a 1)").get().success);
+  std::future<EvaluationResult> slow = manager.submit(a, LONG_PROGRAM);
+  std::future<EvaluationResult> queued = manager.submit(a, "(+ a 1)");
+
+  EvaluationResult other = manager.submit(b, "(+ 1 2)").get();
+  REQUIRE(other.success);
+
+  EvaluationResult interrupted = interrupt_until_done(manager, a, slow);
+  REQUIRE_FALSE(interrupted.success);
+  REQUIRE(interrupted.error == "Error: interpreter kernal interupted");
+
+  // the interrupted program was undone, the one queued after it still runs
+  EvaluationResult after = queued.get();
+  REQUIRE(after.success);
+  REQUIRE(after.value == Expression(2.));
+}
+
+TEST_CASE( "Test resetting a session", "[session_manager]" ) {
+
+  SessionManager manager(1);
+  SessionManager::SessionId id = manager.open(started());
+
+  REQUIRE(manager.submit(id, "(define a 1)").get().success);
+  manager.reset(id);
+  REQUIRE_FALSE(manager.submit(id, "(+ a 1)").get().success);
+  REQUIRE(manager.submit(id, "(real I)").get().success);
+}
+
+TEST_CASE( "Test closing a session", "[session_manager]" ) {
+
+  SessionManager manager(1);
+  SessionManager::SessionId id = manager.open(started());
+
+  std::future<EvaluationResult> slow = manager.submit(id, LONG_PROGRAM);
+  std::future<EvaluationResult> queued = manager.submit(id, "(+ 1 2)");
+  manager.close(id);
+  REQUIRE(manager.size() == 0);
+
+  EvaluationResult dropped = queued.get();
+  REQUIRE_FALSE(dropped.success);
+  REQUIRE(dropped.error == "Error: session closed");
+  slow.wait();
+
+  REQUIRE_THROWS_AS(manager.submit(id, "(+ 1 2)"), std::out_of_range);
+  REQUIRE_NOTHROW(manager.close(id));
+}
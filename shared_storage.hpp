@@ -0,0 +1,210 @@
+/*! \file shared_storage.hpp
+Defines reference-counted, copy-on-write containers used for the tail and the
+properties of an Expression.
+
+Copying either container only copies a pointer, so copying an Expression is
+O(1) no matter how large the tree under it is. The underlying storage is
+treated as immutable while it is shared, and is cloned the first time a
+shared copy is modified. A SharedVector can cache a value computed from its
+items, such as their hash, with the storage; the value is dropped when the
+items are modified.
+
+The storage is drawn from the Arena current on the thread that creates it,
+if any (see arena.hpp). Storage that is not in the current arena is never
+modified in place while that arena is current, so storage outside an arena
+only ever holds items whose storage is outside it too.
+ */
+#ifndef SHARED_STORAGE_HPP
+#define SHARED_STORAGE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+
+/*! \class SharedVector
+\brief A copy-on-write std::vector.
+
+Read access has the same shape as a const std::vector. Any modification
+first detaches this copy from storage shared with others.
+*/
+template <class T>
+class SharedVector {
+public:
+
+  typedef std::vector<T> VectorType;
+  typedef typename VectorType::const_iterator const_iterator;
+
+  /// Construct an empty vector, which holds no storage
+  SharedVector() {}
+
+  /// Construct holding a copy of items
+  SharedVector(const VectorType & items) {
+    if(!items.empty()) data = make(items);
+  }
+
+  /// Construct taking over items
+  SharedVector(VectorType && items) {
+    if(!items.empty()) data = make(std::move(items));
+  }
+
+  /// return a const-reference to the underlying vector
+  const VectorType & items() const noexcept { return data ? data->items : none(); }
+
+  std::size_t size() const noexcept { return data ? data->items.size() : 0; }
+  bool empty() const noexcept { return size() == 0; }
+  const T & operator[](std::size_t i) const { return data->items[i]; }
+  const T & back() const { return data->items.back(); }
+  const_iterator begin() const noexcept { return items().cbegin(); }
+  const_iterator end() const noexcept { return items().cend(); }
+
+  /// return the underlying vector for modification, detaching it if shared
+  VectorType & write() {
+    if(!data){
+      data = make(VectorType());
+    }
+    else if(data.use_count() > 1 || data->arena != Arena::current()){
+      data = make(data->items);
+    }
+    else{
+      data->cached.store(0, std::memory_order_relaxed);
+    }
+    return data->items;
+  }
+
+  /// return the value last cached with the storage, 0 if none or modified since
+  std::size_t cached() const noexcept {
+    return data ? data->cached.load(std::memory_order_relaxed) : 0;
+  }
+
+  /// cache a value derived from the items with the storage, until it is modified
+  void cache(std::size_t value) const noexcept {
+    if(data) data->cached.store(value, std::memory_order_relaxed);
+  }
+
+  void push_back(const T & value) { write().push_back(value); }
+  void push_back(T && value) { write().push_back(std::move(value)); }
+  template <class... Args> void emplace_back(Args &&... args) {
+    write().emplace_back(std::forward<Args>(args)...);
+  }
+  void clear() noexcept { data.reset(); }
+
+  /*! Move the items to the end of out and drop the storage, if no other
+    copy shares it.
+    \return true if the items were moved
+   */
+  bool release(VectorType & out) {
+    if(!data || data.use_count() > 1){
+      return false;
+    }
+    std::move(data->items.begin(), data->items.end(), std::back_inserter(out));
+    data.reset();
+    return true;
+  }
+
+  /// determine if both vectors refer to the same storage
+  bool sameStorage(const SharedVector & other) const noexcept {
+    return data == other.data;
+  }
+
+  /// determine if the storage, but not the items, is in arena
+  bool inArena(const Arena & arena) const noexcept {
+    return data && data->arena == &arena;
+  }
+
+private:
+  struct Storage {
+    template <class V> Storage(V && items): items(std::forward<V>(items)), arena(Arena::current()), cached(0) {}
+    VectorType items;
+    Arena * arena;
+    // read and written by any thread sharing the storage
+    std::atomic<std::size_t> cached;
+  };
+  std::shared_ptr<Storage> data;
+
+  template <class V> static std::shared_ptr<Storage> make(V && items) {
+    return std::allocate_shared<Storage>(ArenaAllocator<Storage>(), std::forward<V>(items));
+  }
+
+  static const VectorType & none() {
+    static const VectorType empty_vector;
+    return empty_vector;
+  }
+};
+
+/*! \class SharedMap
+\brief A copy-on-write std::map.
+
+Read access has the same shape as a const std::map. Any modification first
+detaches this copy from storage shared with others.
+*/
+template <class K, class V>
+class SharedMap {
+public:
+
+  typedef std::map<K, V, std::less<K>, ArenaAllocator<std::pair<const K, V>>> MapType;
+  typedef typename MapType::const_iterator const_iterator;
+
+  /// Construct an empty map, which holds no storage
+  SharedMap() {}
+
+  /// return a const-reference to the underlying map
+  const MapType & items() const noexcept { return data ? data->items : none(); }
+
+  std::size_t size() const noexcept { return data ? data->items.size() : 0; }
+  bool empty() const noexcept { return size() == 0; }
+  const_iterator find(const K & key) const { return items().find(key); }
+  const_iterator begin() const noexcept { return items().cbegin(); }
+  const_iterator end() const noexcept { return items().cend(); }
+  const V & at(const K & key) const { return items().at(key); }
+
+  /// return the underlying map for modification, detaching it if shared
+  MapType & write() {
+    if(!data){
+      data = make(MapType());
+    }
+    else if(data.use_count() > 1 || data->arena != Arena::current()){
+      data = make(data->items);
+    }
+    return data->items;
+  }
+
+  V & operator[](const K & key) { return write()[key]; }
+  void erase(const K & key) { if(find(key) != end()) write().erase(key); }
+  void clear() noexcept { data.reset(); }
+
+  /// determine if both maps refer to the same storage
+  bool sameStorage(const SharedMap & other) const noexcept {
+    return data == other.data;
+  }
+
+  /// determine if the storage, but not the values, is in arena
+  bool inArena(const Arena & arena) const noexcept {
+    return data && data->arena == &arena;
+  }
+
+private:
+  struct Storage {
+    template <class M> Storage(M && items): items(std::forward<M>(items)), arena(Arena::current()) {}
+    MapType items;
+    Arena * arena;
+  };
+  std::shared_ptr<Storage> data;
+
+  template <class M> static std::shared_ptr<Storage> make(M && items) {
+    return std::allocate_shared<Storage>(ArenaAllocator<Storage>(), std::forward<M>(items));
+  }
+
+  static const MapType & none() {
+    static const MapType empty_map;
+    return empty_map;
+  }
+};
+
+#endif
@@ -0,0 +1,264 @@
+#include "snapshot.hpp"
+
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+#include "numeric_list.hpp"
+
+namespace {
+
+// the first bytes of every snapshot, ending in the version of the format
+const char MAGIC[] = "plotscript-snapshot 1\n";
+const std::size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+
+enum AtomTag : std::uint8_t { NoneTag, NumberTag, SymbolTag, ComplexTag };
+
+enum ListTag : std::uint8_t { BoxedTag, RealTag, ComplexListTag };
+
+}
+
+/*! \class SnapshotCodec
+\brief Writes expressions into a snapshot and reads them back.
+
+The codec is a friend of Expression, so the rebuilt expressions have exactly
+the type, tail and properties of the saved ones.
+*/
+class SnapshotCodec {
+public:
+
+  // writing
+  explicit SnapshotCodec(std::string & out): out(&out){}
+
+  // reading
+  SnapshotCodec(const char * data, std::size_t size): next(data), end(data + size){}
+
+  template <class T>
+  void put(T value){
+    out->append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void put_string(const std::string & s){
+    put<std::uint32_t>(s.size());
+    out->append(s);
+  }
+
+  void put_atom(const Atom & a){
+    if(a.isNumber()){
+      put<std::uint8_t>(NumberTag);
+      put<double>(a.asNumber());
+    }
+    else if(a.isComplex()){
+      put<std::uint8_t>(ComplexTag);
+      put<double>(a.asComplex().real());
+      put<double>(a.asComplex().imag());
+    }
+    else if(a.isSymbol() || a.isString()){
+      // strings are symbols keeping their quotes
+      put<std::uint8_t>(SymbolTag);
+      put_string(a.asString());
+    }
+    else{
+      put<std::uint8_t>(NoneTag);
+    }
+  }
+
+  void put_expression(const Expression & e){
+
+    put<std::uint8_t>(static_cast<std::uint8_t>(e.m_type));
+    put_atom(e.m_head);
+
+    if(e.m_numeric && !e.m_numeric->isComplex()){
+      put<std::uint8_t>(RealTag);
+      put<std::uint32_t>(e.m_numeric->size());
+      for(double x : e.m_numeric->real()){
+        put<double>(x);
+      }
+    }
+    else if(e.m_numeric){
+      put<std::uint8_t>(ComplexListTag);
+      put<std::uint32_t>(e.m_numeric->size());
+      for(const std::complex<double> & z : e.m_numeric->complex()){
+        put<double>(z.real());
+        put<double>(z.imag());
+      }
+    }
+    else{
+      put<std::uint8_t>(BoxedTag);
+      put<std::uint32_t>(e.m_tail.size());
+      for(const Expression & item : e.m_tail.items()){
+        put_expression(item);
+      }
+    }
+
+    put<std::uint32_t>(e.m_properties.size());
+    for(const auto & property : e.m_properties){
+      put_string(property.first);
+      put_expression(property.second);
+    }
+  }
+
+  template <class T>
+  bool get(T & value){
+    if(static_cast<std::size_t>(end - next) < sizeof(T)){
+      return false;
+    }
+    std::memcpy(&value, next, sizeof(T));
+    next += sizeof(T);
+    return true;
+  }
+
+  bool get_string(std::string & s){
+    std::uint32_t size;
+    if(!get(size) || static_cast<std::size_t>(end - next) < size){
+      return false;
+    }
+    s.assign(next, size);
+    next += size;
+    return true;
+  }
+
+  bool get_atom(Atom & a){
+    std::uint8_t tag;
+    if(!get(tag)){
+      return false;
+    }
+    double x, y;
+    std::string s;
+    switch(tag){
+    case NoneTag:
+      a = Atom();
+      return true;
+    case NumberTag:
+      if(!get(x)) return false;
+      a = Atom(x);
+      return true;
+    case ComplexTag:
+      if(!get(x) || !get(y)) return false;
+      a = Atom(std::complex<double>(x, y));
+      return true;
+    case SymbolTag:
+      if(!get_string(s)) return false;
+      a = Atom(s);
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool get_expression(Expression & e){
+
+    std::uint8_t type, list;
+    std::uint32_t count;
+    if(!get(type) || type > static_cast<std::uint8_t>(Expression::ExpType::Plot) ||
+       !get_atom(e.m_head) || !get(list) || !get(count)){
+      return false;
+    }
+    e.m_type = static_cast<Expression::ExpType>(type);
+
+    // every item takes at least a byte, which bounds what a bad count reserves
+    if(count > static_cast<std::size_t>(end - next)){
+      return false;
+    }
+    if(list == RealTag){
+      std::vector<double> values(count);
+      for(double & x : values){
+        if(!get(x)) return false;
+      }
+      e.m_numeric = std::make_shared<NumericList>(std::move(values));
+    }
+    else if(list == ComplexListTag){
+      std::vector<std::complex<double>> values(count);
+      for(std::complex<double> & z : values){
+        double x, y;
+        if(!get(x) || !get(y)) return false;
+        z = std::complex<double>(x, y);
+      }
+      e.m_numeric = std::make_shared<NumericList>(std::move(values));
+    }
+    else if(list == BoxedTag){
+      std::vector<Expression> items(count);
+      for(Expression & item : items){
+        if(!get_expression(item)) return false;
+      }
+      e.m_tail = SharedVector<Expression>(std::move(items));
+    }
+    else{
+      return false;
+    }
+
+    if(!get(count)){
+      return false;
+    }
+    for(std::uint32_t i = 0; i < count; ++i){
+      std::string key;
+      Expression value;
+      if(!get_string(key) || !get_expression(value)) return false;
+      e.m_properties[key] = value;
+    }
+    return true;
+  }
+
+  bool done() const noexcept{
+    return next == end;
+  }
+
+private:
+  std::string * out = nullptr;
+  const char * next = nullptr;
+  const char * end = nullptr;
+};
+
+std::string write_snapshot(const Environment & env){
+
+  std::string result(MAGIC, MAGIC_SIZE);
+  SnapshotCodec codec(result);
+
+  std::vector<std::pair<std::string, Expression>> definitions = env.definitions();
+  codec.put<std::uint32_t>(definitions.size());
+  for(const auto & definition : definitions){
+    codec.put_string(definition.first);
+    codec.put_expression(definition.second);
+  }
+  return result;
+}
+
+bool read_snapshot(const char * data, std::size_t size, Environment & env){
+
+  if(size < MAGIC_SIZE || std::memcmp(data, MAGIC, MAGIC_SIZE) != 0){
+    return false;
+  }
+
+  // the environment outlives any evaluation that happens to be running
+  ArenaScope suspend(nullptr);
+  SnapshotCodec codec(data + MAGIC_SIZE, size - MAGIC_SIZE);
+  Environment result;
+
+  std::uint32_t count;
+  if(!codec.get(count)){
+    return false;
+  }
+  for(std::uint32_t i = 0; i < count; ++i){
+    std::string symbol;
+    Expression value;
+    if(!codec.get_string(symbol) || !codec.get_expression(value)){
+      return false;
+    }
+    Atom sym(symbol);
+    if(!sym.isSymbol() || result.is_known(sym)){
+      // the built-ins cannot be redefined
+      return false;
+    }
+    result.add_exp(sym, value);
+  }
+  if(!codec.done()){
+    return false;
+  }
+
+  env = result;
+  return true;
+}
@@ -0,0 +1,37 @@
+/*! \file snapshot.hpp
+Defines the serialized snapshot of a global environment.
+
+A snapshot holds the definitions an environment adds to the built-ins, so an
+interpreter can start in the state left by a program without lexing,
+parsing or evaluating the program again. The snapshot of the startup file is
+made when plotscript is built (see make_snapshot.cpp) and is compiled into
+the programs as STARTUP_SNAPSHOT (see startup_config.hpp), so loading it
+only rebuilds the expressions of its definitions.
+
+Numbers are stored in the byte order of the machine writing the snapshot,
+so a snapshot is only meant to be read by programs built alongside it.
+ */
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "environment.hpp"
+
+/*! Serialize the definitions of an environment.
+  \param env the global environment to save
+  \return the bytes of the snapshot
+ */
+std::string write_snapshot(const Environment & env);
+
+/*! Rebuild an environment from a snapshot.
+  \param data the bytes of the snapshot
+  \param size the number of bytes
+  \param env set to the built-ins plus the definitions of the snapshot
+  \return true if the snapshot was read, false if it is malformed, in which
+  case env is unchanged
+ */
+bool read_snapshot(const char * data, std::size_t size, Environment & env);
+
+#endif
@@ -0,0 +1,102 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "snapshot.hpp"
+#include "startup_config.hpp"
+
+static Expression evaluate_in(Interpreter & interp, const std::string & program){
+
+  std::istringstream iss(program);
+  INFO(program);
+  REQUIRE(interp.parseStream(iss));
+  return interp.evaluate();
+}
+
+TEST_CASE( "Test a snapshot restores every kind of definition", "[snapshot]" ) {
+
+  Interpreter interp;
+  evaluate_in(interp, "(define a 3.5)");
+  evaluate_in(interp, "(define z (+ 1 I))");
+  evaluate_in(interp, "(define s \"a string\")");
+  evaluate_in(interp, "(define mixed (list 1 \"two\" (list I 4)))");
+  evaluate_in(interp, "(define numbers (range 0 10 1))");
+  evaluate_in(interp, "(define f (lambda (x y) (+ (* x x) y)))");
+  evaluate_in(interp, "(define p (set-property \"size\" 2 (set-property \"object-name\" \"point\" (list 1 2))))");
+
+  Environment saved = interp.snapshot();
+  std::string bytes = write_snapshot(saved);
+
+  Environment loaded;
+  REQUIRE(read_snapshot(bytes.data(), bytes.size(), loaded));
+  for(const std::string & name : {"a", "z", "s", "mixed", "numbers", "f", "p"}){
+    INFO(name);
+    REQUIRE(loaded.get_exp(Atom(name)) == saved.get_exp(Atom(name)));
+  }
+  REQUIRE(loaded.definitions().size() == 7);
+
+  Interpreter restored;
+  restored.restore(loaded);
+  REQUIRE(evaluate_in(restored, "(f a 1)") == Expression(13.25));
+  REQUIRE(evaluate_in(restored, "(length numbers)") == Expression(11.));
+  REQUIRE(evaluate_in(restored, "(get-property \"size\" p)") == Expression(2.));
+  REQUIRE(evaluate_in(restored, "(+ (* 2 pi) (sin 0))") == Expression(2 * std::atan2(0, -1)));
+
+  // saving what was loaded gives the same snapshot
+  REQUIRE(write_snapshot(loaded) == bytes);
+}
+
+TEST_CASE( "Test the startup snapshot matches evaluating the startup file", "[snapshot]" ) {
+
+  Interpreter interp;
+  std::ifstream startup(STARTUP_FILE);
+  REQUIRE(interp.parseStream(startup));
+  REQUIRE_NOTHROW(interp.evaluate());
+
+  Environment loaded;
+  REQUIRE(read_snapshot(STARTUP_SNAPSHOT, STARTUP_SNAPSHOT_SIZE, loaded));
+
+  auto expected = interp.snapshot().definitions();
+  auto actual = loaded.definitions();
+  REQUIRE(actual.size() == expected.size());
+  for(std::size_t i = 0; i < actual.size(); ++i){
+    REQUIRE(actual[i].first == expected[i].first);
+    REQUIRE(actual[i].second == expected[i].second);
+  }
+
+  Interpreter restored;
+  restored.restore(loaded);
+  Expression point = evaluate_in(restored, "(make-point 1 2)");
+  REQUIRE(point == evaluate_in(interp, "(make-point 1 2)"));
+}
+
+TEST_CASE( "Test malformed snapshots are rejected", "[snapshot]" ) {
+
+  Interpreter interp;
+  evaluate_in(interp, "(define f (lambda (x) (list x \"text\" 2)))");
+  std::string bytes = write_snapshot(interp.snapshot());
+
+  Environment env;
+  env.add_exp(Atom("kept"), Expression(1.));
+
+  std::string wrong_magic = bytes;
+  wrong_magic[0] = 'P';
+  REQUIRE_FALSE(read_snapshot(wrong_magic.data(), wrong_magic.size(), env));
+
+  // every truncation fails, rather than reading past the end
+  for(std::size_t size = 0; size < bytes.size(); ++size){
+    INFO(size);
+    REQUIRE_FALSE(read_snapshot(bytes.data(), size, env));
+  }
+
+  std::string trailing = bytes + "x";
+  REQUIRE_FALSE(read_snapshot(trailing.data(), trailing.size(), env));
+
+  // a failed read leaves the environment as it was
+  REQUIRE(env.get_exp(Atom("kept")) == Expression(1.));
+  REQUIRE_FALSE(env.is_known(Atom("f")));
+}
@@ -0,0 +1,168 @@
+#include "stream_plot.hpp"
+
+#include <atomic>
+#include <string>
+#include <utility>
+
+#include "memo_cache.hpp"
+#include "numeric_list.hpp"
+#include "semantic_error.hpp"
+
+namespace {
+
+thread_local const StreamSink * current_sink = nullptr;
+
+// the plots of every kernel are numbered apart, so that an append to a plot
+// of a kernel that was reset is never drawn on a plot of the new one
+std::atomic<std::uint64_t> last_id(0);
+
+// the coordinates of points, a list of points or the two columns of data
+// read as columns, interleaved into xy
+bool coordinates(const Expression & points, std::vector<double> & xy){
+
+  if(!points.isList()){
+    return false;
+  }
+
+  if(points.checkProperty("layout", "columns")){
+    if(points.tailLength() != 2){
+      return false;
+    }
+    std::vector<double> columns[2];
+    for(std::size_t c = 0; c < 2; ++c){
+      const Expression & column = points.contents()[c];
+      const NumericList * packed = column.numericList();
+      if(packed != nullptr && !packed->isComplex()){
+        columns[c] = packed->real();
+        continue;
+      }
+      if(!column.isList()){
+        return false;
+      }
+      for(const Expression & e : column.contents()){
+        if(e.tailLength() != 0 || !e.head().isNumber()) return false;
+        columns[c].push_back(e.head().asNumber());
+      }
+    }
+    if(columns[0].size() != columns[1].size()){
+      return false;
+    }
+    xy.reserve(2 * columns[0].size());
+    for(std::size_t i = 0; i < columns[0].size(); ++i){
+      xy.push_back(columns[0][i]);
+      xy.push_back(columns[1][i]);
+    }
+    return true;
+  }
+
+  xy.reserve(2 * points.tailLength());
+  for(const Expression & p : points.contents()){
+    if(!p.isList() || p.tailLength() != 2 ||
+       !p.contents()[0].head().isNumber() || !p.contents()[1].head().isNumber()){
+      return false;
+    }
+    xy.push_back(p.contents()[0].head().asNumber());
+    xy.push_back(p.contents()[1].head().asNumber());
+  }
+  return true;
+}
+
+}
+
+StreamSink::StreamSink(Send send): receiver(std::move(send)){}
+
+void StreamSink::send(const Expression & data) const{
+  receiver(data);
+}
+
+const StreamSink * StreamSink::current() noexcept{
+  return current_sink;
+}
+
+StreamScope::StreamScope(const StreamSink * sink) noexcept: previous(current_sink){
+  current_sink = sink;
+}
+
+StreamScope::~StreamScope(){
+  current_sink = previous;
+}
+
+bool is_stream_plot(const Expression & e){
+  return e.head().isNumber() && e.tailLength() == 0 && e.objectKind() == Expression::ObjectKind::StreamPlot;
+}
+
+bool is_stream_data(const Expression & e){
+  return e.objectKind() == Expression::ObjectKind::StreamData;
+}
+
+std::uint64_t stream_id(const Expression & e){
+
+  if(is_stream_data(e)){
+    return static_cast<std::uint64_t>(e.getNumericalProperty("\"stream\""));
+  }
+  return is_stream_plot(e) ? static_cast<std::uint64_t>(e.head().asNumber()) : 0;
+}
+
+Expression stream_plot(const std::vector<Expression> & args){
+
+  if(args.size() != 1 || !args[0].isList()){
+    throw SemanticError("Error: in call to stream-plot, argument not a list of options");
+  }
+
+  // a new plot every time, so the handle is never taken from the cache
+  note_outside_read();
+
+  Expression plot(Atom(static_cast<double>(++last_id)));
+  plot.setProperty("\"object-name\"", Expression(Atom("\"stream-plot\"")));
+
+  for(const Expression & option : args[0].contents()){
+    if(option.tailLength() != 2 || !option.contents()[0].head().isString() ||
+       !option.contents()[1].head().isString()){
+      throw SemanticError("Error: in call to stream-plot, an option is not a list of a name and a string");
+    }
+    const std::string & name = option.contents()[0].head().asString();
+    if(name != "\"title\"" && name != "\"abscissa-label\"" && name != "\"ordinate-label\""){
+      throw SemanticError("Error: in call to stream-plot, option " + name +
+                          " not one of \"title\", \"abscissa-label\" or \"ordinate-label\"");
+    }
+    plot.setProperty(name, option.contents()[1]);
+  }
+  return plot;
+}
+
+Expression stream_append(const std::vector<Expression> & args){
+
+  if(args.size() != 2){
+    throw SemanticError("Error: in call to stream-append, invalid number of arguments");
+  }
+  if(!is_stream_plot(args[0])){
+    throw SemanticError("Error: in call to stream-append, first argument not a streaming plot");
+  }
+
+  std::vector<double> xy;
+  if(!coordinates(args[1], xy)){
+    throw SemanticError("Error: in call to stream-append, second argument not a list of points");
+  }
+
+  // the append is what the call does, so it is never skipped by the cache
+  note_outside_read();
+
+  const StreamSink * sink = StreamSink::current();
+  if(sink != nullptr && !xy.empty()){
+    Expression data = make_numeric_list(std::move(xy));
+    data.setProperty("\"object-name\"", Expression(Atom("\"stream-data\"")));
+    data.setProperty("\"stream\"", Expression(args[0].head()));
+    // the points arrive ahead of the result of the cell making the plot, so
+    // they carry what the notebook needs to show it
+    for(const char * label : {"\"title\"", "\"abscissa-label\"", "\"ordinate-label\""}){
+      Atom text = args[0].getProperty(label);
+      if(text.isString()){
+        data.setProperty(label, Expression(text));
+      }
+    }
+    // the message outlives the evaluation, and with it its arena
+    promote_to_heap(data);
+    sink->send(data);
+  }
+  return args[0];
+}
@@ -0,0 +1,93 @@
+/*! \file stream_plot.hpp
+Defines the streaming plots, to which a program appends points while it runs.
+
+(stream-plot options) returns a handle to a new plot, which the notebook
+shows as an empty frame, and (stream-append plot points) sends the points to
+it. The points are not kept by the handle: each append is sent as one stream
+data message to the StreamSink current on the evaluating thread, which the
+kernel of the notebook forwards over its output queue, so the notebook
+extends the plot by the new points alone instead of drawing it again. The
+messages are sent as the program runs, ahead of the result of the cell, so
+each carries the labels of its plot and the first of them shows a plot the
+notebook has not been handed yet.
+
+An evaluation without a current sink, as in the REPL or on the workers of
+pmap, appends nowhere. Appending is a side effect, so both procedures note a
+read outside of the program (see memo_cache.hpp) and are never cached.
+ */
+#ifndef STREAM_PLOT_HPP
+#define STREAM_PLOT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "expression.hpp"
+
+/*! \class StreamSink
+\brief Receives the stream data messages of the evaluations on a thread.
+*/
+class StreamSink {
+public:
+
+  typedef std::function<void(const Expression &)> Send;
+
+  explicit StreamSink(Send send);
+
+  StreamSink(const StreamSink &) = delete;
+  StreamSink & operator=(const StreamSink &) = delete;
+
+  /// hand a stream data message to the receiver
+  void send(const Expression & data) const;
+
+  /// return the sink current on the calling thread, or nullptr
+  static const StreamSink * current() noexcept;
+
+private:
+  Send receiver;
+};
+
+/*! \class StreamScope
+\brief Makes a sink current on the calling thread for its lifetime.
+*/
+class StreamScope {
+public:
+  explicit StreamScope(const StreamSink * sink) noexcept;
+  ~StreamScope();
+
+  StreamScope(const StreamScope &) = delete;
+  StreamScope & operator=(const StreamScope &) = delete;
+
+private:
+  const StreamSink * previous;
+};
+
+/// predicate, e is the handle of a streaming plot
+bool is_stream_plot(const Expression & e);
+
+/// predicate, e is a stream data message
+bool is_stream_data(const Expression & e);
+
+/// return the identifier of the plot of a handle or a stream data message
+std::uint64_t stream_id(const Expression & e);
+
+/*! Create a streaming plot.
+
+  (stream-plot options) returns the handle of a new plot labelled by
+  options, a list of (name value) pairs of which the names are "title",
+  "abscissa-label" and "ordinate-label", which may be empty. The labels are
+  kept as properties of the handle.
+ */
+Expression stream_plot(const std::vector<Expression> & args);
+
+/*! Append points to a streaming plot.
+
+  (stream-append plot points) sends points, a list of points or of lists of
+  two numbers, or two columns as read by read-csv, to the plot and returns
+  the handle. A stream data message is the packed list of the interleaved
+  coordinates x0 y0 x1 y1 ... with the property "stream" set to the
+  identifier of the plot, and the labels of the plot as its properties.
+ */
+Expression stream_append(const std::vector<Expression> & args);
+
+#endif
@@ -0,0 +1,92 @@
+#include "catch.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.hpp"
+#include "numeric_list.hpp"
+#include "semantic_error.hpp"
+#include "stream_plot.hpp"
+
+static Expression evaluate_in(Interpreter & interp, const std::string & program){
+
+  std::istringstream iss(program);
+  INFO(program);
+  REQUIRE(interp.parseStream(iss));
+  return interp.evaluate();
+}
+
+TEST_CASE( "Test appending to a streaming plot sends the new points", "[stream_plot]" ) {
+
+  std::vector<Expression> sent;
+  StreamSink sink([&sent](const Expression & data){ sent.push_back(data); });
+  StreamScope scope(&sink);
+  REQUIRE(StreamSink::current() == &sink);
+
+  Interpreter interp;
+  Expression plot = evaluate_in(interp, "(define s (stream-plot (list (list \"title\" \"Feed\"))))");
+  REQUIRE(is_stream_plot(plot));
+  REQUIRE(plot.checkProperty("title", "Feed"));
+  REQUIRE(stream_id(plot) != 0);
+  REQUIRE(sent.empty());
+
+  REQUIRE(evaluate_in(interp, "(stream-append s (list (list 1 2) (list 3 4)))") == plot);
+  REQUIRE(sent.size() == 1);
+  REQUIRE(is_stream_data(sent[0]));
+  REQUIRE(stream_id(sent[0]) == stream_id(plot));
+  REQUIRE(sent[0].numericList() != nullptr);
+  REQUIRE(sent[0].numericList()->real() == std::vector<double>({1, 2, 3, 4}));
+  // the points come ahead of the handle, so they carry its labels
+  REQUIRE(sent[0].checkProperty("title", "Feed"));
+
+  // each append sends only its own points, also from columns
+  evaluate_in(interp, "(stream-append s (set-property \"layout\" \"columns\" (list (list 5 6) (range 7 8 1))))");
+  REQUIRE(sent.size() == 2);
+  REQUIRE(sent[1].numericList()->real() == std::vector<double>({5, 7, 6, 8}));
+
+  // an append is never skipped for a cached value
+  interp.setMemoize(true);
+  evaluate_in(interp, "(stream-append s (list (list 0 0)))");
+  evaluate_in(interp, "(stream-append s (list (list 0 0)))");
+  REQUIRE(sent.size() == 4);
+
+  // nothing is sent for no points, and each plot is new
+  evaluate_in(interp, "(stream-append s (list))");
+  REQUIRE(sent.size() == 4);
+  REQUIRE(stream_id(evaluate_in(interp, "(stream-plot (list))")) != stream_id(plot));
+}
+
+TEST_CASE( "Test appending without a sink", "[stream_plot]" ) {
+
+  REQUIRE(StreamSink::current() == nullptr);
+
+  Interpreter interp;
+  Expression plot = evaluate_in(interp, "(define s (stream-plot (list)))");
+  REQUIRE(evaluate_in(interp, "(stream-append s (list (list 1 2)))") == plot);
+  REQUIRE(!is_stream_data(plot));
+  REQUIRE(!is_stream_plot(evaluate_in(interp, "(+ 1 2)")));
+}
+
+TEST_CASE( "Test errors of streaming plots", "[stream_plot]" ) {
+
+  Interpreter interp;
+  evaluate_in(interp, "(define s (stream-plot (list)))");
+
+  std::vector<std::string> programs = {
+    "(stream-plot 1)",
+    "(stream-plot s)",
+    "(stream-plot (list) (list))",
+    "(stream-plot (list (list \"colour\" \"red\")))",
+    "(stream-plot (list (list \"title\" 1)))",
+    "(stream-append 1 (list (list 1 2)))",
+    "(stream-append s)",
+    "(stream-append s (list 1 2))",
+    "(stream-append s (list (list 1 I)))",
+    "(stream-append s (set-property \"layout\" \"columns\" (list (list 1) (list 1 2))))",
+  };
+  for(auto s : programs){
+    INFO(s);
+    REQUIRE_THROWS_AS(evaluate_in(interp, s), SemanticError);
+  }
+}
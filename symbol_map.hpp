@@ -0,0 +1,174 @@
+/*! \file symbol_map.hpp
+Defines the hash table keyed by interned symbols that holds the bindings of
+an environment frame.
+
+The table uses open addressing with linear probing over a power-of-two
+number of slots, so a lookup hashes the small integer identifier of the
+symbol and compares identifiers, never names. Bindings are never removed,
+only overwritten, so the table needs no tombstones.
+
+A lookup may be given a SlotHint, the slot where the symbol was found the
+last time. The hint is only a guess: it is checked against the key in the
+slot before it is used, so a stale hint, or one found in another table,
+costs one comparison before the table is probed as usual.
+ */
+#ifndef SYMBOL_MAP_HPP
+#define SYMBOL_MAP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "symbol_table.hpp"
+
+/*! \class SlotHint
+\brief The slot a symbol was last found in, cached by the expression that
+       looks it up.
+
+The expressions of a program may be evaluated by several threads at once,
+as by pmap, so the hint is read and written atomically, without ordering.
+*/
+class SlotHint {
+public:
+  SlotHint() noexcept: slot(0) {}
+  SlotHint(const SlotHint & other) noexcept: slot(other.get()) {}
+  SlotHint & operator=(const SlotHint & other) noexcept {
+    set(other.get());
+    return *this;
+  }
+
+  std::uint32_t get() const noexcept { return slot.load(std::memory_order_relaxed); }
+  void set(std::uint32_t value) noexcept { slot.store(value, std::memory_order_relaxed); }
+
+private:
+  std::atomic<std::uint32_t> slot;
+};
+
+/*! \class SymbolMap
+\brief An open-addressing hash table from SymbolId to V.
+
+NoSymbol marks the empty slots, so it is never a key.
+*/
+template <class V>
+class SymbolMap {
+public:
+
+  /// A key and its value, the key NoSymbol marking an empty slot
+  struct Slot {
+    SymbolId key = NoSymbol;
+    V value;
+  };
+
+  /// Iterates over the occupied slots, in no particular order
+  class const_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Slot value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Slot * pointer;
+    typedef const Slot & reference;
+
+    const_iterator(const Slot * slot, const Slot * end) noexcept: slot(slot), end(end) { skip(); }
+    reference operator*() const noexcept { return *slot; }
+    pointer operator->() const noexcept { return slot; }
+    const_iterator & operator++() noexcept { ++slot; skip(); return *this; }
+    bool operator==(const const_iterator & other) const noexcept { return slot == other.slot; }
+    bool operator!=(const const_iterator & other) const noexcept { return slot != other.slot; }
+
+  private:
+    void skip() noexcept { while(slot != end && slot->key == NoSymbol) ++slot; }
+    const Slot * slot;
+    const Slot * end;
+  };
+
+  /// Construct an empty table, which allocates no slots until the first insertion
+  SymbolMap() noexcept: count(0) {}
+
+  std::size_t size() const noexcept { return count; }
+  bool empty() const noexcept { return count == 0; }
+
+  const_iterator begin() const noexcept {
+    return const_iterator(slots.data(), slots.data() + slots.size());
+  }
+  const_iterator end() const noexcept {
+    return const_iterator(slots.data() + slots.size(), slots.data() + slots.size());
+  }
+
+  /// return the value of key, or nullptr if the table has none
+  const V * find(SymbolId key) const noexcept {
+    std::size_t slot = probe(key);
+    return slots.empty() || slots[slot].key != key ? nullptr : &slots[slot].value;
+  }
+
+  /// find, trying the slot in hint first and leaving it where key was found
+  const V * find(SymbolId key, SlotHint & hint) const noexcept {
+    if(slots.empty()){
+      return nullptr;
+    }
+    std::size_t guess = hint.get() & (slots.size() - 1);
+    if(slots[guess].key == key){
+      return &slots[guess].value;
+    }
+    std::size_t slot = probe(key);
+    if(slots[slot].key != key){
+      return nullptr;
+    }
+    hint.set(static_cast<std::uint32_t>(slot));
+    return &slots[slot].value;
+  }
+
+  /// return the value of key, inserting a default value if the table has none
+  V & operator[](SymbolId key) {
+    std::size_t slot = probe(key);
+    if(!slots.empty() && slots[slot].key == key){
+      return slots[slot].value;
+    }
+    // at most half of the slots are used, so every probe ends at an empty one
+    if(2 * (count + 1) > slots.size()){
+      grow();
+      slot = probe(key);
+    }
+    slots[slot].key = key;
+    ++count;
+    return slots[slot].value;
+  }
+
+private:
+  std::vector<Slot> slots;
+  std::size_t count;
+
+  // a frame of a lambda binds a few parameters, so tables start small
+  static const std::size_t MIN_SLOTS = 8;
+
+  // the slot holding key, or the empty slot ending its probe sequence
+  std::size_t probe(SymbolId key) const noexcept {
+    if(slots.empty()){
+      return 0;
+    }
+    std::size_t mask = slots.size() - 1;
+    // multiplying by an odd constant spreads the consecutive identifiers
+    // handed out by interning over the slots
+    std::size_t slot = static_cast<std::uint32_t>(key * 2654435769u) & mask;
+    while(slots[slot].key != key && slots[slot].key != NoSymbol){
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  void grow() {
+    std::vector<Slot> old(slots.empty() ? std::size_t(MIN_SLOTS) : 2 * slots.size());
+    old.swap(slots);
+    for(Slot & slot : old){
+      if(slot.key != NoSymbol){
+        Slot & moved = slots[probe(slot.key)];
+        moved.key = slot.key;
+        moved.value = std::move(slot.value);
+      }
+    }
+  }
+};
+
+#endif
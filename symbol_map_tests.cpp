@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include <set>
+
+#include "symbol_map.hpp"
+
+TEST_CASE( "Test symbol map insertion and lookup", "[symbol_map]" ) {
+
+  SymbolMap<int> map;
+  REQUIRE(map.empty());
+  REQUIRE(map.find(SymbolTable::intern("unbound")) == nullptr);
+  REQUIRE(map.begin() == map.end());
+
+  SymbolId a = SymbolTable::intern("symbol-map-a");
+  SymbolId b = SymbolTable::intern("symbol-map-b");
+  map[a] = 1;
+  map[b] = 2;
+  REQUIRE(map.size() == 2);
+  REQUIRE(*map.find(a) == 1);
+  REQUIRE(*map.find(b) == 2);
+
+  // assigning again overwrites, rather than adding a second entry
+  map[a] = 3;
+  REQUIRE(map.size() == 2);
+  REQUIRE(*map.find(a) == 3);
+}
+
+TEST_CASE( "Test symbol map growth", "[symbol_map]" ) {
+
+  SymbolMap<std::size_t> map;
+  std::vector<SymbolId> keys;
+  for(std::size_t i = 0; i < 1000; ++i){
+    keys.push_back(SymbolTable::intern("symbol-map-" + std::to_string(i)));
+    map[keys.back()] = i;
+  }
+
+  REQUIRE(map.size() == 1000);
+  for(std::size_t i = 0; i < keys.size(); ++i){
+    REQUIRE(map.find(keys[i]) != nullptr);
+    REQUIRE(*map.find(keys[i]) == i);
+  }
+
+  // every entry is visited once
+  std::set<SymbolId> visited;
+  for(const auto & slot : map){
+    REQUIRE(*map.find(slot.key) == slot.value);
+    visited.insert(slot.key);
+  }
+  REQUIRE(visited.size() == 1000);
+}
+
+TEST_CASE( "Test symbol map slot hints", "[symbol_map]" ) {
+
+  SymbolMap<int> map;
+  SymbolId a = SymbolTable::intern("symbol-map-hinted");
+  SymbolId b = SymbolTable::intern("symbol-map-other");
+  map[a] = 1;
+  map[b] = 2;
+
+  SlotHint hint;
+  REQUIRE(*map.find(a, hint) == 1);
+  std::uint32_t slot = hint.get();
+  REQUIRE(*map.find(a, hint) == 1);
+  REQUIRE(hint.get() == slot);
+
+  // a hint left by another key is checked before it is used
+  REQUIRE(*map.find(b, hint) == 2);
+  REQUIRE(hint.get() != slot);
+  REQUIRE(map.find(SymbolTable::intern("symbol-map-missing"), hint) == nullptr);
+
+  // a stale hint still finds the key after the slots are rehashed
+  SlotHint copy(hint);
+  for(int i = 0; i < 100; ++i){
+    map[SymbolTable::intern("symbol-map-filler-" + std::to_string(i))] = i;
+  }
+  REQUIRE(*map.find(b, copy) == 2);
+}
@@ -0,0 +1,68 @@
+#include "symbol_table.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+// the names of the special forms, in SpecialForm order
+const char * const SPECIAL_FORM_NAMES[NumSpecialForms] = {
+  "begin", "define", "lambda", "list", "apply", "map",
+  "set-property", "get-property", "discrete-plot", "continuous-plot",
+  "pmap",
+  // no program can write a name holding parentheses, only the optimizer
+  "(constant)"
+};
+
+struct Table {
+  std::mutex mutex;
+  std::unordered_map<std::string, SymbolId> ids;
+  // deque keeps references to the names stable as the table grows
+  std::deque<std::string> names;
+
+  Table(){
+    for(SymbolId id = 0; id < NumSpecialForms; ++id){
+      names.emplace_back(SPECIAL_FORM_NAMES[id]);
+      ids.emplace(names.back(), id);
+    }
+  }
+};
+
+Table & table(){
+  static Table instance;
+  return instance;
+}
+
+}
+
+SymbolId SymbolTable::intern(const std::string & name){
+
+  const std::string * stored;
+  return intern(name, stored);
+}
+
+SymbolId SymbolTable::intern(const std::string & name, const std::string * & stored){
+
+  Table & t = table();
+  std::lock_guard<std::mutex> lock(t.mutex);
+
+  auto found = t.ids.find(name);
+  if(found != t.ids.end()){
+    stored = &t.names[found->second];
+    return found->second;
+  }
+
+  SymbolId id = static_cast<SymbolId>(t.names.size());
+  t.names.push_back(name);
+  t.ids.emplace(name, id);
+  stored = &t.names.back();
+  return id;
+}
+
+const std::string & SymbolTable::name(SymbolId id){
+
+  Table & t = table();
+  std::lock_guard<std::mutex> lock(t.mutex);
+  return t.names.at(id);
+}
@@ -0,0 +1,75 @@
+/*! \file symbol_table.hpp
+Defines the process-wide table of interned symbol names.
+
+Every symbol seen by the tokenizer is interned exactly once and from then on
+is identified by a small integer. The names of the special forms are
+reserved in a fixed order so that their identifiers double as the opcode
+used by Expression::eval to dispatch them.
+ */
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <string>
+
+/*! \typedef SymbolId
+\brief The identifier of an interned symbol name.
+*/
+typedef std::uint32_t SymbolId;
+
+/*! \enum SpecialForm
+\brief Opcodes of the special forms.
+
+The value of each opcode is also the SymbolId of its name, so resolving the
+special form of a symbol is a single comparison.
+*/
+enum SpecialForm : SymbolId {
+  BeginForm,          //< begin
+  DefineForm,         //< define
+  LambdaForm,         //< lambda
+  ListForm,           //< list
+  ApplyForm,          //< apply
+  MapForm,            //< map
+  SetPropertyForm,    //< set-property
+  GetPropertyForm,    //< get-property
+  DiscretePlotForm,   //< discrete-plot
+  ContinuousPlotForm, //< continuous-plot
+  PMapForm,           //< pmap
+  ConstantForm,       //< a value folded by the optimizer (see constant_folding.hpp)
+  NumSpecialForms,    //< number of reserved symbol ids
+  NotSpecialForm = NumSpecialForms
+};
+
+/// identifier used by atoms that do not name an interned symbol
+const SymbolId NoSymbol = UINT32_MAX;
+
+/*! \class SymbolTable
+\brief Thread-safe table mapping symbol names to identifiers and back.
+
+Identifiers are never recycled, so they stay valid for the lifetime of the
+process and may be freely shared between interpreters and threads.
+*/
+class SymbolTable {
+public:
+
+  /*! Intern a symbol name.
+    \param name the symbol text
+    \return the identifier of name, creating it on first use
+   */
+  static SymbolId intern(const std::string & name);
+
+  /*! Intern a symbol name, also returning the name kept by the table.
+    \param name the symbol text
+    \param stored set to the copy of name in the table, which is never moved
+    \return the identifier of name, creating it on first use
+   */
+  static SymbolId intern(const std::string & name, const std::string * & stored);
+
+  /*! Lookup the name of an interned symbol.
+    \param id an identifier previously returned by intern
+    \return the symbol text
+   */
+  static const std::string & name(SymbolId id);
+};
+
+#endif
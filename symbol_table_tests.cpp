@@ -0,0 +1,30 @@
+#include "catch.hpp"
+
+#include "symbol_table.hpp"
+#include "atom.hpp"
+
+TEST_CASE( "Test symbol interning", "[symbol_table]" ) {
+
+  SymbolId a = SymbolTable::intern("interned-symbol");
+  SymbolId b = SymbolTable::intern("interned-symbol");
+  SymbolId c = SymbolTable::intern("another-symbol");
+
+  REQUIRE(a == b);
+  REQUIRE(a != c);
+  REQUIRE(SymbolTable::name(a) == "interned-symbol");
+  REQUIRE(SymbolTable::name(c) == "another-symbol");
+}
+
+TEST_CASE( "Test special forms are reserved", "[symbol_table]" ) {
+
+  REQUIRE(SymbolTable::intern("begin") == BeginForm);
+  REQUIRE(SymbolTable::intern("define") == DefineForm);
+  REQUIRE(SymbolTable::intern("continuous-plot") == ContinuousPlotForm);
+  REQUIRE(SymbolTable::intern("+") >= NumSpecialForms);
+
+  REQUIRE(Atom("lambda").specialForm() == LambdaForm);
+  REQUIRE(Atom(Token("set-property")).specialForm() == SetPropertyForm);
+  REQUIRE(Atom("sqrt").specialForm() == NotSpecialForm);
+  REQUIRE(Atom("\"map\"").specialForm() == NotSpecialForm);
+  REQUIRE(Atom(1.0).specialForm() == NotSpecialForm);
+}
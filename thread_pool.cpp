@@ -0,0 +1,185 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <limits>
+
+#include "TSmessage.hpp"
+
+namespace {
+
+// the pool and queue of the current thread when it is a worker
+thread_local const ThreadPool * current_pool = nullptr;
+thread_local std::size_t current_queue = 0;
+
+}
+
+ThreadPool::ThreadPool(std::size_t count): queued(0), stopping(false){
+
+  for(std::size_t i = 0; i <= count; ++i){
+    queues.emplace_back(new Queue);
+  }
+  for(std::size_t i = 0; i < count; ++i){
+    threads.emplace_back(&ThreadPool::worker, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool(){
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for(auto & t : threads){
+    t.join();
+  }
+}
+
+ThreadPool & ThreadPool::shared(){
+
+  // the thread waiting on a parallel loop works too, so leave it a core
+  static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+std::size_t ThreadPool::size() const noexcept{
+  return threads.size();
+}
+
+std::size_t ThreadPool::local_queue() const{
+  return current_pool == this ? current_queue : threads.size();
+}
+
+void ThreadPool::submit(Task task){
+
+  // count the task before it becomes visible, so the count never underflows
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    ++queued;
+  }
+  Queue & q = *queues[local_queue()];
+  {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(std::move(task));
+  }
+  wake.notify_one();
+}
+
+bool ThreadPool::try_pop(std::size_t index, Task & task){
+
+  // newest first from our own queue, it is the most likely to be in cache
+  {
+    Queue & own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if(!own.tasks.empty()){
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued;
+      return true;
+    }
+  }
+
+  // oldest first from everyone else, it is the most likely to be large
+  for(std::size_t i = 1; i < queues.size(); ++i){
+    Queue & victim = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if(!victim.tasks.empty()){
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::worker(std::size_t index){
+
+  current_pool = this;
+  current_queue = index;
+
+  Task task;
+  while(true){
+    if(try_pop(index, task)){
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    wake.wait(lock, [this](){ return stopping || queued > 0; });
+    if(stopping && queued == 0){
+      return;
+    }
+  }
+}
+
+void ThreadPool::parallel_for(std::size_t n, std::size_t grain,
+                              const std::function<void(std::size_t, std::size_t)> & body){
+
+  if(n == 0){
+    return;
+  }
+  grain = std::max<std::size_t>(grain, 1);
+  std::size_t ranges = (n + grain - 1) / grain;
+
+  // a single range, or no workers, gains nothing from going through the queues
+  if(ranges == 1 || threads.empty()){
+    body(0, n);
+    return;
+  }
+
+  struct Loop {
+    std::atomic<std::size_t> remaining;
+    std::atomic<std::size_t> failed;
+    std::mutex mutex;
+    std::exception_ptr error;
+    // signalled by the range that finishes last
+    TSmessage<bool> finished;
+  };
+  auto loop = std::make_shared<Loop>();
+  loop->remaining = ranges;
+  loop->failed = std::numeric_limits<std::size_t>::max();
+
+  for(std::size_t r = 0; r < ranges; ++r){
+    submit([loop, r, n, grain, &body](){
+      // ranges past a known failure cannot change the outcome
+      if(r < loop->failed){
+        try{
+          body(r * grain, std::min(n, (r + 1) * grain));
+        }
+        catch(...){
+          std::lock_guard<std::mutex> lock(loop->mutex);
+          if(r < loop->failed){
+            loop->failed = r;
+            loop->error = std::current_exception();
+          }
+        }
+      }
+      if(--loop->remaining == 0){
+        loop->finished.push(true);
+      }
+    });
+  }
+
+  // help rather than block, the tasks we wait on may be queued behind us;
+  // with nothing to run, sleep until the last range finishes, waking now and
+  // then to help with tasks a nested loop may have queued since
+  std::size_t index = local_queue();
+  Task task;
+  bool done = false;
+  while(loop->remaining > 0){
+    if(try_pop(index, task)){
+      task();
+      task = nullptr;
+    }
+    else{
+      loop->finished.wait_and_pop(done, std::chrono::milliseconds(1));
+    }
+  }
+
+  if(loop->error){
+    std::rethrow_exception(loop->error);
+  }
+}
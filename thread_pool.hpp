@@ -0,0 +1,86 @@
+/*! \file thread_pool.hpp
+Defines the work-stealing thread pool shared by the parallel special forms.
+
+Each worker owns a deque of tasks. A worker takes its newest task first and,
+when its own deque is empty, steals the oldest task of another worker. A
+thread waiting on a parallel loop helps run queued tasks instead of
+blocking, so parallel loops may be nested without starving the pool.
+ */
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! \class ThreadPool
+\brief A fixed set of worker threads with per-worker work-stealing queues.
+*/
+class ThreadPool {
+public:
+
+  typedef std::function<void()> Task;
+
+  /// Construct a pool with the given number of worker threads (may be 0)
+  explicit ThreadPool(std::size_t threads);
+
+  /// Finish the queued tasks and join the workers
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  /// return the pool shared by the interpreter, sized to the hardware
+  static ThreadPool & shared();
+
+  /// return the number of worker threads
+  std::size_t size() const noexcept;
+
+  /// queue a task to be run by some worker
+  void submit(Task task);
+
+  /*! Run body over [0,n) split into ranges of at most grain items, using the
+    workers and the calling thread, and return when every range is done.
+
+    If a range throws, ranges after it that have not started are skipped and
+    the exception of the lowest throwing range is rethrown, so the error
+    seen is the one a serial loop would have seen first.
+    \param n the number of items
+    \param grain the maximum number of items per range
+    \param body called with the [begin,end) of each range
+   */
+  void parallel_for(std::size_t n, std::size_t grain,
+                    const std::function<void(std::size_t, std::size_t)> & body);
+
+private:
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void worker(std::size_t index);
+
+  /// pop a task from queue index, else steal one from another queue
+  bool try_pop(std::size_t index, Task & task);
+
+  /// return the queue of the calling thread, the shared one outside the pool
+  std::size_t local_queue() const;
+
+  // one queue per worker plus one for threads outside the pool
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> threads;
+
+  std::mutex sleep_mutex;
+  std::condition_variable wake;
+  std::atomic<std::size_t> queued;
+  bool stopping;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+TEST_CASE( "Test ThreadPool parallel_for covers every item once", "[ThreadPool]" ) {
+
+  ThreadPool pool(3);
+  std::vector<int> hits(1000, 0);
+
+  pool.parallel_for(hits.size(), 7, [&](std::size_t begin, std::size_t end){
+    for(std::size_t i = begin; i < end; ++i) ++hits[i];
+  });
+
+  for(auto h : hits){
+    REQUIRE(h == 1);
+  }
+}
+
+TEST_CASE( "Test ThreadPool nested parallel_for", "[ThreadPool]" ) {
+
+  ThreadPool pool(2);
+  std::atomic<int> total(0);
+
+  pool.parallel_for(8, 1, [&](std::size_t, std::size_t){
+    pool.parallel_for(8, 1, [&](std::size_t, std::size_t){ ++total; });
+  });
+
+  REQUIRE(total == 64);
+}
+
+TEST_CASE( "Test ThreadPool parallel_for rethrows the lowest error", "[ThreadPool]" ) {
+
+  ThreadPool pool(4);
+
+  for(int trial = 0; trial < 20; ++trial){
+    std::string message;
+    try{
+      pool.parallel_for(64, 1, [](std::size_t begin, std::size_t){
+        if(begin >= 3) throw std::runtime_error(std::to_string(begin));
+      });
+    }
+    catch(std::runtime_error & ex){
+      message = ex.what();
+    }
+    REQUIRE(message == "3");
+  }
+}
+
+TEST_CASE( "Test ThreadPool without workers", "[ThreadPool]" ) {
+
+  ThreadPool pool(0);
+  REQUIRE(pool.size() == 0);
+
+  int sum = 0;
+  pool.parallel_for(10, 3, [&](std::size_t begin, std::size_t end){
+    for(std::size_t i = begin; i < end; ++i) sum += i;
+  });
+  REQUIRE(sum == 45);
+}
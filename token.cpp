@@ -1,17 +1,17 @@
 #include "token.hpp"
 
-// define constants for special characters
-const char OPENCHAR = '(';
-const char CLOSECHAR = ')';
-const char COMMENTCHAR = ';';
-const char QUOTECHAR = '"';
+#include "lexer.hpp"
 
 Token::Token(TokenType t): m_type(t){}
 
-Token::Token(const std::string & str): value(str), m_type(STRING) {
+Token::Token(const std::string & str): m_type(STRING), value(str) {
 
 }
 
+Token::Token(const char * data, std::size_t size):
+  m_type(STRING), m_view(data), m_view_size(size)
+{}
+
 Token::TokenType Token::type() const{
   return m_type;
 }
@@ -23,63 +23,55 @@ std::string Token::asString() const{
       return "(";
     case CLOSE:
       return ")";
+    default:
+      break;
     }
-    return value;
+    return m_view ? std::string(m_view, m_view_size) : value;
 }
 
+const char * Token::data() const noexcept{
+  switch(m_type){
+    case OPEN:
+      return "(";
+    case CLOSE:
+      return ")";
+    default:
+      break;
+    }
+    return m_view ? m_view : value.data();
+}
 
-// add token to sequence unless it is empty, clears token
-void store_ifnot_empty(std::string & token, TokenSequenceType & seq){
-  if(!token.empty()){
-    seq.emplace_back(token);
-    token.clear();
+std::size_t Token::size() const noexcept{
+  if(m_type != STRING){
+    return 1;
   }
+  return m_view ? m_view_size : value.size();
 }
 
 TokenSequenceType tokenize(std::istream & seq){
+
+  StreamSource source(seq);
+  Lexer<StreamSource> lexer(source);
+
   TokenSequenceType tokens;
-  std::string token;
-
-  while(true){
-    char c = seq.get();
-    if(seq.eof()) break;
-
-    if(c == COMMENTCHAR){
-      // chomp until the end of the line
-      while((!seq.eof()) && (c != '\n')){
-	      c = seq.get();
-      }
-      if(seq.eof()) break;
-    }
-    else if(c == OPENCHAR){ // c == (
-      store_ifnot_empty(token, tokens);
-      tokens.push_back(Token::TokenType::OPEN);
-    }
-    else if(c == CLOSECHAR){ // c == )
-      store_ifnot_empty(token, tokens);
-      tokens.push_back(Token::TokenType::CLOSE);
-    }
-    else if(c == QUOTECHAR){ // c == " (BEGIN SPECIAL CASE)
-      token.push_back(QUOTECHAR);
-      c = seq.get();
-      while(!seq.eof() && c != QUOTECHAR){
-	      token.push_back(c);
-        c = seq.get();
-      }
-      if(seq.eof()) {
-        break;
-      }
-      token.push_back(QUOTECHAR); // push last ending quote
-      store_ifnot_empty(token, tokens);
-    }
-    else if(isspace(c)){ // c == ' '
-      store_ifnot_empty(token, tokens);
-    }
-    else{ // c == any other character
-      token.push_back(c);
-    }
+  Token token(Token::OPEN);
+  std::size_t at;
+  while(lexer.next(token, at)){
+    tokens.push_back(token);
   }
-  store_ifnot_empty(token, tokens);
+  return tokens;
+}
 
+TokenSequenceType tokenize(const char * begin, const char * end){
+
+  BufferSource source(begin, end);
+  Lexer<BufferSource> lexer(source);
+
+  TokenSequenceType tokens;
+  Token token(Token::OPEN);
+  std::size_t at;
+  while(lexer.next(token, at)){
+    tokens.push_back(token);
+  }
   return tokens;
-}
\ No newline at end of file
+}
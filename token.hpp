@@ -4,14 +4,18 @@ Defines the Token and TokenSequence types, and associated functions.
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
+#include <cstddef>
 #include <deque>
 #include <istream>
+#include <string>
 #include <future>
 
 /*! \class Token
   \brief Value class representing a token.
 
-  A token is a composition of a tag type and an optional string value.
+  A token is a composition of a tag type and an optional string value. The
+  value is either owned by the token or a view of the buffer the token was
+  read from, in which case the buffer must outlive the token.
 */
 class Token {
 public:
@@ -30,15 +34,28 @@ public:
   /// contruct a token of type String with value
   Token(const std::string & str);
 
+  /// construct a token of type String viewing size characters at data
+  Token(const char * data, std::size_t size);
+
   /// return the type of the token
   TokenType type() const;
 
   /// return the token rendered as a string
   std::string asString() const;
 
+  /// return the first character of the token text, valid while the token is
+  const char * data() const noexcept;
+
+  /// return the number of characters in the token text
+  std::size_t size() const noexcept;
+
 private:
   TokenType m_type;
   std::string value;
+
+  // the viewed text, or nullptr when the text is owned in value
+  const char * m_view = nullptr;
+  std::size_t m_view_size = 0;
 };
 
 /*! \typedef TokenSequenceType
@@ -60,4 +77,16 @@ Ignores any whitespace and comments (from any ";" to end-of-line).
 */
 TokenSequenceType tokenize(std::istream & seq);
 
+/*! \fn TokenSequenceType tokenize(const char * begin, const char * end)
+\brief Split a contiguous buffer into a sequence of tokens
+
+\param begin the first character of the input
+\param end one past the last character of the input
+\return The sequence of tokens, which view the buffer and must not outlive it
+
+Splits the input exactly as tokenize(std::istream &) does, without copying
+the text of the tokens.
+*/
+TokenSequenceType tokenize(const char * begin, const char * end);
+
 #endif
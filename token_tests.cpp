@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include "token.hpp"
+#include <sstream>
 
 TEST_CASE( "Test Token creation", "[token]" ) {
 
@@ -78,3 +79,28 @@ TEST_CASE( "Test tokenize", "[token]" ) {
   REQUIRE(tokens.empty());
 }
 
+
+TEST_CASE( "Test tokenize buffer", "[token]" ) {
+  std::string input = "(define s \"a (quoted) string\") ab;comment\ncd 12 \"open";
+
+  TokenSequenceType tokens = tokenize(input.data(), input.data() + input.size());
+
+  std::istringstream iss(input);
+  TokenSequenceType streamed = tokenize(iss);
+
+  REQUIRE(tokens.size() == streamed.size());
+  for(std::size_t i = 0; i < tokens.size(); ++i){
+    REQUIRE(tokens[i].type() == streamed[i].type());
+    REQUIRE(tokens[i].asString() == streamed[i].asString());
+  }
+
+  REQUIRE(tokens.size() == 8);
+  REQUIRE(tokens[3].asString() == "\"a (quoted) string\"");
+  // a comment directly after a token does not end it
+  REQUIRE(tokens[5].asString() == "abcd");
+  REQUIRE(tokens[7].asString() == "\"open");
+
+  // plain tokens are views of the buffer
+  REQUIRE(tokens[1].data() == input.data() + 1);
+  REQUIRE(tokens[1].size() == 6);
+}
@@ -0,0 +1,501 @@
+#include "vm.hpp"
+
+#include <complex>
+#include <iterator>
+#include <new>
+
+#include "cancellation.hpp"
+#include "numeric_list.hpp"
+#include "profiler.hpp"
+#include "semantic_error.hpp"
+
+namespace {
+
+// predicate, e is a real number without properties, which a Value holds unboxed
+bool plain_number(const Expression & e){
+  return e.isNone() && e.head().isNumber() && !e.hasProperties();
+}
+
+}
+
+VirtualMachine::Value::Value(const Expression & e): boxed(!plain_number(e)){
+  if(boxed) new (&exp) Expression(e);
+  else number = e.head().asNumber();
+}
+
+VirtualMachine::Value::Value(Expression && e): boxed(!plain_number(e)){
+  if(boxed) new (&exp) Expression(std::move(e));
+  else number = e.head().asNumber();
+}
+
+VirtualMachine::Value::Value(const Value & v): boxed(v.boxed){
+  if(boxed) new (&exp) Expression(v.exp);
+  else number = v.number;
+}
+
+VirtualMachine::Value::Value(Value && v) noexcept: boxed(v.boxed){
+  if(boxed) new (&exp) Expression(std::move(v.exp));
+  else number = v.number;
+}
+
+VirtualMachine::Value & VirtualMachine::Value::operator=(const Value & v){
+
+  if(this == &v){
+    return *this;
+  }
+  if(boxed && v.boxed){
+    exp = v.exp;
+    return *this;
+  }
+  if(boxed){
+    exp.~Expression();
+    boxed = false;
+  }
+  if(v.boxed){
+    new (&exp) Expression(v.exp);
+    boxed = true;
+  }
+  else{
+    number = v.number;
+  }
+  return *this;
+}
+
+VirtualMachine::Value & VirtualMachine::Value::operator=(Value && v) noexcept{
+
+  if(this == &v){
+    return *this;
+  }
+  if(boxed && v.boxed){
+    exp = std::move(v.exp);
+    return *this;
+  }
+  if(boxed){
+    exp.~Expression();
+    boxed = false;
+  }
+  if(v.boxed){
+    new (&exp) Expression(std::move(v.exp));
+    boxed = true;
+  }
+  else{
+    number = v.number;
+  }
+  return *this;
+}
+
+VirtualMachine::Value::~Value(){
+  if(boxed) exp.~Expression();
+}
+
+Expression VirtualMachine::Value::expression() const{
+  return boxed ? exp : Expression(Atom(number));
+}
+
+Expression VirtualMachine::Value::release(){
+  return boxed ? std::move(exp) : Expression(Atom(number));
+}
+
+Expression VirtualMachine::run(const Chunk & program, Environment & top){
+
+  env = &top;
+  try{
+    Value result = execute(program, 0);
+    stack.clear();
+    return result.release();
+  }
+  catch(...){
+    stack.clear();
+    frames.clear();
+    shadowing = 0;
+    throw;
+  }
+}
+
+const VirtualMachine::Value * VirtualMachine::find_local(const Atom & sym) const{
+
+  SymbolId id = sym.symbolId();
+  if(id == NoSymbol) return nullptr;
+
+  for(auto f = frames.rbegin(); f != frames.rend(); ++f){
+    const std::vector<Atom> & params = f->chunk->params;
+    for(std::size_t i = params.size(); i > 0; --i){
+      if(params[i - 1].symbolId() == id) return &stack[f->base + i - 1];
+    }
+    for(auto & local : f->locals){
+      if(local.first.symbolId() == id) return &local.second;
+    }
+  }
+  return nullptr;
+}
+
+bool VirtualMachine::is_lambda(const Atom & sym) const{
+
+  const Value * local = find_local(sym);
+  return local ? local->isLambda() : env->get_exp(sym).isLambda();
+}
+
+bool VirtualMachine::is_proc(const Atom & sym) const{
+
+  // frames only ever bind expressions, which hide procedures
+  return find_local(sym) == nullptr && env->is_proc(sym);
+}
+
+const Environment & VirtualMachine::materialize(std::size_t count){
+
+  if(count == 0){
+    return *env;
+  }
+
+  Frame & f = frames[count - 1];
+  if(!f.snapshot){
+    f.snapshot = std::make_shared<Environment>(&materialize(count - 1));
+    for(std::size_t i = 0; i < f.chunk->params.size(); ++i){
+      f.snapshot->__shadowing_helper(f.chunk->params[i], stack[f.base + i].expression());
+    }
+    for(auto & local : f.locals){
+      f.snapshot->add_exp(local.first, local.second.expression());
+    }
+  }
+  return *f.snapshot;
+}
+
+std::shared_ptr<const Chunk> VirtualMachine::compiled(const Expression & lambda){
+
+  const Expression * body = &lambda.contents().back();
+  auto found = lambdas.find(body);
+  if(found != lambdas.end()){
+    return found->second.second;
+  }
+
+  // a lambda made in this evaluation may not outlive it, so it is compiled
+  // for each call; any other is compiled once, outside of the arena
+  Arena * arena = Arena::current();
+  if(arena && lambda.inArena(*arena)){
+    return compile_lambda(lambda, *env);
+  }
+
+  ArenaScope suspend(nullptr);
+  std::shared_ptr<const Chunk> chunk = compile_lambda(lambda, *env);
+  lambdas.emplace(body, std::make_pair(lambda, chunk));
+  return chunk;
+}
+
+void VirtualMachine::push_frame(const Chunk * chunk, std::size_t base){
+
+  frames.push_back(Frame{chunk, base, {}, nullptr});
+  if(chunk->shadows_procs) ++shadowing;
+}
+
+void VirtualMachine::pop_frame(){
+
+  if(frames.back().chunk->shadows_procs) --shadowing;
+  frames.pop_back();
+}
+
+void VirtualMachine::call_lambda(const Expression & lambda, std::size_t argc){
+
+  if(argc != lambda.contents().front().tailLength()){
+    throw SemanticError("Error: during apply: Error in call to procedure: invalid number of arguments.");
+  }
+  std::shared_ptr<const Chunk> body = compiled(lambda);
+  invoke(lambda, body.get(), argc);
+}
+
+void VirtualMachine::invoke(const Expression & lambda, const Chunk * body, std::size_t argc){
+
+  // lambda may be a binding the call redefines, or a slot of the stack it
+  // grows, so it is not used once the body runs
+  std::size_t base = stack.size() - argc;
+  Value result;
+
+  if(body){
+    push_frame(body, base);
+    result = execute(*body, base);
+    pop_frame();
+  }
+  else{
+    // the body needs the tree-walker, so give it the frames as Environments
+    Expression callee = lambda;
+    Environment inner_scope(&materialize(frames.size()));
+    std::size_t count = base;
+    const Expression & parameters = callee.contents().front();
+    for(auto p = parameters.tailConstBegin(); p != parameters.tailConstEnd(); ++p){
+      inner_scope.__shadowing_helper(p->head(), stack[count++].expression());
+    }
+    result = Value(callee.contents().back().eval(inner_scope));
+  }
+
+  stack.resize(base);
+  stack.push_back(std::move(result));
+}
+
+const Expression * VirtualMachine::callee(const Chunk & chunk, std::uint32_t name) const{
+
+  const Atom & op = chunk.names[name];
+  Procedure proc = chunk.procs[name];
+
+  // a built-in is only looked for in the frames if a parameter may hide it
+  const Value * local = (proc == nullptr || shadowing > 0) ? find_local(op) : nullptr;
+
+  if(local == nullptr && proc != nullptr){
+    return nullptr;
+  }
+  if(local != nullptr){
+    if(local->isLambda()) return &local->boxedExpression();
+  }
+  else{
+    const Environment::EnvResult * binding = env->lookup(op, chunk.hints[name]);
+    if(binding != nullptr && binding->type == Environment::ExpressionType && binding->exp.isLambda()){
+      return &binding->exp;
+    }
+  }
+  throw SemanticError("Error during evaluation: symbol does not name a procedure");
+}
+
+void VirtualMachine::call(const Chunk & chunk, std::uint32_t name, std::size_t argc){
+
+  check_interrupt();
+
+  const Expression * lambda = callee(chunk, name);
+  if(lambda != nullptr){
+    ProfileFrame frame(Profiler::LambdaKind, chunk.names[name]);
+    call_lambda(*lambda, argc);
+    return;
+  }
+
+  std::vector<Expression> args;
+  args.reserve(argc);
+  for(auto v = stack.end() - argc; v != stack.end(); ++v){
+    args.push_back(v->release());
+  }
+  stack.resize(stack.size() - argc);
+  ProfileFrame frame(Profiler::ProcedureKind, chunk.names[name]);
+  stack.push_back(Value(chunk.procs[name](args)));
+}
+
+bool VirtualMachine::arithmetic(OpCode op, std::size_t argc){
+
+  check_interrupt();
+
+  // a profile counts every call of a procedure, so make them all
+  if(shadowing > 0 || Profiler::current() != nullptr){
+    return false;
+  }
+  auto first = stack.end() - argc;
+  for(auto v = first; v != stack.end(); ++v){
+    if(!v->isNumber()) return false;
+  }
+
+  // each result is computed the way the procedure computes it
+  double result = 0;
+  switch(op){
+    case OpCode::Add:
+      for(auto v = first; v != stack.end(); ++v) result += v->asNumber();
+      break;
+    case OpCode::Mul:
+      result = 1;
+      for(auto v = first; v != stack.end(); ++v) result *= v->asNumber();
+      break;
+    case OpCode::Sub:
+      if(argc == 1) result = -first[0].asNumber();
+      else if(argc == 2) result = first[0].asNumber() - first[1].asNumber();
+      else return false;
+      break;
+    case OpCode::Div:{
+      // the procedure divides in the complex plane, which rounds differently
+      typedef std::complex<double> C;
+      if(argc == 1){
+        result = (C(1.0, 0) / C(first[0].asNumber())).real();
+      }
+      else if(argc == 2){
+        C quotient = C(first[0].asNumber()) * C(first[0].asNumber());
+        quotient /= first[0].asNumber();
+        quotient /= first[1].asNumber();
+        result = quotient.real();
+      }
+      else{
+        return false;
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+
+  stack.resize(stack.size() - argc);
+  stack.push_back(Value(result));
+  return true;
+}
+
+VirtualMachine::Value VirtualMachine::execute(const Chunk & chunk, std::size_t base){
+
+  for(const Instruction & in : chunk.code){
+    switch(in.op){
+      case OpCode::Const:
+        stack.push_back(Value(chunk.constants[in.a]));
+        break;
+      case OpCode::LoadLocal:{
+        Value value = stack[base + in.a];
+        stack.push_back(std::move(value));
+        break;
+      }
+      case OpCode::LoadName:{
+        const Atom & sym = chunk.names[in.a];
+        const Value * local = find_local(sym);
+        if(local){
+          Value value = *local;
+          stack.push_back(std::move(value));
+        }
+        else{
+          const Environment::EnvResult * binding = env->lookup(sym, chunk.hints[in.a]);
+          if(binding == nullptr || binding->type != Environment::ExpressionType){
+            throw SemanticError("Error during handle lookup: unknown symbol " + sym.asString());
+          }
+          stack.push_back(Value(binding->exp));
+        }
+        break;
+      }
+      case OpCode::Pop:
+        stack.pop_back();
+        break;
+      case OpCode::Throw:
+        throw SemanticError(chunk.messages[in.a]);
+      case OpCode::CheckDefine:
+        if(is_proc(chunk.names[in.a])){
+          throw SemanticError("Error during handle define: attempt to redefine a built-in procedure");
+        }
+        break;
+      case OpCode::DefineGlobal:
+        env->add_exp(chunk.names[in.a], stack.back().expression());
+        break;
+      case OpCode::DefineLocal:{
+        Frame & f = frames.back();
+        f.snapshot.reset();
+        if(in.b != NoSlot){
+          stack[base + in.b] = stack.back();
+          break;
+        }
+        const Atom & sym = chunk.names[in.a];
+        auto local = f.locals.begin();
+        while(local != f.locals.end() && local->first.symbolId() != sym.symbolId()) ++local;
+        if(local == f.locals.end()){
+          f.locals.emplace_back(sym, stack.back());
+        }
+        else{
+          local->second = stack.back();
+        }
+        break;
+      }
+      case OpCode::MakeList:{
+        std::vector<Expression> items;
+        items.reserve(in.b);
+        for(auto v = stack.end() - in.b; v != stack.end(); ++v){
+          items.push_back(v->release());
+        }
+        stack.resize(stack.size() - in.b);
+        stack.push_back(Value(Expression(std::move(items))));
+        break;
+      }
+      case OpCode::Call:
+        call(chunk, in.a, in.b);
+        break;
+      case OpCode::Add:
+      case OpCode::Sub:
+      case OpCode::Mul:
+      case OpCode::Div:
+        if(!arithmetic(in.op, in.b)){
+          call(chunk, in.a, in.b);
+        }
+        break;
+      case OpCode::CheckCallable:
+        if(!is_lambda(chunk.names[in.a]) && !is_proc(chunk.names[in.a])){
+          throw SemanticError(chunk.messages[in.b]);
+        }
+        break;
+      case OpCode::CheckLambda:
+        if(!is_lambda(chunk.names[in.a])){
+          throw SemanticError(chunk.messages[in.b]);
+        }
+        break;
+      case OpCode::Apply:{
+        Value arguments = std::move(stack.back());
+        stack.pop_back();
+        if(arguments.isNumber() || !arguments.boxedExpression().isList()){
+          throw SemanticError("Error: second argument to apply not a list");
+        }
+        const Expression & list = arguments.boxedExpression();
+        for(auto e = list.tailConstBegin(); e != list.tailConstEnd(); ++e){
+          stack.push_back(Value(*e));
+        }
+        call(chunk, in.a, list.tailLength());
+        break;
+      }
+      case OpCode::Map:{
+        Value argument = std::move(stack.back());
+        stack.pop_back();
+        if(argument.isNumber() || !argument.boxedExpression().isList()){
+          throw SemanticError("Error: second argument to apply not a list");
+        }
+        const Expression & list = argument.boxedExpression();
+        const NumericList * values = list.numericList();
+        const double * reals = (values && !values->isComplex()) ? values->real().data() : nullptr;
+        std::size_t n = list.tailLength();
+
+        // the name cannot be rebound while the map runs, so a lambda is
+        // resolved and compiled once
+        Expression lambda;
+        std::shared_ptr<const Chunk> body;
+        const Expression * target = n > 0 ? callee(chunk, in.a) : nullptr;
+        if(target != nullptr){
+          lambda = *target;
+          if(lambda.contents().front().tailLength() != 1){
+            throw SemanticError("Error: during apply: Error in call to procedure: invalid number of arguments.");
+          }
+          body = compiled(lambda);
+        }
+
+        // the results are packed as they come, for as long as they are real numbers
+        bool packed = n > 0;
+        std::vector<double> numbers;
+        std::vector<Expression> results;
+        numbers.reserve(n);
+        for(std::size_t i = 0; i < n; ++i){
+          if(reals) stack.push_back(Value(reals[i]));
+          else stack.push_back(Value(values ? values->at(i) : list.contents()[i]));
+          if(target != nullptr){
+            check_interrupt();
+            ProfileFrame frame(Profiler::LambdaKind, chunk.names[in.a]);
+            invoke(lambda, body.get(), 1);
+          }
+          else{
+            call(chunk, in.a, 1);
+          }
+          Value & result = stack.back();
+          if(packed && result.isNumber()){
+            numbers.push_back(result.asNumber());
+          }
+          else{
+            if(packed){
+              packed = false;
+              results.reserve(n);
+              for(double x : numbers) results.push_back(Expression(Atom(x)));
+            }
+            results.push_back(result.release());
+          }
+          stack.pop_back();
+        }
+        stack.push_back(Value(packed ? make_numeric_list(std::move(numbers)) : make_list(std::move(results))));
+        break;
+      }
+      case OpCode::Fallback:
+        // only emitted at the top level, where the environment is exact
+        stack.push_back(Value(chunk.constants[in.a].eval(*env)));
+        break;
+    }
+  }
+
+  Value result = std::move(stack.back());
+  stack.pop_back();
+  return result;
+}
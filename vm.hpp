@@ -0,0 +1,121 @@
+/*! \file vm.hpp
+Defines the stack virtual machine that runs compiled Chunks.
+ */
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "environment.hpp"
+#include "expression.hpp"
+
+/*! \class VirtualMachine
+\brief Runs compiled programs against an Environment.
+
+The arguments of a lambda call stay on the operand stack and become the
+stack slots of its frame, so calling a compiled lambda binds no names. Real
+numbers are held on the stack as they are rather than as Expressions, and
+the arithmetic instructions compute on them in place, so numeric code only
+makes an Expression of a number where one leaves the machine.
+Lookups of names that are not parameters follow the frames from the
+innermost call outward and then the environment, which is the dynamic
+scoping of the tree-walker. Lambda bodies are compiled on their first call
+and kept for the lifetime of the machine.
+*/
+class VirtualMachine {
+public:
+
+  /*! Run a compiled program at the top level of env.
+    \param program the program, compiled for env by compile_program
+    \param env the environment top level definitions are made in
+    \return the value of the program
+    \throws SemanticError as the tree-walker would
+   */
+  Expression run(const Chunk & program, Environment & env);
+
+private:
+
+  // a value on the operand stack: a real number, or any other Expression
+  class Value {
+  public:
+    Value() noexcept: boxed(false), number(0) {}
+    explicit Value(double x) noexcept: boxed(false), number(x) {}
+    // a plain real number is unboxed
+    explicit Value(const Expression & e);
+    explicit Value(Expression && e);
+    Value(const Value & v);
+    Value(Value && v) noexcept;
+    Value & operator=(const Value & v);
+    Value & operator=(Value && v) noexcept;
+    ~Value();
+
+    bool isNumber() const noexcept { return !boxed; }
+    double asNumber() const noexcept { return number; }
+    bool isLambda() const noexcept { return boxed && exp.isLambda(); }
+
+    // the boxed Expression, only valid when the value is not a number
+    const Expression & boxedExpression() const noexcept { return exp; }
+
+    // the value as an Expression, boxing a number
+    Expression expression() const;
+    Expression release();
+
+  private:
+    bool boxed;
+    union {
+      double number;
+      Expression exp;
+    };
+  };
+
+  struct Frame {
+    const Chunk * chunk;
+    std::size_t base;
+    // names defined by the body that are not parameters
+    std::vector<std::pair<Atom, Value>> locals;
+    // the frame as an Environment, built when the tree-walker needs it
+    std::shared_ptr<Environment> snapshot;
+  };
+
+  Value execute(const Chunk & chunk, std::size_t base);
+
+  // the innermost frame binding of sym, invalidated by any push
+  const Value * find_local(const Atom & sym) const;
+
+  bool is_lambda(const Atom & sym) const;
+  bool is_proc(const Atom & sym) const;
+
+  // the lambda the name calls, or nullptr if it calls chunk.procs[name]
+  const Expression * callee(const Chunk & chunk, std::uint32_t name) const;
+
+  void call(const Chunk & chunk, std::uint32_t name, std::size_t argc);
+  void call_lambda(const Expression & lambda, std::size_t argc);
+  // call lambda, already checked for argc, by its chunk or tree-walked if null
+  void invoke(const Expression & lambda, const Chunk * body, std::size_t argc);
+  std::shared_ptr<const Chunk> compiled(const Expression & lambda);
+
+  // compute op on the top argc values in place, false if they are not all
+  // real numbers or the call must be made as the procedure would be
+  bool arithmetic(OpCode op, std::size_t argc);
+
+  void push_frame(const Chunk * chunk, std::size_t base);
+  void pop_frame();
+
+  // the innermost of the first count frames, as a chain of Environments
+  const Environment & materialize(std::size_t count);
+
+  Environment * env = nullptr;
+  std::vector<Value> stack;
+  std::vector<Frame> frames;
+  // the frames whose parameters hide built-in procedures
+  std::size_t shadowing = 0;
+
+  // keyed by the address of the lambda body, which the kept lambda keeps alive
+  std::unordered_map<const Expression *, std::pair<Expression, std::shared_ptr<const Chunk>>> lambdas;
+};
+
+#endif